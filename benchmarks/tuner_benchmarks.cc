@@ -0,0 +1,335 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file benchmarks the host-side performance of the tuner itself: the configuration space, the
+// steps of the search methods, the training and prediction of the machine learning models, and the
+// number of configurations tuned per second on a trivial kernel. The results are written to a file
+// with one benchmark per line. Given the file of an earlier run as a baseline, benchmarks which got
+// slower than the tolerance (a factor, 1.25 by default) are reported and the program returns 1.
+//
+// Usage: tuner_benchmarks [output.csv] [baseline.csv] [tolerance]
+//
+// =================================================================================================
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <fstream>
+
+// Includes the tuner library and its internals
+#include "cltune.h"
+#include "internal/kernel_info.h"
+#include "internal/searchers/full_search.h"
+#include "internal/searchers/random_search.h"
+#include "internal/searchers/annealing.h"
+#include "internal/searchers/pso.h"
+#include "internal/searchers/bayesian.h"
+#include "internal/ml_models/linear_regression.h"
+#include "internal/ml_models/neural_network.h"
+
+// Settings (platform 0, device 0)
+const auto kPlatformID = size_t{0};
+const auto kDeviceID = size_t{0};
+const auto kRepetitions = size_t{3};
+const auto kDefaultTolerance = 1.25;
+const auto kNumFeatures = size_t{8}; // for the machine learning models
+
+// Keeps the results of the benchmarked code alive, such that it is not optimised away
+volatile double benchmark_sink = 0.0;
+
+// =================================================================================================
+
+// A benchmark result: the total time of all iterations in milliseconds (the fastest repetition)
+struct Result {
+  std::string name;
+  size_t size;
+  size_t iterations;
+  double time_ms;
+};
+
+// Runs the function a number of times and returns the fastest time in milliseconds
+double Measure(const std::function<void()> &function, const size_t repetitions) {
+  auto best = 0.0;
+  for (auto r=size_t{0}; r<repetitions; ++r) {
+    const auto start_time = std::chrono::steady_clock::now();
+    function();
+    const auto elapsed = std::chrono::steady_clock::now() - start_time;
+    const auto time_ms = std::chrono::duration<double,std::milli>(elapsed).count();
+    best = (r == 0) ? time_ms : std::min(best, time_ms);
+  }
+  return best;
+}
+
+// Prints a result as it comes in
+void Report(std::vector<Result> &results, const Result &result) {
+  fprintf(stdout, "[ BENCHMARK ] %-26s %10zu %12.3lf ms %14.1lf /s\n", result.name.c_str(),
+          result.size, result.time_ms, 1000.0 * result.iterations / result.time_ms);
+  results.push_back(result);
+}
+
+// =================================================================================================
+
+// Creates a synthetic configuration space of 10^num_parameters points. A constraint rejects about
+// a third of them.
+cltune::KernelInfo SyntheticKernel(const size_t num_parameters, const cltune::Device &device) {
+  auto kernel = cltune::KernelInfo("synthetic", "", device);
+  kernel.set_global_base({1024});
+  kernel.set_local_base({1});
+  for (auto p=size_t{0}; p<num_parameters; ++p) {
+    kernel.AddParameter("P"+std::to_string(p), {1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
+  }
+  kernel.AddConstraint([] (std::vector<size_t> v) { return (v[0] * v[1]) % 3 != 0; },
+                       {"P0", "P1"});
+  return kernel;
+}
+
+// A synthetic execution time with a single optimum, such that the searchers have a landscape
+double SyntheticTime(const cltune::KernelInfo &kernel, const size_t index) {
+  auto time = 1.0;
+  for (auto &value: kernel.GetValues(index)) {
+    time += (static_cast<double>(value) - 4.0) * (static_cast<double>(value) - 4.0);
+  }
+  return time;
+}
+
+// Constructing and scanning the configuration space: this is where the tuner spends its time
+// before the search starts, and for each scan over the valid configurations (e.g. for prediction)
+void BenchmarkSpace(const cltune::Device &device, std::vector<Result> &results) {
+  for (auto num_parameters=size_t{3}; num_parameters<=7; ++num_parameters) {
+    auto num_raw = size_t{1};
+    for (auto p=size_t{0}; p<num_parameters; ++p) { num_raw *= 10; }
+    const auto build_time = Measure([&] () {
+      benchmark_sink = SyntheticKernel(num_parameters, device).NumRawConfigurations();
+    }, kRepetitions);
+    Report(results, Result{"space/build", num_raw, 1, build_time});
+
+    const auto kernel = SyntheticKernel(num_parameters, device);
+    const auto scan_time = Measure([&] () {
+      auto num_valid = size_t{0};
+      for (auto index=size_t{0}; index<num_raw; ++index) {
+        if (kernel.IsValidConfiguration(index)) { ++num_valid; }
+      }
+      benchmark_sink = num_valid;
+    }, kRepetitions);
+    Report(results, Result{"space/scan", num_raw, num_raw, scan_time});
+  }
+}
+
+// The host-side cost of the search methods: their construction followed by a fixed number of steps
+// (handing out a configuration and processing its result)
+void BenchmarkSearchers(const cltune::Device &device, std::vector<Result> &results) {
+  const auto kNumParameters = size_t{5};
+  const auto kMaxSteps = size_t{1000};
+  const auto kernel = SyntheticKernel(kNumParameters, device);
+  const auto seed = 42U;
+  const auto fraction = 0.02; // 2000 out of 10^5 configurations (about 1333 valid ones)
+  const auto searchers = std::vector<std::pair<std::string,
+                                               std::function<cltune::Searcher*()>>>{
+    {"search/full", [&] () { return new cltune::FullSearch{kernel, seed}; }},
+    {"search/random", [&] () { return new cltune::RandomSearch{kernel, fraction, seed}; }},
+    {"search/annealing", [&] () { return new cltune::Annealing{kernel, fraction, 4.0, 1, seed}; }},
+    {"search/pso", [&] () { return new cltune::PSO{kernel, fraction, 4, 0.4, 0.0, 0.4, seed}; }},
+    {"search/bayesian", [&] () { return new cltune::Bayesian{kernel, fraction, seed}; }}
+  };
+  for (auto &searcher: searchers) {
+    auto num_steps = size_t{0};
+    const auto time = Measure([&] () {
+      auto search = std::unique_ptr<cltune::Searcher>(searcher.second());
+      num_steps = 0;
+      while (num_steps < kMaxSteps) {
+        const auto indices = search->RequestConfigurations(1);
+        if (indices.empty()) { break; }
+        search->ReportResults(indices, {SyntheticTime(kernel, indices[0])});
+        ++num_steps;
+      }
+    }, kRepetitions);
+    Report(results, Result{searcher.first, kernel.NumRawConfigurations(), num_steps, time});
+  }
+}
+
+// Training and prediction of the models used by 'ModelPrediction' and 'UseModelPruning' for an
+// increasing number of training samples
+void BenchmarkModels(std::vector<Result> &results) {
+  const auto kNumPredictions = size_t{100000};
+  auto generator = std::default_random_engine(42);
+  auto distribution = std::uniform_real_distribution<float>(1.0f, 10.0f);
+  const auto sample = [&] () {
+    auto x = std::vector<float>(kNumFeatures);
+    for (auto &feature: x) { feature = distribution(generator); }
+    return x;
+  };
+  const auto target = [] (const std::vector<float> &x) {
+    auto y = 1.0f;
+    for (auto &feature: x) { y += (feature - 4.0f) * (feature - 4.0f); }
+    return y;
+  };
+  auto x_predict = cltune::Matrix<float>(kNumPredictions, kNumFeatures);
+  for (auto m=size_t{0}; m<kNumPredictions; ++m) {
+    const auto x = sample();
+    std::copy(x.begin(), x.end(), x_predict[m]);
+  }
+
+  for (auto num_samples: {size_t{100}, size_t{1000}, size_t{10000}}) {
+    auto x_train = std::vector<std::vector<float>>();
+    auto y_train = std::vector<float>();
+    for (auto m=size_t{0}; m<num_samples; ++m) {
+      x_train.push_back(sample());
+      y_train.push_back(target(x_train.back()));
+    }
+    const auto models = std::vector<std::pair<std::string,
+                                              std::function<cltune::MLModel<float>*()>>>{
+      {"model/linear_regression", [] () {
+        return new cltune::LinearRegression<float>(400, 0.05f, 0.2f, false,
+                                                   cltune::Optimizer::kAdam);
+      }},
+      {"model/neural_network", [] () {
+        return new cltune::NeuralNetwork<float>(400, 0.05f, 0.005f, {kNumFeatures, 20, 1}, false,
+                                                cltune::Optimizer::kAdam);
+      }}
+    };
+    for (auto &model_creator: models) {
+      auto model = std::unique_ptr<cltune::MLModel<float>>();
+      const auto train_time = Measure([&] () {
+        model.reset(model_creator.second());
+        model->Train(x_train, y_train);
+      }, kRepetitions);
+      Report(results, Result{model_creator.first+"/train", num_samples, num_samples, train_time});
+      const auto predict_time = Measure([&] () {
+        benchmark_sink = model->PredictBatch(x_predict)[0];
+      }, kRepetitions);
+      Report(results, Result{model_creator.first+"/predict", num_samples, kNumPredictions,
+                             predict_time});
+    }
+  }
+}
+
+// =================================================================================================
+
+// The end-to-end throughput of the tuner on a trivial kernel, which runs for only microseconds.
+// Without the 'VARIANT' parameter in the source, all configurations share a single program and the
+// tuner's own overhead dominates. With it, each configuration is compiled as well.
+void BenchmarkTuning(std::vector<Result> &results) {
+  #ifdef USE_OPENCL
+    const auto source = std::string{
+      "__kernel void copy(const int n, const __global float* a, __global float* b) {\n"
+      "  const int i = get_global_id(0);\n"
+      "  if (i < n) { b[i] = a[i] * SCALE; }\n"
+      "}\n"};
+  #else
+    const auto source = std::string{
+      "extern \"C\" __global__ void copy(const int n, const float* a, float* b) {\n"
+      "  const int i = blockIdx.x*blockDim.x + threadIdx.x;\n"
+      "  if (i < n) { b[i] = a[i] * SCALE; }\n"
+      "}\n"};
+  #endif
+  const auto kSize = size_t{64*1024};
+  const auto a = std::vector<float>(kSize, 1.0f);
+  const auto b = std::vector<float>(kSize, 0.0f);
+  const auto num_configurations = size_t{6 * 8};
+  for (auto compiled: {false, true}) {
+    const auto time = Measure([&] () {
+      cltune::Tuner tuner(kPlatformID, kDeviceID);
+      const auto kernel_source = (compiled) ? "#define SCALE (VARIANT)\n" + source :
+                                              "#define SCALE 2\n" + source;
+      const auto id = tuner.AddKernelFromString(kernel_source, "copy", {kSize}, {1});
+      tuner.AddParameter(id, "GROUP_SIZE", {16, 32, 64, 128, 256, 512});
+      tuner.AddParameter(id, "VARIANT", {1, 2, 3, 4, 5, 6, 7, 8});
+      tuner.MulLocalSize(id, {"GROUP_SIZE"});
+      tuner.AddArgumentScalar(static_cast<int>(kSize));
+      tuner.AddArgumentInput(a);
+      tuner.AddArgumentOutput(b);
+      tuner.SetNumRuns(1);
+      tuner.SuppressOutput();
+      tuner.Tune();
+    }, 1);
+    const auto name = std::string{(compiled) ? "tune/compiled" : "tune/cached"};
+    Report(results, Result{name, num_configurations, num_configurations, time});
+  }
+}
+
+// =================================================================================================
+
+// Writes the results with one benchmark per line, separated by semicolons
+void WriteResults(const std::string &filename, const std::vector<Result> &results) {
+  auto file = fopen(filename.c_str(), "w");
+  if (!file) { throw std::runtime_error("Unable to write '"+filename+"'"); }
+  fprintf(file, "name;size;iterations;time_ms;per_second\n");
+  for (auto &result: results) {
+    fprintf(file, "%s;%zu;%zu;%.6lf;%.3lf\n", result.name.c_str(), result.size,
+            result.iterations, result.time_ms, 1000.0 * result.iterations / result.time_ms);
+  }
+  fclose(file);
+}
+
+// Compares the results to those of an earlier run (matched by name and size) and returns the
+// number of regressions. Benchmarks which aren't in the baseline are ignored.
+size_t CompareResults(const std::string &filename, const std::vector<Result> &results,
+                      const double tolerance) {
+  std::ifstream file(filename);
+  if (file.fail()) { throw std::runtime_error("Unable to read baseline '"+filename+"'"); }
+  auto baseline = std::map<std::pair<std::string,size_t>, double>();
+  auto line = std::string{};
+  std::getline(file, line); // the header
+  while (std::getline(file, line)) {
+    const auto first = line.find(';');
+    const auto second = line.find(';', first + 1);
+    const auto third = line.find(';', second + 1);
+    if (third == std::string::npos) { continue; }
+    const auto size = static_cast<size_t>(std::strtoull(line.c_str() + first + 1, nullptr, 10));
+    const auto time_ms = std::strtod(line.c_str() + third + 1, nullptr);
+    baseline[{line.substr(0, first), size}] = time_ms;
+  }
+
+  auto num_regressions = size_t{0};
+  for (auto &result: results) {
+    const auto entry = baseline.find({result.name, result.size});
+    if (entry == baseline.end()) { continue; }
+    const auto ratio = result.time_ms / entry->second;
+    const auto regressed = (ratio > tolerance);
+    fprintf(stdout, "[ %-9s ] %-26s %10zu %12.3lf ms (baseline %.3lf ms, %.2lfx)\n",
+            (regressed) ? "SLOWER" : "OK", result.name.c_str(), result.size, result.time_ms,
+            entry->second, ratio);
+    if (regressed) { ++num_regressions; }
+  }
+  return num_regressions;
+}
+
+// =================================================================================================
+
+int main(int argc, char* argv[]) {
+  const auto output = std::string{(argc > 1) ? argv[1] : "tuner_benchmarks.csv"};
+  const auto tolerance = (argc > 3) ? std::strtod(argv[3], nullptr) : kDefaultTolerance;
+
+  // Runs all benchmarks: those of the tuner's internals only use the device for the kernel info
+  auto platform = cltune::Platform(kPlatformID);
+  auto device = cltune::Device(platform, kDeviceID);
+  auto results = std::vector<Result>();
+  BenchmarkSpace(device, results);
+  BenchmarkSearchers(device, results);
+  BenchmarkModels(results);
+  BenchmarkTuning(results);
+  WriteResults(output, results);
+
+  // Compares against the baseline (if given)
+  if (argc > 2) {
+    const auto num_regressions = CompareResults(argv[2], results, tolerance);
+    fprintf(stdout, "[ BENCHMARK ] %zu regression(s) beyond %.2lfx\n", num_regressions, tolerance);
+    if (num_regressions > 0) { return 1; }
+  }
+  return 0;
+}
+
+// =================================================================================================
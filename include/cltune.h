@@ -33,6 +33,9 @@
 #include <vector> // std::vector
 #include <memory> // std::unique_ptr
 #include <functional> // std::function
+#include <future> // std::shared_future
+#include <array> // std::array
+#include <algorithm> // std::copy
 #include <utility> // std::pair
 #include <unordered_map> // std::unordered_map
 
@@ -60,12 +63,137 @@ using StringRange = std::vector<std::string>;
 using ConstraintFunction = std::function<bool(std::vector<size_t>)>;
 using LocalMemoryFunction = std::function<size_t(std::vector<size_t>)>;
 
+// As above, but for a fixed number of parameters of which the values are passed as a pointer to an
+// array, such that they don't have to be copied into a newly allocated vector for each call
+using FixedConstraintFunction = std::function<bool(const size_t*)>;
+using FixedLocalMemoryFunction = std::function<size_t(const size_t*)>;
+
+// Creates the names of the parameters of a typed constraint or local memory function (see the
+// typed 'AddConstraint'), e.g. 'ParameterNames("MWG", "NWG")'. Their number is part of the type.
+template <typename... Names>
+std::array<std::string, sizeof...(Names)> ParameterNames(const Names&... names) {
+  return std::array<std::string, sizeof...(Names)>{{std::string(names)...}};
+}
+
 // Enumeration for search strategies
-enum class SearchMethod{FullSearch, RandomSearch, Annealing, PSO};
+enum class SearchMethod{FullSearch, RandomSearch, Annealing, PSO, Bayesian};
 
 // Machine learning models
 enum class Model { kLinearRegression, kNeuralNetwork };
 
+// Methods to measure the execution time of a kernel: device-side profiling events (default), the
+// host's wall-clock (including launch overhead), or both (ranking by the device-side time)
+enum class TimingMethod { kDeviceEvents, kHostClock, kBoth };
+
+// Returns the current power draw of the device in Watts, e.g. read through NVML or ROCm-SMI
+using PowerFunction = std::function<double()>;
+
+// What the search method minimises: the time (the default), the energy per run (which requires a
+// power sensor), or a weighted combination of both (see 'SetObjective')
+enum class Objective { kTime, kEnergy, kWeighted };
+
+// The names and values of the counters of a configuration (see 'UseCounters')
+using Counters = std::vector<std::pair<std::string,double>>;
+
+// User-supplied hooks around the timed runs of a configuration, e.g. to read hardware counters
+// through CUPTI or a vendor extension. 'start' is called with the name of the kernel before the
+// first timed run, 'stop' after the last one, returning the values of the counters. Either can be
+// empty.
+struct CounterHooks {
+  std::function<void(const std::string&)> start;
+  std::function<Counters()> stop;
+};
+
+// Ways to pass the value of a tuning parameter to a kernel: as a define in the source-code (the
+// default, compiled for each value) or as a scalar kernel argument of type 'int' (see
+// 'AddArgumentParameter'), such that a single program covers all values of the parameter
+enum class ParameterMode { kDefine, kArgument };
+
+// Statistics to summarise the repeated time measurements of a single configuration
+enum class Statistic { kMinimum, kMedian, kMean, kTrimmedMean };
+
+// The policy for repeated time measurements of a single configuration. After the warm-up runs
+// (which are not used), the kernel is run at least 'min_runs' and at most 'max_runs' times. In
+// between, measuring stops as soon as the 95% confidence interval of the mean is within the target
+// fraction of the mean (a target of 0 always performs 'max_runs' runs).
+struct MeasurementPolicy {
+  size_t num_warmup_runs;
+  size_t min_runs;
+  size_t max_runs;
+  double target_relative_ci;
+  Statistic statistic;
+  double trimmed_fraction; // fraction of samples discarded at both ends for the trimmed mean
+};
+
+// Metrics to compare an output buffer against the output of the reference kernel: the sum of the
+// absolute differences (the default), the L2 norm of the differences relative to the L2 norm of the
+// reference, the maximum absolute difference, the maximum distance in units in the last place
+// (ULPs) of the data-type, or a user-supplied function
+enum class VerificationMetric { kAbsoluteSum, kRelativeL2, kMaxAbsolute, kMaxULP, kCustom };
+
+// A user-supplied comparison, given the (sampled) reference and output values converted to doubles
+// (complex values as their real and imaginary parts). Returns whether the output is correct.
+using VerificationFunction = std::function<bool(const std::vector<double>&,
+                                                const std::vector<double>&)>;
+
+// The verification of a single output buffer: the output is correct if the value of the metric is
+// at most the tolerance. If 'num_samples' is non-zero, only about that many elements are compared,
+// spread out over the buffer in small contiguous blocks. The function is only used for kCustom.
+struct Verification {
+  VerificationMetric metric;
+  double tolerance;
+  size_t num_samples;
+  VerificationFunction function;
+};
+
+// A problem size of a multi-size sweep (see 'TuneSizes'): the base global range of all kernels
+// (including the reference), the values of the scalar arguments in the order in which they were
+// added (complex scalars take the value as their real part), and the number of elements of the
+// buffer arguments in the order in which they were added. Empty fields keep the values as given.
+struct ProblemSize {
+  IntRange global;
+  std::vector<double> scalars;
+  std::vector<size_t> buffer_sizes;
+};
+
+// The progress of a tuning run started with 'TuneAsync', passed to its callback after each explored
+// configuration: the kernel, the parameters of the configuration and its time in milliseconds (the
+// maximum float value if it failed), whether it passed the verification, the number of explored
+// configurations of the kernel out of the number it is going to explore, and the parameters and
+// time of the best result of the kernel so far (empty parameters if there is none yet).
+struct TuningProgress {
+  std::string kernel_name;
+  std::unordered_map<std::string, size_t> parameters;
+  float time;
+  bool status;
+  size_t num_explored;
+  size_t num_configurations;
+  std::unordered_map<std::string, size_t> best_parameters;
+  float best_time;
+};
+using ProgressFunction = std::function<void(const TuningProgress&)>;
+
+// A tuning run in the background, as returned by 'TuneAsync'. Destroying the last copy of a handle
+// waits for the run to finish.
+class TuningHandle {
+ public:
+  PUBLIC_API TuningHandle(std::shared_future<void> done, std::function<void()> cancel);
+
+  // Asks the run to stop once the configurations which are being run are done. The run then ends
+  // as usual: the results so far are stored and can be retrieved and printed through the tuner.
+  void PUBLIC_API Cancel();
+
+  // Whether the run is done, without waiting for it
+  bool PUBLIC_API IsDone() const;
+
+  // Waits for the run to finish. An exception thrown by the run (or by the callback) is re-thrown.
+  void PUBLIC_API Wait() const;
+
+ private:
+  std::shared_future<void> done_;
+  std::function<void()> cancel_;
+};
+
 // The tuner class and its public API
 class Tuner {
  public:
@@ -73,6 +201,16 @@ class Tuner {
   // Initializes the tuner either with platform 0 and device 0 or with a custom platform/device
   explicit PUBLIC_API Tuner();
   explicit PUBLIC_API Tuner(size_t platform_id, size_t device_id);
+
+  // Initializes the tuner on multiple devices, given as a list of platform/device pairs. The first
+  // device is the main device; the others run upcoming configurations in parallel while tuning.
+  explicit PUBLIC_API Tuner(const std::vector<std::pair<size_t,size_t>> &devices);
+
+  // Initializes the tuner on a custom platform/device, re-using an existing context of the
+  // application: an OpenCL 'cl_context' or a CUDA 'CUcontext' (not released by the tuner). This is
+  // needed to use the application's device buffers as kernel arguments.
+  template <typename ContextHandle>
+  explicit Tuner(size_t platform_id, size_t device_id, ContextHandle context);
   PUBLIC_API ~Tuner();
 
   // Adds a new kernel to the list of tuning-kernels and returns a unique ID (to be used when
@@ -92,12 +230,14 @@ class Tuner {
                                          const IntRange &global, const IntRange &local);
 
   // Adds a new tuning parameter for a kernel with a specific ID. The parameter has a name, the
-  // number of values, and a list of values.
+  // number of values, and a list of values. The mode selects how its value is passed to the kernel.
   void PUBLIC_API AddParameter(const size_t id, const std::string &parameter_name,
-                               const std::vector<size_t> &values);
+                               const std::vector<size_t> &values,
+                               const ParameterMode mode = ParameterMode::kDefine);
 
   // As above, but now adds a single valued parameter to the reference
-  void PUBLIC_API AddParameterReference(const std::string &parameter_name, const size_t value);
+  void PUBLIC_API AddParameterReference(const std::string &parameter_name, const size_t value,
+                                        const ParameterMode mode = ParameterMode::kDefine);
 
   // Modifies the global or local thread-size (integers) by one of the parameters (strings). The
   // modifier can be multiplication or division.
@@ -118,19 +258,87 @@ class Tuner {
   void PUBLIC_API SetLocalMemoryUsage(const size_t id, LocalMemoryFunction amount,
                                       const std::vector<std::string> &parameters);
 
+  // Typed versions of the above for a fixed number of parameters, given as 'ParameterNames', e.g.
+  // 'AddConstraint(id, [] (const std::array<size_t,2> &v) { return v[0] <= v[1]; },
+  // ParameterNames("MWG", "NWG"))'. The function object takes the values in a 'std::array' of the
+  // same size: it is inlined into the check, which allocates no memory.
+  template <size_t N, typename Function>
+  void AddConstraint(const size_t id, Function valid_if,
+                     const std::array<std::string,N> &parameters) {
+    AddFixedConstraint(id, [valid_if] (const size_t *values) -> bool {
+      auto array = std::array<size_t,N>();
+      std::copy(values, values + N, array.begin());
+      return valid_if(array);
+    }, StringRange(parameters.begin(), parameters.end()));
+  }
+  template <size_t N, typename Function>
+  void SetLocalMemoryUsage(const size_t id, Function amount,
+                           const std::array<std::string,N> &parameters) {
+    SetFixedLocalMemoryUsage(id, [amount] (const size_t *values) -> size_t {
+      auto array = std::array<size_t,N>();
+      std::copy(values, values + N, array.begin());
+      return amount(array);
+    }, StringRange(parameters.begin(), parameters.end()));
+  }
+
+  // The basis of all of the above: the function objects take the values of the parameters (in the
+  // given order) as a pointer to an array
+  void PUBLIC_API AddFixedConstraint(const size_t id, FixedConstraintFunction valid_if,
+                                     const std::vector<std::string> &parameters);
+  void PUBLIC_API SetFixedLocalMemoryUsage(const size_t id, FixedLocalMemoryFunction amount,
+                                           const std::vector<std::string> &parameters);
+
+  // Combines kernels into a pipeline which is tuned as a whole and returns its ID. Each
+  // configuration launches the kernels one after another, and its time is their total time. The
+  // parameters of the kernels become those of the pipeline; more parameters and constraints (also
+  // spanning several kernels) can be added to its ID. For each kernel, 'arguments' lists the
+  // positions (in the order in which they were added) of the arguments it is launched with, or is
+  // empty to pass all arguments. The kernels themselves are no longer tuned on their own.
+  size_t PUBLIC_API AddPipeline(const std::string &pipeline_name, const std::vector<size_t> &ids,
+                                const std::vector<std::vector<size_t>> &arguments);
+
   // Functions to add kernel-arguments for input buffers, output buffers, and scalars. Make sure to
   // call these in the order in which the arguments appear in the kernel.
   template <typename T> void AddArgumentInput(const std::vector<T> &source);
-  template <typename T> void AddArgumentOutput(const std::vector<T> &source);
+  template <typename T> void AddArgumentOutput(const std::vector<T> &source,
+                                               const Verification &verification = Verification{
+                                               VerificationMetric::kAbsoluteSum, 1e-4, 0, nullptr});
+
+  // As above, but for buffers which already live on the device: an OpenCL 'cl_mem' or a CUDA
+  // 'CUdeviceptr' holding 'size' elements. These are used as-is, without copying or taking
+  // ownership, and must belong to the context given to the constructor. Output buffers are still
+  // copied before each run, such that the application's data is never overwritten.
+  template <typename T, typename BufferHandle>
+  void AddArgumentInput(const BufferHandle buffer, const size_t size);
+  template <typename T, typename BufferHandle>
+  void AddArgumentOutput(const BufferHandle buffer, const size_t size,
+                         const Verification &verification = Verification{
+                         VerificationMetric::kAbsoluteSum, 1e-4, 0, nullptr});
+
+  // As above, but for output buffers which the kernel completely overwrites without reading them.
+  // These are not restored to their original contents before each run.
+  template <typename T> void AddArgumentOutputOnly(const std::vector<T> &source,
+                                                   const Verification &verification = Verification{
+                                                   VerificationMetric::kAbsoluteSum, 1e-4, 0, nullptr});
   template <typename T> void AddArgumentScalar(const T argument);
 
+  // Adds a device buffer of 'size' elements, which is only used to pass data between the kernels
+  // of a pipeline. It is initialised to zero once, and is neither restored nor verified.
+  template <typename T> void AddArgumentIntermediate(const size_t size);
+
+  // Adds a scalar kernel argument (of type 'int') which takes the value of a tuning parameter in
+  // 'ParameterMode::kArgument' mode. Every kernel (including the reference) has to have it.
+  void PUBLIC_API AddArgumentParameter(const std::string &parameter_name);
+
   // Configures a specific search method. The default search method is "FullSearch". These are
   // implemented as separate functions since they each take a different number of arguments.
   void PUBLIC_API UseFullSearch();
   void PUBLIC_API UseRandomSearch(const double fraction);
-  void PUBLIC_API UseAnnealing(const double fraction, const double max_temperature);
+  void PUBLIC_API UseAnnealing(const double fraction, const double max_temperature,
+                               const size_t num_chains = 1);
   void PUBLIC_API UsePSO(const double fraction, const size_t swarm_size, const double influence_global,
                          const double influence_local, const double influence_random);
+  void PUBLIC_API UseBayesian(const double fraction);
 
   // Outputs the search process to a file
   void PUBLIC_API OutputSearchLog(const std::string &filename);
@@ -139,6 +347,42 @@ class Tuner {
   // parameters. Note that this might take a while.
   void PUBLIC_API Tune();
 
+  // As 'Tune', but for multiple problem sizes at once: each configuration is compiled once and then
+  // run for each of the sizes. Buffers which are too small for a size are grown once up-front,
+  // repeating their contents. The search is guided by the geometric mean of the times over all
+  // sizes. The results are kept per size (see 'GetSweepResult') instead of with those of 'Tune'.
+  void PUBLIC_API TuneSizes(const std::vector<ProblemSize> &sizes);
+
+  // As 'Tune', but runs on a separate thread and returns right away. The callback (if any) is
+  // called on that thread after each explored configuration (see the TuningProgress struct). With a
+  // time budget in milliseconds, no more configurations are started once it is used up (0 for
+  // none). The tuner can't be used otherwise until the run is done.
+  TuningHandle PUBLIC_API TuneAsync(ProgressFunction callback = nullptr,
+                                    const double time_budget_ms = 0.0);
+
+  // Retrieves the parameters of the best result of a problem size (by its position) of the sweep
+  std::unordered_map<std::string, size_t> PUBLIC_API GetSweepResult(const size_t size_id) const;
+
+  // Records every result in the given journal file as soon as it is measured, such that an
+  // interrupted tuning run can later be continued with 'Resume'. An existing file is overwritten.
+  void PUBLIC_API UseJournal(const std::string &filename);
+
+  // Continues an interrupted tuning run: as 'Tune', but configurations found in the journal are not
+  // run again. This requires the same kernels, parameters, and search method as the original run.
+  // New results are appended to the journal. Without an existing journal, this simply starts one.
+  void PUBLIC_API Resume(const std::string &filename);
+
+  // Keeps the best result of each kernel in the given database file, under the name of the kernel,
+  // the device, and the problem size (the base global range). The file is created if needed. Each
+  // search then starts at the best stored results of the kernel (preferring those of this device
+  // and problem size), and the best results of a tuning run are added to the database afterwards.
+  void PUBLIC_API UseDatabase(const std::string &filename);
+
+  // Retrieves the parameters of the best stored result of a kernel on this device for its problem
+  // size, without tuning. Requires 'UseDatabase'. Returns an empty map if there is no such result.
+  // Applications can also select results without a tuner: see the Dispatcher (cltune_dispatch.h).
+  std::unordered_map<std::string, size_t> PUBLIC_API GetDatabaseResult(const size_t id) const;
+
   // Trains a machine learning model based on the search space explored so far. Then, all the
   // missing data-points are estimated based on this model. This is only useful if a fraction of
   // the search space is explored, as is the case when doing random-search.
@@ -156,12 +400,87 @@ class Tuner {
                             const std::vector<std::pair<std::string,std::string>> &descriptions) const;
   void PUBLIC_API PrintToFile(const std::string &filename) const;
 
+  // Prints the phases recorded since 'UseTracing' was called, either as a Chrome trace file (to be
+  // opened with chrome://tracing or Perfetto) or as a summary table per phase to stdout. Throws an
+  // exception of type std::runtime_error if tracing isn't enabled.
+  void PUBLIC_API PrintTrace(const std::string &filename) const;
+  void PUBLIC_API PrintTraceSummary() const;
+
   // Disables all further printing to stdout
   void PUBLIC_API SuppressOutput();
 
-  // Changes the number of times each kernel should be run. Used for averaging execution times.
+  // Changes the number of times each kernel should be run. Used for averaging execution times. This
+  // sets both the minimum and maximum number of runs of the measurement policy.
   void PUBLIC_API SetNumRuns(const size_t num_runs);
 
+  // Sets the full measurement policy (see the MeasurementPolicy structure above)
+  void PUBLIC_API SetMeasurementPolicy(const MeasurementPolicy &policy);
+
+  // Stops measuring a configuration as soon as one of its runs is slower than 'factor' times the
+  // best time found so far for the kernel. Such configurations are marked as pruned. The default of
+  // 0 disables pruning.
+  void PUBLIC_API SetPruningFactor(const double factor);
+
+  // Skips configurations before compiling them if a machine learning model predicts them to be more
+  // than 'margin' (e.g. 0.5 for 50%) slower than the best time found so far for the kernel. The
+  // model is first trained after 'num_warmup' successful results and retrained after each
+  // 'retrain_interval' new ones. Skipped configurations are reported with their predicted time and
+  // are marked as failed and pruned. A 'num_warmup' of 0 disables this (the default).
+  void PUBLIC_API UseModelPruning(const Model model_type, const size_t num_warmup,
+                                  const size_t retrain_interval, const double margin);
+
+  // Gives up on kernel runs which take longer than the timeout in milliseconds, or longer than the
+  // relative factor times the best time found so far for the kernel. Such configurations are
+  // reported as failed. Each of the timeouts is disabled by setting it to 0, which is the default.
+  void PUBLIC_API SetKernelTimeout(const double timeout_ms, const double relative_factor);
+
+  // Selects how the execution time of each kernel run is measured (see the TimingMethod enum)
+  void PUBLIC_API SetTimingMethod(const TimingMethod method);
+
+  // Reads the power draw of the device from the sensor every 'interval_ms' milliseconds while a
+  // configuration is being timed. The results then also hold the energy per run in millijoules.
+  void PUBLIC_API UsePowerSensor(PowerFunction sensor, const double interval_ms);
+
+  // Records counters for each configuration: the memory (and on CUDA the register) usage of the
+  // compiled kernel, followed by the counters returned by the hooks (see the CounterHooks struct)
+  void PUBLIC_API UseCounters(const CounterHooks &hooks);
+
+  // Records how long each phase of the tuner takes (e.g. compiling, copying the output buffers,
+  // launching, verifying, and the search method's bookkeeping) for each configuration, starting
+  // from now. See 'PrintTrace' and 'PrintTraceSummary' for the results.
+  void PUBLIC_API UseTracing();
+
+  // Selects what the search method minimises and which result is the best (see the Objective
+  // enum). The weighted objective is time^(1-w) * energy^w for an 'energy_weight' w in [0,1].
+  void PUBLIC_API SetObjective(const Objective objective, const double energy_weight);
+
+  // Sets the number of host threads which compile upcoming configurations in the background while
+  // the device is running the current one. The default of 0 compiles each kernel just before it
+  // is run.
+  void PUBLIC_API SetCompileThreads(const size_t num_threads);
+
+  // Stores compiled kernels in the given (existing) directory and re-uses them in later runs. Cached
+  // kernels are identified by their source, the build options, and the platform/device/driver.
+  void PUBLIC_API UseBinaryCache(const std::string &directory);
+
+  // Distributes the configurations over remote workers as well: 'Tune' waits for 'num_workers'
+  // workers to connect on the given TCP port before it starts running configurations
+  void PUBLIC_API UseDistributedWorkers(const size_t port, const size_t num_workers);
+
+  // Runs the configurations in a separate child process instead of in this process. A crash of the
+  // child (e.g. caused by an out-of-bounds write) or a configuration taking longer than the timeout
+  // in seconds (0 for none) marks the configuration as failed, after which a new child is started.
+  // The child is this program started again with the same arguments: it turns into a worker as
+  // soon as it constructs its first tuner (before setting up that tuner's device). Anything the
+  // program does before constructing its first tuner is thus also done by the child, which should
+  // be kept free of side effects. Only supported on Linux.
+  void PUBLIC_API UseIsolatedExecution(const double timeout_seconds);
+
+  // Turns this tuner into a remote worker: connects to a coordinator (a tuner which called
+  // 'UseDistributedWorkers'), receives the kernels and arguments from it, and runs the
+  // configurations it hands out on this tuner's device. Returns when the coordinator is done.
+  void PUBLIC_API RunWorker(const std::string &host, const size_t port);
+
  private:
 
   // This implements the pointer to implementation idiom (pimpl) and hides all private functions and
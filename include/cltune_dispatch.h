@@ -0,0 +1,101 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the externally visible Dispatcher class: the run-time counterpart of the
+// tuner. It is built from a tuning database (see 'Tuner::UseDatabase') and selects the parameters
+// of a kernel for a device and a problem size when the application launches it, without tuning
+// and without access to the tuner's device. Problem sizes which were not tuned for take the result
+// of the nearest tuned size. If the tuner used a binary cache, the dispatcher also refers to the
+// compiled program of the selected result, such that it can be loaded without compilation.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_CLTUNE_DISPATCH_H_
+#define CLTUNE_CLTUNE_DISPATCH_H_
+
+#include "cltune.h"
+
+#include <string> // std::string
+#include <vector> // std::vector
+#include <map> // std::map
+#include <utility> // std::pair
+#include <unordered_map> // std::unordered_map
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class Dispatcher {
+ public:
+
+  // The selection for a launch: the parameter values, the filename of the compiled program (empty
+  // if it wasn't cached while tuning), and whether it was tuned for exactly this device and size
+  struct Selection {
+    std::unordered_map<std::string, size_t> parameters;
+    std::string binary;
+    bool exact;
+  };
+
+  // Reads the results of a kernel from a tuning database (read-only). The filenames of the binaries
+  // are relative to the given directory, a copy of the tuner's binary cache. Throws an exception of
+  // type std::runtime_error if the database can't be read.
+  explicit PUBLIC_API Dispatcher(const std::string &database, const std::string &kernel_name,
+                                 const std::string &binary_directory);
+
+  // Selects the parameters for a device and a problem size (the base global range of the kernel).
+  // The results of the device itself are preferred, those of other devices are used otherwise.
+  // Within these, an exact match is taken if present, else the result of the nearest problem size
+  // with the same number of dimensions. Returns false if there is no such result at all.
+  bool PUBLIC_API Select(const std::string &device, const IntRange &problem,
+                         Selection &selection) const;
+
+  // Returns the number of results of the kernel
+  size_t NumResults() const { return results_.size(); }
+
+ private:
+
+  // Helper structure holding a result of the kernel
+  struct Result {
+    std::string device;
+    IntRange problem;
+    double time;
+    Selection selection;
+  };
+
+  // Parses a problem size as stored in the database (the dimensions joined by 'x')
+  static bool ParseProblem(const std::string &problem, IntRange &sizes);
+
+  // Computes the distance between two problem sizes (of the same dimensionality) on a logarithmic
+  // scale, such that e.g. 1024 is as close to 512 as it is to 2048
+  static double Distance(const IntRange &a, const IntRange &b);
+
+  // Member variables: all results and an index of the exact matches
+  std::vector<Result> results_;
+  std::map<std::pair<std::string, IntRange>, size_t> exact_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_CLTUNE_DISPATCH_H_
+#endif
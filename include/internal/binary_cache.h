@@ -0,0 +1,87 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the BinaryCache class, which stores compiled device programs (OpenCL binaries
+// or CUDA PTX) on disk, such that later tuning runs can skip compilation. Entries are identified by
+// a hash of the full source-string (including the parameter defines), the build options, and the
+// identity of the platform, device, and driver.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_BINARY_CACHE_H_
+#define CLTUNE_BINARY_CACHE_H_
+
+// Uses either the OpenCL or CUDA back-end (CLCudaAPI C++11 headers)
+#if USE_OPENCL
+  #include "internal/clpp11.h"
+#else
+  #include "internal/cupp11.h"
+#endif
+
+#include <string> // std::string
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class BinaryCache {
+ public:
+
+  // Initializes the cache in an existing directory for a specific platform and device
+  BinaryCache(const std::string &directory, const Platform &platform, const Device &device);
+
+  // Accessor to the cache directory
+  std::string directory() const { return directory_; }
+
+  // Computes the key of a program, based on its source, its build options, and the device
+  std::string Key(const std::string &source, const std::string &options) const;
+
+  // Retrieves the binary of a key from disk. Returns false if the binary is not in the cache.
+  bool Load(const std::string &key, std::string &binary) const;
+
+  // Stores a binary on disk. The binary is first written to a temporary file and then renamed, such
+  // that other threads or processes never read a partially written binary. Failures to write are
+  // ignored: the cache is only an optimisation.
+  void Store(const std::string &key, const std::string &binary) const;
+
+  // Returns the name of the file (without the directory) holding the binary of a key
+  static std::string Basename(const std::string &key);
+
+ private:
+
+  // Computes the 64-bit FNV-1a hash of a string and returns it as a hexadecimal string
+  static std::string Hash(const std::string &data);
+
+  // Returns the filename of the binary corresponding to a key
+  std::string Filename(const std::string &key) const;
+
+  // Member variables
+  std::string directory_;
+  std::string device_identity_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_BINARY_CACHE_H_
+#endif
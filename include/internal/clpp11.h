@@ -93,6 +93,14 @@ class Event {
     CheckError(clWaitForEvents(1, &(*event_)));
   }
 
+  // Checks without blocking whether the event's command has finished (or was aborted by an error)
+  bool IsComplete() const {
+    auto status = cl_int{CL_COMPLETE};
+    CheckError(clGetEventInfo(*event_, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int),
+                              &status, nullptr));
+    return status <= CL_COMPLETE;
+  }
+
   // Retrieves the elapsed time of the last recorded event. Note that no error checking is done on
   // the 'clGetEventProfilingInfo' function, since there is a bug in Apple's OpenCL implementation:
   // http://stackoverflow.com/questions/26145603/clgeteventprofilinginfo-bug-in-macosx
@@ -211,6 +219,7 @@ class Device {
   }
   std::string Vendor() const { return GetInfoString(CL_DEVICE_VENDOR); }
   std::string Name() const { return GetInfoString(CL_DEVICE_NAME); }
+  std::string DriverVersion() const { return GetInfoString(CL_DRIVER_VERSION); }
   std::string Type() const {
     auto type = GetInfo<cl_device_type>(CL_DEVICE_TYPE);
     switch(type) {
@@ -495,6 +504,11 @@ class Queue {
     CheckError(clFinish(*queue_));
   }
 
+  // Submits all queued commands to the device without waiting for them
+  void Flush() const {
+    CheckError(clFlush(*queue_));
+  }
+
   // Retrieves the corresponding context or device
   Context GetContext() const {
     auto bytes = size_t{0};
@@ -727,6 +741,30 @@ class Kernel {
     return static_cast<unsigned long>(result);
   }
 
+  // Retrieves the amount of private memory used per work-item for this kernel (including spills)
+  unsigned long PrivateMemUsage(const Device &device) const {
+    const auto bytes = sizeof(cl_ulong);
+    auto query = cl_kernel_work_group_info{CL_KERNEL_PRIVATE_MEM_SIZE};
+    auto result = cl_ulong{0};
+    CheckError(clGetKernelWorkGroupInfo(*kernel_, device(), query, bytes, &result, nullptr));
+    return static_cast<unsigned long>(result);
+  }
+
+  // Retrieves the maximum number of work-items per work-group with which this kernel can be
+  // launched, which can be lower than the device's maximum due to the kernel's resource usage
+  size_t MaxWorkGroupSize(const Device &device) const {
+    const auto bytes = sizeof(size_t);
+    auto query = cl_kernel_work_group_info{CL_KERNEL_WORK_GROUP_SIZE};
+    auto result = size_t{0};
+    CheckError(clGetKernelWorkGroupInfo(*kernel_, device(), query, bytes, &result, nullptr));
+    return result;
+  }
+
+  // Retrieves the number of registers used per work-item: not available in OpenCL
+  size_t NumRegisters() const {
+    return 0;
+  }
+
   // Retrieves the name of the kernel
   std::string GetFunctionName() const {
     auto bytes = size_t{0};
@@ -0,0 +1,99 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the CompilePool class, a pool of host worker threads which compiles device
+// programs in the background. The tuner hands it the sources of upcoming configurations, such that
+// these are compiled while the device is busy benchmarking the current configuration. Programs are
+// identified by their full source-string (including the parameter defines).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_COMPILE_POOL_H_
+#define CLTUNE_COMPILE_POOL_H_
+
+// Uses either the OpenCL or CUDA back-end (CLCudaAPI C++11 headers)
+#if USE_OPENCL
+  #include "internal/clpp11.h"
+#else
+  #include "internal/cupp11.h"
+#endif
+
+#include <string> // std::string
+#include <vector> // std::vector
+#include <deque> // std::deque
+#include <unordered_map> // std::unordered_map
+#include <functional> // std::function
+#include <thread> // std::thread
+#include <mutex> // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <future> // std::future, std::promise
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class CompilePool {
+ public:
+
+  // The function which turns a source-string into a compiled program. It reports failures by
+  // throwing an exception, which is passed on to the caller of 'Retrieve'.
+  using BuildFunction = std::function<Program(const std::string&)>;
+
+  // Starts the worker threads
+  CompilePool(BuildFunction build_function, const size_t num_threads);
+  ~CompilePool();
+
+  // Schedules a source for compilation. Sources which are already scheduled are ignored.
+  void Enqueue(const std::string &source);
+
+  // Returns the compiled program of a source, waiting for its compilation to finish. If the source
+  // was never scheduled, it is compiled directly on the calling thread. Compilation errors are
+  // re-thrown here.
+  Program Retrieve(const std::string &source);
+
+ private:
+
+  // Helper structure holding a single compilation job
+  struct Job {
+    std::string source;
+    std::promise<Program> promise;
+  };
+
+  // The loop executed by each of the worker threads
+  void WorkerLoop();
+
+  // Member variables
+  BuildFunction build_function_;
+  std::vector<std::thread> workers_;
+  std::deque<Job> jobs_;
+  std::unordered_map<std::string, std::future<Program>> programs_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_COMPILE_POOL_H_
+#endif
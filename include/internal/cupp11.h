@@ -97,6 +97,14 @@ class Event {
   // Waits for completion of this event (not implemented for CUDA)
   void WaitForCompletion() const { }
 
+  // Checks without blocking whether the event's command has finished
+  bool IsComplete() const {
+    const auto status = cuEventQuery(*end_);
+    if (status == CUDA_ERROR_NOT_READY) { return false; }
+    CheckError(status);
+    return true;
+  }
+
   // Retrieves the elapsed time of the last recorded event
   float GetElapsedTime() const {
     auto result = 0.0f;
@@ -172,6 +180,7 @@ class Device {
     CheckError(cuDriverGetVersion(&result));
     return static_cast<size_t>(result);
   }
+  std::string DriverVersion() const { return Version(); }
   std::string Vendor() const { return "NVIDIA Corporation"; }
   std::string Name() const {
     auto result = std::string{};
@@ -373,6 +382,9 @@ class Queue {
     CheckError(cuStreamSynchronize(*queue_));
   }
 
+  // Submits all queued commands to the device (CUDA streams already do so when they are queued)
+  void Flush() const { }
+
   // Retrieves the corresponding context or device
   Context GetContext() const { return context_; }
   Device GetDevice() const { return device_; }
@@ -381,8 +393,8 @@ class Queue {
   const CUstream& operator()() const { return *queue_; }
  private:
   std::shared_ptr<CUstream> queue_;
-  const Context context_;
-  const Device device_;
+  Context context_;
+  Device device_;
 };
 
 // =================================================================================================
@@ -593,6 +605,29 @@ class Kernel {
     return static_cast<unsigned long>(result);
   }
 
+  // Retrieves the amount of private memory used per thread for this kernel (including spills).
+  // Note that this is the local memory in CUDA terminology.
+  unsigned long PrivateMemUsage(const Device &) const {
+    auto result = 0;
+    CheckError(cuFuncGetAttribute(&result, CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES, kernel_));
+    return static_cast<unsigned long>(result);
+  }
+
+  // Retrieves the maximum number of threads per block with which this kernel can be launched,
+  // which can be lower than the device's maximum due to the kernel's register usage
+  size_t MaxWorkGroupSize(const Device &) const {
+    auto result = 0;
+    CheckError(cuFuncGetAttribute(&result, CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK, kernel_));
+    return static_cast<size_t>(result);
+  }
+
+  // Retrieves the number of registers used per thread
+  size_t NumRegisters() const {
+    auto result = 0;
+    CheckError(cuFuncGetAttribute(&result, CU_FUNC_ATTRIBUTE_NUM_REGS, kernel_));
+    return static_cast<size_t>(result);
+  }
+
   // Retrieves the name of the kernel
   std::string GetFunctionName() const {
     return std::string{"unknown"}; // Not implemented for the CUDA backend
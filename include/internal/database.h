@@ -0,0 +1,114 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the Database class, a persistent store of the best tuning result of each
+// kernel, keyed by the name of the kernel, the name of the device, and the problem size. Unlike the
+// journal, it outlives individual tuning runs: later runs are warm-started from the stored results
+// (also those of other devices and problem sizes), and applications can look up the best
+// parameters at start-up without tuning at all. The file is a plain text file to which improved
+// results are appended. It is read completely when it is opened, after which lookups are a search
+// in an ordered map. Each result can also refer to the compiled binary of its configuration in the
+// binary cache, such that it can be shipped with the application (see the Dispatcher class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_DATABASE_H_
+#define CLTUNE_DATABASE_H_
+
+#include <string> // std::string
+#include <vector> // std::vector
+#include <fstream> // std::ofstream
+#include <map> // std::map
+#include <tuple> // std::tuple
+#include <utility> // std::pair
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class Database {
+ public:
+
+  // Errors are reported as exceptions of this type
+  class Exception: public std::runtime_error {
+   public:
+    explicit Exception(const std::string &message): std::runtime_error(message) { }
+  };
+
+  // The parameter settings of a result, as pairs of names and values
+  using Parameters = std::vector<std::pair<std::string,size_t>>;
+
+  // A stored result. The kernel is part of the key and is therefore not repeated here. The binary
+  // is the filename of the compiled program in the binary cache, or empty if it wasn't cached.
+  struct Entry {
+    std::string device;
+    std::string problem;
+    double time;
+    Parameters parameters;
+    std::string binary;
+  };
+
+  // Opens a database, reading its entries first if the file exists. New entries are appended. A
+  // read-only database has to exist already and can't be stored to.
+  Database(const std::string &filename, const bool read_only);
+
+  // Retrieves the stored result of a kernel on a device for a problem size. Returns false if there
+  // is none.
+  bool Find(const std::string &kernel, const std::string &device, const std::string &problem,
+            Entry &entry) const;
+
+  // Retrieves all stored results of a kernel, the most relevant ones first: the exact match, then
+  // those of the same device (other problem sizes), then those of the same problem size (other
+  // devices), and then all others. Results within each group are ordered by their time.
+  std::vector<Entry> FindAll(const std::string &kernel, const std::string &device,
+                             const std::string &problem) const;
+
+  // Stores a result, unless a faster one is stored already. Returns whether it was stored.
+  bool Store(const std::string &kernel, const Entry &entry);
+
+  // Returns the number of stored results
+  size_t NumEntries() const { return entries_.size(); }
+
+ private:
+
+  // Reads all entries of an existing database. Later entries for the same key replace earlier ones
+  // if they are faster, lines which can't be parsed are skipped.
+  bool Read(const std::string &filename);
+
+  // Converts an entry into a line of the file and back. The fields are separated by tabs, since the
+  // names of kernels and devices can contain spaces. The binary is an optional last field.
+  static std::string ToLine(const std::string &kernel, const Entry &entry);
+  static bool FromLine(const std::string &line, std::string &kernel, Entry &entry);
+
+  // Member variables
+  std::ofstream file_;
+  bool read_only_;
+  std::map<std::tuple<std::string,std::string,std::string>, Entry> entries_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_DATABASE_H_
+#endif
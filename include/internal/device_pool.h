@@ -0,0 +1,161 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the DevicePool class template, a pool of host threads of which each drives one
+// additional device. The tuner hands it upcoming configurations (identified by their index in the
+// configuration space), which are run on whichever device is free. When the tuner arrives at a
+// configuration that no device has started yet, it takes the job back and runs it itself. The
+// implementation lives in this header since it is a class template.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_DEVICE_POOL_H_
+#define CLTUNE_DEVICE_POOL_H_
+
+#include <vector> // std::vector
+#include <deque> // std::deque
+#include <unordered_map> // std::unordered_map
+#include <functional> // std::function
+#include <thread> // std::thread
+#include <mutex> // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <future> // std::future, std::promise
+#include <utility> // std::move
+#include <exception> // std::current_exception
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+template <typename Result>
+class DevicePool {
+ public:
+
+  // A job receives the ID of the worker (device) on which it is executed
+  using Job = std::function<Result(const size_t worker_id)>;
+
+  // Starts one worker thread per device
+  explicit DevicePool(const size_t num_workers):
+      workers_(), jobs_(), results_(), mutex_(), condition_(), stop_(false),
+      retired_(num_workers, false) {
+    for (auto w=size_t{0}; w<num_workers; ++w) {
+      workers_.push_back(std::thread(&DevicePool::WorkerLoop, this, w));
+    }
+  }
+
+  // Signals the worker threads to stop and waits for them to finish their current job
+  ~DevicePool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    condition_.notify_all();
+    for (auto &worker: workers_) { worker.join(); }
+  }
+
+  // Schedules a job for a configuration index. Indices which are already scheduled are ignored.
+  void Enqueue(const size_t key, Job job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (results_.find(key) != results_.end()) { return; }
+      auto entry = Entry{key, std::move(job), std::promise<Result>()};
+      results_.emplace(key, entry.promise.get_future());
+      jobs_.push_back(std::move(entry));
+    }
+    condition_.notify_one();
+  }
+
+  // Takes a worker out of the pool, e.g. called by a job when its device failed: the worker then
+  // stops after its current job, such that the other workers take over the remaining jobs
+  void Retire(const size_t worker_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retired_[worker_id] = true;
+  }
+
+  // Returns the result of a configuration index, waiting for a device to finish it. If no device
+  // has started the job yet (or it was never scheduled), the given function is run instead on the
+  // calling thread. Exceptions thrown by a job are re-thrown here.
+  Result Retrieve(const size_t key, const std::function<Result()> &run_here) {
+    auto result = std::future<Result>();
+    auto found = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto entry = results_.find(key);
+      if (entry != results_.end()) {
+        result = std::move(entry->second);
+        results_.erase(entry);
+        found = true;
+        for (auto job=jobs_.begin(); job!=jobs_.end(); ++job) {
+          if (job->key == key) { jobs_.erase(job); found = false; break; }
+        }
+      }
+    }
+    if (!found) { return run_here(); }
+    return result.get();
+  }
+
+ private:
+
+  // Helper structure holding a single job and the promise of its result
+  struct Entry {
+    size_t key;
+    Job job;
+    std::promise<Result> promise;
+  };
+
+  // Repeatedly takes a job from the front of the queue and runs it on this worker's device
+  void WorkerLoop(const size_t worker_id) {
+    while (true) {
+      auto entry = Entry{};
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (retired_[worker_id]) { return; }
+        condition_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (stop_) { return; }
+        entry = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      try {
+        entry.promise.set_value(entry.job(worker_id));
+      }
+      catch (...) {
+        entry.promise.set_exception(std::current_exception());
+      }
+    }
+  }
+
+  // Member variables
+  std::vector<std::thread> workers_;
+  std::deque<Entry> jobs_;
+  std::unordered_map<size_t, std::future<Result>> results_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_;
+  std::vector<bool> retired_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_DEVICE_POOL_H_
+#endif
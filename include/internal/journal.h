@@ -0,0 +1,115 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the Journal class, an append-only text file which records every tuning result
+// as soon as it is measured. An interrupted tuning run can be resumed from its journal: the tuner
+// replays the search with the recorded random seed, taking the recorded results instead of running
+// the configurations again. Since the searchers are deterministic given their seed and the
+// execution times, this also restores their internal state (e.g. the PSO particles).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_JOURNAL_H_
+#define CLTUNE_JOURNAL_H_
+
+#include "cltune.h"
+#include "internal/measurement.h"
+
+#include <string> // std::string
+#include <fstream> // std::ofstream
+#include <map> // std::map
+#include <utility> // std::pair
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class Journal {
+ public:
+
+  // Errors are reported as exceptions of this type
+  class Exception: public std::runtime_error {
+   public:
+    explicit Exception(const std::string &message): std::runtime_error(message) { }
+  };
+
+  // A single recorded result, holding all fields of a tuning result except for its kernel name
+  struct Record {
+    size_t kernel_id;
+    size_t configuration_id;
+    float time;
+    size_t threads;
+    bool status;
+    TimingMethod timing_method;
+    float host_time;
+    SampleStatistics statistics;
+    bool pruned;
+    bool timed_out;
+    float energy;
+  };
+
+  // Opens a journal for writing. When resuming, the records of an existing journal are read first
+  // and new records are appended to it. Otherwise, any existing file is overwritten.
+  Journal(const std::string &filename, const bool resume);
+
+  // Starts the search of a kernel and returns the seed to use for it. If the kernel was already
+  // (partially) searched, the recorded seed is returned, else the given seed is recorded. The
+  // identity describes the kernel and the search: it has to match the recorded one.
+  unsigned int StartKernel(const size_t kernel_id, const std::string &identity,
+                           const unsigned int seed);
+
+  // Retrieves a recorded result. Returns false if the configuration was not measured before.
+  bool Find(const size_t kernel_id, const size_t configuration_id, Record &record) const;
+  bool Contains(const size_t kernel_id, const size_t configuration_id) const;
+
+  // Appends a record and flushes it to disk immediately, such that it survives a crash
+  void Append(const Record &record);
+
+  // Returns the number of records read when resuming
+  size_t NumResumedRecords() const { return num_resumed_records_; }
+
+ private:
+
+  // Reads all records of an existing journal. An incomplete last line (e.g. the process was killed
+  // while writing) is ignored. Returns false if there is no journal to resume from.
+  bool Read(const std::string &filename);
+
+  // Helper structure holding the recorded information of a kernel
+  struct KernelEntry {
+    std::string identity;
+    unsigned int seed;
+  };
+
+  // Member variables
+  std::ofstream file_;
+  std::map<size_t, KernelEntry> kernels_;
+  std::map<std::pair<size_t,size_t>, Record> records_;
+  size_t num_resumed_records_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_JOURNAL_H_
+#endif
@@ -36,6 +36,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <memory>
+#include <unordered_map>
 
 // Uses either the OpenCL or CUDA back-end (CLCudaAPI C++11 headers)
 #if USE_OPENCL
@@ -57,10 +58,11 @@ class KernelInfo {
   // Enumeration of modifiers to global/local thread-sizes
   enum class ThreadSizeModifierType { kGlobalMul, kGlobalDiv, kLocalMul, kLocalDiv };
 
-  // Helper structure holding a parameter name and a list of all values
+  // Helper structure holding a parameter name, a list of all values, and how it is passed
   struct Parameter {
     std::string name;
     std::vector<size_t> values;
+    ParameterMode mode;
   };
 
   // Helper structure holding a setting: a name and a value. Multiple settings combined make a
@@ -84,16 +86,26 @@ class KernelInfo {
   // Helper structure holding a constraint on parameters. This constraint consists of a constraint
   // function object and a vector of paramater names represented as strings.
   struct Constraint {
-    ConstraintFunction valid_if;
+    FixedConstraintFunction valid_if;
     std::vector<std::string> parameters;
   };
 
   // As above, but for local memory size.
   struct LocalMemory {
-    LocalMemoryFunction amount;
+    FixedLocalMemoryFunction amount;
     std::vector<std::string> parameters;
   };
 
+  // Helper structure holding a stage of a pipeline: a kernel which is part of the source-code of
+  // the pipeline, the positions (in the order in which they were added to the tuner) of the
+  // arguments it is launched with, and its global/local ranges for the current configuration
+  struct Stage {
+    std::shared_ptr<const KernelInfo> kernel;
+    std::vector<size_t> arguments;
+    IntRange global;
+    IntRange local;
+  };
+
   // Exception of the KernelInfo class
   class Exception : public std::runtime_error {
    public:
@@ -111,7 +123,10 @@ class KernelInfo {
   IntRange local_base() const { return local_base_; }
   IntRange global() const { return global_; }
   IntRange local() const { return local_; }
-  std::vector<Configuration> configurations() { return configurations_; }
+  std::vector<ThreadSizeModifier> thread_size_modifiers() const { return thread_size_modifiers_; }
+  Configuration arguments() const { return arguments_; }
+  std::vector<Stage> stages() const { return stages_; }
+  bool IsPipeline() const { return !stages_.empty(); }
 
   // Accessors (setters) - Note that these also pre-set the final global/local size
   void set_global_base(IntRange global) { global_base_ = global; global_ = global; }
@@ -121,11 +136,22 @@ class KernelInfo {
   void PUBLIC_API PrependSource(const std::string &extra_source);
 
   // Adds a new parameter with a name and a vector of possible values
-  void PUBLIC_API AddParameter(const std::string &name, const std::vector<size_t> &values);
+  void PUBLIC_API AddParameter(const std::string &name, const std::vector<size_t> &values,
+                               const ParameterMode mode = ParameterMode::kDefine);
 
   // Checks wheter a parameter exists, returns "true" if it does exist
   bool PUBLIC_API ParameterExists(const std::string parameter_name);
 
+  // Checks whether a parameter appears as an identifier in the source-code. Parameters which don't
+  // (e.g. those only used to modify the thread-sizes) don't need to be defined, such that
+  // configurations which only differ in such parameters share the same program. All parameters
+  // count as used in sources with an '#include' or token pasting ('##').
+  bool PUBLIC_API ParameterInSource(const std::string &parameter_name) const;
+
+  // Checks whether a parameter has to be added as a define to the source-code: this is not the case
+  // for unused parameters (see above) and for those passed as kernel arguments.
+  bool PUBLIC_API ParameterIsDefine(const std::string &parameter_name) const;
+
   // Specifies a modifier in the form of a StringRange to the global/local thread-sizes. This
   // modifier has to contain (per-dimension) the name of a single parameter or an empty string. The
   // supported modifiers are given by the ThreadSizeModifierType enumeration.
@@ -140,33 +166,107 @@ class KernelInfo {
   // As above, but for local memory usage
   void PUBLIC_API SetLocalMemoryUsage(LocalMemoryFunction amount, const std::vector<std::string> &parameters);
 
+  // As the above two, but the function objects take the values as a pointer to an array. These are
+  // stored as such: the two above wrap their function objects.
+  void PUBLIC_API AddFixedConstraint(FixedConstraintFunction valid_if,
+                                     const std::vector<std::string> &parameters);
+  void PUBLIC_API SetFixedLocalMemoryUsage(FixedLocalMemoryFunction amount,
+                                           const std::vector<std::string> &parameters);
+
+  // Adds a kernel as the next stage of this pipeline. The configuration space of the pipeline
+  // has to hold all parameters of the stage: its configurations are only valid if they are valid
+  // for each of the stages as well (their constraints, local memory usage, and thread-sizes).
+  void PUBLIC_API AddStage(const KernelInfo &kernel, const std::vector<size_t> &arguments);
+
   // Computes the global/local ranges (in NDRange-form) based on all global/local thread-sizes (in
   // StringRange-form) and a single permutation (i.e. a configuration) containing a list of all
-  // parameter names and their current values.
+  // parameter names and their current values. Also stores the settings of the parameters which are
+  // passed as kernel arguments (see 'arguments') and the ranges of the stages of a pipeline.
   void PUBLIC_API ComputeRanges(const Configuration &config);
 
-  // Computes all permutations based on the parameters and their values (the configuration list).
-  // The result is stored as a member variable.
-  void PUBLIC_API SetConfigurations();
-  
+  // The configuration space is never stored: each permutation of the parameter values is identified
+  // by an index in mixed-radix form, in which every parameter is a digit (the first parameter being
+  // the most significant one). Configurations are decoded on demand and the constraints are only
+  // checked when a particular index is visited. Note that not all indices are valid configurations.
+  size_t PUBLIC_API NumRawConfigurations() const;
+  Configuration PUBLIC_API GetConfiguration(const size_t index) const;
+  std::vector<size_t> PUBLIC_API GetValues(const size_t index) const;
+  bool PUBLIC_API IsValidConfiguration(const size_t index) const;
+
+  // Enumerates the valid configurations (in ascending order of their indices) or only counts them.
+  // Each constraint is checked as soon as all of its parameters have a value, such that a failing
+  // constraint prunes all permutations of the remaining parameters at once. The work is split over
+  // threads (0 selects the number of hardware threads) by the values of the outermost parameters,
+  // so the constraint and local memory functions have to be safe to call concurrently.
+  std::vector<size_t> PUBLIC_API ValidIndices(const size_t num_threads) const;
+  size_t PUBLIC_API NumValidConfigurations(const size_t num_threads) const;
+
+  // Conversions between an index and the per-parameter value indices (the digits in mixed-radix
+  // form). A configuration which is not part of the space results in 'NumRawConfigurations()'.
+  std::vector<size_t> PUBLIC_API ValueIndices(const size_t index) const;
+  size_t PUBLIC_API IndexFromValueIndices(const std::vector<size_t> &value_indices) const;
+  size_t PUBLIC_API IndexFromConfiguration(const Configuration &config) const;
+
  private:
-  // Called recursively internally by SetConfigurations 
-  void PopulateConfigurations(const size_t index, const Configuration &config);
+  // As ComputeRanges, but returns the results instead of storing them
+  void ComputeRanges(const Configuration &config, IntRange &global, IntRange &local) const;
 
   // Returns whether or not a given configuration is valid. This check is based on the user-supplied
   // constraints.
-  bool ValidConfiguration(const Configuration &config);
+  bool ValidConfiguration(const Configuration &config) const;
+
+  // As above, but for the values of all parameters (in the order in which they were added)
+  bool ValidValues(const std::vector<size_t> &values) const;
+
+  // Converts the parameter names of the constraints, the local memory usage, and the modifiers into
+  // positions in the list of parameters (see the member variables below)
+  void ResolveParameters();
+
+  // The checks making up 'ValidValues': a single constraint, the local memory usage, the local
+  // thread-sizes against the device limits, and the stages of a pipeline. Each of these (except
+  // for the stages) only reads the values of the parameters it depends on.
+  bool ValidConstraint(const size_t constraint_id, const std::vector<size_t> &values) const;
+  bool ValidLocalMemory(const std::vector<size_t> &values) const;
+  bool ValidThreadSizes(const std::vector<size_t> &values) const;
+  bool ValidStages(const std::vector<size_t> &values) const;
+  bool ValidCheck(const size_t check_id, const std::vector<size_t> &values) const;
+
+  // Enumerates the valid configurations of which the parameters before 'depth' have their values
+  // set (forming the 'index' so far). The checks are grouped by the deepest parameter they depend
+  // on. Valid indices are appended to 'valid' (if not a null-pointer) and counted.
+  void EnumerateValid(const std::vector<std::vector<size_t>> &checks, const size_t depth,
+                      const size_t index, std::vector<size_t> &values, std::vector<size_t> *valid,
+                      size_t &num_valid) const;
+  size_t EnumerateAllValid(const size_t num_threads, std::vector<size_t> *valid) const;
+
+  // Returns whether a name appears in the source-code as a whole identifier
+  bool IdentifierInSource(const std::string &name) const;
 
   // Member variables
   std::string name_;
   std::string source_;
   std::vector<Parameter> parameters_;
-  std::vector<Configuration> configurations_;
+  std::vector<std::unordered_map<size_t,size_t>> value_positions_; // per parameter: value to index
+  std::vector<bool> in_source_; // per parameter: whether it is used in the source-code
   std::vector<Constraint> constraints_;
   LocalMemory local_memory_;
 
+  // The parameter names of the above and of the modifiers resolved into positions in 'parameters_'
+  // once, such that checking a configuration requires no string comparisons. Unknown names have
+  // the position 'kUnknownParameter'.
+  static const size_t kUnknownParameter;
+  std::vector<std::vector<size_t>> constraint_positions_;
+  std::vector<size_t> local_memory_positions_;
+  std::vector<std::vector<size_t>> modifier_positions_; // per modifier: per dimension
+
   Device device_;
 
+  // Device limits, queried once because they are checked for every visited configuration
+  size_t max_work_group_size_;
+  size_t max_work_item_dimensions_;
+  std::vector<size_t> max_work_item_sizes_;
+  unsigned long local_mem_size_;
+
   // Global/local thread-sizes
   IntRange global_base_;
   IntRange local_base_;
@@ -175,6 +275,12 @@ class KernelInfo {
 
   // Multipliers and dividers for global/local thread-sizes
   std::vector<ThreadSizeModifier> thread_size_modifiers_;
+
+  // The settings of the parameters passed as kernel arguments, for the current configuration
+  Configuration arguments_;
+
+  // The kernels launched one after another if this is a pipeline (empty otherwise)
+  std::vector<Stage> stages_;
 };
 
 // =================================================================================================
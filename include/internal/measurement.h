@@ -0,0 +1,75 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the SampleStatistics structure and the functions to compute it. These are used
+// to summarise the repeated time measurements of a single configuration according to the tuner's
+// measurement policy.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_MEASUREMENT_H_
+#define CLTUNE_MEASUREMENT_H_
+
+#include "cltune.h"
+
+#include <vector> // std::vector
+#include <utility> // std::pair
+
+namespace cltune {
+// =================================================================================================
+
+// Summary of a set of time measurements (in milliseconds)
+struct SampleStatistics {
+  size_t num_samples;
+  double minimum;
+  double median;
+  double mean;
+  double trimmed_mean;
+  double standard_deviation;
+  double relative_ci; // half-width of the 95% confidence interval of the mean, relative to the mean
+};
+
+// Computes the statistics of a set of samples. The trimmed mean discards the given fraction of the
+// samples at both the bottom and the top. For less than two samples, the interval is set to zero.
+SampleStatistics ComputeStatistics(const std::vector<float> &samples,
+                                   const double trimmed_fraction);
+
+// Returns the value of the requested statistic
+double SelectStatistic(const SampleStatistics &statistics, const Statistic statistic);
+
+// Returns whether measuring can stop early, since even the fastest run so far is slower than the
+// pruning factor times the best time of the kernel. A factor of zero disables pruning, as does an
+// unknown best time (the maximum float).
+bool IsPruned(const SampleStatistics &statistics, const double pruning_factor,
+              const float best_time);
+
+// Returns the positions of the points on the Pareto front of two values which are both minimised
+// (e.g. the time and the energy): those for which no other point is at least as low in both values
+// and lower in one of them. The front is ordered by the first value; equal points appear once.
+std::vector<size_t> ParetoFront(const std::vector<std::pair<double,double>> &points);
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_MEASUREMENT_H_
+#endif
@@ -7,7 +7,8 @@
 //
 // This file contains a base class which implements machine learning models. Actual models are
 // derived from this class, such as linear regression or a neural network. This class contains
-// common functionality, such as gradient descent and feature normalization.
+// common functionality, such as the optimizers and feature normalization. The training data are
+// stored contiguously (one sample per row) and the samples are processed by multiple threads.
 //
 // -------------------------------------------------------------------------------------------------
 //
@@ -33,6 +34,7 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <cstddef>
 
 // For output formatting messages
 #include "internal/tuner_impl.h"
@@ -40,6 +42,36 @@
 namespace cltune {
 // =================================================================================================
 
+// The methods to minimize the cost-function of a model
+enum class Optimizer { kGradientDescent, kAdam };
+
+// A dense matrix stored contiguously in row-major order, holding one sample per row
+template <typename T>
+class Matrix {
+ public:
+  Matrix(const size_t rows, const size_t cols):
+      rows_(rows), cols_(cols), data_(rows*cols, static_cast<T>(0)) { }
+  explicit Matrix(const std::vector<std::vector<T>> &x):
+      Matrix(x.size(), (x.empty()) ? 0 : x[0].size()) {
+    for (auto mid=size_t{0}; mid<rows_; ++mid) {
+      for (auto nid=size_t{0}; nid<cols_; ++nid) { data_[mid*cols_ + nid] = x[mid][nid]; }
+    }
+  }
+
+  // Accessors to the sizes and to the start of a row
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  T* operator[](const size_t row) { return &data_[row*cols_]; }
+  const T* operator[](const size_t row) const { return &data_[row*cols_]; }
+
+ private:
+  size_t rows_;
+  size_t cols_;
+  std::vector<T> data_;
+};
+
+// =================================================================================================
+
 // See comment at top of file for a description of the class
 template <typename T>
 class MLModel {
@@ -47,9 +79,13 @@ class MLModel {
 
   // Constants
   static constexpr auto kGradientDescentCostReportAmount = 10;
+  static constexpr auto kMinSamplesPerThread = size_t{256};
+  static constexpr auto kAdamBeta1 = 0.9;
+  static constexpr auto kAdamBeta2 = 0.999;
+  static constexpr auto kAdamEpsilon = 1e-8;
 
   // Constructor
-  MLModel(const bool debug_display);
+  MLModel(const bool debug_display, const Optimizer optimizer);
 
   // Trains and validates the model
   virtual void Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) = 0;
@@ -58,6 +94,9 @@ class MLModel {
   // Pure virtual prediction function: predicts 'y' based on 'x' and the learning parameters 'theta'
   virtual T Predict(const std::vector<T> &x) const = 0;
 
+  // Predicts 'y' for each sample (row) of 'x' at once, spreading the samples over the threads
+  std::vector<T> PredictBatch(const Matrix<T> &x) const;
+
  protected:
   // Process the training data in various ways
   void ComputeNormalizations(const std::vector<std::vector<T>> &x);
@@ -66,27 +105,48 @@ class MLModel {
   void AddPolynomialRecursive(std::vector<T> &xi, const size_t order, const T value,
                               const size_t n) const;
 
-  // Methods to minimize an unconstrained function
-  void GradientDescent(const std::vector<std::vector<T>> &x, const std::vector<T> &y,
-                       const T alpha, const T lambda, const size_t iterations);
+  // Methods to minimize an unconstrained function: 'Optimize' runs the one set in the constructor.
+  // These initialize and update the learned weights 'theta_'.
+  void Optimize(const Matrix<T> &x, const std::vector<T> &y, const T alpha, const T lambda,
+                const size_t iterations);
+  void GradientDescent(const Matrix<T> &x, const std::vector<T> &y, const T alpha, const T lambda,
+                       const size_t iterations);
+  void Adam(const Matrix<T> &x, const std::vector<T> &y, const T alpha, const T lambda,
+            const size_t iterations);
+  void ReportCost(const size_t iteration, const size_t iterations, const T lambda,
+                  const Matrix<T> &x, const std::vector<T> &y) const;
 
   // Verification methods
-  float SuccessRate(const std::vector<std::vector<T>> &x, const std::vector<T> &y,
-                    const float margin) const;
-  float Verify(const std::vector<std::vector<T>> &x, const std::vector<T> &y) const;
+  float SuccessRate(const Matrix<T> &x, const std::vector<T> &y, const float margin) const;
+  float Verify(const Matrix<T> &x, const std::vector<T> &y) const;
+
+  // Splits the samples into chunks and calls 'function' with the chunk index and the begin and end
+  // samples of each chunk, each on its own thread. Small data-sets are processed as a single chunk.
+  size_t NumChunks(const size_t m) const;
+  void ForEachChunk(const size_t m,
+                    const std::function<void(const size_t, const size_t, const size_t)> &function)
+                    const;
+
+  // Helpers operating on contiguous data, written such that the compiler can vectorize them
+  static T Dot(const T *a, const T *b, const size_t n);
+  static void Axpy(const T alpha, const T *x, T *y, const size_t n);
 
   // Pre and post-processing of data
+  virtual void PreProcessFeatures(std::vector<std::vector<T>> &x) const = 0;
   virtual T PostProcessExecutionTime(T value) const = 0;
 
   // Pure virtual function for weights initialization
   virtual void InitializeTheta(const size_t n) = 0;
 
-  // Pure virtual hypothesis, cost and gradient functions: to be implemented by derived classes
-  virtual T Hypothesis(const std::vector<T> &x) const = 0;
-  virtual T Cost(const size_t m, const size_t n, const T lambda,
-                 const std::vector<std::vector<T>> &x, const std::vector<T> &y) const = 0;
-  virtual void Gradient(const size_t m, const size_t n, const T lambda, const T alpha,
-                        const std::vector<std::vector<T>> &x, const std::vector<T> &y) = 0;
+  // Pure virtual hypothesis, cost and gradient functions: to be implemented by derived classes. The
+  // hypothesis takes a single sample (a row of 'x'), the gradient is computed into 'gradient'.
+  virtual T Hypothesis(const T *x) const = 0;
+  virtual T Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const = 0;
+  virtual void Gradient(const T lambda, const Matrix<T> &x, const std::vector<T> &y,
+                        std::vector<T> &gradient) const = 0;
+
+  // The learned weights
+  std::vector<T> theta_;
 
   // Information for normalization
   std::vector<T> ranges_;
@@ -94,6 +154,8 @@ class MLModel {
 
   // Settings
   const bool debug_display_;
+  const Optimizer optimizer_;
+  const size_t num_threads_;
 };
 
 // =================================================================================================
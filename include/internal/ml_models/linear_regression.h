@@ -45,16 +45,22 @@ class LinearRegression: public MLModel<T> {
   using MLModel<T>::ComputeNormalizations;
   using MLModel<T>::NormalizeFeatures;
   using MLModel<T>::AddPolynomialFeatures;
-  using MLModel<T>::GradientDescent;
+  using MLModel<T>::Optimize;
   using MLModel<T>::Verify;
+  using MLModel<T>::NumChunks;
+  using MLModel<T>::ForEachChunk;
+  using MLModel<T>::Dot;
+  using MLModel<T>::Axpy;
 
   // Variables from the base class
   using MLModel<T>::means_;
   using MLModel<T>::ranges_;
+  using MLModel<T>::theta_;
+  using MLModel<T>::debug_display_;
 
   // Constructor
   LinearRegression(const size_t learning_iterations, const T learning_rate, const T lambda,
-                   const bool debug_display);
+                   const bool debug_display, const Optimizer optimizer);
 
   // Trains and validates the model
   virtual void Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
@@ -65,7 +71,7 @@ class LinearRegression: public MLModel<T> {
 
  private:
   // Pre and post-processing of data
-  void PreProcessFeatures(std::vector<std::vector<T>> &x) const;
+  virtual void PreProcessFeatures(std::vector<std::vector<T>> &x) const override;
   void PreProcessExecutionTimes(std::vector<T> &y) const;
   virtual T PostProcessExecutionTime(T value) const override;
 
@@ -73,14 +79,10 @@ class LinearRegression: public MLModel<T> {
   virtual void InitializeTheta(const size_t n) override;
 
   // Hypothesis, cost and gradient functions
-  virtual T Hypothesis(const std::vector<T> &x) const override;
-  virtual T Cost(const size_t m, const size_t n, const T lambda,
-                 const std::vector<std::vector<T>> &x, const std::vector<T> &y) const override;
-  virtual void Gradient(const size_t m, const size_t n, const T lambda, const T alpha,
-                        const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
-
-  // The learned weights
-  std::vector<T> theta_;
+  virtual T Hypothesis(const T *x) const override;
+  virtual T Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const override;
+  virtual void Gradient(const T lambda, const Matrix<T> &x, const std::vector<T> &y,
+                        std::vector<T> &gradient) const override;
 
   // Settings
   size_t learning_iterations_;
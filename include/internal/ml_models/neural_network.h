@@ -45,16 +45,23 @@ class NeuralNetwork: public MLModel<T> {
   using MLModel<T>::ComputeNormalizations;
   using MLModel<T>::NormalizeFeatures;
   using MLModel<T>::AddPolynomialFeatures;
-  using MLModel<T>::GradientDescent;
+  using MLModel<T>::Optimize;
   using MLModel<T>::Verify;
+  using MLModel<T>::NumChunks;
+  using MLModel<T>::ForEachChunk;
+  using MLModel<T>::Dot;
+  using MLModel<T>::Axpy;
 
   // Variables from the base class
   using MLModel<T>::means_;
   using MLModel<T>::ranges_;
+  using MLModel<T>::theta_;
+  using MLModel<T>::debug_display_;
 
   // Constructor
   NeuralNetwork(const size_t learning_iterations, const T learning_rate, const T lambda,
-                const std::vector<size_t> &layer_sizes, const bool debug_display);
+                const std::vector<size_t> &layer_sizes, const bool debug_display,
+                const Optimizer optimizer);
 
   // Trains and validates the model
   virtual void Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
@@ -65,7 +72,7 @@ class NeuralNetwork: public MLModel<T> {
 
  private:
   // Pre and post-processing of data
-  void PreProcessFeatures(std::vector<std::vector<T>> &x) const;
+  virtual void PreProcessFeatures(std::vector<std::vector<T>> &x) const override;
   void PreProcessExecutionTimes(std::vector<T> &y) const;
   virtual T PostProcessExecutionTime(T value) const override;
 
@@ -73,28 +80,25 @@ class NeuralNetwork: public MLModel<T> {
   virtual void InitializeTheta(const size_t n) override;
 
   // Hypothesis, cost and gradient functions
-  virtual T Hypothesis(const std::vector<T> &x) const override;
-  virtual T Cost(const size_t m, const size_t n, const T lambda,
-                 const std::vector<std::vector<T>> &x, const std::vector<T> &y) const override;
-  virtual void Gradient(const size_t m, const size_t, const T lambda, const T alpha,
-                        const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
-
-  // Feed-forward helpers
-  std::vector<T> FeedForward0(const std::vector<T> &x) const;
-  std::vector<T> FeedForward1(const std::vector<T> &a0, const bool sigmoid) const;
-  std::vector<T> FeedForward2(const std::vector<T> &a1) const;
-
-  // Helpers for the sigmoid function
+  virtual T Hypothesis(const T *x) const override;
+  virtual T Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const override;
+  virtual void Gradient(const T lambda, const Matrix<T> &x, const std::vector<T> &y,
+                        std::vector<T> &gradient) const override;
+
+  // Feed-forward helper: computes the activations 'a1' of the hidden layer (without the bias unit)
+  // and returns the output of the network for a single sample
+  T FeedForward(const T *x, T *a1) const;
+
+  // Helper for the sigmoid function
   T Sigmoid(const T value) const {
     return static_cast<T>(1) / (static_cast<T>(1) + static_cast<T>(exp(-value)));
   }
-  T SigmoidGradient(const T value) const {
-    return Sigmoid(value)*(static_cast<T>(1) - Sigmoid(value));
-  }
 
-  // The learned weights
-  std::vector<T> theta1_;
-  std::vector<T> theta2_;
+  // The learned weights are stored in 'theta_': first those of the hidden layer (a row of inputs
+  // per hidden unit, starting with the bias), followed by those of the output layer
+  size_t NumWeights1() const { return (layer_sizes_[0]+1)*layer_sizes_[1]; }
+  const T* theta1() const { return theta_.data(); }
+  const T* theta2() const { return theta_.data() + NumWeights1(); }
 
   // Neural network configuration
   size_t num_layers_;
@@ -0,0 +1,150 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the classes used for distributed tuning: a blocking TCP socket which sends and
+// receives length-prefixed messages, and the Message class which (de)serializes the contents of
+// such a message. Multi-byte values are always sent in little-endian byte order. Sockets are only
+// supported on POSIX systems.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_NETWORK_H_
+#define CLTUNE_NETWORK_H_
+
+#include <string> // std::string
+#include <vector> // std::vector
+#include <memory> // std::unique_ptr
+#include <cstdint> // uint64_t
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// A message consisting of a sequence of integers, floating-point values, and strings. Values are
+// read back in the order in which they were written.
+class Message {
+ public:
+
+  // Exception thrown when reading beyond the end of a message
+  class Exception : public std::runtime_error {
+   public:
+    Exception(const std::string &message): std::runtime_error(message) { }
+  };
+
+  // Creates an empty message for writing or a message with received data for reading
+  Message();
+  explicit Message(const std::string &data);
+
+  // Appends values to the message
+  void WriteInteger(const uint64_t value);
+  void WriteDouble(const double value);
+  void WriteString(const std::string &value);
+
+  // Reads the next value from the message
+  uint64_t ReadInteger();
+  double ReadDouble();
+  std::string ReadString();
+
+  // Accessor to the raw data
+  const std::string& data() const { return data_; }
+
+ private:
+  std::string data_;
+  size_t position_;
+};
+
+// =================================================================================================
+
+// A connected TCP socket. Failures (including a closed connection) are reported by throwing.
+class Socket {
+ public:
+
+  // Exception thrown on network failures
+  class Exception : public std::runtime_error {
+   public:
+    Exception(const std::string &message): std::runtime_error(message) { }
+  };
+
+  // Connects to a listening socket on a host (name or address) and port
+  static std::unique_ptr<Socket> Connect(const std::string &host, const size_t port);
+
+  // Listens on a port and waits for a number of incoming connections
+  static std::vector<std::unique_ptr<Socket>> Accept(const size_t port,
+                                                     const size_t num_connections);
+
+  // Closes the connection
+  ~Socket();
+
+  // Sends or receives a complete message. Receiving a message larger than the maximum size (e.g.
+  // because of a corrupt or malicious length) throws instead of allocating it.
+  static const size_t kMaxMessageSize;
+  void Send(const Message &message);
+  Message Receive();
+
+  // Makes receiving fail if no data arrives for the given number of seconds (0 waits forever)
+  void SetTimeout(const double seconds);
+
+ private:
+  friend class Listener;
+  explicit Socket(const int descriptor);
+  Socket(const Socket&) = delete;
+  Socket& operator=(const Socket&) = delete;
+
+  // Sends or receives exactly the given number of bytes
+  void SendBytes(const char* data, const size_t size);
+  void ReceiveBytes(char* data, const size_t size);
+
+  int descriptor_;
+};
+
+// =================================================================================================
+
+// A listening TCP socket, accepting connections one at a time with a timeout
+class Listener {
+ public:
+
+  // Listens on a port on all interfaces, or on the loopback interface only. Port 0 selects a free
+  // port, which can be queried afterwards.
+  Listener(const size_t port, const bool loopback_only);
+  ~Listener();
+
+  // Retrieves the port the socket is listening on
+  size_t port() const { return port_; }
+
+  // Waits for an incoming connection. Returns a null-pointer if there was none within the timeout.
+  // A negative timeout waits forever.
+  std::unique_ptr<Socket> Accept(const double timeout_seconds);
+
+ private:
+  Listener(const Listener&) = delete;
+  Listener& operator=(const Listener&) = delete;
+
+  int descriptor_;
+  size_t port_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_NETWORK_H_
+#endif
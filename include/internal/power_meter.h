@@ -0,0 +1,85 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the PowerMeter class, which measures the average power draw of the device
+// while a configuration is being timed. A background thread reads a user-supplied sensor (e.g.
+// through NVML or ROCm-SMI) at a fixed interval, and the samples are integrated over time. The
+// sensor is also read at the start and at the end of each measurement, such that measurements
+// shorter than the interval still have a result.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_POWER_METER_H_
+#define CLTUNE_POWER_METER_H_
+
+#include "cltune.h"
+
+#include <chrono> // std::chrono::steady_clock
+#include <thread> // std::thread
+#include <mutex> // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <exception> // std::exception_ptr
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class PowerMeter {
+ public:
+
+  // Reads the sensor every 'interval_ms' milliseconds while measuring
+  PowerMeter(PowerFunction sensor, const double interval_ms);
+  ~PowerMeter();
+
+  // Starts a new measurement. A measurement which is still running is discarded.
+  void Start();
+
+  // Ends the measurement and returns the average power in Watts since 'Start' (0 if there was no
+  // measurement running). An exception thrown by the sensor is re-thrown here.
+  double Stop();
+
+ private:
+
+  // The loop executed by the sampling thread, and a single sample
+  void SampleLoop();
+  void Sample();
+
+  // Member variables
+  PowerFunction sensor_;
+  std::chrono::duration<double,std::milli> interval_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool running_;
+  std::exception_ptr error_; // the first exception thrown by the sensor, if any
+  double energy_; // in millijoules, since the start of the measurement
+  double last_power_; // in Watts
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::time_point last_time_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_POWER_METER_H_
+#endif
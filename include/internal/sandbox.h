@@ -0,0 +1,90 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the Sandbox class, which manages a child process running configurations on
+// behalf of the tuner. A crash or a hang of the device driver (e.g. caused by out-of-bounds writes
+// of an invalid configuration) then only takes down the child, which is simply started again. The
+// child is a fresh instance of the same executable, which turns into a worker (see 'RunWorker') as
+// soon as it constructs its first tuner. It is connected over the loopback interface.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_SANDBOX_H_
+#define CLTUNE_SANDBOX_H_
+
+#include "internal/network.h"
+
+#include <string> // std::string
+#include <memory> // std::unique_ptr
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class Sandbox {
+ public:
+
+  // The environment variable through which a child learns the parent's port and its device
+  static const std::string kEnvironmentVariable;
+
+  // The maximum time in seconds a child may take to start up and connect
+  static const double kStartupTimeout;
+
+  // Checks whether this process was started as a child. If so, returns true and sets the port of
+  // the parent and the platform and device to use.
+  static bool IsChild(size_t &port, size_t &platform_id, size_t &device_id);
+
+  // Initializes without a running child
+  Sandbox(const size_t platform_id, const size_t device_id);
+  ~Sandbox();
+
+  // Starts a new child process and waits for it to connect. Throws a Socket::Exception if the child
+  // exits or doesn't connect in time, or if child processes are not supported on this platform.
+  void Start();
+
+  // Waits for a child which was told to stop to exit. Use 'Kill' after a failure instead.
+  void Stop();
+
+  // Terminates the child forcefully (e.g. after a crash or a timeout) and cleans it up
+  void Kill();
+
+  // Accessors to the connection with the child (only valid while it is running)
+  bool IsRunning() const { return socket_ != nullptr; }
+  Socket& socket() { return *socket_; }
+
+ private:
+  Sandbox(const Sandbox&) = delete;
+  Sandbox& operator=(const Sandbox&) = delete;
+
+  // Member variables
+  size_t platform_id_;
+  size_t device_id_;
+  int process_id_; // the child's process ID, or -1 if there is no child
+  std::unique_ptr<Socket> socket_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_SANDBOX_H_
+#endif
@@ -7,8 +7,8 @@
 //
 // This file contains a base class for search algorithms. It is meant to be inherited by other less
 // abstract search algorithms, such as full search or a random search. The pure virtual functions
-// declared here are customised in the derived classes. This class stores all configurations which
-// could be examined, and receives feedback from the tuner in the form of execution time.
+// declared here are customised in the derived classes. This class refers to the (lazy) configuration
+// space of a kernel, and receives feedback from the tuner in the form of execution time.
 //
 // -------------------------------------------------------------------------------------------------
 //
@@ -33,6 +33,8 @@
 
 #include <vector>
 #include <chrono>
+#include <random>
+#include <unordered_map>
 
 #include "internal/kernel_info.h"
 
@@ -46,16 +48,56 @@ class Searcher {
   // Short-hand for a list of configurations
   using Configurations = std::vector<KernelInfo::Configuration>;
 
-  // Base constructor
-  Searcher(const Configurations &configurations);
+  // Configuration spaces up to this size are counted exactly, larger ones are estimated by sampling
+  static const size_t kMaxExactCount;
+  static const size_t kNumEstimationSamples;
+
+  // Base constructor. The kernel (and thus its configuration space) has to outlive the searcher.
+  // All random decisions of the searcher are derived from the seed, such that a search can be
+  // replayed exactly given the same seed and the same execution times.
+  Searcher(const KernelInfo &kernel, const unsigned int seed);
   virtual ~Searcher() { }
 
+  // Pseudo-random seed based on the time
+  static unsigned int TimeSeed() {
+    // std::random_device rd;
+    // return rd();
+    return static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
+  }
+
   // Pushes feedback (in the form of execution time) from the tuner to the search algorithm
   virtual void PushExecutionTime(const double execution_time);
 
   // Prints the log of the search process
   void PrintLog(FILE* fp) const;
 
+  // Retrieves up to 'count' configurations which will be explored after the current one, without
+  // changing the state of the search. Searchers for which the next step depends on the feedback of
+  // the current one can return fewer (or no) configurations. This is used to compile ahead.
+  virtual Configurations PeekConfigurations(const size_t count) const;
+
+  // Retrieves the index of the current configuration in the kernel's configuration space
+  size_t GetIndex() const { return index_; }
+
+  // Batch interface for parallel evaluation, built on top of the sequential interface below. Hands
+  // out up to 'count' configurations (as indices) which can be evaluated at the same time: the
+  // current one and the known upcoming ones (see 'PeekConfigurations'), skipping those which are
+  // already handed out. Returns fewer (or none) if the next ones depend on pending results.
+  virtual std::vector<size_t> RequestConfigurations(const size_t count);
+
+  // Reports the execution times of configurations handed out before, in any order and grouping.
+  // Results which arrive early are kept until the search reaches their configuration, such that
+  // the search makes the same decisions as when evaluating one configuration at a time.
+  virtual void ReportResults(const std::vector<size_t> &indices, const std::vector<double> &times);
+
+  // Returns the number of configurations which are handed out but not yet reported
+  size_t NumPendingConfigurations() const { return pending_indices_.size(); }
+
+  // Starts the search at (or close to) the given valid configurations in order of preference, e.g.
+  // the best ones of earlier runs. This is called before the first configuration is requested. By
+  // default these are ignored, e.g. by full search which visits all configurations anyway.
+  virtual void WarmStart(const std::vector<size_t> &) { }
+
   // Pure virtual functions: these are overriden by the derived classes
   virtual KernelInfo::Configuration GetConfiguration() = 0;
   virtual void CalculateNextIndex() = 0;
@@ -63,18 +105,36 @@ class Searcher {
 
  protected:
 
-  // Pseudo-random seed based on the time
-  unsigned int RandomSeed() const {
-    // std::random_device rd;
-    // return rd();
-    return static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
-  }
+  // The seed this searcher was constructed with
+  unsigned int RandomSeed() const { return seed_; }
+
+  // Returns the first valid configuration index at or after 'start' (wrapping around at the end of
+  // the space if requested), or 'NumRawConfigurations()' if there is none
+  size_t NextValidIndex(const size_t start, const bool wrap_around) const;
+
+  // Returns a uniformly sampled valid configuration index. Falls back to a scan from a random
+  // position if sampling doesn't find one. Throws if there are no valid configurations at all.
+  size_t RandomValidIndex(std::default_random_engine &generator) const;
+
+  // Returns the (estimated) number of valid configurations
+  size_t NumValidConfigurations() const;
+
+  // Returns the time of an explored configuration, or the maximum value if unexplored
+  double ExecutionTime(const size_t index) const;
 
   // Protected member variables accessible by derived classes
-  Configurations configurations_;
-  std::vector<double> execution_times_;
+  const KernelInfo &kernel_;
+  const unsigned int seed_;
+  std::unordered_map<size_t, double> execution_times_;
   std::vector<size_t> explored_indices_;
   size_t index_;
+
+ private:
+
+  // Configurations handed out by the batch interface without a result, and results which are not
+  // yet passed to the search because it didn't reach their configuration
+  std::vector<size_t> pending_indices_;
+  std::unordered_map<size_t, double> reported_times_;
 };
 
 // =================================================================================================
@@ -5,7 +5,9 @@
 //
 // Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
 //
-// This file implements the simulated annealing algorithm. (...)
+// This file implements the simulated annealing algorithm. (...) Multiple independent chains can be
+// run, which take turns similar to the particles of PSO. The pending neighbours of the other chains
+// are thus known in advance, such that the chains can be evaluated in parallel.
 //
 // -------------------------------------------------------------------------------------------------
 //
@@ -47,9 +49,12 @@ class Annealing: public Searcher {
   // Maximum number of differences to consider this still a neighbour
   static const size_t kMaxDifferences;
 
-  // Takes additionally a fraction of configurations to consider
-  Annealing(const Configurations &configurations,
-            const double fraction, const double max_temperature);
+  // Maximum number of attempts to find a valid neighbour before staying at the current state
+  static const size_t kMaxNeighbourAttempts;
+
+  // Takes additionally a fraction of configurations to consider and the number of chains
+  Annealing(const KernelInfo &kernel, const double fraction, const double max_temperature,
+            const size_t num_chains, const unsigned int seed);
   ~Annealing() {}
 
   // Retrieves the next configuration to test
@@ -64,10 +69,16 @@ class Annealing: public Searcher {
   // Pushes feedback (in the form of execution time) from the tuner to the search algorithm
   virtual void PushExecutionTime(const double execution_time) override;
 
+  // Retrieves the neighbours of the other chains, which are evaluated next
+  virtual Configurations PeekConfigurations(const size_t count) const override;
+
+  // Starts the first chains in the given states
+  virtual void WarmStart(const std::vector<size_t> &indices) override;
+
  private:
 
-  // Retrieves a vector with all neighbours of a reference configuration
-  std::vector<size_t> GetNeighboursOf(const size_t reference_id) const;
+  // Retrieves a random neighbour of a reference configuration
+  size_t GetNeighbourOf(const size_t reference_id);
 
   // Computes the acceptance probability P of simulated annealing based on the 'energy' of the
   // current and neighbouring state, and the 'temperature'.
@@ -79,15 +90,16 @@ class Annealing: public Searcher {
   double fraction_;
   double max_temperature_;
 
-  // Annealing-specific member variables
+  // Annealing-specific member variables, with a current and a neighbour state per chain
+  size_t num_configurations_;
   size_t num_visited_states_;
-  size_t current_state_;
-  size_t neighbour_state_;
+  size_t chain_;
+  std::vector<size_t> current_states_;
+  std::vector<size_t> neighbour_states_;
   size_t num_already_visisted_states_;
 
   // Random number generation
   std::default_random_engine generator_;
-  std::uniform_int_distribution<int> int_distribution_;
   std::uniform_real_distribution<double> probability_distribution_;
 };
 
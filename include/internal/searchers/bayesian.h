@@ -0,0 +1,131 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements a Bayesian-optimisation searcher, derived from the basic search class. After
+// a few random configurations, it fits a Gaussian-process surrogate to the (logarithms of the)
+// execution times measured so far. The next configuration is the candidate with the highest
+// expected improvement over the best one, which balances exploiting the predicted optimum against
+// exploring uncertain regions of the space. Candidates are random valid configurations and the
+// neighbours of the best configuration, such that the (lazy) configuration space is never
+// enumerated.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_SEARCHERS_BAYESIAN_H_
+#define CLTUNE_SEARCHERS_BAYESIAN_H_
+
+#include <vector>
+#include <random>
+
+#include "internal/searcher.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class Bayesian: public Searcher {
+ public:
+
+  // Number of random configurations explored before the surrogate model is used
+  static const size_t kNumInitialSamples;
+
+  // Number of random candidates scored by the surrogate model in each step
+  static const size_t kNumCandidates;
+
+  // Number of attempts to draw a configuration which is not explored yet
+  static const size_t kMaxCandidateAttempts;
+
+  // Maximum number of explored configurations the model is fitted to (the fastest ones are kept),
+  // bounding the cubic cost of fitting a Gaussian process
+  static const size_t kMaxObservations;
+
+  // The kernel length-scales considered, of which the most likely one is selected in each step
+  static const std::vector<double> kLengthScales;
+
+  // The variance of the measurement noise, relative to that of the (standardised) execution times
+  static const double kNoiseVariance;
+
+  // Takes additionally a fraction of configurations to consider
+  Bayesian(const KernelInfo &kernel, const double fraction, const unsigned int seed);
+  ~Bayesian() {}
+
+  // Retrieves the next configuration to test
+  virtual KernelInfo::Configuration GetConfiguration() override;
+
+  // Calculates the next index
+  virtual void CalculateNextIndex() override;
+
+  // Retrieves the total number of configurations to try
+  virtual size_t NumConfigurations() override;
+
+  // Explores the given configurations before any others
+  virtual void WarmStart(const std::vector<size_t> &indices) override;
+
+ private:
+
+  // Returns a random valid configuration which is not explored yet. If none is found by sampling,
+  // this optionally scans the whole space. Returns 'NumRawConfigurations()' if none is found.
+  size_t RandomUnexploredIndex(const bool scan_if_not_found);
+
+  // Retrieves the normalised features of a configuration: one per parameter
+  std::vector<double> Features(const size_t index) const;
+
+  // Fits the Gaussian process to the explored configurations. Returns false if there is nothing to
+  // fit yet (e.g. only failed configurations).
+  bool FitModel();
+
+  // Predicts the mean and the standard deviation of the (standardised) execution time
+  void Predict(const std::vector<double> &features, double &mean, double &deviation) const;
+
+  // Computes the expected improvement of a prediction over the best explored configuration
+  double ExpectedImprovement(const double mean, const double deviation) const;
+
+  // Configuration parameters
+  double fraction_;
+  size_t num_configurations_;
+
+  // The normalisation of each parameter's values: the scale, the mean, and the range
+  std::vector<bool> feature_logarithmic_;
+  std::vector<double> feature_means_;
+  std::vector<double> feature_ranges_;
+
+  // The fitted model: the training features, the Cholesky factor of the covariance matrix (lower
+  // triangular, row-major), the weights of the training samples, and the selected length-scale
+  std::vector<std::vector<double>> training_features_;
+  std::vector<double> cholesky_;
+  std::vector<double> weights_;
+  double length_scale_;
+  double best_target_;
+
+  // The given configurations which are not explored yet, the next one at the back
+  std::vector<size_t> warm_start_indices_;
+
+  // Random number generation
+  std::default_random_engine generator_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_SEARCHERS_BAYESIAN_H_
+#endif
@@ -39,7 +39,7 @@ namespace cltune {
 // See comment at top of file for a description of the class
 class FullSearch: public Searcher {
  public:
-  FullSearch(const Configurations &configurations);
+  FullSearch(const KernelInfo &kernel, const unsigned int seed);
   ~FullSearch() {}
 
   // Retrieves the next configuration to test
@@ -51,7 +51,11 @@ class FullSearch: public Searcher {
   // Retrieves the total number of configurations to try
   virtual size_t NumConfigurations() override;
 
+  // Retrieves the configurations following the current one
+  virtual Configurations PeekConfigurations(const size_t count) const override;
+
  private:
+  size_t num_configurations_;
 };
 
 // =================================================================================================
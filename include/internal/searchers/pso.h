@@ -46,13 +46,13 @@ namespace cltune {
 class PSO: public Searcher {
  public:
 
-  // Shorthand
-  using Parameters = std::vector<KernelInfo::Parameter>;
+  // Maximum number of attempts to move a particle to a valid position before it stays in place
+  static const size_t kMaxMoveAttempts;
 
   // Takes additionally a fraction of configurations to consider
-  PSO(const Configurations &configurations, const Parameters &parameters,
-      const double fraction, const size_t swarm_size, const double influence_global,
-      const double influence_local, const double influence_random);
+  PSO(const KernelInfo &kernel, const double fraction, const size_t swarm_size,
+      const double influence_global, const double influence_local, const double influence_random,
+      const unsigned int seed);
   ~PSO() { }
 
   // Retrieves the next configuration to test
@@ -67,13 +67,17 @@ class PSO: public Searcher {
   // Pushes feedback (in the form of execution time) from the tuner to the search algorithm
   virtual void PushExecutionTime(const double execution_time) override;
 
- private:
+  // Retrieves the current positions of the particles that are up next
+  virtual Configurations PeekConfigurations(const size_t count) const override;
+
+  // Starts the first particles at the given positions
+  virtual void WarmStart(const std::vector<size_t> &indices) override;
 
-  // Returns the index of the target configuration in the whole configuration list
-  size_t IndexFromConfiguration(const KernelInfo::Configuration target) const;
+ private:
 
   // Configuration parameters
   double fraction_;
+  size_t num_configurations_;
   size_t swarm_size_;
 
   // Percentages of influence on the whole swarm's best (global), the particle's best (local), and
@@ -89,15 +93,14 @@ class PSO: public Searcher {
   // Best cases found so far
   double global_best_time_;
   std::vector<double> local_best_times_;
-  KernelInfo::Configuration global_best_config_;
-  std::vector<KernelInfo::Configuration> local_best_configs_;
+  size_t global_best_index_;
+  std::vector<size_t> local_best_indices_;
 
   // Allowed parameters
-  Parameters parameters_;
+  std::vector<KernelInfo::Parameter> parameters_;
 
   // Random number generation
   std::default_random_engine generator_;
-  std::uniform_int_distribution<int> int_distribution_;
   std::uniform_real_distribution<double> probability_distribution_;
 };
 
@@ -7,6 +7,9 @@
 //
 // This file implements a random-search algorithm, testing the configurations randomly. However,
 // it does not consider the same configuration twice. It is derived from the basic search class.
+// Instead of shuffling a list of all configurations, the configuration space is visited in the
+// order of a pseudo-random permutation of its indices (a Feistel network with cycle-walking), such
+// that no list of configurations nor a set of visited configurations is ever kept in memory.
 //
 // -------------------------------------------------------------------------------------------------
 //
@@ -30,6 +33,7 @@
 #define CLTUNE_SEARCHERS_RANDOM_SEARCH_H_
 
 #include <vector>
+#include <cstdint>
 
 #include "internal/searcher.h"
 
@@ -41,7 +45,7 @@ class RandomSearch: public Searcher {
  public:
 
   // Takes additionally a fraction of configurations to try (1.0 == full search)
-  RandomSearch(const Configurations &configurations, const double fraction);
+  RandomSearch(const KernelInfo &kernel, const double fraction, const unsigned int seed);
   ~RandomSearch() {}
 
   // Retrieves the next configuration to test
@@ -53,8 +57,36 @@ class RandomSearch: public Searcher {
   // Retrieves the total number of configurations to try
   virtual size_t NumConfigurations() override;
 
+  // Retrieves the configurations following the current one
+  virtual Configurations PeekConfigurations(const size_t count) const override;
+
+  // Visits the given configurations before those in the random order
+  virtual void WarmStart(const std::vector<size_t> &indices) override;
+
  private:
-    double fraction_;
+
+  // Number of rounds of the Feistel network
+  static const size_t kNumRounds;
+
+  // Maps a position in the random order onto a configuration index (a bijection on the space)
+  size_t PermutedIndex(const size_t position) const;
+
+  // Returns the first valid configuration at or after the given position in the random order. The
+  // position is advanced past it. Returns 'NumRawConfigurations()' if the space is exhausted.
+  // Configurations given to 'WarmStart' are skipped, since they are visited already.
+  size_t NextValidPosition(size_t &position) const;
+
+  double fraction_;
+  size_t num_configurations_;
+  size_t position_;
+
+  // The configurations given to 'WarmStart' and the number of them which are visited
+  std::vector<size_t> warm_start_indices_;
+  size_t warm_start_position_;
+
+  // Settings of the Feistel network: the bit-width of its halves and the per-round keys
+  size_t half_bits_;
+  std::vector<uint64_t> keys_;
 };
 
 // =================================================================================================
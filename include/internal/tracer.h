@@ -0,0 +1,118 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the Tracer class, which records where the wall-clock time of a tuning run
+// goes. The tuner marks its phases (e.g. compiling, copying buffers, launching, verifying, and the
+// search method's bookkeeping) as spans, which may come from several threads and may be nested.
+// These are written as a Chrome trace (readable by chrome://tracing and Perfetto) and summarised
+// per phase.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_TRACER_H_
+#define CLTUNE_TRACER_H_
+
+#include <string> // std::string
+#include <vector> // std::vector
+#include <map> // std::map
+#include <chrono> // std::chrono::steady_clock
+#include <thread> // std::thread::id
+#include <mutex> // std::mutex
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class Tracer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // A recorded span: its times are in microseconds since the creation of the tracer, the thread is
+  // numbered in order of appearance (the first one being 0)
+  struct Event {
+    std::string name;
+    std::string detail;
+    size_t thread;
+    double start;
+    double duration;
+  };
+
+  // The summary of all spans of a single phase (in milliseconds)
+  struct Phase {
+    std::string name;
+    size_t count;
+    double total;
+    double maximum;
+  };
+
+  // Records a span from its construction until 'End' is called or it goes out of scope. Without a
+  // tracer (a null-pointer), nothing is recorded and the clock isn't read.
+  class Span {
+   public:
+    Span(Tracer *tracer, const char *name, const std::string &detail = std::string{});
+    ~Span() { End(); }
+    void End();
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+   private:
+    Tracer *tracer_;
+    const char *name_;
+    std::string detail_;
+    Clock::time_point start_;
+  };
+
+  // Starts the clock
+  Tracer();
+
+  // Records a span (thread-safe)
+  void Record(const std::string &name, const std::string &detail, const Clock::time_point start,
+              const Clock::time_point end);
+
+  // Returns all spans recorded so far, in order of their end times
+  std::vector<Event> Events() const;
+
+  // Returns the summary of each phase, the largest total time first. Note that nested spans are
+  // also counted in the phases which contain them.
+  std::vector<Phase> Summary() const;
+
+  // Returns the wall-clock time since the creation of the tracer in milliseconds
+  double Elapsed() const;
+
+  // Writes all spans in the Chrome trace event format. Throws a std::runtime_error if the file
+  // can't be written.
+  void WriteChromeTrace(const std::string &filename) const;
+
+ private:
+
+  // Member variables
+  Clock::time_point origin_;
+  mutable std::mutex mutex_;
+  std::vector<Event> events_;
+  std::map<std::thread::id, size_t> threads_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_TRACER_H_
+#endif
@@ -40,6 +40,17 @@
 #endif
 
 #include "internal/kernel_info.h"
+#include "internal/compile_pool.h"
+#include "internal/binary_cache.h"
+#include "internal/journal.h"
+#include "internal/database.h"
+#include "internal/measurement.h"
+#include "internal/power_meter.h"
+#include "internal/tracer.h"
+#include "internal/verification.h"
+#include "internal/device_pool.h"
+#include "internal/network.h"
+#include "internal/sandbox.h"
 #include "internal/msvc.h"
 
 // Host data-type for half-precision floating-point (16-bit)
@@ -50,6 +61,15 @@
 #include <memory> // std::shared_ptr
 #include <complex> // std::complex
 #include <stdexcept> // std::runtime_error
+#include <map> // std::map
+#include <set> // std::set
+#include <list> // std::list
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::steady_clock
+#include <future> // std::shared_future
+#include <unordered_map> // std::unordered_map
+#include <algorithm> // std::copy
+#include <limits> // std::numeric_limits
 
 namespace cltune {
 // =================================================================================================
@@ -58,13 +78,21 @@ namespace cltune {
 using float2 = std::complex<float>; // cl_float2;
 using double2 = std::complex<double>; // cl_double2;
 
-// Raw device buffer
+// Raw device buffer and context
 #if USE_OPENCL
   using BufferRaw = cl_mem;
+  using ContextRaw = cl_context;
 #else
   using BufferRaw = CUdeviceptr;
+  using ContextRaw = CUcontext;
 #endif
 
+// The machine learning models (see 'ml_model.h', which depends on this header)
+template <typename T> class MLModel;
+
+// The search methods (see 'searcher.h')
+class Searcher;
+
 // Enumeration of currently supported data-types by this class
 enum class MemType { kShort, kInt, kSizeT, kHalf, kFloat, kDouble, kFloat2, kDouble2 };
 
@@ -73,9 +101,6 @@ class TunerImpl {
  // Note that everything here is public because of the Pimpl-idiom
  public:
 
-  // Parameters
-  static const double kMaxL2Norm; // This is the threshold for 'correctness'
-
   // Messages printed to stdout (in colours)
   static const std::string kMessageFull;
   static const std::string kMessageHead;
@@ -94,6 +119,8 @@ class TunerImpl {
     size_t size;        // The number of elements (not bytes)
     MemType type;       // The data-type (e.g. float)
     BufferRaw buffer;   // The buffer on the device
+    bool no_restore;    // Output-only: its contents don't have to be restored before each run
+    bool user_owned;    // The buffer belongs to the user: it is never released by the tuner
   };
 
   // Helper structure to hold the results of a tuning run
@@ -102,42 +129,227 @@ class TunerImpl {
     float time;
     size_t threads;
     bool status;
-    KernelInfo::Configuration configuration;
+    size_t kernel_id; // the position of the kernel in 'kernels_'
+    size_t configuration_id; // the index of the configuration in the kernel's configuration space
+    TimingMethod timing_method; // the method used to measure 'time'
+    float host_time; // the host-side wall-clock time, including the launch overhead
+    SampleStatistics statistics; // summary of all the measurements 'time' is based on
+    bool pruned; // whether measuring was stopped early or skipped (no samples) for being slow
+    bool timed_out; // whether the kernel was abandoned, in which case 'time' is the timeout
+    float energy; // the energy per run in millijoules, 0 if the power wasn't measured
+    Counters counters; // empty if the counters weren't collected
+  };
+
+  // Helper structure with the resources of a compiled kernel as reported by the driver
+  struct KernelResources {
+    size_t local_memory; // in bytes per work-group
+    size_t max_threads; // the largest work-group it can be launched with, 0 if unknown
   };
 
-  // Initialize either with platform 0 and device 0 or with a custom platform/device
-  explicit TunerImpl(const size_t platform_id = 0, const size_t device_id = 0);
+  // Initialize either with platform 0 and device 0 or with a custom platform/device. Optionally, an
+  // existing context of the user can be given, which is then used instead of creating a new one.
+  explicit TunerImpl(const size_t platform_id = 0, const size_t device_id = 0,
+                     const ContextRaw context = nullptr);
   ~TunerImpl();
 
   // Starts the tuning process. This function is called directly from the Tuner API.
   void Tune();
 
-  // Compiles and runs a kernel and returns the elapsed time
+  // Asynchronous tuning: runs 'Tune' on a separate thread with the progress callback and the time
+  // budget until it is done or the flag is set. Tuning stops early once 'IsTuningStopped'.
+  std::shared_future<void> TuneAsync(ProgressFunction callback, const double time_budget_ms,
+                                     std::shared_ptr<std::atomic<bool>> cancel);
+  bool IsTuningStopped() const;
+
+  // Passes the progress after an explored configuration to the callback (if any). The best result
+  // of the kernel so far is kept up-to-date in 'best'.
+  void ReportProgress(const TunerResult &result, TunerResult &best, const size_t num_explored,
+                      const size_t num_configurations) const;
+
+  // Creates the search method selected through the Tuner API for the configurations of a kernel
+  std::unique_ptr<Searcher> CreateSearcher(const KernelInfo &kernel, const unsigned int seed) const;
+
+  // Starts the tuning process for multiple problem sizes. This is called from the Tuner API.
+  void TuneSizes(const std::vector<ProblemSize> &sizes);
+
+  // Multi-size sweep helpers: sets all scalar arguments (except for the parameter arguments) in the
+  // order of their argument indices, and grows a buffer by repeating its current contents
+  void SetScalarArguments(const std::vector<double> &values);
+  void GrowBuffer(MemArgument &argument, const size_t size);
+  template <typename T> void GrowBuffer(MemArgument &argument, const size_t size);
+
+  // Adds the parameters of a configuration to the kernel's source-code as defines. Parameters which
+  // don't appear in the source-code are left out, such that these don't result in a new program.
+  std::string SourceWithDefines(const KernelInfo &kernel,
+                                const KernelInfo::Configuration &configuration) const;
+
+  // Compiles a device program and throws an exception in case of compilation errors. This may be
+  // called from the worker threads of the compilation pool. If the binary cache is enabled, the
+  // program is loaded from disk if possible and stored on disk otherwise.
+  Program CompileProgram(const std::string &source) const;
+
+  // Returns the build options, taken from the 'CLTUNE_BUILD_OPTIONS' environmental variable
+  static std::vector<std::string> BuildOptions();
+
+  // Retrieves the program of a source-code: from the recently used programs, from the background
+  // compilation threads, or by compiling it right here
+  Program GetProgram(const std::string &source);
+  bool IsProgramCached(const std::string &source) const;
+
+  // Resource pre-filtering: the resources of each compiled program are stored (one entry per
+  // launched kernel), such that configurations sharing a program which they can't be launched with
+  // are rejected without compiling again. Returns the reason, or an empty string if the kernel (of
+  // which the ranges are set) fits or if the program wasn't compiled yet. The second version checks
+  // a configuration instead, e.g. before scheduling it for compilation.
+  std::string ExceededResources(const std::string &source, const KernelInfo &kernel) const;
+  bool FitsResources(const std::string &source, const KernelInfo &kernel,
+                     const KernelInfo::Configuration &configuration) const;
+
+  // Compiles and runs a kernel and returns the elapsed time. The best time of the kernel so far (if
+  // known) is used to prune slow configurations and to compute the relative timeout.
   TunerResult RunKernel(const std::string &source, const KernelInfo &kernel,
-                        const size_t configuration_id, const size_t num_configurations);
+                        const size_t configuration_id, const size_t num_configurations,
+                        const float best_time = std::numeric_limits<float>::max());
+
+  // Stores a result and keeps the best valid time of its kernel up-to-date, such that 'BestTime'
+  // doesn't search all results for each configuration
+  void StoreResult(const TunerResult &result);
+  float BestTime(const size_t kernel_id) const;
 
-  // Copies an output buffer
+  // Sets the arguments of a kernel, or those of a stage of a pipeline given their positions
+  void SetArguments(Kernel &launch_kernel, const KernelInfo &kernel,
+                    const std::vector<size_t> &positions) const;
+
+  // Copies an output buffer into a newly allocated buffer or restores an existing copy
   template <typename T> MemArgument CopyOutputBuffer(MemArgument &argument);
+  template <typename T> void RestoreOutputBuffer(const MemArgument &argument, MemArgument &copy);
+
+  // Creates a tuner for each of the additional devices and copies all the arguments and the output
+  // of the reference kernel to it. These tuners are used by the device pool's worker threads.
+  void StartDeviceWorkers();
+  MemArgument CopyArgument(const MemArgument &argument, TunerImpl &worker);
+  template <typename T> MemArgument CopyArgument(const MemArgument &argument, TunerImpl &worker);
+  template <typename T> void CopyReference(const size_t i, TunerImpl &worker) const;
+
+  // Distributed tuning: the coordinator accepts the remote workers and sends them the tuning
+  // specification (kernels, parameters, arguments, reference output, and settings). Remote workers
+  // are driven by the device pool just like the additional devices. A worker which fails is
+  // disconnected: its configurations are run by this device instead.
+  void StartRemoteWorkers();
+  void StopRemoteWorkers();
+  TunerResult RunRemoteKernel(const size_t worker_id, const size_t kernel_id,
+                              const size_t configuration_id, const size_t step,
+                              const size_t num_configurations);
+  TunerResult ExchangeJob(Socket &worker, const size_t kernel_id, const size_t configuration_id,
+                          const size_t step, const size_t num_configurations);
+  Message SerializeSpecification();
+  void DeserializeSpecification(Message &message);
+  void SerializeArgument(const MemArgument &argument, Message &message);
+  MemArgument DeserializeArgument(Message &message);
+  size_t SizeOf(const MemType type) const;
+
+  // Worker mode: connects to a coordinator and runs the configurations it hands out until it is
+  // told to stop
+  void RunWorker(const std::string &host, const size_t port);
+
+  // Isolated execution: runs a configuration of this device in the sandbox's child process instead
+  // of in this process, starting the child if needed. A crash or timeout of the child results in a
+  // failed configuration, after which the next configuration starts a fresh child.
+  TunerResult RunIsolated(const size_t kernel_id, const size_t configuration_id,
+                          const size_t step, const size_t num_configurations);
+  void StopIsolated();
+
+  // Uploads host data to a device buffer on the copy queue without waiting for it to complete. The
+  // data is first copied into a (pinned) staging buffer, which is kept until 'FinishTransfers'.
+  template <typename T>
+  void UploadAsync(Buffer<T> &buffer, const std::vector<T> &source) {
+    if (source.empty()) { return; }
+    auto staging = std::make_shared<BufferHost<T>>(context_, source.size());
+    std::copy(source.begin(), source.end(), staging->data());
+    buffer.WriteAsync(copy_queue_, source.size(), *staging);
+    staging_buffers_.push_back(staging);
+  }
 
-  // Stores the output of the reference run into the host memory
+  // Waits for all transfers on the copy queue: the argument uploads and the reference download
+  void FinishTransfers();
+
+  // Stores the output of the reference run into the host memory. The download is not waited for.
   void StoreReferenceOutput();
   template <typename T> void DownloadReference(MemArgument &device_buffer);
 
   // Downloads the output of a tuning run and compares it against the reference run
   bool VerifyOutput();
   template <typename T> bool DownloadAndCompare(MemArgument &device_buffer, const size_t i);
-  template <typename T> double AbsoluteDifference(const T reference, const T result);
-
-  // Trains and uses a machine learning model based on the search space explored so far
+  template <typename T> void AppendValues(const T value, std::vector<double> &values);
+  Precision GetPrecision(const MemType type) const;
+
+  // Compares the output of a tuning run against the reference run on the device itself, such that
+  // only a few values have to be transferred. Returns "false" if this is not supported for the
+  // data-type or device, in which case the comparison is done on the host instead.
+  bool CompareOnDevice(const MemArgument &device_buffer, const size_t i, const size_t num_samples,
+                       ErrorStatistics &errors);
+  std::string VerificationSource(const MemType type) const;
+  void UploadReferenceOutput();
+
+  // Trains and uses a machine learning model based on the search space explored so far. The
+  // configurations are predicted in blocks of the given size.
+  static const size_t kPredictionBlockSize;
   void ModelPrediction(const Model model_type, const float validation_fraction,
                        const size_t test_top_x_configurations);
 
+  // Creates a machine learning model with the learning parameters used throughout the tuner
+  static std::unique_ptr<MLModel<float>> CreateModel(const Model model_type,
+                                                     const size_t num_features,
+                                                     const bool debug_display);
+
+  // Model-guided pruning: (re-)trains the model once enough new configurations of the kernel are
+  // measured, and checks whether a configuration is predicted to be much slower than the best one
+  void UpdatePruningModel(const size_t kernel_id);
+  void RecordPruningSample(const TunerResult &result);
+  static bool IsMeasured(const TunerResult &result);
+  bool IsPredictedSlow(const size_t kernel_id, const size_t configuration_id,
+                       float &predicted_time) const;
+
+  // Describes a kernel and the search method, such that a journal can only be resumed by a tuner
+  // which searches in exactly the same way
+  std::string JournalIdentity(const KernelInfo &kernel) const;
+
+  // Converts tuning results to and from the entries of the journal
+  static Journal::Record ToRecord(const TunerResult &result);
+  TunerResult FromRecord(const Journal::Record &record) const;
+
+  // Database helpers: the problem size of a kernel as used in the key of the database (its base
+  // global range), the configurations of the best stored results of a kernel which are part of its
+  // configuration space (at most this number), and storing the best result of each kernel (also
+  // referring to its compiled binary if the binary cache is enabled) among the given results
+  static const size_t kMaxWarmStartConfigurations;
+  static std::string DatabaseProblem(const KernelInfo &kernel);
+  std::vector<size_t> WarmStartIndices(const KernelInfo &kernel) const;
+  void StoreInDatabase(const std::vector<TunerResult> &results);
+
+  // Waits for a kernel run to complete, giving up after the timeout in milliseconds (if not zero).
+  // Returns false on a timeout. The timeout of a kernel is absolute, relative to the best time so
+  // far, or the smallest of both.
+  bool WaitForKernel(Event &event, const double timeout) const;
+  double KernelTimeout(const float best_time) const;
+
+  // Gives up on the kernel runs which are still in flight: the queue is replaced by a new one and
+  // the output buffers they write to are no longer used, since the device might still be busy
+  void AbandonRuns();
+
   // Prints results of a particular kernel run
   void PrintResult(FILE* fp, const TunerResult &result, const std::string &message) const;
 
-  // Retrieves the best tuning result
+  // Retrieves the best tuning result according to the objective
   TunerResult GetBestResult() const;
 
+  // Computes the value of a result which the search method minimises (see the Objective enum)
+  double ObjectiveValue(const TunerResult &result) const;
+
+  // Decodes the configuration of a tuning result using the parameters of its kernel. Results are
+  // stored as indices only, such that they don't hold copies of the parameter names.
+  KernelInfo::Configuration GetConfiguration(const TunerResult &result) const;
+
   // Loads a file from disk into a string
   std::string LoadFile(const std::string &filename);
 
@@ -167,13 +379,54 @@ class TunerImpl {
   Device device_;
   Context context_;
   Queue queue_;
+  Queue copy_queue_; // A separate queue for the uploads and downloads during initialization
+  std::vector<std::shared_ptr<void>> staging_buffers_; // Host memory of transfers still in flight
+
+  // The IDs this tuner was initialized with
+  size_t platform_id_;
+  size_t device_id_;
 
   // Settings
-  size_t num_runs_; // This is used for more-accurate execution time measurement
+  MeasurementPolicy measurement_policy_; // This is used for more-accurate execution time measurement
   bool has_reference_;
   bool suppress_output_;
   bool output_search_process_;
   std::string search_log_filename_;
+  size_t num_compile_threads_; // The number of background compilation threads (0 == disabled)
+
+  // The pool of background compilation threads, only present while tuning
+  std::unique_ptr<CompilePool> compile_pool_;
+
+  // The most recently used programs (most recent first) together with their source-code. This
+  // avoids compiling again for configurations which only differ in their thread-sizes.
+  static const size_t kNumRecentPrograms;
+  std::list<std::pair<std::string,Program>> recent_programs_;
+  std::unordered_map<std::string,std::vector<KernelResources>> program_resources_; // by source
+  std::unique_ptr<BinaryCache> binary_cache_;
+  std::unique_ptr<Journal> journal_; // records all results while tuning (if enabled)
+  std::unique_ptr<Database> database_; // the best results of earlier runs (if enabled)
+  TimingMethod timing_method_;
+  std::unique_ptr<PowerMeter> power_meter_; // measures the energy per run (if enabled)
+  Objective objective_;
+  double energy_weight_; // for the weighted objective only
+  bool collect_counters_;
+  CounterHooks counter_hooks_; // only used on this device
+  std::shared_ptr<Tracer> tracer_; // shared with the additional devices (if enabled)
+  ProgressFunction progress_callback_; // only while tuning asynchronously
+  double time_budget_; // in milliseconds, 0 for none
+  std::shared_ptr<std::atomic<bool>> cancel_tuning_; // set to stop tuning early (if present)
+  std::chrono::steady_clock::time_point tuning_start_;
+  double pruning_factor_; // 0 disables pruning
+  Model pruning_model_type_;
+  size_t pruning_model_warmup_; // 0 disables model-guided pruning
+  size_t pruning_model_interval_;
+  double pruning_model_margin_;
+  std::unique_ptr<MLModel<float>> pruning_model_; // the model of the kernel being tuned (if any)
+  size_t pruning_model_samples_; // the number of measured configurations the model was trained on
+  size_t pruning_model_measured_; // the number of measured configurations of the kernel so far
+  float pruning_model_best_; // the best measured time of the kernel so far
+  double kernel_timeout_; // in milliseconds, 0 disables the absolute timeout
+  double relative_kernel_timeout_; // w.r.t. the best time so far, 0 disables the relative timeout
 
   // The search method and its arguments
   SearchMethod search_method_;
@@ -182,22 +435,52 @@ class TunerImpl {
   // Storage of kernel sources, arguments, and parameters
   size_t argument_counter_;
   std::vector<KernelInfo> kernels_;
+  std::set<size_t> pipeline_stages_; // kernels which are only tuned as a stage of a pipeline
   std::vector<MemArgument> arguments_input_;
   std::vector<MemArgument> arguments_output_; // these remain constant
-  std::vector<MemArgument> arguments_output_copy_; // these may be modified by the kernel
+  std::vector<MemArgument> arguments_output_copy_; // these may be modified by the kernel (allocated once)
+  std::vector<MemArgument> abandoned_buffers_; // output copies of timed-out runs, freed at the end
+  std::vector<Verification> output_verifications_; // how each of the output buffers is verified
   std::vector<std::pair<size_t,int>> arguments_int_;
   std::vector<std::pair<size_t,size_t>> arguments_size_t_;
   std::vector<std::pair<size_t,float>> arguments_float_;
   std::vector<std::pair<size_t,double>> arguments_double_;
   std::vector<std::pair<size_t,float2>> arguments_float2_;
   std::vector<std::pair<size_t,double2>> arguments_double2_;
+  std::vector<std::pair<size_t,std::string>> arguments_parameter_; // the names of the parameters
 
   // Storage for the reference kernel and output
   std::unique_ptr<KernelInfo> reference_kernel_;
   std::vector<void*> reference_outputs_;
-
-  // List of tuning results
+  std::vector<MemArgument> reference_buffers_; // device copies of the above, uploaded on first use
+
+  // The compiled verification kernels per data-type. A null-pointer marks a data-type for which the
+  // kernel isn't available, such that the output is compared on the host.
+  std::map<MemType, std::shared_ptr<Program>> verification_programs_;
+  std::unique_ptr<Buffer<char>> verification_partials_; // their results, re-used by all calls
+
+  // Additional devices to run configurations on in parallel. Their tuners and the pool of threads
+  // driving them are only present while tuning.
+  std::vector<std::pair<size_t,size_t>> extra_devices_;
+  std::vector<std::unique_ptr<TunerImpl>> device_workers_;
+  std::unique_ptr<DevicePool<TunerResult>> device_pool_;
+
+  // Remote workers for distributed tuning, connected to while tuning. Disconnected workers are null.
+  size_t distributed_port_;
+  size_t num_remote_workers_; // 0 disables distributed tuning
+  std::vector<std::unique_ptr<Socket>> remote_workers_;
+
+  // The child process running the configurations of this device in isolation (if enabled)
+  std::unique_ptr<Sandbox> sandbox_;
+  double isolation_timeout_; // per configuration in seconds, 0 == no timeout
+  Message sandbox_specification_; // sent to each (re)started child, created once per tuning run
+
+  // List of tuning results and the best valid time of each kernel among these (by kernel ID)
   std::vector<TunerResult> tuning_results_;
+  std::unordered_map<size_t,float> best_times_;
+
+  // The results of the last multi-size sweep, per problem size
+  std::vector<std::vector<TunerResult>> sweep_results_;
 };
 
 // =================================================================================================
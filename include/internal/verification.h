@@ -0,0 +1,83 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the functions to compare an output buffer against the output of the reference
+// kernel according to a verification metric (see 'Verification' in the public API). The values of
+// both buffers are first converted to doubles; the original precision is only used for ULPs.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_VERIFICATION_H_
+#define CLTUNE_VERIFICATION_H_
+
+#include "cltune.h"
+
+#include <string> // std::string
+#include <vector> // std::vector
+#include <utility> // std::pair
+
+namespace cltune {
+// =================================================================================================
+
+// The number of contiguous elements compared per block when only a sample of a buffer is compared
+const size_t kVerificationBlockSize = 64;
+
+// The precision of the original data, which determines the size of a unit in the last place
+enum class Precision { kInteger, kHalf, kSingle, kDouble };
+
+// Summary of the differences between an output and a reference
+struct ErrorStatistics {
+  bool has_nan;
+  double absolute_sum;
+  double max_absolute;
+  double squared_sum; // the sum of the squared differences
+  double reference_squared_sum; // the sum of the squared reference values
+  double max_ulp;
+};
+
+// Returns the distance between two values in units in the last place of the given precision. Any
+// NaN results in infinity.
+double UlpDistance(const double reference, const double result, const Precision precision);
+
+// Computes the statistics of the differences between two sets of values of equal length
+ErrorStatistics ComputeErrors(const std::vector<double> &reference,
+                              const std::vector<double> &result, const Precision precision);
+
+// Returns the value of the metric, which is to be compared against the tolerance (not for kCustom)
+double MetricValue(const ErrorStatistics &errors, const VerificationMetric metric);
+bool IsWithinTolerance(const ErrorStatistics &errors, const Verification &verification);
+std::string MetricName(const VerificationMetric metric);
+
+// Returns the stride between the blocks of elements to compare when sampling a buffer. A stride
+// of 'kVerificationBlockSize' means every element is compared. The number of compared elements is
+// 'num_blocks * kVerificationBlockSize', in which the last block may extend beyond the buffer.
+size_t SampleStride(const size_t size, const size_t num_samples, size_t &num_blocks);
+
+// Returns the first element and the number of elements of each block of a sampled buffer
+std::vector<std::pair<size_t,size_t>> SampleBlocks(const size_t size, const size_t num_samples);
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_VERIFICATION_H_
+#endif
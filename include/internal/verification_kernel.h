@@ -0,0 +1,132 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the source-code of the device kernel which compares the output of a tuning
+// run against the output of the reference kernel. Each work-group computes the sum and the maximum
+// of the absolute differences, the sum of the squared differences, and the sum of the squared
+// reference values over a part of the buffers. It writes these four values to the 'partials'
+// buffer, the host combines the results of all work-groups. Only a sample of the elements is
+// compared if the stride between the blocks of BLOCK elements is larger than BLOCK. The kernel is
+// written for both OpenCL and CUDA: the back-end specific keywords are defined before it is
+// compiled, as are the (scalar) data-type (TYPE), the number of scalars per element (COMPONENTS,
+// 2 for complex numbers), the accumulator type (ACC), and the difference function (DIFF).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_VERIFICATION_KERNEL_H_
+#define CLTUNE_VERIFICATION_KERNEL_H_
+
+#include <string> // std::string
+
+namespace cltune {
+// =================================================================================================
+
+// The number of threads per work-group, which must be a power of 2
+const size_t kVerificationWorkGroupSize = 256;
+
+// The back-end specific definitions
+#if USE_OPENCL
+const std::string kVerificationDefines = R"(
+#define KERNEL __kernel
+#define GLOBAL __global
+#define LOCAL __local
+#define LOCAL_ID get_local_id(0)
+#define GROUP_ID get_group_id(0)
+#define GLOBAL_ID get_global_id(0)
+#define GLOBAL_SIZE get_global_size(0)
+#define BARRIER barrier(CLK_LOCAL_MEM_FENCE)
+typedef ulong SizeT;
+)";
+#else
+const std::string kVerificationDefines = R"(
+#define KERNEL extern "C" __global__
+#define GLOBAL
+#define LOCAL __shared__
+#define LOCAL_ID threadIdx.x
+#define GROUP_ID blockIdx.x
+#define GLOBAL_ID (blockIdx.x*blockDim.x + threadIdx.x)
+#define GLOBAL_SIZE (gridDim.x*blockDim.x)
+#define BARRIER __syncthreads()
+typedef unsigned long long SizeT;
+)";
+#endif
+
+// The kernel itself
+const std::string kVerificationKernel = R"(
+KERNEL void VerifyOutput(const unsigned int n, const unsigned int stride, const unsigned int size,
+                         const GLOBAL TYPE* reference, const GLOBAL TYPE* result,
+                         GLOBAL ACC* partials) {
+  LOCAL ACC sums[WGS];
+  LOCAL ACC maxima[WGS];
+  LOCAL ACC squares[WGS];
+  LOCAL ACC reference_squares[WGS];
+  const unsigned int lid = LOCAL_ID;
+
+  // Each thread loops over a part of the (sampled) elements
+  ACC sum = 0;
+  ACC maximum = 0;
+  ACC square = 0;
+  ACC reference_square = 0;
+  for (unsigned int k = GLOBAL_ID; k < n; k += GLOBAL_SIZE) {
+    const unsigned int i = (k / BLOCK) * stride + (k % BLOCK);
+    if (i < size) {
+      for (unsigned int c = 0; c < COMPONENTS; ++c) {
+        const TYPE reference_value = reference[i*COMPONENTS + c];
+        const ACC difference = DIFF(reference_value, result[i*COMPONENTS + c]);
+        sum += difference;
+        maximum = (difference > maximum) ? difference : maximum;
+        square += difference * difference;
+        reference_square += (ACC)reference_value * (ACC)reference_value;
+      }
+    }
+  }
+  sums[lid] = sum;
+  maxima[lid] = maximum;
+  squares[lid] = square;
+  reference_squares[lid] = reference_square;
+  BARRIER;
+
+  // Reduces the results of all threads in the work-group
+  for (unsigned int s = WGS/2; s > 0; s >>= 1) {
+    if (lid < s) {
+      sums[lid] += sums[lid + s];
+      maxima[lid] = (maxima[lid + s] > maxima[lid]) ? maxima[lid + s] : maxima[lid];
+      squares[lid] += squares[lid + s];
+      reference_squares[lid] += reference_squares[lid + s];
+    }
+    BARRIER;
+  }
+  if (lid == 0) {
+    partials[4*GROUP_ID] = sums[0];
+    partials[4*GROUP_ID + 1] = maxima[0];
+    partials[4*GROUP_ID + 2] = squares[0];
+    partials[4*GROUP_ID + 3] = reference_squares[0];
+  }
+}
+)";
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_VERIFICATION_KERNEL_H_
+#endif
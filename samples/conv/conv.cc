@@ -128,10 +128,12 @@ int main(int argc, char* argv[]) {
   // 1) Simulated annealing
   // 2) Particle swarm optimisation (PSO)
   // 3) Full search
+  // 4) Bayesian optimisation
   auto fraction = 1/64.0f;
   if      (method == 0) { tuner.UseRandomSearch(fraction); }
   else if (method == 1) { tuner.UseAnnealing(fraction, static_cast<double>(search_param_1)); }
   else if (method == 2) { tuner.UsePSO(fraction, static_cast<size_t>(search_param_1), 0.4, 0.0, 0.4); }
+  else if (method == 4) { tuner.UseBayesian(fraction); }
   else                  { tuner.UseFullSearch(); }
 
   // Outputs the search process to a file
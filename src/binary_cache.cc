@@ -0,0 +1,134 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the BinaryCache class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/binary_cache.h"
+
+#include <fstream> // std::ifstream, std::ofstream
+#include <sstream> // std::stringstream
+#include <cstdio> // std::rename, std::remove, snprintf
+#include <cstdint> // uint64_t
+#include <thread> // std::this_thread
+#include <functional> // std::hash
+
+// The ID of this process, part of the names of the temporary files
+#ifdef _WIN32
+  #include <process.h> // _getpid
+#else
+  #include <unistd.h> // getpid
+#endif
+
+namespace cltune {
+// =================================================================================================
+
+// Gathers all information which identifies the device and the compiler. A change of any of these
+// (e.g. a driver update) automatically results in new keys and thus invalidates old entries.
+BinaryCache::BinaryCache(const std::string &directory, const Platform &platform,
+                         const Device &device):
+    directory_(directory),
+    device_identity_() {
+  if (!directory_.empty() && directory_.back() != '/' && directory_.back() != '\\') {
+    directory_ += '/';
+  }
+  device_identity_ = platform.Name() + "\n" + platform.Version() + "\n" +
+                     device.Name() + "\n" + device.Version() + "\n" +
+                     device.DriverVersion() + "\n" + device.Capabilities() + "\n";
+}
+
+// =================================================================================================
+
+// The key combines the device identity, the build options, and the source. The options and the
+// source are length-prefixed such that different combinations can never produce the same input.
+std::string BinaryCache::Key(const std::string &source, const std::string &options) const {
+  return Hash(device_identity_ + std::to_string(options.size()) + ":" + options +
+              std::to_string(source.size()) + ":" + source);
+}
+
+// Reads the entire file into the binary (if it exists)
+bool BinaryCache::Load(const std::string &key, std::string &binary) const {
+  std::ifstream file(Filename(key), std::ios::binary);
+  if (file.fail()) { return false; }
+  std::stringstream file_contents;
+  file_contents << file.rdbuf();
+  binary = file_contents.str();
+  return !binary.empty();
+}
+
+// Retrieves the ID of this process
+namespace {
+  long ProcessID() {
+    #ifdef _WIN32
+      return static_cast<long>(_getpid());
+    #else
+      return static_cast<long>(getpid());
+    #endif
+  }
+}
+
+// Writes to a temporary file which is unique for this process and thread (multiple tuners can share
+// the cache directory), then moves it into place
+void BinaryCache::Store(const std::string &key, const std::string &binary) const {
+  if (binary.empty()) { return; }
+  const auto process_id = ProcessID();
+  const auto thread_id = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const auto temporary = Filename(key) + ".tmp" + std::to_string(process_id) + "_" +
+                         std::to_string(thread_id);
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    if (file.fail()) { return; }
+    file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (file.fail()) { file.close(); std::remove(temporary.c_str()); return; }
+  }
+  if (std::rename(temporary.c_str(), Filename(key).c_str()) != 0) {
+    std::remove(temporary.c_str());
+  }
+}
+
+// =================================================================================================
+
+// Implements the 64-bit variant of the Fowler-Noll-Vo (FNV-1a) hash
+std::string BinaryCache::Hash(const std::string &data) {
+  auto hash = uint64_t{14695981039346656037ULL};
+  for (const auto character: data) {
+    hash ^= static_cast<unsigned char>(character);
+    hash *= uint64_t{1099511628211ULL};
+  }
+  char result[17];
+  snprintf(result, sizeof(result), "%016llx", static_cast<unsigned long long>(hash));
+  return std::string(result);
+}
+
+// Binaries are stored as 'cltune_<key>.bin' in the cache directory
+std::string BinaryCache::Basename(const std::string &key) {
+  return "cltune_" + key + ".bin";
+}
+std::string BinaryCache::Filename(const std::string &key) const {
+  return directory_ + Basename(key);
+}
+
+// =================================================================================================
+} // namespace cltune
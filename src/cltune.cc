@@ -33,17 +33,58 @@
 
 #include <iostream> // FILE
 #include <limits> // std::numeric_limits
+#include <cstdlib> // std::exit
+#include <algorithm> // std::find
+#include <chrono> // std::chrono::seconds
+#include <atomic> // std::atomic
+#include <memory> // std::make_shared
 
 namespace cltune {
 // =================================================================================================
 
+// If this process was started as the child process of an isolated tuner (see
+// 'UseIsolatedExecution'), it runs the configurations handed out by its parent and then exits
+// instead of returning to the program
+namespace {
+  void RunAsSandboxChild() {
+    auto port = size_t{0};
+    auto platform_id = size_t{0};
+    auto device_id = size_t{0};
+    if (!Sandbox::IsChild(port, platform_id, device_id)) { return; }
+    try {
+      TunerImpl worker(platform_id, device_id);
+      worker.RunWorker("127.0.0.1", port);
+    } catch (...) {
+      std::exit(EXIT_FAILURE);
+    }
+    std::exit(EXIT_SUCCESS);
+  }
+
+  // Creates the implementation of a tuner. A sandbox child is detected before, such that it doesn't
+  // set up the device of the tuner next to the one of its worker.
+  template <typename... Arguments>
+  TunerImpl* NewTunerImpl(Arguments... arguments) {
+    RunAsSandboxChild();
+    return new TunerImpl(arguments...);
+  }
+}
+
 // The implemenation of the constructors and destructors are hidden in the TunerImpl class
 Tuner::Tuner():
-    pimpl(new TunerImpl()) {
+    pimpl(NewTunerImpl()) {
 }
 Tuner::Tuner(size_t platform_id, size_t device_id):
-    pimpl(new TunerImpl(platform_id, device_id)) {
+    pimpl(NewTunerImpl(platform_id, device_id)) {
+}
+Tuner::Tuner(const std::vector<std::pair<size_t,size_t>> &devices):
+    pimpl(NewTunerImpl(devices.at(0).first, devices.at(0).second)) {
+  pimpl->extra_devices_.assign(devices.begin() + 1, devices.end());
 }
+template <typename ContextHandle>
+Tuner::Tuner(size_t platform_id, size_t device_id, ContextHandle context):
+    pimpl(NewTunerImpl(platform_id, device_id, context)) {
+}
+template PUBLIC_API Tuner::Tuner(size_t, size_t, ContextRaw);
 Tuner::~Tuner() {
 }
 
@@ -95,16 +136,27 @@ void Tuner::SetReferenceFromString(const std::string &source, const std::string
 
 // Adds parameters for a kernel to tune. Also checks whether this parameter already exists.
 void Tuner::AddParameter(const size_t id, const std::string &parameter_name,
-                         const std::vector<size_t> &values) {
+                         const std::vector<size_t> &values, const ParameterMode mode) {
   if (id >= pimpl->kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
   if (pimpl->kernels_[id].ParameterExists(parameter_name)) {
     throw std::runtime_error("Parameter already exists");
   }
-  pimpl->kernels_[id].AddParameter(parameter_name, values);
+  pimpl->kernels_[id].AddParameter(parameter_name, values, mode);
 }
 
 // As above, but now adds a single valued parameter to the reference
-void Tuner::AddParameterReference(const std::string &parameter_name, const size_t value) {
+// Parameters passed as kernel arguments become single-valued parameters of the reference kernel,
+// of which the only configuration is selected immediately.
+void Tuner::AddParameterReference(const std::string &parameter_name, const size_t value,
+                                  const ParameterMode mode) {
+  if (mode == ParameterMode::kArgument) {
+    if (pimpl->reference_kernel_->ParameterExists(parameter_name)) {
+      throw std::runtime_error("Parameter already exists");
+    }
+    pimpl->reference_kernel_->AddParameter(parameter_name, {value}, mode);
+    pimpl->reference_kernel_->ComputeRanges(pimpl->reference_kernel_->GetConfiguration(0));
+    return;
+  }
   auto value_string = std::string{std::to_string(static_cast<long long>(value))};
   pimpl->reference_kernel_->PrependSource("#define "+parameter_name+" "+value_string);
 }
@@ -130,42 +182,109 @@ void Tuner::DivLocalSize(const size_t id, const StringRange range) {
   pimpl->kernels_[id].AddModifier(range, KernelInfo::ThreadSizeModifierType::kLocalDiv);
 }
 
-// Adds a contraint to the list of constraints for a particular kernel. First checks whether the
-// kernel exists and whether the parameters exist.
+// Adds a contraint to the list of constraints for a particular kernel. The values are copied into
+// a vector for the user's function object.
 void Tuner::AddConstraint(const size_t id, ConstraintFunction valid_if,
                           const std::vector<std::string> &parameters) {
+  const auto num_values = parameters.size();
+  AddFixedConstraint(id, [valid_if, num_values] (const size_t *values) {
+    return valid_if(std::vector<size_t>(values, values + num_values));
+  }, parameters);
+}
+
+// As above, but for the local memory usage
+void Tuner::SetLocalMemoryUsage(const size_t id, LocalMemoryFunction amount,
+                                const std::vector<std::string> &parameters) {
+  const auto num_values = parameters.size();
+  SetFixedLocalMemoryUsage(id, [amount, num_values] (const size_t *values) {
+    return amount(std::vector<size_t>(values, values + num_values));
+  }, parameters);
+}
+
+// Adds a constraint which takes the values as an array. First checks whether the kernel exists and
+// whether the parameters exist.
+void Tuner::AddFixedConstraint(const size_t id, FixedConstraintFunction valid_if,
+                               const std::vector<std::string> &parameters) {
   if (id >= pimpl->kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
   for (auto &parameter: parameters) {
     if (!pimpl->kernels_[id].ParameterExists(parameter)) {
       throw std::runtime_error("Invalid parameter");
     }
   }
-  pimpl->kernels_[id].AddConstraint(valid_if, parameters);
+  pimpl->kernels_[id].AddFixedConstraint(valid_if, parameters);
 }
 
 // As above, but for the local memory usage
-void Tuner::SetLocalMemoryUsage(const size_t id, LocalMemoryFunction amount,
-                                const std::vector<std::string> &parameters) {
+void Tuner::SetFixedLocalMemoryUsage(const size_t id, FixedLocalMemoryFunction amount,
+                                     const std::vector<std::string> &parameters) {
   if (id >= pimpl->kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
   for (auto &parameter: parameters) {
     if (!pimpl->kernels_[id].ParameterExists(parameter)) {
       throw std::runtime_error("Invalid parameter");
     }
   }
-  pimpl->kernels_[id].SetLocalMemoryUsage(amount, parameters);
+  pimpl->kernels_[id].SetFixedLocalMemoryUsage(amount, parameters);
+}
+
+// =================================================================================================
+
+// Creates a pipeline of kernels added before. Its source-code holds the source of each of the
+// kernels once, such that each configuration is compiled as a single program. A parameter which is
+// shared by several kernels has to have the same values and mode in each of them.
+size_t Tuner::AddPipeline(const std::string &pipeline_name, const std::vector<size_t> &ids,
+                          const std::vector<std::vector<size_t>> &arguments) {
+  if (ids.empty()) { throw std::runtime_error("A pipeline requires at least one kernel"); }
+  if (arguments.size() != ids.size()) {
+    throw std::runtime_error("Expected the arguments of "+std::to_string(ids.size())+" kernel(s)");
+  }
+  auto sources = std::vector<std::string>();
+  auto source = std::string{};
+  for (auto &id: ids) {
+    if (id >= pimpl->kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
+    const auto &kernel = pimpl->kernels_[id];
+    if (kernel.IsPipeline() || pimpl->pipeline_stages_.count(id) != 0) {
+      throw std::runtime_error("Kernel "+kernel.name()+" is already part of a pipeline");
+    }
+    if (std::find(sources.begin(), sources.end(), kernel.source()) == sources.end()) {
+      sources.push_back(kernel.source());
+      source += kernel.source() + "\n";
+    }
+  }
+  auto pipeline = KernelInfo(pipeline_name, source, pimpl->device());
+  pipeline.set_global_base(pimpl->kernels_[ids.front()].global_base());
+  pipeline.set_local_base(pimpl->kernels_[ids.front()].local_base());
+  for (auto i=size_t{0}; i<ids.size(); ++i) {
+    const auto &kernel = pimpl->kernels_[ids[i]];
+    for (auto &parameter: kernel.parameters()) {
+      auto exists = false;
+      for (auto &existing: pipeline.parameters()) {
+        if (existing.name != parameter.name) { continue; }
+        if (existing.values != parameter.values || existing.mode != parameter.mode) {
+          throw std::runtime_error("Parameter "+parameter.name+" differs between the kernels");
+        }
+        exists = true;
+      }
+      if (!exists) { pipeline.AddParameter(parameter.name, parameter.values, parameter.mode); }
+    }
+    pipeline.AddStage(kernel, arguments[i]);
+  }
+  pimpl->kernels_.push_back(pipeline);
+  for (auto &id: ids) { pimpl->pipeline_stages_.insert(id); }
+  return pimpl->kernels_.size() - 1;
 }
 
 
 // =================================================================================================
 
 // Creates a new buffer of type Memory (containing both host and device data) based on a source
-// vector of data. Then, upload it to the device and store the argument in a list.
+// vector of data. Then, upload it to the device and store the argument in a list. The upload is
+// not waited for: it continues in the background until the first kernel is run.
 template <typename T>
 void Tuner::AddArgumentInput(const std::vector<T> &source) {
   auto device_buffer = Buffer<T>(pimpl->context(), BufferAccess::kNotOwned, source.size());
-  device_buffer.Write(pimpl->queue(), source.size(), source);
+  pimpl->UploadAsync(device_buffer, source);
   auto argument = TunerImpl::MemArgument{pimpl->argument_counter_++, source.size(),
-                                         pimpl->GetType<T>(), device_buffer()};
+                                         pimpl->GetType<T>(), device_buffer(), false, false};
   pimpl->arguments_input_.push_back(argument);
 }
 
@@ -182,23 +301,127 @@ template void PUBLIC_API Tuner::AddArgumentInput<double2>(const std::vector<doub
 // Similar to the above function, but now marked as output buffer. Output buffers are special in the
 // sense that they will be checked in the verification process.
 template <typename T>
-void Tuner::AddArgumentOutput(const std::vector<T> &source) {
+void Tuner::AddArgumentOutput(const std::vector<T> &source, const Verification &verification) {
+  if (verification.metric == VerificationMetric::kCustom && !verification.function) {
+    throw std::runtime_error("A custom verification metric requires a verification function");
+  }
   auto device_buffer = Buffer<T>(pimpl->context(), BufferAccess::kNotOwned, source.size());
-  device_buffer.Write(pimpl->queue(), source.size(), source);
+  pimpl->UploadAsync(device_buffer, source);
   auto argument = TunerImpl::MemArgument{pimpl->argument_counter_++, source.size(),
-                                         pimpl->GetType<T>(), device_buffer()};
+                                         pimpl->GetType<T>(), device_buffer(), false, false};
+  pimpl->arguments_output_.push_back(argument);
+  pimpl->output_verifications_.push_back(verification);
+}
+
+// Compiles the function for various data-types
+template void PUBLIC_API Tuner::AddArgumentOutput<short>(const std::vector<short>&,
+                                                         const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<int>(const std::vector<int>&,
+                                                       const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<size_t>(const std::vector<size_t>&,
+                                                          const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<half>(const std::vector<half>&,
+                                                        const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<float>(const std::vector<float>&,
+                                                         const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<double>(const std::vector<double>&,
+                                                          const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<float2>(const std::vector<float2>&,
+                                                          const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<double2>(const std::vector<double2>&,
+                                                           const Verification&);
+
+// As above, but for buffers owned by the user which already live on the device
+template <typename T, typename BufferHandle>
+void Tuner::AddArgumentInput(const BufferHandle buffer, const size_t size) {
+  auto argument = TunerImpl::MemArgument{pimpl->argument_counter_++, size, pimpl->GetType<T>(),
+                                         buffer, false, true};
+  pimpl->arguments_input_.push_back(argument);
+}
+template <typename T, typename BufferHandle>
+void Tuner::AddArgumentOutput(const BufferHandle buffer, const size_t size,
+                              const Verification &verification) {
+  if (verification.metric == VerificationMetric::kCustom && !verification.function) {
+    throw std::runtime_error("A custom verification metric requires a verification function");
+  }
+  auto argument = TunerImpl::MemArgument{pimpl->argument_counter_++, size, pimpl->GetType<T>(),
+                                         buffer, false, true};
   pimpl->arguments_output_.push_back(argument);
+  pimpl->output_verifications_.push_back(verification);
+}
+
+// Compiles the functions for various data-types
+template void PUBLIC_API Tuner::AddArgumentInput<short>(const BufferRaw, const size_t);
+template void PUBLIC_API Tuner::AddArgumentInput<int>(const BufferRaw, const size_t);
+template void PUBLIC_API Tuner::AddArgumentInput<size_t>(const BufferRaw, const size_t);
+template void PUBLIC_API Tuner::AddArgumentInput<half>(const BufferRaw, const size_t);
+template void PUBLIC_API Tuner::AddArgumentInput<float>(const BufferRaw, const size_t);
+template void PUBLIC_API Tuner::AddArgumentInput<double>(const BufferRaw, const size_t);
+template void PUBLIC_API Tuner::AddArgumentInput<float2>(const BufferRaw, const size_t);
+template void PUBLIC_API Tuner::AddArgumentInput<double2>(const BufferRaw, const size_t);
+template void PUBLIC_API Tuner::AddArgumentOutput<short>(const BufferRaw, const size_t,
+                                                         const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<int>(const BufferRaw, const size_t,
+                                                       const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<size_t>(const BufferRaw, const size_t,
+                                                          const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<half>(const BufferRaw, const size_t,
+                                                        const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<float>(const BufferRaw, const size_t,
+                                                         const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<double>(const BufferRaw, const size_t,
+                                                          const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<float2>(const BufferRaw, const size_t,
+                                                          const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutput<double2>(const BufferRaw, const size_t,
+                                                           const Verification&);
+
+// Creates a device buffer without a host-side copy. It is initialised to zero, such that the
+// kernels of a pipeline start from the same contents on every device.
+template <typename T>
+void Tuner::AddArgumentIntermediate(const size_t size) {
+  auto device_buffer = Buffer<T>(pimpl->context(), BufferAccess::kNotOwned, size);
+  pimpl->UploadAsync(device_buffer, std::vector<T>(size));
+  auto argument = TunerImpl::MemArgument{pimpl->argument_counter_++, size, pimpl->GetType<T>(),
+                                         device_buffer(), false, false};
+  pimpl->arguments_input_.push_back(argument);
+}
+
+// Compiles the function for various data-types
+template void PUBLIC_API Tuner::AddArgumentIntermediate<short>(const size_t);
+template void PUBLIC_API Tuner::AddArgumentIntermediate<int>(const size_t);
+template void PUBLIC_API Tuner::AddArgumentIntermediate<size_t>(const size_t);
+template void PUBLIC_API Tuner::AddArgumentIntermediate<half>(const size_t);
+template void PUBLIC_API Tuner::AddArgumentIntermediate<float>(const size_t);
+template void PUBLIC_API Tuner::AddArgumentIntermediate<double>(const size_t);
+template void PUBLIC_API Tuner::AddArgumentIntermediate<float2>(const size_t);
+template void PUBLIC_API Tuner::AddArgumentIntermediate<double2>(const size_t);
+
+// As above, but marks the buffer as output-only: it is not restored before each run
+template <typename T>
+void Tuner::AddArgumentOutputOnly(const std::vector<T> &source,
+                                  const Verification &verification) {
+  AddArgumentOutput(source, verification);
+  pimpl->arguments_output_.back().no_restore = true;
 }
 
 // Compiles the function for various data-types
-template void PUBLIC_API Tuner::AddArgumentOutput<short>(const std::vector<short>&);
-template void PUBLIC_API Tuner::AddArgumentOutput<int>(const std::vector<int>&);
-template void PUBLIC_API Tuner::AddArgumentOutput<size_t>(const std::vector<size_t>&);
-template void PUBLIC_API Tuner::AddArgumentOutput<half>(const std::vector<half>&);
-template void PUBLIC_API Tuner::AddArgumentOutput<float>(const std::vector<float>&);
-template void PUBLIC_API Tuner::AddArgumentOutput<double>(const std::vector<double>&);
-template void PUBLIC_API Tuner::AddArgumentOutput<float2>(const std::vector<float2>&);
-template void PUBLIC_API Tuner::AddArgumentOutput<double2>(const std::vector<double2>&);
+template void PUBLIC_API Tuner::AddArgumentOutputOnly<short>(const std::vector<short>&,
+                                                             const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutputOnly<int>(const std::vector<int>&,
+                                                           const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutputOnly<size_t>(const std::vector<size_t>&,
+                                                              const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutputOnly<half>(const std::vector<half>&,
+                                                            const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutputOnly<float>(const std::vector<float>&,
+                                                             const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutputOnly<double>(const std::vector<double>&,
+                                                              const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutputOnly<float2>(const std::vector<float2>&,
+                                                              const Verification&);
+template void PUBLIC_API Tuner::AddArgumentOutputOnly<double2>(const std::vector<double2>&,
+                                                               const Verification&);
 
 // Sets a scalar value as an argument to the kernel. Since a vector of scalars of any type doesn't
 // exist, there is no general implemenation. Instead, each data-type has its specialised version in
@@ -228,6 +451,11 @@ template <> void PUBLIC_API Tuner::AddArgumentScalar<double2>(const double2 argu
   pimpl->arguments_double2_.push_back({pimpl->argument_counter_++, argument});
 }
 
+// The value is set for each configuration separately, see 'RunKernel'
+void Tuner::AddArgumentParameter(const std::string &parameter_name) {
+  pimpl->arguments_parameter_.push_back({pimpl->argument_counter_++, parameter_name});
+}
+
 // =================================================================================================
 
 // Use full search as a search strategy. This is the default method.
@@ -242,10 +470,12 @@ void Tuner::UseRandomSearch(const double fraction) {
 }
 
 // Use simulated annealing as a search strategy.
-void Tuner::UseAnnealing(const double fraction, const double max_temperature) {
+void Tuner::UseAnnealing(const double fraction, const double max_temperature,
+                         const size_t num_chains) {
   pimpl->search_method_ = SearchMethod::Annealing;
   pimpl->search_args_.push_back(fraction);
   pimpl->search_args_.push_back(max_temperature);
+  pimpl->search_args_.push_back(static_cast<double>(num_chains));
 }
 
 // Use PSO as a search strategy.
@@ -259,6 +489,12 @@ void Tuner::UsePSO(const double fraction, const size_t swarm_size, const double
   pimpl->search_args_.push_back(influence_random);
 }
 
+// Use Bayesian optimisation as a search strategy.
+void Tuner::UseBayesian(const double fraction) {
+  pimpl->search_method_ = SearchMethod::Bayesian;
+  pimpl->search_args_.push_back(fraction);
+}
+
 
 // Output the search process to a file. This is disabled per default.
 void Tuner::OutputSearchLog(const std::string &filename) {
@@ -273,6 +509,66 @@ void Tuner::Tune() {
   pimpl->Tune();
 }
 
+// Tunes in the background. The cancellation flag belongs to this run only, such that cancelling
+// after the run has finished doesn't affect later runs.
+TuningHandle Tuner::TuneAsync(ProgressFunction callback, const double time_budget_ms) {
+  if (time_budget_ms < 0.0) { throw std::runtime_error("The time budget can't be negative"); }
+  auto cancel = std::make_shared<std::atomic<bool>>(false);
+  auto done = pimpl->TuneAsync(callback, time_budget_ms, cancel);
+  return TuningHandle(done, [cancel] () { *cancel = true; });
+}
+
+// Tunes for multiple problem sizes. See the TunerImpl's implemenation for details
+void Tuner::TuneSizes(const std::vector<ProblemSize> &sizes) {
+  pimpl->TuneSizes(sizes);
+}
+
+// Retrieves the parameters of the best result of a problem size of the sweep
+std::unordered_map<std::string, size_t> Tuner::GetSweepResult(const size_t size_id) const {
+  if (size_id >= pimpl->sweep_results_.size()) { throw std::runtime_error("Invalid size ID"); }
+  auto parameters = std::unordered_map<std::string, size_t>{};
+  auto best_time = std::numeric_limits<float>::max();
+  for (const auto &result: pimpl->sweep_results_[size_id]) {
+    if (!result.status || result.time >= best_time) { continue; }
+    best_time = result.time;
+    parameters.clear();
+    for (const auto &setting: pimpl->GetConfiguration(result)) {
+      parameters[setting.name] = setting.value;
+    }
+  }
+  return parameters;
+}
+
+// Starts a new journal, which is written to while tuning
+void Tuner::UseJournal(const std::string &filename) {
+  pimpl->journal_.reset(new Journal(filename, false));
+}
+
+// Reads the journal of an earlier run and tunes the remaining configurations
+void Tuner::Resume(const std::string &filename) {
+  pimpl->journal_.reset(new Journal(filename, true));
+  pimpl->Tune();
+}
+
+// Opens the database of the best results, reading its entries
+void Tuner::UseDatabase(const std::string &filename) {
+  pimpl->database_.reset(new Database(filename, false));
+}
+
+// Looks up the best stored result of a kernel
+std::unordered_map<std::string, size_t> Tuner::GetDatabaseResult(const size_t id) const {
+  if (id >= pimpl->kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
+  if (!pimpl->database_) { throw std::runtime_error("No database in use, see 'UseDatabase'"); }
+  const auto &kernel = pimpl->kernels_[id];
+  auto entry = Database::Entry{};
+  auto parameters = std::unordered_map<std::string, size_t>{};
+  if (pimpl->database_->Find(kernel.name(), pimpl->device().Name(),
+                             TunerImpl::DatabaseProblem(kernel), entry)) {
+    for (auto &setting: entry.parameters) { parameters[setting.first] = setting.second; }
+  }
+  return parameters;
+}
+
 // =================================================================================================
 
 // Fits a machine learning model. See the TunerImpl's implemenation for details
@@ -287,7 +583,7 @@ void Tuner::ModelPrediction(const Model model_type, const float validation_fract
 // Retrieves the parameters of the best tuning result
 std::unordered_map<std::string, size_t> Tuner::GetBestResult() const {
   const auto best_result = pimpl->GetBestResult();
-  const auto best_configuration = best_result.configuration;
+  const auto best_configuration = pimpl->GetConfiguration(best_result);
 
   // Converts the std::vector<KernelInfo::Setting> into an unordere map of strings and integers
   auto parameters = std::unordered_map<std::string, size_t>{};
@@ -332,12 +628,13 @@ void Tuner::PrintFormatted() const {
   const auto best_result = pimpl->GetBestResult();
 
   // Prints the best result in C++ database format
+  const auto best_configuration = pimpl->GetConfiguration(best_result);
   auto count = size_t{0};
   pimpl->PrintHeader("Printing best result in database format to stdout");
   fprintf(stdout, "{ \"%s\", { ", pimpl->device().Name().c_str());
-  for (auto &setting: best_result.configuration) {
+  for (auto &setting: best_configuration) {
     fprintf(stdout, "%s", setting.GetDatabase().c_str());
-    if (count < best_result.configuration.size()-1) {
+    if (count < best_configuration.size()-1) {
       fprintf(stdout, ", ");
     }
     count++;
@@ -374,6 +671,19 @@ void Tuner::PrintJSON(const std::string &filename,
     }
   }
 
+  // Prints all the parameters of a result
+  const auto print_parameters = [&] (const TunerImpl::TunerResult &result) {
+    fprintf(file, "      \"parameters\": {");
+    const auto configuration = pimpl->GetConfiguration(result);
+    auto num_configs = configuration.size();
+    for (auto p=size_t{0}; p<num_configs; ++p) {
+      auto config = configuration[p];
+      fprintf(file, "\"%s\": %zu", config.name.c_str(), config.value);
+      if (p < num_configs-1) { fprintf(file, ","); }
+    }
+    fprintf(file, "}\n");
+  };
+
   // Loops over all the results
   auto num_results = results.size();
   for (auto r=size_t{0}; r<num_results; ++r) {
@@ -381,22 +691,56 @@ void Tuner::PrintJSON(const std::string &filename,
     fprintf(file, "    {\n");
     fprintf(file, "      \"kernel\": \"%s\",\n", result.kernel_name.c_str());
     fprintf(file, "      \"time\": %.3lf,\n", result.time);
-
-    // Loops over all the parameters for this result
-    fprintf(file, "      \"parameters\": {");
-    auto num_configs = result.configuration.size();
-    for (auto p=size_t{0}; p<num_configs; ++p) {
-      auto config = result.configuration[p];
-      fprintf(file, "\"%s\": %zu", config.name.c_str(), config.value);
-      if (p < num_configs-1) { fprintf(file, ","); }
+    if (result.timing_method == TimingMethod::kBoth) {
+      fprintf(file, "      \"host_time\": %.3lf,\n", result.host_time);
     }
-    fprintf(file, "}\n");
+    if (pimpl->power_meter_) { fprintf(file, "      \"energy\": %.3lf,\n", result.energy); }
+    fprintf(file, "      \"timing\": \"%s\",\n",
+            (result.timing_method == TimingMethod::kHostClock) ? "host" : "device");
+    if (result.pruned) { fprintf(file, "      \"pruned\": true,\n"); }
+    if (!result.counters.empty()) {
+      fprintf(file, "      \"counters\": {");
+      for (auto c=size_t{0}; c<result.counters.size(); ++c) {
+        fprintf(file, "\"%s\": %.6g", result.counters[c].first.c_str(), result.counters[c].second);
+        if (c < result.counters.size()-1) { fprintf(file, ","); }
+      }
+      fprintf(file, "},\n");
+    }
+    print_parameters(result);
 
     // The footer
     fprintf(file, "    }");
     if (r < num_results-1) { fprintf(file, ","); }
     fprintf(file, "\n");
   }
+
+  // With power measurements, also prints the trade-offs between the time and the energy: the Pareto
+  // front of each kernel, ordered by the time
+  if (pimpl->power_meter_) {
+    fprintf(file, "  ],\n");
+    fprintf(file, "  \"pareto_front\": [\n");
+    auto front = std::vector<TunerImpl::TunerResult>();
+    for (auto kernel_id=size_t{0}; kernel_id<pimpl->kernels_.size(); ++kernel_id) {
+      auto kernel_results = std::vector<TunerImpl::TunerResult>();
+      auto points = std::vector<std::pair<double,double>>();
+      for (auto &result: results) {
+        if (result.kernel_id != kernel_id || result.energy == 0.0f) { continue; }
+        kernel_results.push_back(result);
+        points.push_back({result.time, result.energy});
+      }
+      for (auto &i: ParetoFront(points)) { front.push_back(kernel_results[i]); }
+    }
+    for (auto r=size_t{0}; r<front.size(); ++r) {
+      fprintf(file, "    {\n");
+      fprintf(file, "      \"kernel\": \"%s\",\n", front[r].kernel_name.c_str());
+      fprintf(file, "      \"time\": %.3lf,\n", front[r].time);
+      fprintf(file, "      \"energy\": %.3lf,\n", front[r].energy);
+      print_parameters(front[r]);
+      fprintf(file, "    }");
+      if (r < front.size()-1) { fprintf(file, ","); }
+      fprintf(file, "\n");
+    }
+  }
   fprintf(file, "  ]\n");
   fprintf(file, "}\n");
   fclose(file);
@@ -417,12 +761,16 @@ void Tuner::PrintToFile(const std::string &filename) const {
       }
       processed_kernels.push_back(tuning_result.kernel_name);
 
-      // Prints the header in case of a new kernel name
+      // Prints the header in case of a new kernel name. The counters follow the parameters.
+      const auto configuration = pimpl->GetConfiguration(tuning_result);
       if (new_kernel) {
         fprintf(file, "name;time;threads;");
-        for (auto &setting: tuning_result.configuration) {
+        for (auto &setting: configuration) {
           fprintf(file, "%s;", setting.name.c_str());
         }
+        for (auto &counter: tuning_result.counters) {
+          fprintf(file, "%s;", counter.first.c_str());
+        }
         fprintf(file, "\n");
       }
 
@@ -430,15 +778,42 @@ void Tuner::PrintToFile(const std::string &filename) const {
       fprintf(file, "%s;", tuning_result.kernel_name.c_str());
       fprintf(file, "%.2lf;", tuning_result.time);
       fprintf(file, "%zu;", tuning_result.threads);
-      for (auto &setting: tuning_result.configuration) {
+      for (auto &setting: configuration) {
         fprintf(file, "%zu;", setting.value);
       }
+      for (auto &counter: tuning_result.counters) {
+        fprintf(file, "%.6g;", counter.second);
+      }
       fprintf(file, "\n");
     }
   }
   fclose(file);
 }
 
+// Writes all recorded spans as a Chrome trace
+void Tuner::PrintTrace(const std::string &filename) const {
+  if (!pimpl->tracer_) { throw std::runtime_error("Tracing is not enabled"); }
+  pimpl->PrintHeader("Printing trace to file: "+filename);
+  pimpl->tracer_->WriteChromeTrace(filename);
+}
+
+// Prints the total time per phase, also as a percentage of the wall-clock time since tracing was
+// enabled. Phases of different threads overlap in time, so the percentages can add up to more.
+void Tuner::PrintTraceSummary() const {
+  if (!pimpl->tracer_) { throw std::runtime_error("Tracing is not enabled"); }
+  const auto elapsed = pimpl->tracer_->Elapsed();
+  pimpl->PrintHeader("Printing trace summary to stdout");
+  fprintf(stdout, "%s %-14s %8s %12s %10s %10s %7s\n", pimpl->kMessageResult.c_str(), "phase",
+          "count", "total (ms)", "mean (ms)", "max (ms)", "share");
+  for (auto &phase: pimpl->tracer_->Summary()) {
+    fprintf(stdout, "%s %-14s %8zu %12.1lf %10.3lf %10.3lf %6.1lf%%\n",
+            pimpl->kMessageResult.c_str(), phase.name.c_str(), phase.count, phase.total,
+            phase.total / phase.count, phase.maximum, 100.0 * phase.total / elapsed);
+  }
+  fprintf(stdout, "%s %-14s %8s %12.1lf\n", pimpl->kMessageResult.c_str(), "wall-clock", "",
+          elapsed);
+}
+
 // Set the flag to suppress output to true. Note that this cannot be undone.
 void Tuner::SuppressOutput() {
   pimpl->suppress_output_ = true;
@@ -446,7 +821,127 @@ void Tuner::SuppressOutput() {
 
 // Sets the number of runs to average time measurements.
 void Tuner::SetNumRuns(const size_t num_runs) {
-  pimpl->num_runs_ = num_runs;
+  if (num_runs == 0) { throw std::runtime_error("Measurement policy requires at least one run"); }
+  pimpl->measurement_policy_.min_runs = num_runs;
+  pimpl->measurement_policy_.max_runs = num_runs;
+}
+
+// Sets the policy for repeated time measurements
+void Tuner::SetMeasurementPolicy(const MeasurementPolicy &policy) {
+  if (policy.max_runs == 0) { throw std::runtime_error("Measurement policy requires at least one run"); }
+  if (policy.min_runs > policy.max_runs) {
+    throw std::runtime_error("Measurement policy's minimum number of runs exceeds the maximum");
+  }
+  if (!(policy.trimmed_fraction >= 0.0 && policy.trimmed_fraction < 0.5)) {
+    throw std::runtime_error("Measurement policy's trimmed fraction must be in [0, 0.5)");
+  }
+  pimpl->measurement_policy_ = policy;
+}
+
+// Sets the factor to prune slow configurations (0 disables pruning)
+void Tuner::SetPruningFactor(const double factor) {
+  if (factor != 0.0 && factor < 1.0) { throw std::runtime_error("Pruning factor must be at least 1"); }
+  pimpl->pruning_factor_ = factor;
+}
+
+// Sets the model used to skip configurations predicted to be slow (a warm-up of 0 disables it)
+void Tuner::UseModelPruning(const Model model_type, const size_t num_warmup,
+                            const size_t retrain_interval, const double margin) {
+  if (num_warmup != 0 && retrain_interval == 0) {
+    throw std::runtime_error("Model pruning retrain interval must be at least 1");
+  }
+  if (margin < 0.0) { throw std::runtime_error("Model pruning margin can't be negative"); }
+  pimpl->pruning_model_type_ = model_type;
+  pimpl->pruning_model_warmup_ = num_warmup;
+  pimpl->pruning_model_interval_ = retrain_interval;
+  pimpl->pruning_model_margin_ = margin;
+}
+
+// Sets the absolute and relative kernel timeouts (0 disables them)
+void Tuner::SetKernelTimeout(const double timeout_ms, const double relative_factor) {
+  if (timeout_ms < 0.0) { throw std::runtime_error("Kernel timeout can't be negative"); }
+  if (relative_factor != 0.0 && relative_factor < 1.0) {
+    throw std::runtime_error("Relative kernel timeout must be at least 1");
+  }
+  pimpl->kernel_timeout_ = timeout_ms;
+  pimpl->relative_kernel_timeout_ = relative_factor;
+}
+
+// Sets the method of measuring the execution times
+void Tuner::SetTimingMethod(const TimingMethod method) {
+  pimpl->timing_method_ = method;
+}
+
+// Enables the power measurements
+void Tuner::UsePowerSensor(PowerFunction sensor, const double interval_ms) {
+  pimpl->power_meter_.reset(new PowerMeter(sensor, interval_ms));
+}
+
+// Enables the collection of counters
+void Tuner::UseCounters(const CounterHooks &hooks) {
+  pimpl->collect_counters_ = true;
+  pimpl->counter_hooks_ = hooks;
+}
+
+// Enables the phase tracer, which starts its clock
+void Tuner::UseTracing() {
+  pimpl->tracer_ = std::make_shared<Tracer>();
+}
+
+// Sets the objective of the search (the time by default)
+void Tuner::SetObjective(const Objective objective, const double energy_weight) {
+  if (energy_weight < 0.0 || energy_weight > 1.0) {
+    throw std::runtime_error("The energy weight must be between 0 and 1");
+  }
+  pimpl->objective_ = objective;
+  pimpl->energy_weight_ = energy_weight;
+}
+
+// Sets the number of background compilation threads (0 disables background compilation)
+void Tuner::SetCompileThreads(const size_t num_threads) {
+  pimpl->num_compile_threads_ = num_threads;
+}
+
+// Enables the on-disk cache of compiled kernels
+void Tuner::UseBinaryCache(const std::string &directory) {
+  pimpl->binary_cache_.reset(new BinaryCache(directory, pimpl->platform(), pimpl->device()));
+}
+
+// =================================================================================================
+
+// Enables distributed tuning as the coordinator
+void Tuner::UseDistributedWorkers(const size_t port, const size_t num_workers) {
+  if (num_workers == 0) { throw std::runtime_error("At least one remote worker is required"); }
+  pimpl->distributed_port_ = port;
+  pimpl->num_remote_workers_ = num_workers;
+}
+
+// Runs as a remote worker of a coordinator
+void Tuner::RunWorker(const std::string &host, const size_t port) {
+  pimpl->RunWorker(host, port);
+}
+
+// Enables running all configurations of this device in a child process
+void Tuner::UseIsolatedExecution(const double timeout_seconds) {
+  pimpl->sandbox_.reset(new Sandbox(pimpl->platform_id_, pimpl->device_id_));
+  pimpl->isolation_timeout_ = timeout_seconds;
+}
+
+// =================================================================================================
+
+// The handle of a tuning run in the background: the future of its result and a way to cancel it
+TuningHandle::TuningHandle(std::shared_future<void> done, std::function<void()> cancel):
+    done_(done),
+    cancel_(cancel) {
+}
+void TuningHandle::Cancel() {
+  if (cancel_) { cancel_(); }
+}
+bool TuningHandle::IsDone() const {
+  return done_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+void TuningHandle::Wait() const {
+  done_.get();
 }
 
 // =================================================================================================
@@ -0,0 +1,121 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the CompilePool class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/compile_pool.h"
+
+#include <utility> // std::move
+#include <exception> // std::current_exception
+
+namespace cltune {
+// =================================================================================================
+
+// Starts the worker threads, which wait for jobs to arrive
+CompilePool::CompilePool(BuildFunction build_function, const size_t num_threads):
+    build_function_(build_function),
+    workers_(),
+    jobs_(),
+    programs_(),
+    mutex_(),
+    condition_(),
+    stop_(false) {
+  for (auto t=size_t{0}; t<num_threads; ++t) {
+    workers_.push_back(std::thread(&CompilePool::WorkerLoop, this));
+  }
+}
+
+// Signals the worker threads to stop and waits for them to finish their current job. Jobs which
+// haven't been started yet are discarded.
+CompilePool::~CompilePool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  for (auto &worker: workers_) { worker.join(); }
+}
+
+// =================================================================================================
+
+// Adds a new job to the back of the job-queue, unless this source is already known
+void CompilePool::Enqueue(const std::string &source) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (programs_.find(source) != programs_.end()) { return; }
+    auto job = Job{source, std::promise<Program>()};
+    programs_.emplace(source, job.promise.get_future());
+    jobs_.push_back(std::move(job));
+  }
+  condition_.notify_one();
+}
+
+// Takes the (future) program out of the pool and waits for it. Jobs that are still in the queue
+// are not yet being worked on: in that case the job is taken out and compiled right here.
+Program CompilePool::Retrieve(const std::string &source) {
+  auto program = std::future<Program>();
+  auto compile_here = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = programs_.find(source);
+    if (entry != programs_.end()) {
+      program = std::move(entry->second);
+      programs_.erase(entry);
+      compile_here = false;
+      for (auto job=jobs_.begin(); job!=jobs_.end(); ++job) {
+        if (job->source == source) { jobs_.erase(job); compile_here = true; break; }
+      }
+    }
+  }
+  if (compile_here) { return build_function_(source); }
+  return program.get();
+}
+
+// =================================================================================================
+
+// Repeatedly takes a job from the front of the queue and compiles it. Any exception thrown by the
+// build function is stored in the promise, such that it can be handled by the tuner's thread.
+void CompilePool::WorkerLoop() {
+  while (true) {
+    auto job = Job{};
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (stop_) { return; }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    try {
+      job.promise.set_value(build_function_(job.source));
+    }
+    catch (...) {
+      job.promise.set_exception(std::current_exception());
+    }
+  }
+}
+
+// =================================================================================================
+} // namespace cltune
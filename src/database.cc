@@ -0,0 +1,192 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the Database class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/database.h"
+
+#include <sstream> // std::stringstream, std::istringstream
+#include <algorithm> // std::stable_sort
+#include <cstdio> // snprintf
+#include <cstdlib> // std::strtod, std::strtoull
+
+namespace cltune {
+// =================================================================================================
+
+// The first line of each database, identifying the format
+const std::string kDatabaseHeader = "CLTune database 1";
+
+// =================================================================================================
+
+// Reads the existing entries first, such that the file can be re-opened for appending
+Database::Database(const std::string &filename, const bool read_only):
+    file_(),
+    read_only_(read_only),
+    entries_() {
+  const auto exists = Read(filename);
+  if (read_only_) {
+    if (!exists) { throw Exception("Unable to read database '"+filename+"'"); }
+    return;
+  }
+  file_.open(filename, std::ios::out | std::ios::app);
+  if (file_.fail()) { throw Exception("Unable to open database '"+filename+"' for writing"); }
+  if (!exists) {
+    file_ << kDatabaseHeader << "\n";
+    file_.flush();
+  }
+}
+
+// =================================================================================================
+
+// Looks up an entry by its full key
+bool Database::Find(const std::string &kernel, const std::string &device,
+                    const std::string &problem, Entry &entry) const {
+  auto found = entries_.find(std::make_tuple(kernel, device, problem));
+  if (found == entries_.end()) { return false; }
+  entry = found->second;
+  return true;
+}
+
+// The entries of a kernel are adjacent in the map, since the kernel is the first part of the key
+std::vector<Database::Entry> Database::FindAll(const std::string &kernel,
+                                               const std::string &device,
+                                               const std::string &problem) const {
+  auto entries = std::vector<Entry>();
+  for (auto it = entries_.lower_bound(std::make_tuple(kernel, std::string{}, std::string{}));
+       it != entries_.end() && std::get<0>(it->first) == kernel; ++it) {
+    entries.push_back(it->second);
+  }
+  const auto relevance = [&device, &problem] (const Entry &entry) {
+    if (entry.device == device) { return (entry.problem == problem) ? 0 : 1; }
+    return (entry.problem == problem) ? 2 : 3;
+  };
+  std::stable_sort(entries.begin(), entries.end(), [&relevance] (const Entry &a, const Entry &b) {
+    if (relevance(a) != relevance(b)) { return relevance(a) < relevance(b); }
+    return a.time < b.time;
+  });
+  return entries;
+}
+
+// Appends the entry and flushes it to disk immediately
+bool Database::Store(const std::string &kernel, const Entry &entry) {
+  if (read_only_) { throw Exception("Unable to store in a read-only database"); }
+  const auto key = std::make_tuple(kernel, entry.device, entry.problem);
+  auto existing = entries_.find(key);
+  if (existing != entries_.end() && existing->second.time <= entry.time) { return false; }
+  const auto line = ToLine(kernel, entry);
+  entries_[key] = entry;
+  file_ << line << "\n";
+  file_.flush();
+  return true;
+}
+
+// =================================================================================================
+
+// Only complete lines are processed, such that a database which was cut off while writing can
+// still be used
+bool Database::Read(const std::string &filename) {
+  std::ifstream file(filename);
+  if (file.fail()) { return false; } // nothing to read: starts a new database
+  std::stringstream file_contents;
+  file_contents << file.rdbuf();
+  auto contents = file_contents.str();
+  if (contents.empty()) { return false; }
+  if (contents.compare(0, kDatabaseHeader.size(), kDatabaseHeader) != 0) {
+    throw Exception("File '"+filename+"' is not a tuning database");
+  }
+
+  auto line_start = contents.find('\n');
+  while (line_start != std::string::npos) {
+    const auto line_end = contents.find('\n', line_start + 1);
+    if (line_end == std::string::npos) { break; }
+    const auto line = contents.substr(line_start + 1, line_end - line_start - 1);
+    line_start = line_end;
+    auto kernel = std::string{};
+    auto entry = Entry{};
+    if (!FromLine(line, kernel, entry)) { continue; }
+    const auto key = std::make_tuple(kernel, entry.device, entry.problem);
+    auto existing = entries_.find(key);
+    if (existing == entries_.end() || entry.time < existing->second.time) { entries_[key] = entry; }
+  }
+
+  // Terminates a partially written line, such that new entries start on a line of their own
+  if (contents.back() != '\n' && !read_only_) {
+    std::ofstream append(filename, std::ios::out | std::ios::app);
+    append << "\n";
+  }
+  return true;
+}
+
+// =================================================================================================
+
+// The time is printed with enough digits to be read back exactly, the parameters as 'name=value'
+std::string Database::ToLine(const std::string &kernel, const Entry &entry) {
+  for (auto &field: {kernel, entry.device, entry.problem, entry.binary}) {
+    if (field.find_first_of("\t\n") != std::string::npos) {
+      throw Exception("Database field '"+field+"' contains a tab or a newline");
+    }
+  }
+  char time[32];
+  snprintf(time, sizeof(time), "%.17g", entry.time);
+  auto line = "result\t" + kernel + "\t" + entry.device + "\t" + entry.problem + "\t" + time + "\t";
+  for (auto p=size_t{0}; p<entry.parameters.size(); ++p) {
+    if (p > 0) { line += " "; }
+    line += entry.parameters[p].first + "=" + std::to_string(entry.parameters[p].second);
+  }
+  if (!entry.binary.empty()) { line += "\t" + entry.binary; }
+  return line;
+}
+
+// Splits the line at the tabs and the parameters at the spaces
+bool Database::FromLine(const std::string &line, std::string &kernel, Entry &entry) {
+  auto fields = std::vector<std::string>();
+  auto field_start = size_t{0};
+  while (true) {
+    const auto field_end = line.find('\t', field_start);
+    fields.push_back(line.substr(field_start, field_end - field_start));
+    if (field_end == std::string::npos) { break; }
+    field_start = field_end + 1;
+  }
+  if ((fields.size() != 6 && fields.size() != 7) || fields[0] != "result") { return false; }
+  kernel = fields[1];
+  entry.device = fields[2];
+  entry.problem = fields[3];
+  entry.time = std::strtod(fields[4].c_str(), nullptr);
+  entry.binary = (fields.size() == 7) ? fields[6] : std::string{};
+  entry.parameters.clear();
+  std::istringstream parameters(fields[5]);
+  auto parameter = std::string{};
+  while (parameters >> parameter) {
+    const auto separator = parameter.find('=');
+    if (separator == std::string::npos) { return false; }
+    const auto value = std::strtoull(parameter.c_str() + separator + 1, nullptr, 10);
+    entry.parameters.push_back({parameter.substr(0, separator), static_cast<size_t>(value)});
+  }
+  return true;
+}
+
+// =================================================================================================
+} // namespace cltune
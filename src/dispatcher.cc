@@ -0,0 +1,134 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the Dispatcher class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "cltune_dispatch.h"
+
+// The implementation is based on the tuning database
+#include "internal/database.h"
+
+#include <cmath> // std::log
+#include <algorithm> // std::max
+#include <cstdlib> // std::strtoull
+#include <limits> // std::numeric_limits
+
+namespace cltune {
+// =================================================================================================
+
+// Converts the stored results of the kernel once, such that selecting requires no parsing
+Dispatcher::Dispatcher(const std::string &database, const std::string &kernel_name,
+                       const std::string &binary_directory):
+    results_(),
+    exact_() {
+  auto directory = binary_directory;
+  if (!directory.empty() && directory.back() != '/' && directory.back() != '\\') {
+    directory += '/';
+  }
+  const auto entries = Database(database, true).FindAll(kernel_name, "", "");
+  for (auto &entry: entries) {
+    auto result = Result{entry.device, IntRange{}, entry.time, Selection{{}, "", false}};
+    if (!ParseProblem(entry.problem, result.problem)) { continue; }
+    for (auto &setting: entry.parameters) {
+      result.selection.parameters[setting.first] = setting.second;
+    }
+    if (!entry.binary.empty()) { result.selection.binary = directory + entry.binary; }
+    exact_[std::make_pair(result.device, result.problem)] = results_.size();
+    results_.push_back(result);
+  }
+}
+
+// =================================================================================================
+
+// Looks for an exact match first. Otherwise, considers all results of the same dimensionality,
+// preferring those of the device, then those with the nearest problem size, then the fastest.
+bool Dispatcher::Select(const std::string &device, const IntRange &problem,
+                        Selection &selection) const {
+  auto exact = exact_.find(std::make_pair(device, problem));
+  if (exact != exact_.end()) {
+    selection = results_[exact->second].selection;
+    selection.exact = true;
+    return true;
+  }
+
+  auto best = results_.size();
+  auto best_other_device = true;
+  auto best_distance = std::numeric_limits<double>::max();
+  for (auto i=size_t{0}; i<results_.size(); ++i) {
+    const auto &result = results_[i];
+    if (result.problem.size() != problem.size()) { continue; }
+    const auto other_device = (result.device != device);
+    const auto distance = Distance(result.problem, problem);
+    if (best != results_.size()) {
+      if (other_device && !best_other_device) { continue; }
+      const auto same_group = (other_device == best_other_device);
+      if (same_group && (distance > best_distance ||
+                         (distance == best_distance && result.time >= results_[best].time))) {
+        continue;
+      }
+    }
+    best = i;
+    best_other_device = other_device;
+    best_distance = distance;
+  }
+  if (best == results_.size()) { return false; }
+  selection = results_[best].selection;
+  selection.exact = false;
+  return true;
+}
+
+// =================================================================================================
+
+// Splits the problem at the 'x' characters. Each dimension has to be a positive number.
+bool Dispatcher::ParseProblem(const std::string &problem, IntRange &sizes) {
+  sizes.clear();
+  auto start = size_t{0};
+  while (true) {
+    const auto end = problem.find('x', start);
+    const auto dimension = problem.substr(start, end - start);
+    if (dimension.empty() || dimension.find_first_not_of("0123456789") != std::string::npos) {
+      return false;
+    }
+    sizes.push_back(static_cast<size_t>(std::strtoull(dimension.c_str(), nullptr, 10)));
+    if (sizes.back() == 0) { return false; }
+    if (end == std::string::npos) { return true; }
+    start = end + 1;
+  }
+}
+
+// Sums the squared differences of the logarithms of the dimensions
+double Dispatcher::Distance(const IntRange &a, const IntRange &b) {
+  auto distance = 0.0;
+  for (auto i=size_t{0}; i<a.size(); ++i) {
+    const auto difference = std::log(static_cast<double>(a[i])) -
+                            std::log(static_cast<double>(std::max(b[i], size_t{1})));
+    distance += difference * difference;
+  }
+  return distance;
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -0,0 +1,180 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the Journal class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/journal.h"
+
+#include <sstream> // std::stringstream, std::istringstream
+#include <vector> // std::vector
+#include <cstdio> // snprintf
+#include <cstdlib> // std::strtod, std::strtoull
+
+namespace cltune {
+// =================================================================================================
+
+// The first line of each journal, identifying the format
+const std::string kJournalHeader = "CLTune journal 1";
+
+// =================================================================================================
+
+// Reads the existing records first (if resuming), such that the file can be re-opened for appending
+Journal::Journal(const std::string &filename, const bool resume):
+    file_(),
+    kernels_(),
+    records_(),
+    num_resumed_records_(0) {
+  const auto exists = (resume) ? Read(filename) : false;
+  const auto mode = (exists) ? std::ios::app : std::ios::trunc;
+  file_.open(filename, std::ios::out | mode);
+  if (file_.fail()) { throw Exception("Unable to open journal '"+filename+"' for writing"); }
+  if (!exists) {
+    file_ << kJournalHeader << "\n";
+    file_.flush();
+  }
+}
+
+// =================================================================================================
+
+// Records the kernel on first use. Later runs have to search exactly the same space in the same
+// way, since otherwise the configuration indices and the replay don't match.
+unsigned int Journal::StartKernel(const size_t kernel_id, const std::string &identity,
+                                  const unsigned int seed) {
+  auto entry = kernels_.find(kernel_id);
+  if (entry != kernels_.end()) {
+    if (entry->second.identity != identity) {
+      throw Exception("Journal entry '"+entry->second.identity+"' of kernel "+
+                      std::to_string(kernel_id)+" doesn't match '"+identity+"'");
+    }
+    return entry->second.seed;
+  }
+  kernels_[kernel_id] = KernelEntry{identity, seed};
+  file_ << "kernel " << kernel_id << " " << seed << " " << identity << "\n";
+  file_.flush();
+  return seed;
+}
+
+// Looks up a record by its kernel and configuration
+bool Journal::Find(const size_t kernel_id, const size_t configuration_id, Record &record) const {
+  auto entry = records_.find(std::make_pair(kernel_id, configuration_id));
+  if (entry == records_.end()) { return false; }
+  record = entry->second;
+  return true;
+}
+bool Journal::Contains(const size_t kernel_id, const size_t configuration_id) const {
+  return records_.find(std::make_pair(kernel_id, configuration_id)) != records_.end();
+}
+
+// Writes all fields on a single line. Floating-point values are printed with enough digits to be
+// read back exactly.
+void Journal::Append(const Record &record) {
+  const auto &s = record.statistics;
+  char line[512];
+  snprintf(line, sizeof(line),
+           "result %zu %zu %.9g %zu %d %d %.9g %zu %.17g %.17g %.17g %.17g %.17g %.17g %d %d"
+           " %.9g\n",
+           record.kernel_id, record.configuration_id, record.time, record.threads,
+           (record.status) ? 1 : 0, static_cast<int>(record.timing_method), record.host_time,
+           s.num_samples, s.minimum, s.median, s.mean, s.trimmed_mean, s.standard_deviation,
+           s.relative_ci, (record.pruned) ? 1 : 0, (record.timed_out) ? 1 : 0, record.energy);
+  records_[std::make_pair(record.kernel_id, record.configuration_id)] = record;
+  file_ << line;
+  file_.flush();
+}
+
+// =================================================================================================
+
+// Only complete lines are processed. Lines which can't be parsed are skipped, such that a journal
+// which was cut off while writing can still be resumed.
+bool Journal::Read(const std::string &filename) {
+  std::ifstream file(filename);
+  if (file.fail()) { return false; } // nothing to resume: starts a new journal
+  std::stringstream file_contents;
+  file_contents << file.rdbuf();
+  auto contents = file_contents.str();
+  if (contents.empty()) { return false; }
+  if (contents.compare(0, kJournalHeader.size(), kJournalHeader) != 0) {
+    throw Exception("File '"+filename+"' is not a tuning journal");
+  }
+
+  auto line_start = contents.find('\n');
+  while (line_start != std::string::npos) {
+    const auto line_end = contents.find('\n', line_start + 1);
+    if (line_end == std::string::npos) { break; }
+    std::istringstream line(contents.substr(line_start + 1, line_end - line_start - 1));
+    line_start = line_end;
+
+    // Splits the line into tokens. The identity of a kernel is the remainder of its line.
+    auto type = std::string{};
+    line >> type;
+    if (type == "kernel") {
+      auto kernel_id = size_t{0};
+      auto seed = 0U;
+      auto identity = std::string{};
+      if (!(line >> kernel_id >> seed)) { continue; }
+      line.get();
+      std::getline(line, identity);
+      kernels_[kernel_id] = KernelEntry{identity, seed};
+    }
+    else if (type == "result") {
+      auto tokens = std::vector<std::string>();
+      auto token = std::string{};
+      while (line >> token) { tokens.push_back(token); }
+      if (tokens.size() != 16 && tokens.size() != 17) { continue; } // the energy was added later
+      const auto integer = [&tokens] (const size_t i) {
+        return static_cast<size_t>(std::strtoull(tokens[i].c_str(), nullptr, 10));
+      };
+      const auto real = [&tokens] (const size_t i) {
+        return std::strtod(tokens[i].c_str(), nullptr);
+      };
+      auto record = Record{};
+      record.kernel_id = integer(0);
+      record.configuration_id = integer(1);
+      record.time = static_cast<float>(real(2));
+      record.threads = integer(3);
+      record.status = (integer(4) != 0);
+      record.timing_method = static_cast<TimingMethod>(integer(5));
+      record.host_time = static_cast<float>(real(6));
+      record.statistics = SampleStatistics{integer(7), real(8), real(9), real(10), real(11),
+                                           real(12), real(13)};
+      record.pruned = (integer(14) != 0);
+      record.timed_out = (integer(15) != 0);
+      record.energy = (tokens.size() == 17) ? static_cast<float>(real(16)) : 0.0f;
+      records_[std::make_pair(record.kernel_id, record.configuration_id)] = record;
+      ++num_resumed_records_;
+    }
+  }
+
+  // Terminates a partially written line, such that new records start on a line of their own
+  if (contents.back() != '\n') {
+    std::ofstream append(filename, std::ios::out | std::ios::app);
+    append << "\n";
+  }
+  return true;
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -29,6 +29,13 @@
 #include "internal/kernel_info.h"
 
 #include <cassert>
+#include <cctype> // std::isalnum
+#include <limits> // std::numeric_limits
+#include <algorithm> // std::max
+#include <thread> // std::thread
+#include <atomic> // std::atomic
+#include <mutex> // std::mutex
+#include <exception> // std::exception_ptr
 
 namespace cltune {
 // =================================================================================================
@@ -38,33 +45,59 @@ size_t CeilDiv(const size_t x, const size_t y) {
   return 1 + ((x - 1) / y);
 }
 
+// The position of names which are not a parameter of the kernel
+const size_t KernelInfo::kUnknownParameter = std::numeric_limits<size_t>::max();
+
+// The number of values passed to a constraint or local memory function without allocating memory
+const size_t kMaxStackArguments = 16;
+
 // Initializes the name and kernel source-code, creates empty containers for all other member
 // variables.
 KernelInfo::KernelInfo(const std::string name, const std::string source, const Device &device):
   name_(name),
   source_(source),
   parameters_(),
-  configurations_(),
+  value_positions_(),
+  in_source_(),
   constraints_(),
-  local_memory_(LocalMemory{[] (std::vector<size_t>) { return size_t{0}; }, std::vector<std::string>(0)}),
+  local_memory_(LocalMemory{[] (const size_t*) { return size_t{0}; }, std::vector<std::string>(0)}),
+  constraint_positions_(),
+  local_memory_positions_(),
+  modifier_positions_(),
   device_(device),
+  max_work_group_size_(device.MaxWorkGroupSize()),
+  max_work_item_dimensions_(device.MaxWorkItemDimensions()),
+  max_work_item_sizes_(device.MaxWorkItemSizes()),
+  local_mem_size_(device.LocalMemSize()),
   global_base_(), local_base_(),
   global_(), local_(),
-  thread_size_modifiers_() {
+  thread_size_modifiers_(),
+  arguments_(),
+  stages_() {
 }
 
 // =================================================================================================
 
 void KernelInfo::PrependSource(const std::string &extra_source) {
   source_ = extra_source + "\n" + source_;
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    in_source_[i] = IdentifierInSource(parameters_[i].name);
+  }
 }
 
 // =================================================================================================
 
-// Pushes a new parameter to the list of parameters
-void KernelInfo::AddParameter(const std::string &name, const std::vector<size_t> &values) {
-  Parameter parameter = {name, values};
+// Pushes a new parameter to the list of parameters. Also stores the position of each value, such
+// that configurations can be converted into an index in constant time.
+void KernelInfo::AddParameter(const std::string &name, const std::vector<size_t> &values,
+                              const ParameterMode mode) {
+  Parameter parameter = {name, values, mode};
   parameters_.push_back(parameter);
+  auto positions = std::unordered_map<size_t,size_t>();
+  for (auto i=values.size(); i>0; --i) { positions[values[i-1]] = i-1; }
+  value_positions_.push_back(positions);
+  in_source_.push_back(IdentifierInSource(name));
+  ResolveParameters();
 }
 
 // Loops over all parameters and checks whether the given parameter name is present
@@ -75,32 +108,145 @@ bool KernelInfo::ParameterExists(const std::string parameter_name) {
   return false;
 }
 
+// Parameters which are not part of the kernel are considered to be used
+bool KernelInfo::ParameterInSource(const std::string &parameter_name) const {
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    if (parameters_[i].name == parameter_name) { return in_source_[i]; }
+  }
+  return true;
+}
+
+// Parameters which are not part of the kernel are considered to be defines
+bool KernelInfo::ParameterIsDefine(const std::string &parameter_name) const {
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    if (parameters_[i].name == parameter_name) {
+      return in_source_[i] && parameters_[i].mode == ParameterMode::kDefine;
+    }
+  }
+  return true;
+}
+
+// Searches for occurrences which are not part of a longer identifier, e.g. 'WG' in 'MWG'. This is
+// conservative: occurrences in comments or strings also count as usage. Sources which include other
+// files or paste tokens together can use a parameter without naming it, so all names count as used.
+bool KernelInfo::IdentifierInSource(const std::string &name) const {
+  const auto is_identifier_character = [] (const char character) {
+    return std::isalnum(static_cast<unsigned char>(character)) || character == '_';
+  };
+  if (name.empty()) { return false; }
+  if (source_.find("##") != std::string::npos) { return true; }
+  for (auto hash=source_.find('#'); hash!=std::string::npos; hash=source_.find('#', hash + 1)) {
+    const auto directive = source_.find_first_not_of(" \t", hash + 1);
+    if (directive != std::string::npos && source_.compare(directive, 7, "include") == 0) {
+      return true;
+    }
+  }
+  auto position = source_.find(name);
+  while (position != std::string::npos) {
+    const auto end = position + name.size();
+    if ((position == 0 || !is_identifier_character(source_[position - 1])) &&
+        (end == source_.size() || !is_identifier_character(source_[end]))) {
+      return true;
+    }
+    position = source_.find(name, position + 1);
+  }
+  return false;
+}
+
 // =================================================================================================
 
 // Pushes a new item onto the list of modifiers of a particular type
 void KernelInfo::AddModifier(const StringRange range, const ThreadSizeModifierType type) {
   ThreadSizeModifier modifier = {range, type};
   thread_size_modifiers_.push_back(modifier);
+  ResolveParameters();
 }
 
 // Adds a constraint to the list of constraints
 void KernelInfo::AddConstraint(ConstraintFunction valid_if,
                                const std::vector<std::string> &parameters) {
-  constraints_.push_back({valid_if, parameters});
+  const auto num_values = parameters.size();
+  AddFixedConstraint([valid_if, num_values] (const size_t *values) {
+    return valid_if(std::vector<size_t>(values, values + num_values));
+  }, parameters);
 }
 
 // Sets the local memory size
 void KernelInfo::SetLocalMemoryUsage(LocalMemoryFunction amount,
                                      const std::vector<std::string> &parameters) {
+  const auto num_values = parameters.size();
+  SetFixedLocalMemoryUsage([amount, num_values] (const size_t *values) {
+    return amount(std::vector<size_t>(values, values + num_values));
+  }, parameters);
+}
+
+void KernelInfo::AddFixedConstraint(FixedConstraintFunction valid_if,
+                                    const std::vector<std::string> &parameters) {
+  constraints_.push_back({valid_if, parameters});
+  ResolveParameters();
+}
+void KernelInfo::SetFixedLocalMemoryUsage(FixedLocalMemoryFunction amount,
+                                          const std::vector<std::string> &parameters) {
   local_memory_ = LocalMemory{amount, parameters};
+  ResolveParameters();
+}
+
+// Resolves all names again, since parameters may be added after the constraints which use them
+void KernelInfo::ResolveParameters() {
+  const auto position = [this] (const std::string &name) {
+    for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+      if (parameters_[i].name == name) { return i; }
+    }
+    return kUnknownParameter;
+  };
+  constraint_positions_.clear();
+  for (auto &constraint: constraints_) {
+    auto positions = std::vector<size_t>();
+    for (auto &name: constraint.parameters) { positions.push_back(position(name)); }
+    constraint_positions_.push_back(positions);
+  }
+  local_memory_positions_.clear();
+  for (auto &name: local_memory_.parameters) { local_memory_positions_.push_back(position(name)); }
+  modifier_positions_.clear();
+  for (auto &modifier: thread_size_modifiers_) {
+    auto positions = std::vector<size_t>();
+    for (auto &name: modifier.value) { positions.push_back(position(name)); }
+    modifier_positions_.push_back(positions);
+  }
+}
+
+// =================================================================================================
+
+// The stage is copied, such that later changes to the original kernel don't affect the pipeline
+void KernelInfo::AddStage(const KernelInfo &kernel, const std::vector<size_t> &arguments) {
+  if (kernel.IsPipeline()) { throw Exception("A pipeline can't be a stage of another pipeline"); }
+  stages_.push_back(Stage{std::make_shared<const KernelInfo>(kernel), arguments,
+                          kernel.global_base(), kernel.local_base()});
 }
 
 // =================================================================================================
 
+// Computes the ranges and copies them to the member variables global_ and local_
+void KernelInfo::ComputeRanges(const Configuration &config) {
+  ComputeRanges(config, global_, local_);
+  arguments_.clear();
+  for (auto &setting: config) {
+    for (auto &parameter: parameters_) {
+      if (parameter.name == setting.name && parameter.mode == ParameterMode::kArgument) {
+        arguments_.push_back(setting);
+      }
+    }
+  }
+  for (auto &stage: stages_) {
+    stage.kernel->ComputeRanges(config, stage.global, stage.local);
+  }
+}
+
 // Iterates over all modifiers (e.g. add a local multiplier) and applies these values to the
 // global/local thread-sizes. Modified results are kept in temporary values, but are finally
-// copied back to the member variables global_ and local_.
-void KernelInfo::ComputeRanges(const Configuration &config) {
+// copied to the output arguments.
+void KernelInfo::ComputeRanges(const Configuration &config, IntRange &global,
+                               IntRange &local) const {
 
   // Initializes the result vectors
   size_t num_dimensions = global_base_.size();
@@ -142,94 +288,332 @@ void KernelInfo::ComputeRanges(const Configuration &config) {
   }
 
   // Stores the final integer results
-  global_ = global_values;
-  local_ = local_values;
+  global = global_values;
+  local = local_values;
 }
 
 // =================================================================================================
 
-// Initializes an empty configuration (vector of name/value pairs) and kicks-off the recursive
-// function to find all configurations. It also applies the user-defined constraints within.
-void KernelInfo::SetConfigurations() {
+// The number of raw configurations is the product of the number of values of each parameter. This
+// includes invalid configurations, which are filtered out when visited.
+size_t KernelInfo::NumRawConfigurations() const {
+  auto num_configurations = size_t{1};
+  for (auto &parameter: parameters_) {
+    const auto num_values = parameter.values.size();
+    if (num_values == 0) { return 0; }
+    if (num_configurations > std::numeric_limits<size_t>::max() / num_values) {
+      throw Exception("Too many configurations to index");
+    }
+    num_configurations *= num_values;
+  }
+  return num_configurations;
+}
+
+// Decodes an index into a configuration (a vector of name/value pairs)
+KernelInfo::Configuration KernelInfo::GetConfiguration(const size_t index) const {
+  const auto value_indices = ValueIndices(index);
   auto config = Configuration(parameters_.size());
-  PopulateConfigurations(0, config);
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    config[i] = Setting{parameters_[i].name, parameters_[i].values[value_indices[i]]};
+  }
+  return config;
+}
+
+// As above, but returns only the values (without the parameter names)
+std::vector<size_t> KernelInfo::GetValues(const size_t index) const {
+  auto values = ValueIndices(index);
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    values[i] = parameters_[i].values[values[i]];
+  }
+  return values;
+}
+
+// Decodes the index and checks the resulting values against the constraints
+bool KernelInfo::IsValidConfiguration(const size_t index) const {
+  if (index >= NumRawConfigurations()) { return false; }
+  return ValidValues(GetValues(index));
+}
+
+std::vector<size_t> KernelInfo::ValidIndices(const size_t num_threads) const {
+  auto valid = std::vector<size_t>();
+  EnumerateAllValid(num_threads, &valid);
+  return valid;
+}
+size_t KernelInfo::NumValidConfigurations(const size_t num_threads) const {
+  return EnumerateAllValid(num_threads, nullptr);
+}
+
+// =================================================================================================
+
+// Splits an index into its digits, starting with the least significant one (the last parameter)
+std::vector<size_t> KernelInfo::ValueIndices(const size_t index) const {
+  auto value_indices = std::vector<size_t>(parameters_.size());
+  auto remainder = index;
+  for (auto i=parameters_.size(); i>0; --i) {
+    const auto num_values = parameters_[i-1].values.size();
+    value_indices[i-1] = remainder % num_values;
+    remainder /= num_values;
+  }
+  return value_indices;
+}
+
+// Combines digits into an index, the inverse of the above
+size_t KernelInfo::IndexFromValueIndices(const std::vector<size_t> &value_indices) const {
+  auto index = size_t{0};
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    const auto num_values = parameters_[i].values.size();
+    if (value_indices[i] >= num_values) { return NumRawConfigurations(); }
+    index = index*num_values + value_indices[i];
+  }
+  return index;
 }
 
-// Iterates recursively over all permutations of the user-defined parameters. This code creates
-// multiple chains, in which each chain selects a unique combination of values for all parameters.
-// At the end of each chain (when all parameters are considered), the function stores the result
-// into the configuration list.
-void KernelInfo::PopulateConfigurations(const size_t index, const Configuration &config) {
+// Looks up the position of each setting's value in the list of values of its parameter
+size_t KernelInfo::IndexFromConfiguration(const Configuration &config) const {
+  if (config.size() != parameters_.size()) { return NumRawConfigurations(); }
+  auto value_indices = std::vector<size_t>(parameters_.size());
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    const auto position = value_positions_[i].find(config[i].value);
+    if (position == value_positions_[i].end()) { return NumRawConfigurations(); }
+    value_indices[i] = position->second;
+  }
+  return IndexFromValueIndices(value_indices);
+}
 
-  // End of the chain: all parameters are considered, store the resulting configuration if it is a
-  // valid one according to the constraints
-  if (index == parameters_.size()) {
-    if (ValidConfiguration(config)) {
-      configurations_.push_back(config);
+// Takes the values of the parameters from the configuration by name. This is used for the stages of
+// a pipeline, of which the configuration space holds all parameters of the stages.
+bool KernelInfo::ValidConfiguration(const Configuration &config) const {
+  auto values = std::vector<size_t>(parameters_.size());
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    auto found = false;
+    for (auto &setting: config) {
+      if (setting.name == parameters_[i].name) {
+        values[i] = setting.value;
+        found = true;
+        break;
+      }
     }
-    return;
+    if (!found) { throw Exception("Missing value of parameter "+parameters_[i].name); }
   }
+  return ValidValues(values);
+}
 
-  // This loop iterates over all values of the current parameter and calls this function
-  // recursively
-  Parameter parameter = parameters_[index];
-  for (auto &value: parameter.values) {
-    auto config_copy = config;
-    config_copy[index] = Setting{parameter.name, value};
-    PopulateConfigurations(index+1, config_copy);
+// Assumes initially all configurations are valid, then returns false if one of the checks fails
+bool KernelInfo::ValidValues(const std::vector<size_t> &values) const {
+  for (auto c=size_t{0}; c<constraints_.size(); ++c) {
+    if (!ValidConstraint(c, values)) { return false; }
   }
+  return ValidThreadSizes(values) && ValidLocalMemory(values) && ValidStages(values);
 }
 
-// Loops over all user-defined constraints to check whether or not the configuration is valid.
-// Assumes initially all configurations are valid, then returns false if one of the constraints has
-// not been met. Constraints consist of a user-defined function and a list of parameter names, which
-// are replaced by parameter values in this function.
-inline bool KernelInfo::ValidConfiguration(const Configuration &config) {
+// =================================================================================================
 
-  // Iterates over all constraints
-  for (auto &constraint: constraints_) {
+// Constraints consist of a user-defined function and a list of parameters, of which the values are
+// passed to this function. Unknown parameters are passed as zero. The values are gathered on the
+// stack, unless there are very many of them.
+bool KernelInfo::ValidConstraint(const size_t constraint_id,
+                                 const std::vector<size_t> &values) const {
+  const auto &positions = constraint_positions_[constraint_id];
+  size_t stack_arguments[kMaxStackArguments];
+  auto heap_arguments = std::vector<size_t>();
+  auto arguments = stack_arguments;
+  if (positions.size() > kMaxStackArguments) {
+    heap_arguments.resize(positions.size());
+    arguments = heap_arguments.data();
+  }
+  for (auto i=size_t{0}; i<positions.size(); ++i) {
+    arguments[i] = (positions[i] != kUnknownParameter) ? values[positions[i]] : 0;
+  }
+  return constraints_[constraint_id].valid_if(arguments);
+}
 
-    // Finds the values of the parameters
-    auto values = std::vector<size_t>(constraint.parameters.size());
-    for (auto i=size_t{0}; i<constraint.parameters.size(); ++i) {
-      for (auto &setting: config) {
-        if (setting.name == constraint.parameters[i]) {
-          values[i] = setting.value;
-          break;
-        }
-      }
+// Verifies the local memory usage
+bool KernelInfo::ValidLocalMemory(const std::vector<size_t> &values) const {
+  size_t stack_arguments[kMaxStackArguments];
+  auto heap_arguments = std::vector<size_t>();
+  auto arguments = stack_arguments;
+  if (local_memory_positions_.size() > kMaxStackArguments) {
+    heap_arguments.resize(local_memory_positions_.size());
+    arguments = heap_arguments.data();
+  }
+  for (auto i=size_t{0}; i<local_memory_positions_.size(); ++i) {
+    if (local_memory_positions_[i] == kUnknownParameter) {
+      throw Exception("Invalid settings for the local memory usage constraint");
     }
+    arguments[i] = values[local_memory_positions_[i]];
+  }
+  return local_memory_.amount(arguments) <= local_mem_size_;
+}
 
-    // Checks this constraint for these values
-    if (!constraint.valid_if(values)) {
-      return false;
+// Applies the local modifiers as in 'ComputeRanges' and verifies the resulting thread-sizes against
+// the (cached) device properties
+bool KernelInfo::ValidThreadSizes(const std::vector<size_t> &values) const {
+  const auto num_dimensions = global_base_.size();
+  if (num_dimensions != local_base_.size()) {
+    throw Exception("Mismatching number of global/local dimensions");
+  }
+  if (num_dimensions > max_work_item_dimensions_) { return false; }
+  auto local_size = size_t{1};
+  for (auto dim=size_t{0}; dim<num_dimensions; ++dim) {
+    auto local = local_base_[dim];
+    for (auto m=size_t{0}; m<thread_size_modifiers_.size(); ++m) {
+      const auto &modifier = thread_size_modifiers_[m];
+      if (modifier.value[dim] == "") { continue; }
+      const auto position = modifier_positions_[m][dim];
+      if (position == kUnknownParameter) {
+        throw Exception("Invalid modifier: "+modifier.value[dim]);
+      }
+      switch (modifier.type) {
+        case ThreadSizeModifierType::kGlobalMul: break;
+        case ThreadSizeModifierType::kGlobalDiv: break;
+        case ThreadSizeModifierType::kLocalMul: local *= values[position]; break;
+        case ThreadSizeModifierType::kLocalDiv: local = CeilDiv(local, values[position]); break;
+        default: assert(0 && "Invalid modifier type");
+      }
     }
+    if (local > max_work_item_sizes_[dim]) { return false; }
+    local_size *= local;
   }
+  return local_size <= max_work_group_size_;
+}
 
-  // Computes the global and local worksizes
-  ComputeRanges(config);
+// The configuration has to be valid for each of the stages of a pipeline as well
+bool KernelInfo::ValidStages(const std::vector<size_t> &values) const {
+  if (stages_.empty()) { return true; }
+  auto config = Configuration(parameters_.size());
+  for (auto i=size_t{0}; i<parameters_.size(); ++i) {
+    config[i] = Setting{parameters_[i].name, values[i]};
+  }
+  for (auto &stage: stages_) {
+    if (!stage.kernel->ValidConfiguration(config)) { return false; }
+  }
+  return true;
+}
 
-  // Verifies the global/local thread-sizes against device properties
-  if (!device_.IsThreadConfigValid(local_)) { return false; };
+// The identifiers of the checks: the constraints first, followed by the local memory usage and the
+// thread-sizes
+bool KernelInfo::ValidCheck(const size_t check_id, const std::vector<size_t> &values) const {
+  if (check_id < constraints_.size()) { return ValidConstraint(check_id, values); }
+  if (check_id == constraints_.size()) { return ValidLocalMemory(values); }
+  return ValidThreadSizes(values);
+}
 
-  // Verifies the local memory usage
-  std::vector<size_t> values_local_memory(0);
-  for (auto &parameter: local_memory_.parameters) {
-    for (auto &setting: config) {
-      if (setting.name == parameter) {
-        values_local_memory.push_back(setting.value);
-        break;
+// =================================================================================================
+
+// Depth-first over the values of the parameters at and after 'depth', such that the indices are
+// found in ascending order. The stages of a pipeline are checked for complete configurations only.
+void KernelInfo::EnumerateValid(const std::vector<std::vector<size_t>> &checks, const size_t depth,
+                                const size_t index, std::vector<size_t> &values,
+                                std::vector<size_t> *valid, size_t &num_valid) const {
+  if (depth == parameters_.size()) {
+    if (!ValidStages(values)) { return; }
+    if (valid) { valid->push_back(index); }
+    ++num_valid;
+    return;
+  }
+  const auto &parameter_values = parameters_[depth].values;
+  for (auto v=size_t{0}; v<parameter_values.size(); ++v) {
+    values[depth] = parameter_values[v];
+    auto passes = true;
+    for (auto &check_id: checks[depth]) {
+      if (!ValidCheck(check_id, values)) { passes = false; break; }
+    }
+    if (!passes) { continue; }
+    EnumerateValid(checks, depth + 1, index*parameter_values.size() + v, values, valid, num_valid);
+  }
+}
+
+// Groups the checks by the deepest parameter they depend on. The permutations of the outermost
+// parameters (enough for a couple of them per thread) are then handed out to the threads, each
+// enumerating the remaining parameters. Their results are concatenated in order.
+size_t KernelInfo::EnumerateAllValid(const size_t num_threads, std::vector<size_t> *valid) const {
+  if (NumRawConfigurations() == 0) { return 0; }
+  if (parameters_.empty()) {
+    if (!ValidValues({})) { return 0; }
+    if (valid) { valid->push_back(0); }
+    return 1;
+  }
+  auto checks = std::vector<std::vector<size_t>>(parameters_.size());
+  const auto deepest = [] (const std::vector<size_t> &positions) {
+    auto depth = size_t{0};
+    for (auto &position: positions) {
+      if (position != kUnknownParameter) { depth = std::max(depth, position); }
+    }
+    return depth;
+  };
+  for (auto c=size_t{0}; c<constraints_.size(); ++c) {
+    checks[deepest(constraint_positions_[c])].push_back(c);
+  }
+  checks[deepest(local_memory_positions_)].push_back(constraints_.size());
+  auto modifier_positions = std::vector<size_t>();
+  for (auto &positions: modifier_positions_) {
+    modifier_positions.insert(modifier_positions.end(), positions.begin(), positions.end());
+  }
+  checks[deepest(modifier_positions)].push_back(constraints_.size() + 1);
+
+  // Splits the space at the outermost parameters
+  const auto hardware_threads = static_cast<size_t>(std::thread::hardware_concurrency());
+  const auto threads = std::max(size_t{1}, (num_threads > 0) ? num_threads : hardware_threads);
+  auto split_depth = size_t{0};
+  auto num_parts = size_t{1};
+  while (threads > 1 && split_depth < parameters_.size() && num_parts < 16*threads) {
+    num_parts *= parameters_[split_depth].values.size();
+    ++split_depth;
+  }
+
+  // Enumerates a single part: sets and checks the values of the outermost parameters first
+  auto part_valid = std::vector<std::vector<size_t>>(num_parts);
+  auto part_counts = std::vector<size_t>(num_parts, 0);
+  const auto enumerate_part = [&] (const size_t part, std::vector<size_t> &values) {
+    auto remainder = part;
+    for (auto d=split_depth; d>0; --d) {
+      const auto num_values = parameters_[d-1].values.size();
+      values[d-1] = parameters_[d-1].values[remainder % num_values];
+      remainder /= num_values;
+    }
+    for (auto d=size_t{0}; d<split_depth; ++d) {
+      for (auto &check_id: checks[d]) {
+        if (!ValidCheck(check_id, values)) { return; }
       }
     }
+    EnumerateValid(checks, split_depth, part, values, (valid) ? &part_valid[part] : nullptr,
+                   part_counts[part]);
+  };
+
+  // Runs the parts on the threads (or on this thread only). Exceptions are passed on afterwards.
+  if (threads == 1 || num_parts == 1) {
+    auto values = std::vector<size_t>(parameters_.size());
+    for (auto part=size_t{0}; part<num_parts; ++part) { enumerate_part(part, values); }
   }
-  if (local_memory_.parameters.size() != values_local_memory.size()) {
-    throw Exception("Invalid settings for the local memory usage constraint");
+  else {
+    std::atomic<size_t> next_part(0);
+    auto error = std::exception_ptr{};
+    std::mutex error_mutex;
+    auto workers = std::vector<std::thread>();
+    for (auto t=size_t{0}; t<std::min(threads, num_parts); ++t) {
+      workers.push_back(std::thread([&] () {
+        auto values = std::vector<size_t>(parameters_.size());
+        try {
+          for (auto part=next_part++; part<num_parts; part=next_part++) {
+            enumerate_part(part, values);
+          }
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) { error = std::current_exception(); }
+          next_part = num_parts;
+        }
+      }));
+    }
+    for (auto &worker: workers) { worker.join(); }
+    if (error) { std::rethrow_exception(error); }
   }
-  auto local_mem_usage = local_memory_.amount(values_local_memory);
-  if (!device_.IsLocalMemoryValid(local_mem_usage)) { return false; };
 
-  // Everything was OK: this configuration is valid
-  return true;
+  auto num_valid = size_t{0};
+  for (auto part=size_t{0}; part<num_parts; ++part) {
+    num_valid += part_counts[part];
+    if (valid) { valid->insert(valid->end(), part_valid[part].begin(), part_valid[part].end()); }
+  }
+  return num_valid;
 }
 
 // =================================================================================================
@@ -0,0 +1,128 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the functions to compute the statistics of time measurements (see the
+// header for more information).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/measurement.h"
+
+#include <algorithm> // std::sort, std::stable_sort, std::min
+#include <cmath> // std::sqrt
+#include <limits> // std::numeric_limits
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// Critical values of Student's t-distribution for a two-sided 95% confidence interval, indexed by
+// the degrees of freedom minus one. Beyond the table, the normal distribution's value is used.
+const std::vector<double> kStudentT95 = {
+  12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+const auto kNormal95 = 1.960;
+
+// =================================================================================================
+
+// Sorts a copy of the samples and computes all statistics from it
+SampleStatistics ComputeStatistics(const std::vector<float> &samples,
+                                   const double trimmed_fraction) {
+  if (samples.empty()) { throw std::runtime_error("Cannot compute statistics of zero samples"); }
+  auto sorted = std::vector<double>(samples.begin(), samples.end());
+  std::sort(sorted.begin(), sorted.end());
+  const auto n = sorted.size();
+
+  auto result = SampleStatistics{};
+  result.num_samples = n;
+  result.minimum = sorted.front();
+  result.median = (n % 2 == 1) ? sorted[n/2] : 0.5*(sorted[n/2 - 1] + sorted[n/2]);
+
+  // Computes the mean and the (sample) standard deviation
+  auto sum = 0.0;
+  for (const auto &sample: sorted) { sum += sample; }
+  result.mean = sum / n;
+  auto sum_squares = 0.0;
+  for (const auto &sample: sorted) { sum_squares += (sample - result.mean)*(sample - result.mean); }
+  result.standard_deviation = (n > 1) ? std::sqrt(sum_squares / (n - 1)) : 0.0;
+
+  // Computes the trimmed mean, always keeping at least one sample
+  auto num_trimmed = std::min(static_cast<size_t>(trimmed_fraction * n), (n - 1) / 2);
+  auto trimmed_sum = 0.0;
+  for (auto i=num_trimmed; i<n-num_trimmed; ++i) { trimmed_sum += sorted[i]; }
+  result.trimmed_mean = trimmed_sum / (n - 2*num_trimmed);
+
+  // Computes the confidence interval of the mean
+  if (n > 1 && result.mean > 0.0) {
+    const auto t = (n - 2 < kStudentT95.size()) ? kStudentT95[n - 2] : kNormal95;
+    result.relative_ci = t * result.standard_deviation / std::sqrt(static_cast<double>(n));
+    result.relative_ci /= result.mean;
+  }
+  else {
+    result.relative_ci = 0.0;
+  }
+  return result;
+}
+
+// =================================================================================================
+
+// Simple selection of one of the statistics
+double SelectStatistic(const SampleStatistics &statistics, const Statistic statistic) {
+  switch (statistic) {
+    case Statistic::kMinimum: return statistics.minimum;
+    case Statistic::kMedian: return statistics.median;
+    case Statistic::kMean: return statistics.mean;
+    case Statistic::kTrimmedMean: return statistics.trimmed_mean;
+  }
+  throw std::runtime_error("Unknown statistic");
+}
+
+// The best time can also be known when only the relative kernel timeout needs it
+bool IsPruned(const SampleStatistics &statistics, const double pruning_factor,
+              const float best_time) {
+  if (pruning_factor <= 0.0 || best_time == std::numeric_limits<float>::max()) { return false; }
+  return statistics.minimum > pruning_factor * best_time;
+}
+
+// =================================================================================================
+
+// Sweeps over the points ordered by the first value (ties by the second): a point is on the front
+// if its second value is lower than that of all points before it
+std::vector<size_t> ParetoFront(const std::vector<std::pair<double,double>> &points) {
+  auto order = std::vector<size_t>(points.size());
+  for (auto i=size_t{0}; i<points.size(); ++i) { order[i] = i; }
+  std::stable_sort(order.begin(), order.end(), [&points] (const size_t a, const size_t b) {
+    return points[a] < points[b];
+  });
+  auto front = std::vector<size_t>();
+  for (auto &i: order) {
+    if (front.empty() || points[i].second < points[front.back()].second) { front.push_back(i); }
+  }
+  return front;
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -37,8 +37,9 @@ namespace cltune {
 // Calls the base-class constructor
 template <typename T>
 LinearRegression<T>::LinearRegression(const size_t learning_iterations, const T learning_rate,
-                                      const T lambda, const bool debug_display):
-  MLModel<T>(debug_display),
+                                      const T lambda, const bool debug_display,
+                                      const Optimizer optimizer):
+  MLModel<T>(debug_display, optimizer),
   learning_iterations_(learning_iterations),
   learning_rate_(learning_rate),
   lambda_(lambda) {
@@ -57,12 +58,15 @@ void LinearRegression<T>::Train(const std::vector<std::vector<T>> &x, const std:
   PreProcessFeatures(x_temp);
   PreProcessExecutionTimes(y_temp);
 
-  // Runs gradient descent to train the model
-  GradientDescent(x_temp, y_temp, learning_rate_, lambda_, learning_iterations_);
+  // Runs the optimizer to train the model
+  const auto x_matrix = Matrix<T>(x_temp);
+  Optimize(x_matrix, y_temp, learning_rate_, lambda_, learning_iterations_);
 
   // Verifies and displays the trained results
-  auto cost = Verify(x_temp, y_temp);
-  printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  if (debug_display_) {
+    auto cost = Verify(x_matrix, y_temp);
+    printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  }
 }
 
 // Validates the model
@@ -76,7 +80,7 @@ void LinearRegression<T>::Validate(const std::vector<std::vector<T>> &x, const s
   PreProcessExecutionTimes(y_temp);
 
   // Verifies and displays the trained results
-  auto cost = Verify(x_temp, y_temp);
+  auto cost = Verify(Matrix<T>(x_temp), y_temp);
   printf("%s Validation cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
 }
 
@@ -85,7 +89,7 @@ template <typename T>
 T LinearRegression<T>::Predict(const std::vector<T> &x) const {
   auto x_preprocessed = std::vector<std::vector<T>>{x};
   PreProcessFeatures(x_preprocessed);
-  return PostProcessExecutionTime(Hypothesis(x_preprocessed[0]));
+  return PostProcessExecutionTime(Hypothesis(x_preprocessed[0].data()));
 }
 
 // =================================================================================================
@@ -122,27 +126,28 @@ void LinearRegression<T>::InitializeTheta(const size_t n) {
 
 // Hypothesis-function: pass a single sample through the model and returns its hypothesis
 template <typename T>
-T LinearRegression<T>::Hypothesis(const std::vector<T> &x) const {
-  auto n = x.size();
-  auto hypothesis = static_cast<T>(0);
-  for (auto nid=size_t{0}; nid<n; ++nid) {
-    hypothesis += theta_[nid] * x[nid];
-
-  }
-  return hypothesis;
+T LinearRegression<T>::Hypothesis(const T *x) const {
+  return Dot(theta_.data(), x, theta_.size());
 }
 
 // Cost-function: computes the sum of squared differences
 template <typename T>
-T LinearRegression<T>::Cost(const size_t m, const size_t n, const T lambda,
-                            const std::vector<std::vector<T>> &x, const std::vector<T> &y) const {
-
-  // Computes the sum of squared differences
+T LinearRegression<T>::Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const {
+  auto m = x.rows();
+  auto n = x.cols();
+
+  // Computes the sum of squared differences, a partial sum per chunk of samples
+  auto costs = std::vector<T>(NumChunks(m), static_cast<T>(0));
+  ForEachChunk(m, [&] (const size_t chunk, const size_t begin, const size_t end) {
+    auto cost = static_cast<T>(0);
+    for (auto mid=begin; mid<end; ++mid) {
+      auto difference = Hypothesis(x[mid]) - y[mid];
+      cost += difference * difference;
+    }
+    costs[chunk] = cost;
+  });
   auto cost = static_cast<T>(0);
-  for (auto mid=size_t{0}; mid<m; ++mid) {
-    auto difference = Hypothesis(x[mid]) - y[mid];
-    cost += difference * difference;
-  }
+  for (auto &value: costs) { cost += value; }
 
   // Computes the squared sum of theta's (not counting theta-zero) for the regularization term
   auto theta_squared_sum = static_cast<T>(0);
@@ -154,33 +159,28 @@ T LinearRegression<T>::Cost(const size_t m, const size_t n, const T lambda,
   return (cost + lambda*theta_squared_sum) / (static_cast<T>(2) * static_cast<T>(m));
 }
 
-// Gradient-function: computes the gradient of the cost-function
+// Gradient-function: computes the gradient of the cost-function. The residual of each sample is
+// computed only once and then added to the gradient scaled by the sample's features.
 template <typename T>
-void LinearRegression<T>::Gradient(const size_t m, const size_t n, const T lambda, const T alpha,
-                                   const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
-
-  // Temporary data storage
-  auto theta_temp = std::vector<T>(n, static_cast<T>(0));
-
-  // Loops over all features
-  for (auto nid=size_t{0}; nid<n; ++nid) {
-
-    // Computes the gradient of the cost function
-    auto gradient = static_cast<T>(0);
-    for (auto mid=size_t{0}; mid<m; ++mid) {
-      gradient += (Hypothesis(x[mid]) - y[mid]) * x[mid][nid];
+void LinearRegression<T>::Gradient(const T lambda, const Matrix<T> &x, const std::vector<T> &y,
+                                   std::vector<T> &gradient) const {
+  auto m = x.rows();
+  auto n = x.cols();
+
+  // Computes the gradient of the cost function, a partial gradient per chunk of samples
+  auto gradients = std::vector<std::vector<T>>(NumChunks(m), std::vector<T>(n, static_cast<T>(0)));
+  ForEachChunk(m, [&] (const size_t chunk, const size_t begin, const size_t end) {
+    auto &partial = gradients[chunk];
+    for (auto mid=begin; mid<end; ++mid) {
+      Axpy(Hypothesis(x[mid]) - y[mid], x[mid], partial.data(), n);
     }
+  });
 
-    // Computes the final gradient with regularization
-    gradient = (gradient / static_cast<T>(m)) + ((lambda * theta_[nid]) / static_cast<T>(m));
-
-    // Sets the newly learned theta (temporarily at first)
-    theta_temp[nid] = theta_[nid] - alpha * gradient;
-  }
-
-  // Sets the new final values for theta
+  // Computes the final gradient with regularization
   for (auto nid=size_t{0}; nid<n; ++nid) {
-    theta_[nid] = theta_temp[nid];
+    auto sum = static_cast<T>(0);
+    for (auto &partial: gradients) { sum += partial[nid]; }
+    gradient[nid] = (sum / static_cast<T>(m)) + ((lambda * theta_[nid]) / static_cast<T>(m));
   }
 }
 
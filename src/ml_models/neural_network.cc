@@ -41,8 +41,8 @@ namespace cltune {
 template <typename T>
 NeuralNetwork<T>::NeuralNetwork(const size_t learning_iterations, const T learning_rate,
                                 const T lambda, const std::vector<size_t> &layer_sizes,
-                                const bool debug_display):
-    MLModel<T>(debug_display),
+                                const bool debug_display, const Optimizer optimizer):
+    MLModel<T>(debug_display, optimizer),
     num_layers_(layer_sizes.size()),
     layer_sizes_(layer_sizes),
     learning_iterations_(learning_iterations),
@@ -64,12 +64,15 @@ void NeuralNetwork<T>::Train(const std::vector<std::vector<T>> &x, const std::ve
   PreProcessFeatures(x_temp);
   PreProcessExecutionTimes(y_temp);
 
-  // Runs gradient descent to train the model
-  GradientDescent(x_temp, y_temp, learning_rate_, lambda_, learning_iterations_);
+  // Runs the optimizer to train the model
+  const auto x_matrix = Matrix<T>(x_temp);
+  Optimize(x_matrix, y_temp, learning_rate_, lambda_, learning_iterations_);
 
   // Verifies and displays the trained results
-  auto cost = Verify(x_temp, y_temp);
-  printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  if (debug_display_) {
+    auto cost = Verify(x_matrix, y_temp);
+    printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  }
 }
 
 // Validates the model
@@ -83,7 +86,7 @@ void NeuralNetwork<T>::Validate(const std::vector<std::vector<T>> &x, const std:
   PreProcessExecutionTimes(y_temp);
 
   // Verifies and displays the trained results
-  auto cost = Verify(x_temp, y_temp);
+  auto cost = Verify(Matrix<T>(x_temp), y_temp);
   printf("%s Validation cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
 }
 
@@ -92,7 +95,7 @@ template <typename T>
 T NeuralNetwork<T>::Predict(const std::vector<T> &x) const {
   auto x_preprocessed = std::vector<std::vector<T>>{x};
   PreProcessFeatures(x_preprocessed);
-  return PostProcessExecutionTime(Hypothesis(x_preprocessed[0]));
+  return PostProcessExecutionTime(Hypothesis(x_preprocessed[0].data()));
 }
 
 // =================================================================================================
@@ -124,8 +127,7 @@ void NeuralNetwork<T>::InitializeTheta(const size_t n) {
   // Resizes the weight matrices theta
   if (layer_sizes_[0] != n) { throw std::runtime_error("Invalid size of the first layer"); }
   if (layer_sizes_[2] != 1) { throw std::runtime_error("Invalid size of the third layer"); }
-  theta1_.resize((layer_sizes_[0]+1)*layer_sizes_[1]);
-  theta2_.resize((layer_sizes_[1]+1)*layer_sizes_[2]);
+  theta_.resize(NumWeights1() + (layer_sizes_[1]+1)*layer_sizes_[2]);
 
   // Calculates the random-initialization range
   auto epsilon1 = static_cast<T>(sqrt(static_cast<T>(6))/sqrt(static_cast<T>(layer_sizes_[0]+layer_sizes_[1])));
@@ -138,185 +140,107 @@ void NeuralNetwork<T>::InitializeTheta(const size_t n) {
   std::uniform_real_distribution<T> distribution2(-epsilon2, epsilon2);
 
   // Fills the weights with random values
-  for (auto &weight: theta1_) { weight = distribution1(generator); }
-  for (auto &weight: theta2_) { weight = distribution2(generator); }
+  for (auto i=size_t{0}; i<theta_.size(); ++i) {
+    theta_[i] = (i < NumWeights1()) ? distribution1(generator) : distribution2(generator);
+  }
 }
 
 // =================================================================================================
 
 // Hypothesis-function: pass a single sample through the model and returns its hypothesis
-// TODO: Memory usage and performance can be improved
 template <typename T>
-T NeuralNetwork<T>::Hypothesis(const std::vector<T> &x) const {
-
-  // Adds a bias to the input data
-  auto a0 = FeedForward0(x);
-  
-  // Performs the activations of the first hidden layer
-  auto a1 = FeedForward1(a0, true);
-  
-  // Performs the activations of the output layer
-  auto a2 = FeedForward2(a1);
-
-  // Only one output supported
-  if (layer_sizes_[2] != 1) { throw std::runtime_error("Invalid size of the third layer"); }
-  auto hypothesis = a2[0];
-  return hypothesis;
+T NeuralNetwork<T>::Hypothesis(const T *x) const {
+  auto a1 = std::vector<T>(layer_sizes_[1]);
+  return FeedForward(x, a1.data());
 }
 
 // Cost-function: computes the sum of squared differences
 template <typename T>
-T NeuralNetwork<T>::Cost(const size_t m, const size_t, const T lambda,
-                         const std::vector<std::vector<T>> &x, const std::vector<T> &y) const {
-
-  // Computes the sum of squared differences
+T NeuralNetwork<T>::Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const {
+  auto m = x.rows();
+
+  // Computes the sum of squared differences, a partial sum per chunk of samples
+  auto costs = std::vector<T>(NumChunks(m), static_cast<T>(0));
+  ForEachChunk(m, [&] (const size_t chunk, const size_t begin, const size_t end) {
+    auto a1 = std::vector<T>(layer_sizes_[1]);
+    auto cost = static_cast<T>(0);
+    for (auto mid=begin; mid<end; ++mid) {
+      auto difference = FeedForward(x[mid], a1.data()) - y[mid];
+      cost += difference * difference;
+    }
+    costs[chunk] = cost;
+  });
   auto cost = static_cast<T>(0);
-  for (auto mid=size_t{0}; mid<m; ++mid) {
-    auto difference = Hypothesis(x[mid]) - y[mid];
-    cost += difference * difference;
-  }
+  for (auto &value: costs) { cost += value; }
   cost /= static_cast<T>(m);
 
   // Computes the squared sum of theta's (not counting theta-zero) for the regularization term
   auto theta_squared_sum = static_cast<T>(0);
   for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-    for (auto id0=size_t{1}; id0<layer_sizes_[0]+1; ++id0) {
-      auto value = theta1_[id1*(layer_sizes_[0]+1) + id0];
-      theta_squared_sum += value * value;
-    }
-  }
-  for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-    for (auto id1=size_t{1}; id1<layer_sizes_[1]+1; ++id1) {
-      auto value = theta2_[id2*(layer_sizes_[1]+1) + id1];
-      theta_squared_sum += value * value;
-    }
+    const auto weights = theta1() + id1*(layer_sizes_[0]+1);
+    theta_squared_sum += Dot(weights + 1, weights + 1, layer_sizes_[0]);
   }
+  theta_squared_sum += Dot(theta2() + 1, theta2() + 1, layer_sizes_[1]);
 
   // Computes the final cost
   return cost + (lambda*theta_squared_sum) / (static_cast<T>(2 * m));
 }
 
-// Gradient-function: computes the gradient of the cost-function
+// Gradient-function: computes the gradient of the cost-function using backpropagation
 template <typename T>
-void NeuralNetwork<T>::Gradient(const size_t m, const size_t, const T lambda, const T alpha,
-                                const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
-
-  // Temporary data storage for the gradients
-  auto gradient1 = std::vector<T>(theta1_.size(), static_cast<T>(0));
-  auto gradient2 = std::vector<T>(theta2_.size(), static_cast<T>(0));
-
-  // Loops over all samples of the training data
-  for (auto mid=size_t{0}; mid<m; ++mid) {
-
-    // Performs the feed-forward computations (with and without sigmoid)
-    auto a0 = FeedForward0(x[mid]);
-    auto z1 = FeedForward1(a0, false);
-    auto a1 = FeedForward1(a0, true);
-    auto a2 = FeedForward2(a1);
-
-    // Computes the error at the last layer
-    auto d2 = std::vector<T>(layer_sizes_[2]);
-    if (layer_sizes_[2] != 1) { throw std::runtime_error("Invalid size of the third layer"); }
-    d2[0] = a2[0] - y[mid];
-
-    // Propagates the error back (backpropagation) to compute the delta at the hidden layer
-    auto d1 = std::vector<T>(layer_sizes_[1]);
-    for (auto id1=size_t{1}; id1<layer_sizes_[1]+1; ++id1) {
-      auto value = static_cast<T>(0);
-      for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-        value += d2[id2] * theta2_[id2*(layer_sizes_[1]+1) + id1];
-      }
-      d1[id1-1] = value * SigmoidGradient(z1[id1]);
-    }
-
-    // Accumulates the partial gradients
-    for (auto id0=size_t{0}; id0<layer_sizes_[0]+1; ++id0) {
-      for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-        gradient1[id1*(layer_sizes_[0]+1) + id0] += d1[id1] * a0[id0];
-      }
-    }
-    for (auto id1=size_t{0}; id1<layer_sizes_[1]+1; ++id1) {
-      for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-        gradient2[id2*(layer_sizes_[1]+1) + id1] += d2[id2] * a1[id1];
+void NeuralNetwork<T>::Gradient(const T lambda, const Matrix<T> &x, const std::vector<T> &y,
+                                std::vector<T> &gradient) const {
+  auto m = x.rows();
+  const auto n0 = layer_sizes_[0];
+  const auto n1 = layer_sizes_[1];
+
+  // Computes a partial gradient per chunk of samples
+  auto gradients = std::vector<std::vector<T>>(NumChunks(m),
+                                               std::vector<T>(theta_.size(), static_cast<T>(0)));
+  ForEachChunk(m, [&] (const size_t chunk, const size_t begin, const size_t end) {
+    auto gradient1 = gradients[chunk].data();
+    auto gradient2 = gradient1 + NumWeights1();
+    auto a1 = std::vector<T>(n1);
+    for (auto mid=begin; mid<end; ++mid) {
+
+      // Performs the feed-forward computations and computes the error at the last layer
+      const auto d2 = FeedForward(x[mid], a1.data()) - y[mid];
+
+      // Propagates the error back (backpropagation) to the hidden layer and accumulates the
+      // partial gradients. The gradient of the sigmoid is computed from its output.
+      gradient2[0] += d2;
+      Axpy(d2, a1.data(), gradient2 + 1, n1);
+      for (auto id1=size_t{0}; id1<n1; ++id1) {
+        const auto d1 = d2 * theta2()[id1 + 1] * a1[id1] * (static_cast<T>(1) - a1[id1]);
+        gradient1[id1*(n0+1)] += d1;
+        Axpy(d1, x[mid], gradient1 + id1*(n0+1) + 1, n0);
       }
     }
-  }
-
-  // Computes the final gradients, adding regularization
-  for (auto id0=size_t{0}; id0<layer_sizes_[0]+1; ++id0) {
-    for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-      auto index = id1*(layer_sizes_[0]+1) + id0;
-      if (id0 != 0) { // Don't add regularization for the bias term
-        gradient1[index] += lambda * theta1_[index];
-      }
-      gradient1[index] /= static_cast<T>(m);
-    }
-  }
-  for (auto id1=size_t{0}; id1<layer_sizes_[1]+1; ++id1) {
-    for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-      auto index = id2*(layer_sizes_[1]+1) + id1;
-      if (id1 != 0) { // Don't add regularization for the bias term
-        gradient2[index] += lambda * theta2_[index];
-      }
-      gradient2[index] /= static_cast<T>(m);
-    }
-  }
-
-  // Sets the new values of theta
-  for (auto id0=size_t{0}; id0<layer_sizes_[0]+1; ++id0) {
-    for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-      auto index = id1*(layer_sizes_[0]+1) + id0;
-      theta1_[index] = theta1_[index] - alpha * gradient1[index];
-    }
-  }
-  for (auto id1=size_t{0}; id1<layer_sizes_[1]+1; ++id1) {
-    for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-      auto index = id2*(layer_sizes_[1]+1) + id1;
-      theta2_[index] = theta2_[index] - alpha * gradient2[index];
-    }
+  });
+
+  // Computes the final gradients, adding regularization (but not for the bias terms)
+  for (auto i=size_t{0}; i<theta_.size(); ++i) {
+    auto sum = static_cast<T>(0);
+    for (auto &partial: gradients) { sum += partial[i]; }
+    const auto is_bias = (i < NumWeights1()) ? (i % (n0+1) == 0) : (i == NumWeights1());
+    if (!is_bias) { sum += lambda * theta_[i]; }
+    gradient[i] = sum / static_cast<T>(m);
   }
 }
 
 // =================================================================================================
 
-// Feed-forward function: input layer (with bias unit)
-template <typename T>
-std::vector<T> NeuralNetwork<T>::FeedForward0(const std::vector<T> &x) const {
-  auto a0 = std::vector<T>(layer_sizes_[0]+1);
-  a0[0] = static_cast<T>(1);
-  for (auto id0=size_t{0}; id0<layer_sizes_[0]; ++id0) {
-    a0[id0 + 1] = x[id0];
-  }
-  return a0;
-}
-
-// Feed-forward function: hidden layer (with bias unit and optionally a sigmoid activation function)
-template <typename T>
-std::vector<T> NeuralNetwork<T>::FeedForward1(const std::vector<T> &a0, const bool sigmoid) const {
-  auto a1 = std::vector<T>(layer_sizes_[1]+1);
-  a1[0] = static_cast<T>(1);
-  for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-    auto z1 = static_cast<T>(0);
-    for (auto id0=size_t{0}; id0<layer_sizes_[0]+1; ++id0) {
-      z1 += a0[id0] * theta1_[id1*(layer_sizes_[0]+1) + id0];
-    }
-    a1[id1 + 1] = (sigmoid) ? Sigmoid(z1) : z1;
-  }
-  return a1;
-}
-
-// Feed-forward function: output layer
+// Feed-forward function: the hidden layer uses a sigmoid activation function, the output layer
+// doesn't. The bias units are the first weights of each row.
 template <typename T>
-std::vector<T> NeuralNetwork<T>::FeedForward2(const std::vector<T> &a1) const {
-  auto a2 = std::vector<T>(layer_sizes_[2]);
-  for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-    auto z2 = static_cast<T>(0);
-    for (auto id1=size_t{0}; id1<layer_sizes_[1]+1; ++id1) {
-      z2 += a1[id1] * theta2_[id2*(layer_sizes_[1]+1) + id1];
-    }
-    a2[id2] = z2; // No sigmoid activation function in the output layer
+T NeuralNetwork<T>::FeedForward(const T *x, T *a1) const {
+  const auto n0 = layer_sizes_[0];
+  const auto n1 = layer_sizes_[1];
+  for (auto id1=size_t{0}; id1<n1; ++id1) {
+    const auto weights = theta1() + id1*(n0+1);
+    a1[id1] = Sigmoid(weights[0] + Dot(weights + 1, x, n0));
   }
-  return a2;
+  return theta2()[0] + Dot(theta2() + 1, a1, n1);
 }
 
 // =================================================================================================
@@ -0,0 +1,285 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the Message and Socket classes (see the header for more information).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/network.h"
+
+#include <cstring> // std::memcpy, std::strerror
+#include <cerrno> // errno
+#include <cmath> // std::floor
+#include <utility> // std::move
+
+// POSIX sockets
+#ifndef _WIN32
+  #include <sys/types.h>
+  #include <sys/socket.h>
+  #include <netdb.h>
+  #include <netinet/in.h>
+  #include <unistd.h>
+  #include <poll.h>
+  #include <sys/time.h>
+#endif
+
+namespace cltune {
+// =================================================================================================
+
+// Initializes the message
+Message::Message():
+    data_(),
+    position_(0) {
+}
+Message::Message(const std::string &data):
+    data_(data),
+    position_(0) {
+}
+
+// Appends 8 bytes in little-endian order
+void Message::WriteInteger(const uint64_t value) {
+  for (auto i=size_t{0}; i<8; ++i) {
+    data_.push_back(static_cast<char>((value >> (8*i)) & 0xFF));
+  }
+}
+
+// Writes the bit-pattern of the (IEEE-754) double as an integer
+void Message::WriteDouble(const double value) {
+  auto bits = uint64_t{0};
+  std::memcpy(&bits, &value, sizeof(bits));
+  WriteInteger(bits);
+}
+
+// Writes the length of the string followed by its contents
+void Message::WriteString(const std::string &value) {
+  WriteInteger(value.size());
+  data_ += value;
+}
+
+// Reads 8 bytes in little-endian order
+uint64_t Message::ReadInteger() {
+  if (position_ + 8 > data_.size()) { throw Exception("Reading beyond the end of a message"); }
+  auto value = uint64_t{0};
+  for (auto i=size_t{0}; i<8; ++i) {
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(data_[position_ + i])) << (8*i);
+  }
+  position_ += 8;
+  return value;
+}
+
+// Reads the bit-pattern of a double
+double Message::ReadDouble() {
+  const auto bits = ReadInteger();
+  auto value = 0.0;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Reads the length of the string followed by its contents
+std::string Message::ReadString() {
+  const auto size = static_cast<size_t>(ReadInteger());
+  if (position_ + size > data_.size()) { throw Exception("Reading beyond the end of a message"); }
+  const auto value = data_.substr(position_, size);
+  position_ += size;
+  return value;
+}
+
+// =================================================================================================
+#ifndef _WIN32
+
+// Resolves the host and tries all of its addresses
+std::unique_ptr<Socket> Socket::Connect(const std::string &host, const size_t port) {
+  auto hints = addrinfo{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  const auto port_string = std::to_string(port);
+  if (getaddrinfo(host.c_str(), port_string.c_str(), &hints, &addresses) != 0) {
+    throw Exception("Could not resolve host "+host);
+  }
+  auto descriptor = -1;
+  for (auto address = addresses; address != nullptr; address = address->ai_next) {
+    descriptor = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (descriptor == -1) { continue; }
+    if (connect(descriptor, address->ai_addr, address->ai_addrlen) == 0) { break; }
+    close(descriptor);
+    descriptor = -1;
+  }
+  freeaddrinfo(addresses);
+  if (descriptor == -1) {
+    throw Exception("Could not connect to "+host+":"+port_string);
+  }
+  return std::unique_ptr<Socket>(new Socket(descriptor));
+}
+
+// Opens a listening socket on all interfaces and accepts the connections one by one
+std::vector<std::unique_ptr<Socket>> Socket::Accept(const size_t port,
+                                                    const size_t num_connections) {
+  Listener listener(port, false);
+  auto sockets = std::vector<std::unique_ptr<Socket>>();
+  while (sockets.size() < num_connections) {
+    auto socket = listener.Accept(-1.0);
+    if (socket) { sockets.push_back(std::move(socket)); }
+  }
+  return sockets;
+}
+
+// Wraps a connected socket
+Socket::Socket(const int descriptor):
+    descriptor_(descriptor) {
+}
+
+// Closes the connection
+Socket::~Socket() {
+  close(descriptor_);
+}
+
+// Sends all bytes, continuing after partial writes
+void Socket::SendBytes(const char* data, const size_t size) {
+  auto sent = size_t{0};
+  while (sent < size) {
+    #ifdef MSG_NOSIGNAL
+      const auto result = send(descriptor_, data + sent, size - sent, MSG_NOSIGNAL);
+    #else
+      const auto result = send(descriptor_, data + sent, size - sent, 0);
+    #endif
+    if (result < 0 && errno == EINTR) { continue; }
+    if (result <= 0) { throw Exception("Connection lost while sending"); }
+    sent += static_cast<size_t>(result);
+  }
+}
+
+// Receives all bytes, continuing after partial reads
+void Socket::ReceiveBytes(char* data, const size_t size) {
+  auto received = size_t{0};
+  while (received < size) {
+    const auto result = recv(descriptor_, data + received, size - received, 0);
+    if (result < 0 && errno == EINTR) { continue; }
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      throw Exception("Timed out while receiving");
+    }
+    if (result <= 0) { throw Exception("Connection lost while receiving"); }
+    received += static_cast<size_t>(result);
+  }
+}
+
+// Sets the timeout of the blocking receive calls
+void Socket::SetTimeout(const double seconds) {
+  auto timeout = timeval{};
+  timeout.tv_sec = static_cast<time_t>(std::floor(seconds));
+  timeout.tv_usec = static_cast<suseconds_t>((seconds - std::floor(seconds)) * 1.0e6);
+  setsockopt(descriptor_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+// =================================================================================================
+
+// Binds to the given (or a free) port and starts listening
+Listener::Listener(const size_t port, const bool loopback_only):
+    descriptor_(socket(AF_INET, SOCK_STREAM, 0)),
+    port_(port) {
+  if (descriptor_ == -1) {
+    throw Socket::Exception(std::string{"Could not create socket: "}+std::strerror(errno));
+  }
+  auto reuse = 1;
+  setsockopt(descriptor_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  auto address = sockaddr_in{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl((loopback_only) ? INADDR_LOOPBACK : INADDR_ANY);
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  auto address_size = static_cast<socklen_t>(sizeof(address));
+  if (bind(descriptor_, reinterpret_cast<sockaddr*>(&address), address_size) != 0 ||
+      listen(descriptor_, SOMAXCONN) != 0 ||
+      getsockname(descriptor_, reinterpret_cast<sockaddr*>(&address), &address_size) != 0) {
+    const auto error = std::string{std::strerror(errno)};
+    close(descriptor_);
+    throw Socket::Exception("Could not listen on port "+std::to_string(port)+": "+error);
+  }
+  port_ = ntohs(address.sin_port);
+}
+
+// Stops listening
+Listener::~Listener() {
+  close(descriptor_);
+}
+
+// Waits for the socket to become readable, which signals an incoming connection
+std::unique_ptr<Socket> Listener::Accept(const double timeout_seconds) {
+  auto request = pollfd{descriptor_, POLLIN, 0};
+  const auto ready = poll(&request, 1, static_cast<int>(timeout_seconds * 1000.0));
+  if (ready == 0 || (ready < 0 && errno == EINTR)) { return nullptr; }
+  const auto descriptor = (ready > 0) ? accept(descriptor_, nullptr, nullptr) : -1;
+  if (descriptor == -1) {
+    throw Socket::Exception(std::string{"Could not accept a connection: "}+std::strerror(errno));
+  }
+  return std::unique_ptr<Socket>(new Socket(descriptor));
+}
+
+#else // Sockets are not (yet) supported on Windows
+
+std::unique_ptr<Socket> Socket::Connect(const std::string &, const size_t) {
+  throw Exception("Distributed tuning is not supported on this platform");
+}
+std::vector<std::unique_ptr<Socket>> Socket::Accept(const size_t, const size_t) {
+  throw Exception("Distributed tuning is not supported on this platform");
+}
+Socket::Socket(const int descriptor): descriptor_(descriptor) { }
+Socket::~Socket() { }
+void Socket::SendBytes(const char*, const size_t) { }
+void Socket::ReceiveBytes(char*, const size_t) { }
+void Socket::SetTimeout(const double) { }
+Listener::Listener(const size_t port, const bool): descriptor_(-1), port_(port) {
+  throw Socket::Exception("Listening sockets are not supported on this platform");
+}
+Listener::~Listener() { }
+std::unique_ptr<Socket> Listener::Accept(const double) { return nullptr; }
+
+#endif
+// =================================================================================================
+
+// The largest message: the specification holds copies of all the arguments and reference outputs
+const size_t Socket::kMaxMessageSize = size_t{1} << 31;
+
+// Sends the size of the message first, followed by its contents
+void Socket::Send(const Message &message) {
+  auto header = Message();
+  header.WriteInteger(message.data().size());
+  SendBytes(header.data().data(), header.data().size());
+  SendBytes(message.data().data(), message.data().size());
+}
+
+// Receives the size of the message first, followed by its contents
+Message Socket::Receive() {
+  auto header = std::string(8, '\0');
+  ReceiveBytes(&header[0], header.size());
+  const auto size = static_cast<size_t>(Message(header).ReadInteger());
+  if (size > kMaxMessageSize) {
+    throw Exception("message of "+std::to_string(size)+" bytes exceeds the maximum size");
+  }
+  auto data = std::string(size, '\0');
+  if (size > 0) { ReceiveBytes(&data[0], size); }
+  return Message(data);
+}
+
+// =================================================================================================
+} // namespace cltune
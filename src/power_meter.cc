@@ -0,0 +1,120 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the PowerMeter class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/power_meter.h"
+
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// The sampling thread is only running while measuring
+PowerMeter::PowerMeter(PowerFunction sensor, const double interval_ms):
+    sensor_(sensor),
+    interval_(interval_ms),
+    thread_(),
+    mutex_(),
+    condition_(),
+    running_(false),
+    error_(),
+    energy_(0.0),
+    last_power_(0.0),
+    start_time_(),
+    last_time_() {
+  if (!sensor_) { throw std::runtime_error("The power sensor can't be empty"); }
+  if (interval_ms <= 0.0) {
+    throw std::runtime_error("The power sampling interval must be positive");
+  }
+}
+
+PowerMeter::~PowerMeter() {
+  try { Stop(); } catch (...) { } // a failing sensor is no longer of interest
+}
+
+// =================================================================================================
+
+// Takes the first sample on the calling thread, such that the measurement starts right away
+void PowerMeter::Start() {
+  Stop();
+  energy_ = 0.0;
+  error_ = nullptr;
+  start_time_ = std::chrono::steady_clock::now();
+  last_time_ = start_time_;
+  last_power_ = sensor_();
+  running_ = true;
+  thread_ = std::thread(&PowerMeter::SampleLoop, this);
+}
+
+// Takes the last sample once the thread has finished. The average is taken over the time between
+// the first and the last sample.
+double PowerMeter::Stop() {
+  if (!thread_.joinable()) { return 0.0; }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  condition_.notify_all();
+  thread_.join();
+  if (error_) { std::rethrow_exception(error_); }
+  Sample();
+  const auto duration = std::chrono::duration<double,std::milli>(last_time_ - start_time_).count();
+  return (duration > 0.0) ? energy_ / duration : last_power_;
+}
+
+// =================================================================================================
+
+// Waits for the interval or for the measurement to stop, whichever comes first. A failing sensor
+// ends the sampling: its exception is passed on through 'Stop'.
+void PowerMeter::SampleLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    if (condition_.wait_for(lock, interval_, [this] () { return !running_; })) { break; }
+    lock.unlock();
+    try {
+      Sample();
+    } catch (...) {
+      error_ = std::current_exception();
+      return;
+    }
+    lock.lock();
+  }
+}
+
+// Integrates the power over the time since the previous sample (trapezoidal rule): Watts times
+// milliseconds gives millijoules
+void PowerMeter::Sample() {
+  const auto power = sensor_();
+  const auto time = std::chrono::steady_clock::now();
+  const auto elapsed = std::chrono::duration<double,std::milli>(time - last_time_).count();
+  energy_ += 0.5 * (power + last_power_) * elapsed;
+  last_power_ = power;
+  last_time_ = time;
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -0,0 +1,181 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the Sandbox class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/sandbox.h"
+
+#include <vector> // std::vector
+#include <fstream> // std::ifstream
+#include <sstream> // std::stringstream, std::istringstream
+#include <chrono> // std::chrono::milliseconds
+#include <thread> // std::this_thread::sleep_for
+#include <cstdlib> // std::getenv
+#include <cstring> // std::strerror
+#include <cerrno> // errno
+
+// POSIX processes (child processes are only supported on Linux, see 'Start')
+#ifdef __linux__
+  #include <sys/types.h>
+  #include <sys/wait.h>
+  #include <signal.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  extern char **environ;
+#endif
+
+namespace cltune {
+// =================================================================================================
+
+const std::string Sandbox::kEnvironmentVariable = "CLTUNE_SANDBOX";
+const double Sandbox::kStartupTimeout = 120.0;
+
+// The time given to a child to exit by itself after being told to stop
+const auto kStopTimeout = std::chrono::seconds(10);
+
+// The variable holds the port, the platform ID, and the device ID, separated by spaces
+bool Sandbox::IsChild(size_t &port, size_t &platform_id, size_t &device_id) {
+  const auto value = std::getenv(kEnvironmentVariable.c_str());
+  if (value == nullptr) { return false; }
+  std::istringstream stream(value);
+  return static_cast<bool>(stream >> port >> platform_id >> device_id);
+}
+
+// =================================================================================================
+
+// No child is started until it is needed
+Sandbox::Sandbox(const size_t platform_id, const size_t device_id):
+    platform_id_(platform_id),
+    device_id_(device_id),
+    process_id_(-1),
+    socket_() {
+}
+
+// A child which is still running at this point is no longer needed
+Sandbox::~Sandbox() {
+  Kill();
+}
+
+// =================================================================================================
+#ifdef __linux__
+
+// Starts the child by executing this program again ('/proc/self/exe') with the same arguments. The
+// arguments and the environment are prepared before forking: the tuner is multi-threaded, so the
+// child may only call async-signal-safe functions until it executes the program. The child's
+// standard output is discarded, since the parent already reports the results.
+void Sandbox::Start() {
+  Kill();
+  Listener listener(0, true);
+
+  std::ifstream command_line("/proc/self/cmdline", std::ios::binary);
+  std::stringstream command_line_contents;
+  command_line_contents << command_line.rdbuf();
+  auto arguments = std::vector<std::string>();
+  auto argument = std::string{};
+  while (std::getline(command_line_contents, argument, '\0')) { arguments.push_back(argument); }
+  if (arguments.empty()) { throw Socket::Exception("Could not read the command line"); }
+
+  auto environment = std::vector<std::string>();
+  const auto prefix = kEnvironmentVariable + "=";
+  for (auto variable = environ; *variable != nullptr; ++variable) {
+    if (std::string{*variable}.compare(0, prefix.size(), prefix) != 0) {
+      environment.push_back(*variable);
+    }
+  }
+  environment.push_back(prefix + std::to_string(listener.port()) + " " +
+                        std::to_string(platform_id_) + " " + std::to_string(device_id_));
+
+  auto argv = std::vector<char*>();
+  for (auto &value: arguments) { argv.push_back(&value[0]); }
+  argv.push_back(nullptr);
+  auto envp = std::vector<char*>();
+  for (auto &value: environment) { envp.push_back(&value[0]); }
+  envp.push_back(nullptr);
+
+  const auto process_id = fork();
+  if (process_id == -1) {
+    throw Socket::Exception(std::string{"Could not start a child process: "}+std::strerror(errno));
+  }
+  if (process_id == 0) {
+    const auto null_device = open("/dev/null", O_WRONLY);
+    if (null_device != -1) { dup2(null_device, STDOUT_FILENO); }
+    execve("/proc/self/exe", argv.data(), envp.data());
+    _exit(127);
+  }
+  process_id_ = static_cast<int>(process_id);
+
+  // Waits for the child to connect, checking regularly whether it is still alive
+  const auto start_time = std::chrono::steady_clock::now();
+  while (true) {
+    socket_ = listener.Accept(0.1);
+    if (socket_) { return; }
+    auto status = 0;
+    if (waitpid(process_id_, &status, WNOHANG) == process_id_) {
+      process_id_ = -1;
+      throw Socket::Exception("the child process exited during start-up");
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start_time;
+    if (std::chrono::duration<double>(elapsed).count() > kStartupTimeout) {
+      Kill();
+      throw Socket::Exception("the child process did not connect in time");
+    }
+  }
+}
+
+// Closes the connection and waits for the child to exit, killing it if it takes too long
+void Sandbox::Stop() {
+  socket_.reset();
+  if (process_id_ == -1) { return; }
+  const auto start_time = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start_time < kStopTimeout) {
+    auto status = 0;
+    if (waitpid(process_id_, &status, WNOHANG) == process_id_) { process_id_ = -1; return; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  Kill();
+}
+
+// Sends the kill signal, which can't be ignored, and reaps the child
+void Sandbox::Kill() {
+  socket_.reset();
+  if (process_id_ == -1) { return; }
+  kill(process_id_, SIGKILL);
+  auto status = 0;
+  while (waitpid(process_id_, &status, 0) == -1 && errno == EINTR) { }
+  process_id_ = -1;
+}
+
+#else // Child processes are not (yet) supported on other platforms
+
+void Sandbox::Start() {
+  throw Socket::Exception("Isolated execution is not supported on this platform");
+}
+void Sandbox::Stop() { socket_.reset(); }
+void Sandbox::Kill() { socket_.reset(); }
+
+#endif
+// =================================================================================================
+} // namespace cltune
@@ -29,16 +29,24 @@
 #include "internal/searcher.h"
 
 #include <limits>
+#include <algorithm>
+#include <stdexcept>
 
 namespace cltune {
 // =================================================================================================
 
+const size_t Searcher::kMaxExactCount = size_t{1} << 24;
+const size_t Searcher::kNumEstimationSamples = size_t{1} << 16;
+
 // Simple base-class constructor
-Searcher::Searcher(const Configurations &configurations):
-    configurations_(configurations),
-    execution_times_(configurations.size(), std::numeric_limits<double>::max()),
+Searcher::Searcher(const KernelInfo &kernel, const unsigned int seed):
+    kernel_(kernel),
+    seed_(seed),
+    execution_times_(),
     explored_indices_(),
-    index_(0) {
+    index_(0),
+    pending_indices_(),
+    reported_times_() {
 }
 
 // Adds the resulting execution time to the back of the execution times vector. Also stores the
@@ -48,15 +56,126 @@ void Searcher::PushExecutionTime(const double execution_time) {
   execution_times_[index_] = execution_time;
 }
 
+// By default, nothing is known about the upcoming configurations
+Searcher::Configurations Searcher::PeekConfigurations(const size_t) const {
+  return Configurations{};
+}
+
+// The number of configurations to hand out is limited by the number of steps left in the search
+std::vector<size_t> Searcher::RequestConfigurations(const size_t count) {
+  auto indices = std::vector<size_t>();
+  const auto num_steps = NumConfigurations();
+  const auto num_waiting = pending_indices_.size() + reported_times_.size();
+  const auto num_taken = explored_indices_.size() + num_waiting;
+  if (num_taken >= num_steps) { return indices; }
+  const auto num_requested = std::min(count, num_steps - num_taken);
+
+  // Walks through the current and the upcoming configurations in order, skipping those which are
+  // handed out already. A configuration which appears a second time (e.g. two particles at the
+  // same position) needs a result of its own, so the walk stops there until the first is known.
+  const auto num_raw = kernel_.NumRawConfigurations();
+  auto candidates = std::vector<size_t>{index_};
+  for (auto &configuration: PeekConfigurations(num_waiting + num_requested)) {
+    candidates.push_back(kernel_.IndexFromConfiguration(configuration));
+  }
+  auto skipped = std::vector<size_t>();
+  for (auto &candidate: candidates) {
+    if (indices.size() == num_requested) { break; }
+    if (candidate >= num_raw) { continue; }
+    if (std::find(indices.begin(), indices.end(), candidate) != indices.end()) { break; }
+    if (std::find(skipped.begin(), skipped.end(), candidate) != skipped.end()) { break; }
+    if (reported_times_.find(candidate) != reported_times_.end() ||
+        std::find(pending_indices_.begin(), pending_indices_.end(), candidate) !=
+        pending_indices_.end()) {
+      skipped.push_back(candidate);
+      continue;
+    }
+    indices.push_back(candidate);
+  }
+  pending_indices_.insert(pending_indices_.end(), indices.begin(), indices.end());
+  return indices;
+}
+
+// Stores the results and then feeds them to the sequential interface for as long as the result of
+// the current configuration is known
+void Searcher::ReportResults(const std::vector<size_t> &indices, const std::vector<double> &times) {
+  for (auto i=size_t{0}; i<indices.size() && i<times.size(); ++i) {
+    reported_times_[indices[i]] = times[i];
+    auto pending = std::find(pending_indices_.begin(), pending_indices_.end(), indices[i]);
+    if (pending != pending_indices_.end()) { pending_indices_.erase(pending); }
+  }
+  while (explored_indices_.size() < NumConfigurations()) {
+    auto reported = reported_times_.find(index_);
+    if (reported == reported_times_.end()) { break; }
+    const auto execution_time = reported->second;
+    reported_times_.erase(reported);
+    PushExecutionTime(execution_time);
+    CalculateNextIndex();
+  }
+}
+
 // Prints the explored indices and the corresponding execution times to a log(file)
 void Searcher::PrintLog(FILE* fp) const {
   fprintf(fp, "step;index;time\n");
   auto step = 0;
   for (auto &explored_index: explored_indices_) {
-    fprintf(fp, "%d;%zu;%.3lf\n", step, explored_index, execution_times_[explored_index]);
+    fprintf(fp, "%d;%zu;%.3lf\n", step, explored_index, ExecutionTime(explored_index));
     ++step;
   }
 }
 
+// =================================================================================================
+
+// Simple linear scan over the configuration space, checking the constraints one by one
+size_t Searcher::NextValidIndex(const size_t start, const bool wrap_around) const {
+  const auto num_raw = kernel_.NumRawConfigurations();
+  for (auto index=start; index<num_raw; ++index) {
+    if (kernel_.IsValidConfiguration(index)) { return index; }
+  }
+  if (wrap_around) {
+    for (auto index=size_t{0}; index<start && index<num_raw; ++index) {
+      if (kernel_.IsValidConfiguration(index)) { return index; }
+    }
+  }
+  return num_raw;
+}
+
+// Rejection sampling: draws random indices until a valid one is found
+size_t Searcher::RandomValidIndex(std::default_random_engine &generator) const {
+  const auto num_raw = kernel_.NumRawConfigurations();
+  if (num_raw == 0) { throw std::runtime_error("Searching an empty configuration space"); }
+  std::uniform_int_distribution<size_t> distribution(0, num_raw - 1);
+  for (auto s=size_t{0}; s<kNumEstimationSamples; ++s) {
+    const auto index = distribution(generator);
+    if (kernel_.IsValidConfiguration(index)) { return index; }
+  }
+  const auto index = NextValidIndex(distribution(generator), true);
+  if (index == num_raw) { throw std::runtime_error("No valid configurations found"); }
+  return index;
+}
+
+// Counts the valid configurations of small spaces (pruned by the constraints and spread over all
+// hardware threads). For larger spaces, the fraction of valid configurations is estimated from a
+// fixed number of random samples.
+size_t Searcher::NumValidConfigurations() const {
+  const auto num_raw = kernel_.NumRawConfigurations();
+  if (num_raw <= kMaxExactCount) { return kernel_.NumValidConfigurations(0); }
+  auto generator = std::default_random_engine(RandomSeed());
+  std::uniform_int_distribution<size_t> distribution(0, num_raw - 1);
+  auto num_valid_samples = size_t{0};
+  for (auto s=size_t{0}; s<kNumEstimationSamples; ++s) {
+    if (kernel_.IsValidConfiguration(distribution(generator))) { ++num_valid_samples; }
+  }
+  const auto fraction = static_cast<double>(num_valid_samples) / kNumEstimationSamples;
+  return std::max(size_t{1}, static_cast<size_t>(fraction * static_cast<double>(num_raw)));
+}
+
+// Looks up the execution time in the map of explored configurations
+double Searcher::ExecutionTime(const size_t index) const {
+  const auto entry = execution_times_.find(index);
+  if (entry == execution_times_.end()) { return std::numeric_limits<double>::max(); }
+  return entry->second;
+}
+
 // =================================================================================================
 } // namespace cltune
@@ -30,6 +30,7 @@
 
 #include <limits>
 #include <cmath>
+#include <algorithm>
 
 namespace cltune {
 // =================================================================================================
@@ -41,37 +42,44 @@ const size_t Annealing::kMaxAlreadyVisitedStates = size_t{10};
 // Maximum number of differences to consider this still a neighbour
 const size_t Annealing::kMaxDifferences = size_t{3};
 
+// Maximum number of attempts to find a valid neighbour before staying at the current state
+const size_t Annealing::kMaxNeighbourAttempts = size_t{100};
+
 // Initializes the simulated annealing searcher by specifying the fraction of the total search space
-// to consider and the maximum annealing 'temperature'.
-Annealing::Annealing(const Configurations &configurations,
-                     const double fraction, const double max_temperature):
-    Searcher(configurations),
+// to consider, the maximum annealing 'temperature', and the number of chains. Each chain starts in
+// its own random state.
+Annealing::Annealing(const KernelInfo &kernel,
+                     const double fraction, const double max_temperature,
+                     const size_t num_chains, const unsigned int seed):
+    Searcher(kernel, seed),
     fraction_(fraction),
     max_temperature_(max_temperature),
+    num_configurations_(0),
     num_visited_states_(0),
-    current_state_(0),
-    neighbour_state_(0),
+    chain_(0),
+    current_states_(std::max(size_t{1}, num_chains)),
+    neighbour_states_(std::max(size_t{1}, num_chains)),
     num_already_visisted_states_(0),
     generator_(RandomSeed()),
-    int_distribution_(0, static_cast<int>(configurations_.size())),
     probability_distribution_(0.0, 1.0) {
-  auto random_initial_state = static_cast<size_t>(int_distribution_(generator_));
-  current_state_ = random_initial_state;
-  index_ = random_initial_state;
+  num_configurations_ = std::max(size_t{1},
+    static_cast<size_t>(static_cast<double>(NumValidConfigurations())*fraction_));
+  for (auto &current_state: current_states_) { current_state = RandomValidIndex(generator_); }
+  neighbour_states_ = current_states_;
+  index_ = neighbour_states_[chain_];
 }
 
 // =================================================================================================
 
-// Returns the next configuration. This is similar to other searchers, but now also keeps track of
-// the number of visited states to be able to compute the temperature.
+// Returns the next configuration. This is similar to other searchers.
 KernelInfo::Configuration Annealing::GetConfiguration() {
-  ++num_visited_states_;
-  return configurations_[index_];
+  return kernel_.GetConfiguration(index_);
 }
 
-// Computes the new temperate, the new state (based on the acceptance probability function), and
-// a random neighbour of the new state. If the newly calculated neighbour is already visited, this
-// function is called recursively until some maximum number of calls has been reached.
+// Computes the new temperate, the new state of the current chain (based on the acceptance
+// probability function), and a random neighbour of the new state. If the newly calculated neighbour
+// is already visited, this function is called recursively until some maximum number of calls has
+// been reached. Afterwards, it is the turn of the next chain.
 void Annealing::CalculateNextIndex() {
 
   // Computes the new temperature
@@ -83,23 +91,23 @@ void Annealing::CalculateNextIndex() {
   auto temperature = max_temperature_ * (1.0 - progress);
 
   // Determines whether to continue with the neighbour or with the current ID
-  auto acceptance_probability = AcceptanceProbability(execution_times_[current_state_],
-                                                      execution_times_[neighbour_state_],
+  auto &current_state = current_states_[chain_];
+  auto &neighbour_state = neighbour_states_[chain_];
+  auto acceptance_probability = AcceptanceProbability(ExecutionTime(current_state),
+                                                      ExecutionTime(neighbour_state),
                                                       temperature);
   auto random_probability = probability_distribution_(generator_);
   if (acceptance_probability > random_probability) {
-    current_state_ = neighbour_state_;
+    current_state = neighbour_state;
   }
 
   // Computes the new neighbour state
-  auto neighbours = GetNeighboursOf(current_state_);
-  const auto random_integer = static_cast<size_t>(std::abs(int_distribution_(generator_)));
-  neighbour_state_ = neighbours[random_integer % neighbours.size()];
+  neighbour_state = GetNeighbourOf(current_state);
 
   // Checks whether this neighbour was already visited. If so, calculate a new neighbour instead.
   // This continues up to a maximum number, because all neighbours might already be visited. In
   // that case, the algorithm terminates.
-  if (execution_times_[neighbour_state_] != std::numeric_limits<double>::max()) {
+  if (ExecutionTime(neighbour_state) != std::numeric_limits<double>::max()) {
     if (num_already_visisted_states_ < kMaxAlreadyVisitedStates) {
       ++num_already_visisted_states_;
       CalculateNextIndex();
@@ -108,54 +116,76 @@ void Annealing::CalculateNextIndex() {
   }
   num_already_visisted_states_ = 0;
 
-  // Sets the next index
-  index_ = neighbour_state_;
+  // Sets the next index: the neighbour of the next chain
+  chain_ = (chain_ + 1) % neighbour_states_.size();
+  index_ = neighbour_states_[chain_];
 }
 
 // The number of configurations is equal to all possible configurations
 size_t Annealing::NumConfigurations() {
-  return std::max(size_t{1}, static_cast<size_t>(static_cast<double>(configurations_.size())*fraction_));
+  return num_configurations_;
 }
 
 // =================================================================================================
 
 // Adds the resulting execution time to the back of the execution times vector. Also stores the
-// index value (to keep track of which indices are explored).
+// index value (to keep track of which indices are explored) and counts the number of visited
+// states to be able to compute the temperature.
 void Annealing::PushExecutionTime(const double execution_time) {
-  explored_indices_.push_back(current_state_);
+  ++num_visited_states_;
+  explored_indices_.push_back(current_states_[chain_]);
   execution_times_[index_] = execution_time;
 }
 
-// =================================================================================================
+// The neighbours of the other chains are already computed: they only move when it is their turn
+Searcher::Configurations Annealing::PeekConfigurations(const size_t count) const {
+  auto configurations = Configurations{};
+  for (auto i=size_t{1}; i<neighbour_states_.size() && configurations.size()<count; ++i) {
+    const auto chain = (chain_ + i) % neighbour_states_.size();
+    configurations.push_back(kernel_.GetConfiguration(neighbour_states_[chain]));
+  }
+  return configurations;
+}
 
-// Retrieves the neighbours IDs of a configuration identified by a reference ID. This searches
-// through all configurations and checks how many values are different. This function returns a
-// vector with IDs of which there is only one difference with the reference configuration.
-// TODO: Is there a smarter way to compute this? This can become quite slow if the number of
-// configurations is large.
-std::vector<size_t> Annealing::GetNeighboursOf(const size_t reference_id) const {
-  auto neighbours = std::vector<size_t>{};
-  auto other_id = size_t{0};
-  for (auto &configuration: configurations_) {
-
-    // Count the number of different settings for this configuration
-    auto differences = size_t{0};
-    auto setting_id = size_t{0};
-    for (auto &setting: configuration) {
-      if (setting.value != configurations_[reference_id][setting_id].value) { ++differences; }
-      ++setting_id;
-    }
+// Each of the given states replaces the random initial state of a chain. These states are then
+// evaluated first, since a chain starts by evaluating its initial state.
+void Annealing::WarmStart(const std::vector<size_t> &indices) {
+  for (auto chain=size_t{0}; chain<indices.size() && chain<current_states_.size(); ++chain) {
+    current_states_[chain] = indices[chain];
+    neighbour_states_[chain] = indices[chain];
+  }
+  index_ = neighbour_states_[chain_];
+}
 
-    // Consider this configuration a neighbour if there is at most a certain amount of differences
-    if (differences <= kMaxDifferences) {
-      neighbours.push_back(other_id);
+// =================================================================================================
+
+// Retrieves a random neighbour of a configuration identified by a reference ID. Instead of
+// searching through all configurations, a neighbour is generated directly: between one and
+// 'kMaxDifferences' randomly chosen parameters are changed to another random value. Invalid results
+// are discarded and a new neighbour is generated, up to a maximum number of attempts. If no valid
+// neighbour is found, the reference itself is returned.
+size_t Annealing::GetNeighbourOf(const size_t reference_id) {
+  const auto parameters = kernel_.parameters();
+  const auto reference = kernel_.ValueIndices(reference_id);
+  if (parameters.size() == 0) { return reference_id; }
+  const auto max_differences = std::min(kMaxDifferences, parameters.size());
+  std::uniform_int_distribution<size_t> num_differences_distribution(1, max_differences);
+  std::uniform_int_distribution<size_t> parameter_distribution(0, parameters.size() - 1);
+  for (auto attempt=size_t{0}; attempt<kMaxNeighbourAttempts; ++attempt) {
+    auto neighbour = reference;
+    const auto num_differences = num_differences_distribution(generator_);
+    for (auto d=size_t{0}; d<num_differences; ++d) {
+      const auto parameter_id = parameter_distribution(generator_);
+      const auto num_values = parameters[parameter_id].values.size();
+      if (num_values < 2) { continue; }
+      std::uniform_int_distribution<size_t> value_distribution(0, num_values - 2);
+      const auto value_id = value_distribution(generator_);
+      neighbour[parameter_id] = (value_id >= reference[parameter_id]) ? value_id + 1 : value_id;
     }
-    ++other_id;
-  }
-  if (neighbours.size() == 0) {
-    throw std::runtime_error("Running annealing and found no neighbours, aborting");
+    const auto neighbour_id = kernel_.IndexFromValueIndices(neighbour);
+    if (kernel_.IsValidConfiguration(neighbour_id)) { return neighbour_id; }
   }
-  return neighbours;
+  return reference_id;
 }
 
 // Computes the acceptance probablity P(e_current, e_neighbour, T) based on the Kirkpatrick et al.
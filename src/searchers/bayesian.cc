@@ -0,0 +1,349 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the Bayesian class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/searchers/bayesian.h"
+
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
+namespace cltune {
+// =================================================================================================
+
+const size_t Bayesian::kNumInitialSamples = size_t{10};
+const size_t Bayesian::kNumCandidates = size_t{256};
+const size_t Bayesian::kMaxCandidateAttempts = size_t{20};
+const size_t Bayesian::kMaxObservations = size_t{256};
+const std::vector<double> Bayesian::kLengthScales = {0.1, 0.2, 0.4, 0.8};
+const double Bayesian::kNoiseVariance = 0.01;
+
+// The minimum improvement (in standard deviations of the execution times) to aim for, which favours
+// exploration slightly once the model becomes confident
+const auto kMinImprovement = 0.01;
+
+// Initializes the searcher by specifying the fraction of the total search space to consider. The
+// features are normalised as in the machine-learning models (the mean is subtracted and the result
+// is divided by the range), but based on the values of the parameters instead of on the samples.
+// Parameters with only positive values are taken on a logarithmic scale first, since tuning values
+// are often powers of two.
+Bayesian::Bayesian(const KernelInfo &kernel, const double fraction, const unsigned int seed):
+    Searcher(kernel, seed),
+    fraction_(fraction),
+    num_configurations_(0),
+    feature_logarithmic_(),
+    feature_means_(),
+    feature_ranges_(),
+    training_features_(),
+    cholesky_(),
+    weights_(),
+    length_scale_(kLengthScales[0]),
+    best_target_(0.0),
+    warm_start_indices_(),
+    generator_(RandomSeed()) {
+  for (auto &parameter: kernel_.parameters()) {
+    const auto is_positive = std::all_of(parameter.values.begin(), parameter.values.end(),
+                                         [] (const size_t value) { return value > 0; });
+    auto min = std::numeric_limits<double>::max();
+    auto max = -min;
+    auto sum = 0.0;
+    for (auto &value: parameter.values) {
+      const auto feature = (is_positive) ? std::log2(static_cast<double>(value)) :
+                                           static_cast<double>(value);
+      min = std::min(min, feature);
+      max = std::max(max, feature);
+      sum += feature;
+    }
+    feature_logarithmic_.push_back(is_positive);
+    feature_means_.push_back(sum / static_cast<double>(parameter.values.size()));
+    feature_ranges_.push_back(max - min);
+  }
+  num_configurations_ = std::max(size_t{1},
+    static_cast<size_t>(static_cast<double>(NumValidConfigurations())*fraction_));
+  index_ = RandomValidIndex(generator_);
+}
+
+// =================================================================================================
+
+// Returns the next configuration
+KernelInfo::Configuration Bayesian::GetConfiguration() {
+  return kernel_.GetConfiguration(index_);
+}
+
+// Explores the configurations given to 'WarmStart' first, and then randomly until the model has
+// enough data. Then, scores random unexplored candidates and all neighbours of the best
+// configuration (differing in a single parameter) by their expected improvement, selecting the
+// best one. Without any candidates left, the search ends.
+void Bayesian::CalculateNextIndex() {
+  while (!warm_start_indices_.empty()) {
+    const auto warm_start_index = warm_start_indices_.back();
+    warm_start_indices_.pop_back();
+    if (execution_times_.find(warm_start_index) == execution_times_.end()) {
+      index_ = warm_start_index;
+      return;
+    }
+  }
+  if (explored_indices_.size() < kNumInitialSamples || !FitModel()) {
+    index_ = RandomUnexploredIndex(true);
+    return;
+  }
+
+  auto candidates = std::vector<size_t>();
+  auto is_candidate = std::unordered_set<size_t>();
+  const auto num_raw = kernel_.NumRawConfigurations();
+  for (auto c=size_t{0}; c<kNumCandidates; ++c) {
+    const auto candidate = RandomUnexploredIndex(false);
+    if (candidate == num_raw) { break; }
+    if (is_candidate.insert(candidate).second) { candidates.push_back(candidate); }
+  }
+  auto best_index = explored_indices_[0];
+  for (auto &explored_index: explored_indices_) {
+    if (ExecutionTime(explored_index) < ExecutionTime(best_index)) { best_index = explored_index; }
+  }
+  const auto parameters = kernel_.parameters();
+  const auto best_values = kernel_.ValueIndices(best_index);
+  for (auto p=size_t{0}; p<parameters.size(); ++p) {
+    for (auto v=size_t{0}; v<parameters[p].values.size(); ++v) {
+      if (v == best_values[p]) { continue; }
+      auto neighbour = best_values;
+      neighbour[p] = v;
+      const auto candidate = kernel_.IndexFromValueIndices(neighbour);
+      if (execution_times_.find(candidate) != execution_times_.end()) { continue; }
+      if (!kernel_.IsValidConfiguration(candidate)) { continue; }
+      if (is_candidate.insert(candidate).second) { candidates.push_back(candidate); }
+    }
+  }
+  if (candidates.empty()) {
+    index_ = RandomUnexploredIndex(true);
+    return;
+  }
+
+  auto best_improvement = -1.0;
+  for (auto &candidate: candidates) {
+    auto mean = 0.0;
+    auto deviation = 0.0;
+    Predict(Features(candidate), mean, deviation);
+    const auto improvement = ExpectedImprovement(mean, deviation);
+    if (improvement > best_improvement) {
+      best_improvement = improvement;
+      index_ = candidate;
+    }
+  }
+}
+
+// The number of configurations is a fraction of all (estimated) valid configurations. The search
+// ends early when the space is exhausted.
+size_t Bayesian::NumConfigurations() {
+  if (index_ >= kernel_.NumRawConfigurations()) { return explored_indices_.size(); }
+  return num_configurations_;
+}
+
+// The first configuration replaces the random initial one, the others are explored next
+void Bayesian::WarmStart(const std::vector<size_t> &indices) {
+  if (indices.empty()) { return; }
+  index_ = indices[0];
+  warm_start_indices_.assign(indices.rbegin(), indices.rend() - 1);
+}
+
+// =================================================================================================
+
+// Samples first, since a linear scan is only cheap for small spaces (or rarely needed)
+size_t Bayesian::RandomUnexploredIndex(const bool scan_if_not_found) {
+  for (auto attempt=size_t{0}; attempt<kMaxCandidateAttempts; ++attempt) {
+    const auto index = RandomValidIndex(generator_);
+    if (execution_times_.find(index) == execution_times_.end()) { return index; }
+  }
+  const auto num_raw = kernel_.NumRawConfigurations();
+  if (!scan_if_not_found) { return num_raw; }
+  std::uniform_int_distribution<size_t> distribution(0, num_raw - 1);
+  const auto start = distribution(generator_);
+  for (auto offset=size_t{0}; offset<num_raw; ++offset) {
+    const auto index = (start + offset) % num_raw;
+    if (execution_times_.find(index) != execution_times_.end()) { continue; }
+    if (kernel_.IsValidConfiguration(index)) { return index; }
+  }
+  return num_raw;
+}
+
+// Normalises the parameter values as computed in the constructor
+std::vector<double> Bayesian::Features(const size_t index) const {
+  const auto values = kernel_.GetValues(index);
+  auto features = std::vector<double>(values.size());
+  for (auto i=size_t{0}; i<values.size(); ++i) {
+    const auto value = (feature_logarithmic_[i]) ? std::log2(static_cast<double>(values[i])) :
+                                                   static_cast<double>(values[i]);
+    const auto difference = value - feature_means_[i];
+    features[i] = (feature_ranges_[i] == 0.0) ? difference : difference / feature_ranges_[i];
+  }
+  return features;
+}
+
+// =================================================================================================
+
+// Fits the model to the logarithms of the execution times, which are standardised to a mean of 0
+// and a variance of 1. Failed configurations are taken to be slower than any successful one. The
+// length-scale of the squared-exponential kernel is selected by maximising the marginal likelihood.
+bool Bayesian::FitModel() {
+  auto samples = std::vector<std::pair<double,size_t>>();
+  auto worst_target = -std::numeric_limits<double>::max();
+  for (auto &explored_index: explored_indices_) {
+    const auto time = ExecutionTime(explored_index);
+    if (time >= static_cast<double>(std::numeric_limits<float>::max()) || time <= 0.0) { continue; }
+    samples.push_back({std::log(time), explored_index});
+    worst_target = std::max(worst_target, samples.back().first);
+  }
+  if (samples.empty()) { return false; }
+  for (auto &explored_index: explored_indices_) {
+    const auto time = ExecutionTime(explored_index);
+    if (time >= static_cast<double>(std::numeric_limits<float>::max()) || time <= 0.0) {
+      samples.push_back({worst_target + 1.0, explored_index});
+    }
+  }
+  std::stable_sort(samples.begin(), samples.end(),
+                   [] (const std::pair<double,size_t> &a, const std::pair<double,size_t> &b) {
+                     return a.first < b.first;
+                   });
+  if (samples.size() > kMaxObservations) { samples.resize(kMaxObservations); }
+  const auto m = samples.size();
+
+  // Standardises the targets
+  auto mean = 0.0;
+  for (auto &sample: samples) { mean += sample.first; }
+  mean /= static_cast<double>(m);
+  auto variance = 0.0;
+  for (auto &sample: samples) { variance += (sample.first - mean) * (sample.first - mean); }
+  variance /= static_cast<double>(m);
+  const auto deviation = (variance > 0.0) ? std::sqrt(variance) : 1.0;
+  auto targets = std::vector<double>(m);
+  for (auto i=size_t{0}; i<m; ++i) { targets[i] = (samples[i].first - mean) / deviation; }
+  best_target_ = targets[0];
+  training_features_.resize(m);
+  for (auto i=size_t{0}; i<m; ++i) { training_features_[i] = Features(samples[i].second); }
+
+  // Squared distances between all pairs of training samples
+  auto distances = std::vector<double>(m*m, 0.0);
+  for (auto i=size_t{0}; i<m; ++i) {
+    for (auto j=size_t{0}; j<i; ++j) {
+      auto distance = 0.0;
+      for (auto f=size_t{0}; f<training_features_[i].size(); ++f) {
+        const auto difference = training_features_[i][f] - training_features_[j][f];
+        distance += difference * difference;
+      }
+      distances[i*m + j] = distance;
+    }
+  }
+
+  // Fits the model for each of the length-scales, keeping the most likely
+  auto best_likelihood = -std::numeric_limits<double>::max();
+  auto is_fitted = false;
+  for (auto &length_scale: kLengthScales) {
+
+    // Cholesky decomposition of the covariance matrix (only the lower triangle is used)
+    auto factor = std::vector<double>(m*m, 0.0);
+    auto is_positive_definite = true;
+    for (auto i=size_t{0}; i<m && is_positive_definite; ++i) {
+      for (auto j=size_t{0}; j<=i; ++j) {
+        auto sum = (i == j) ? 1.0 + kNoiseVariance :
+                              std::exp(-distances[i*m + j] / (2.0 * length_scale * length_scale));
+        for (auto k=size_t{0}; k<j; ++k) { sum -= factor[i*m + k] * factor[j*m + k]; }
+        if (i == j) {
+          if (sum <= 0.0) { is_positive_definite = false; break; }
+          factor[i*m + i] = std::sqrt(sum);
+        }
+        else {
+          factor[i*m + j] = sum / factor[j*m + j];
+        }
+      }
+    }
+    if (!is_positive_definite) { continue; }
+
+    // Solves for the weights using forward and backward substitution
+    auto weights = targets;
+    for (auto i=size_t{0}; i<m; ++i) {
+      for (auto k=size_t{0}; k<i; ++k) { weights[i] -= factor[i*m + k] * weights[k]; }
+      weights[i] /= factor[i*m + i];
+    }
+    for (auto i=m; i>0; --i) {
+      for (auto k=i; k<m; ++k) { weights[i-1] -= factor[k*m + i-1] * weights[k]; }
+      weights[i-1] /= factor[(i-1)*m + i-1];
+    }
+
+    // The log marginal likelihood (up to a constant)
+    auto likelihood = 0.0;
+    for (auto i=size_t{0}; i<m; ++i) {
+      likelihood -= 0.5 * targets[i] * weights[i] + std::log(factor[i*m + i]);
+    }
+    if (likelihood > best_likelihood) {
+      is_fitted = true;
+      best_likelihood = likelihood;
+      length_scale_ = length_scale;
+      cholesky_ = factor;
+      weights_ = weights;
+    }
+  }
+  return is_fitted;
+}
+
+// The mean follows from the weights, the variance from a forward substitution with the Cholesky
+// factor. The noise is not included: only the uncertainty of the model matters here.
+void Bayesian::Predict(const std::vector<double> &features, double &mean,
+                       double &deviation) const {
+  const auto m = training_features_.size();
+  auto covariances = std::vector<double>(m);
+  for (auto i=size_t{0}; i<m; ++i) {
+    auto distance = 0.0;
+    for (auto f=size_t{0}; f<features.size(); ++f) {
+      const auto difference = features[f] - training_features_[i][f];
+      distance += difference * difference;
+    }
+    covariances[i] = std::exp(-distance / (2.0 * length_scale_ * length_scale_));
+  }
+  mean = 0.0;
+  for (auto i=size_t{0}; i<m; ++i) { mean += covariances[i] * weights_[i]; }
+  auto variance = 1.0;
+  for (auto i=size_t{0}; i<m; ++i) {
+    for (auto k=size_t{0}; k<i; ++k) { covariances[i] -= cholesky_[i*m + k] * covariances[k]; }
+    covariances[i] /= cholesky_[i*m + i];
+    variance -= covariances[i] * covariances[i];
+  }
+  deviation = std::sqrt(std::max(variance, 1e-12));
+}
+
+// Closed-form expected improvement for minimisation, using the normal distribution's density and
+// cumulative distribution function
+double Bayesian::ExpectedImprovement(const double mean, const double deviation) const {
+  const auto improvement = best_target_ - mean - kMinImprovement;
+  const auto z = improvement / deviation;
+  const auto density = std::exp(-0.5 * z * z) / std::sqrt(2.0 * 3.14159265358979323846);
+  const auto cumulative = 0.5 * std::erfc(-z / std::sqrt(2.0));
+  return improvement * cumulative + deviation * density;
+}
+
+// =================================================================================================
+} // namespace cltune
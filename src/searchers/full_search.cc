@@ -28,29 +28,47 @@
 // The corresponding header file
 #include "internal/searchers/full_search.h"
 
+#include <algorithm>
+
 namespace cltune {
 // =================================================================================================
 
-// Calls the base-class constructor directly
-FullSearch::FullSearch(const Configurations &configurations):
-    Searcher(configurations) {
+// Counts the valid configurations (without storing them) and starts at the first one
+FullSearch::FullSearch(const KernelInfo &kernel, const unsigned int seed):
+    Searcher(kernel, seed),
+    num_configurations_(NumValidConfigurations()) {
+  index_ = NextValidIndex(0, false);
 }
 
 // =================================================================================================
 
 // Returns the next configuration
 KernelInfo::Configuration FullSearch::GetConfiguration() {
-  return configurations_[index_];
+  return kernel_.GetConfiguration(index_);
 }
 
-// Calculates the index of the next configuration to test
+// Calculates the index of the next configuration to test, skipping invalid configurations
 void FullSearch::CalculateNextIndex() {
-  ++index_;
+  index_ = NextValidIndex(index_ + 1, false);
 }
 
-// The number of configurations is equal to all possible configurations
+// The number of configurations is equal to all valid configurations. In case the number was
+// estimated rather than counted, the search stops as soon as the end of the space is reached.
 size_t FullSearch::NumConfigurations() {
-  return configurations_.size();
+  if (index_ >= kernel_.NumRawConfigurations()) { return explored_indices_.size(); }
+  return std::max(num_configurations_, explored_indices_.size() + 1);
+}
+
+// The upcoming configurations are simply the next valid ones in the space
+Searcher::Configurations FullSearch::PeekConfigurations(const size_t count) const {
+  auto configurations = Configurations{};
+  auto index = index_;
+  while (configurations.size() < count) {
+    index = NextValidIndex(index + 1, false);
+    if (index >= kernel_.NumRawConfigurations()) { break; }
+    configurations.push_back(kernel_.GetConfiguration(index));
+  }
+  return configurations;
 }
 
 // =================================================================================================
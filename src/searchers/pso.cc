@@ -34,12 +34,17 @@
 namespace cltune {
 // =================================================================================================
 
-// Initializes the PSO searcher
-PSO::PSO(const Configurations &configurations, const Parameters &parameters,
-         const double fraction, const size_t swarm_size, const double influence_global,
-         const double influence_local, const double influence_random):
-    Searcher(configurations),
+// Maximum number of attempts to move a particle to a valid position before it stays in place
+const size_t PSO::kMaxMoveAttempts = size_t{1000};
+
+// Initializes the PSO searcher. The particles start at random (valid) positions, which also serve
+// as their initial best positions.
+PSO::PSO(const KernelInfo &kernel, const double fraction, const size_t swarm_size,
+         const double influence_global, const double influence_local,
+         const double influence_random, const unsigned int seed):
+    Searcher(kernel, seed),
     fraction_(fraction),
+    num_configurations_(0),
     swarm_size_(swarm_size),
     influence_global_(influence_global),
     influence_local_(influence_local),
@@ -48,15 +53,18 @@ PSO::PSO(const Configurations &configurations, const Parameters &parameters,
     particle_positions_(swarm_size_),
     global_best_time_(std::numeric_limits<double>::max()),
     local_best_times_(swarm_size_, std::numeric_limits<double>::max()),
-    global_best_config_(),
-    local_best_configs_(swarm_size_),
-    parameters_(parameters),
+    global_best_index_(0),
+    local_best_indices_(swarm_size_),
+    parameters_(kernel.parameters()),
     generator_(RandomSeed()),
-    int_distribution_(0, static_cast<int>(configurations_.size())),
     probability_distribution_(0.0, 1.0) {
+  num_configurations_ = std::max(size_t{1},
+                                 static_cast<size_t>(NumValidConfigurations()*fraction_));
   for (auto &position: particle_positions_) {
-    position = static_cast<size_t>(int_distribution_(generator_));
+    position = RandomValidIndex(generator_);
   }
+  local_best_indices_ = particle_positions_;
+  global_best_index_ = particle_positions_[particle_index_];
   index_ = particle_positions_[particle_index_];
 }
 
@@ -64,40 +72,44 @@ PSO::PSO(const Configurations &configurations, const Parameters &parameters,
 
 // Returns the next configuration. This is similar to other searchers.
 KernelInfo::Configuration PSO::GetConfiguration() {
-  return configurations_[index_];
+  return kernel_.GetConfiguration(index_);
 }
 
 // Computes the next position of the current particle in the swarm. This is based on probabilities.
 void PSO::CalculateNextIndex() {
 
   // Calculates the next state of the current swarm. This next state could be an invalid
-  // configuration, so the next block is put in a do-while loop and only ends when a valid next
-  // state is found. The next state is computed for each dimension separately and can depend on:
-  // 1) the global best, 2) the particle's best so far, 3) a random location, and 4) its previous
-  // location.
+  // configuration, so the next block is put in a loop and only ends when a valid next state is
+  // found (or when the particle stays in place after too many attempts). The next state is
+  // computed for each dimension separately and can depend on: 1) the global best, 2) the
+  // particle's best so far, 3) a random location, and 4) its previous location.
+  // Each dimension is represented by the index of the parameter's value.
+  const auto current = kernel_.ValueIndices(index_);
+  const auto global_best = kernel_.ValueIndices(global_best_index_);
+  const auto local_best = kernel_.ValueIndices(local_best_indices_[particle_index_]);
   auto new_index = index_;
-  do {
-    auto next_configuration = configurations_[index_];
+  for (auto attempt=size_t{0}; attempt<kMaxMoveAttempts; ++attempt) {
+    auto next_configuration = current;
     for (auto i=size_t{0}; i<next_configuration.size(); ++i) {
-      //printf("%s = %d\n", next_configuration[i].name.c_str(), next_configuration[i].value);
 
       // Move towards best known globally (swarm)
       if (probability_distribution_(generator_) <= influence_global_) {
-        next_configuration[i].value = global_best_config_[i].value;
+        next_configuration[i] = global_best[i];
       }
       // Move towards best known locally (particle)
       else if (probability_distribution_(generator_) <= influence_local_) {
-        next_configuration[i].value = local_best_configs_[particle_index_][i].value;
+        next_configuration[i] = local_best[i];
       }
       // Move in a random direction
       else if (probability_distribution_(generator_) <= influence_random_) {
-        std::uniform_int_distribution<size_t> distribution(0, parameters_[i].values.size());
-        next_configuration[i].value = parameters_[i].values[distribution(generator_)];
+        std::uniform_int_distribution<size_t> distribution(0, parameters_[i].values.size() - 1);
+        next_configuration[i] = distribution(generator_);
       }
       // Else: stay at current location
     }
-    new_index = IndexFromConfiguration(next_configuration);
-  } while (new_index >= configurations_.size());
+    const auto candidate_index = kernel_.IndexFromValueIndices(next_configuration);
+    if (kernel_.IsValidConfiguration(candidate_index)) { new_index = candidate_index; break; }
+  }
   particle_positions_[particle_index_] = new_index;
 
   // Calculates the next index --> move to the next particle in the swarm
@@ -108,7 +120,7 @@ void PSO::CalculateNextIndex() {
 
 // The number of configurations is equal to all possible configurations
 size_t PSO::NumConfigurations() {
-  return std::max(size_t{1}, static_cast<size_t>(configurations_.size()*fraction_));
+  return num_configurations_;
 }
 
 // =================================================================================================
@@ -120,31 +132,34 @@ void PSO::PushExecutionTime(const double execution_time) {
   execution_times_[index_] = execution_time;
   if (execution_time < local_best_times_[particle_index_]) {
     local_best_times_[particle_index_] = execution_time;
-    local_best_configs_[particle_index_] = configurations_[index_];
+    local_best_indices_[particle_index_] = index_;
   }
   if (execution_time < global_best_time_) {
     global_best_time_ = execution_time;
-    global_best_config_ = configurations_[index_];
+    global_best_index_ = index_;
   }
 }
 
-// =================================================================================================
-
-// Searches all configuration to find which configuration is the 'target' (argument to this
-// function). The target's index in the total configuration vector is returned.
-size_t PSO::IndexFromConfiguration(const KernelInfo::Configuration target) const {
-  auto config_index = size_t{0};
-  for (auto &configuration: configurations_) {
-    auto num_matches = size_t{0};
-    for (auto i=size_t{0}; i<configuration.size(); ++i) {
-      if (configuration[i].value == target[i].value) { num_matches++; }
-    }
-    if (num_matches == configuration.size()) { return config_index; }
-    ++config_index;
+// The positions of all other particles are already known: they are only updated when it is their
+// turn. Therefore, the upcoming configurations are those of the next particles in the swarm.
+Searcher::Configurations PSO::PeekConfigurations(const size_t count) const {
+  auto configurations = Configurations{};
+  for (auto i=size_t{1}; i<swarm_size_ && configurations.size()<count; ++i) {
+    const auto particle = (particle_index_ + i) % swarm_size_;
+    configurations.push_back(kernel_.GetConfiguration(particle_positions_[particle]));
   }
+  return configurations;
+}
 
-  // No match is found: this is an invalid configuration
-  return config_index;
+// Each of the given positions replaces the random initial position of a particle, which then also
+// serves as its initial best position
+void PSO::WarmStart(const std::vector<size_t> &indices) {
+  for (auto p=size_t{0}; p<indices.size() && p<particle_positions_.size(); ++p) {
+    particle_positions_[p] = indices[p];
+  }
+  local_best_indices_ = particle_positions_;
+  global_best_index_ = particle_positions_[particle_index_];
+  index_ = particle_positions_[particle_index_];
 }
 
 // =================================================================================================
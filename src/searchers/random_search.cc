@@ -30,33 +30,116 @@
 
 #include <algorithm>
 #include <random>
+#include <cstdint>
 
 namespace cltune {
 // =================================================================================================
 
-// Randomizes the configurations list
-RandomSearch::RandomSearch(const Configurations &configurations, const double fraction):
-    Searcher(configurations),
-    fraction_(fraction) {
-  std::srand(RandomSeed());
-  std::random_shuffle(configurations_.begin(), configurations_.end());
+const size_t RandomSearch::kNumRounds = 4;
+
+// Initializes the random permutation with random keys and finds the first valid configuration
+RandomSearch::RandomSearch(const KernelInfo &kernel, const double fraction,
+                           const unsigned int seed):
+    Searcher(kernel, seed),
+    fraction_(fraction),
+    num_configurations_(0),
+    position_(0),
+    warm_start_indices_(),
+    warm_start_position_(0),
+    half_bits_(1),
+    keys_(kNumRounds) {
+  const auto num_raw = kernel_.NumRawConfigurations();
+  while (half_bits_ < 32 && (uint64_t{1} << (2*half_bits_)) < num_raw) { ++half_bits_; }
+  auto generator = std::default_random_engine(RandomSeed());
+  std::uniform_int_distribution<uint64_t> distribution;
+  for (auto &key: keys_) { key = distribution(generator); }
+  num_configurations_ = std::max(size_t{1}, static_cast<size_t>(NumValidConfigurations()*fraction_));
+  index_ = NextValidPosition(position_);
 }
 
 // =================================================================================================
 
-// Returns the next configuration (vector of configurations is already shuffled randomly)
+// Returns the next configuration (the configuration space is visited in a random order)
 KernelInfo::Configuration RandomSearch::GetConfiguration() {
-  return configurations_[index_];
+  return kernel_.GetConfiguration(index_);
 }
 
 // Calculates the index of the next configuration to test
 void RandomSearch::CalculateNextIndex() {
-  ++index_;
+  if (warm_start_position_ < warm_start_indices_.size()) {
+    index_ = warm_start_indices_[warm_start_position_++];
+    return;
+  }
+  index_ = NextValidPosition(position_);
 }
 
-// The number of configurations is equal to all possible configurations
+// The number of configurations is a fraction of all (estimated) valid configurations. The search
+// ends early when the space is exhausted.
 size_t RandomSearch::NumConfigurations() {
-  return std::max(size_t{1}, static_cast<size_t>(configurations_.size()*fraction_));
+  if (index_ >= kernel_.NumRawConfigurations()) { return explored_indices_.size(); }
+  return num_configurations_;
+}
+
+// The upcoming configurations are simply the next valid ones in the random order
+Searcher::Configurations RandomSearch::PeekConfigurations(const size_t count) const {
+  auto configurations = Configurations{};
+  for (auto w=warm_start_position_; w<warm_start_indices_.size(); ++w) {
+    if (configurations.size() == count) { return configurations; }
+    configurations.push_back(kernel_.GetConfiguration(warm_start_indices_[w]));
+  }
+  auto position = position_;
+  while (configurations.size() < count) {
+    const auto index = NextValidPosition(position);
+    if (index >= kernel_.NumRawConfigurations()) { break; }
+    configurations.push_back(kernel_.GetConfiguration(index));
+  }
+  return configurations;
+}
+
+// The random order starts again from the beginning, such that it skips the given configurations
+void RandomSearch::WarmStart(const std::vector<size_t> &indices) {
+  if (indices.empty()) { return; }
+  warm_start_indices_ = indices;
+  warm_start_position_ = 1;
+  position_ = 0;
+  index_ = warm_start_indices_[0];
+}
+
+// =================================================================================================
+
+// Balanced Feistel network on 2*half_bits_ bits, which covers at least the whole space. Results
+// outside of the space are fed through the network again ('cycle-walking'): since the network is a
+// bijection, this terminates and the result is still a bijection on the space itself.
+size_t RandomSearch::PermutedIndex(const size_t position) const {
+  const auto num_raw = static_cast<uint64_t>(kernel_.NumRawConfigurations());
+  const auto mask = (uint64_t{1} << half_bits_) - 1;
+  auto value = static_cast<uint64_t>(position);
+  do {
+    auto left = value >> half_bits_;
+    auto right = value & mask;
+    for (const auto &key: keys_) {
+      auto mixed = (right ^ key) * uint64_t{0x9E3779B97F4A7C15ULL};
+      mixed ^= mixed >> 29;
+      const auto new_right = (left ^ mixed) & mask;
+      left = right;
+      right = new_right;
+    }
+    value = (left << half_bits_) | right;
+  } while (value >= num_raw);
+  return static_cast<size_t>(value);
+}
+
+// Walks through the random order, checking the constraints of each configuration
+size_t RandomSearch::NextValidPosition(size_t &position) const {
+  const auto num_raw = kernel_.NumRawConfigurations();
+  while (position < num_raw) {
+    const auto index = PermutedIndex(position);
+    ++position;
+    if (std::find(warm_start_indices_.begin(), warm_start_indices_.end(), index) !=
+        warm_start_indices_.end()) { continue; }
+    if (kernel_.IsValidConfiguration(index)) { return index; }
+  }
+  return num_raw;
 }
 
 // =================================================================================================
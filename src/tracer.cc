@@ -0,0 +1,134 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the Tracer class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/tracer.h"
+
+#include <algorithm> // std::max, std::sort
+#include <cstdio> // fopen, fprintf
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// Only reads the clock if there is a tracer
+Tracer::Span::Span(Tracer *tracer, const char *name, const std::string &detail):
+    tracer_(tracer),
+    name_(name),
+    detail_(detail),
+    start_() {
+  if (tracer_) { start_ = Clock::now(); }
+}
+
+// Records the span only once
+void Tracer::Span::End() {
+  if (!tracer_) { return; }
+  tracer_->Record(name_, detail_, start_, Clock::now());
+  tracer_ = nullptr;
+}
+
+// =================================================================================================
+
+Tracer::Tracer():
+    origin_(Clock::now()),
+    mutex_(),
+    events_(),
+    threads_() {
+}
+
+// Converts the times relative to the creation of the tracer
+void Tracer::Record(const std::string &name, const std::string &detail,
+                    const Clock::time_point start, const Clock::time_point end) {
+  const auto start_us = std::chrono::duration<double,std::micro>(start - origin_).count();
+  const auto duration_us = std::chrono::duration<double,std::micro>(end - start).count();
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto thread = threads_.insert({std::this_thread::get_id(), threads_.size()}).first->second;
+  events_.push_back(Event{name, detail, thread, start_us, duration_us});
+}
+
+std::vector<Tracer::Event> Tracer::Events() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return events_;
+}
+
+// Groups the spans by name, keeping the order of the first appearance for phases with equal totals
+std::vector<Tracer::Phase> Tracer::Summary() const {
+  auto phases = std::vector<Phase>();
+  for (auto &event: Events()) {
+    auto phase = phases.begin();
+    while (phase != phases.end() && phase->name != event.name) { ++phase; }
+    if (phase == phases.end()) {
+      phases.push_back(Phase{event.name, 0, 0.0, 0.0});
+      phase = phases.end() - 1;
+    }
+    phase->count += 1;
+    phase->total += event.duration / 1000.0;
+    phase->maximum = std::max(phase->maximum, event.duration / 1000.0);
+  }
+  std::stable_sort(phases.begin(), phases.end(), [] (const Phase &a, const Phase &b) {
+    return a.total > b.total;
+  });
+  return phases;
+}
+
+double Tracer::Elapsed() const {
+  return std::chrono::duration<double,std::milli>(Clock::now() - origin_).count();
+}
+
+// =================================================================================================
+
+// Each span is a complete event ('X') of a single process. Quotes and backslashes in the names are
+// escaped, other control characters are replaced by spaces.
+void Tracer::WriteChromeTrace(const std::string &filename) const {
+  const auto escape = [] (const std::string &text) {
+    auto result = std::string{};
+    for (auto &character: text) {
+      if (character == '"' || character == '\\') { result += '\\'; }
+      result += (static_cast<unsigned char>(character) < 32) ? ' ' : character;
+    }
+    return result;
+  };
+  auto file = fopen(filename.c_str(), "w");
+  if (!file) { throw std::runtime_error("Unable to write trace '"+filename+"'"); }
+  const auto events = Events();
+  fprintf(file, "{\"traceEvents\": [\n");
+  for (auto e=size_t{0}; e<events.size(); ++e) {
+    const auto &event = events[e];
+    fprintf(file, "  {\"name\": \"%s\", \"cat\": \"cltune\", \"ph\": \"X\", \"pid\": 0, "
+            "\"tid\": %zu, \"ts\": %.3lf, \"dur\": %.3lf", escape(event.name).c_str(),
+            event.thread, event.start, event.duration);
+    if (!event.detail.empty()) {
+      fprintf(file, ", \"args\": {\"detail\": \"%s\"}", escape(event.detail).c_str());
+    }
+    fprintf(file, "}%s\n", (e < events.size() - 1) ? "," : "");
+  }
+  fprintf(file, "], \"displayTimeUnit\": \"ms\"}\n");
+  fclose(file);
+}
+
+// =================================================================================================
+} // namespace cltune
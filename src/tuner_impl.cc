@@ -27,12 +27,14 @@
 
 // The corresponding header file
 #include "internal/tuner_impl.h"
+#include "internal/verification_kernel.h"
 
 // The search strategies
 #include "internal/searchers/full_search.h"
 #include "internal/searchers/random_search.h"
 #include "internal/searchers/annealing.h"
 #include "internal/searchers/pso.h"
+#include "internal/searchers/bayesian.h"
 
 // The machine learning models
 #include "internal/ml_models/linear_regression.h"
@@ -44,13 +46,28 @@
 #include <algorithm> // std::min
 #include <memory> // std::unique_ptr
 #include <tuple> // std::tuple
+#include <deque> // std::deque
+#include <unordered_map> // std::unordered_map
+#include <utility> // std::pair
 #include <cstdlib> // std::getenv
+#include <numeric> // std::accumulate
+#include <cstring> // std::memcpy
+#include <chrono> // std::chrono::steady_clock
+#include <thread> // std::this_thread
+#include <functional> // std::function
+#include <cmath> // std::log, std::exp
 
 namespace cltune {
 // =================================================================================================
 
-// This is the threshold for 'correctness'
-const double TunerImpl::kMaxL2Norm = 1e-4;
+// The number of compiled programs kept in memory for re-use
+const size_t TunerImpl::kNumRecentPrograms = 16;
+
+// The number of configurations predicted at once by 'ModelPrediction'
+const size_t TunerImpl::kPredictionBlockSize = 65536;
+
+// The number of best results of earlier runs each search starts with
+const size_t TunerImpl::kMaxWarmStartConfigurations = 4;
 
 // Messages printed to stdout (in colours)
 const std::string TunerImpl::kMessageFull    = "\x1b[32m[==========]\x1b[0m";
@@ -66,20 +83,62 @@ const std::string TunerImpl::kMessageBest    = "\x1b[35m[     BEST ]\x1b[0m";
   
 // =================================================================================================
 
-// Initializes with a custom platform and device
-TunerImpl::TunerImpl(const size_t platform_id, const size_t device_id):
+// Initializes with a custom platform and device and optionally an existing context
+TunerImpl::TunerImpl(const size_t platform_id, const size_t device_id, const ContextRaw context):
     platform_(Platform(platform_id)),
     device_(Device(platform_, device_id)),
-    context_(Context(device_)),
+    context_((context == nullptr) ? Context(device_) : Context(context)),
     queue_(Queue(context_, device_)),
-    num_runs_(size_t{1}),
+    copy_queue_(Queue(context_, device_)),
+    staging_buffers_(),
+    platform_id_(platform_id),
+    device_id_(device_id),
+    measurement_policy_{0, 1, 1, 0.0, Statistic::kMinimum, 0.1},
     has_reference_(false),
     suppress_output_(false),
     output_search_process_(false),
     search_log_filename_(std::string{}),
+    num_compile_threads_(0),
+    compile_pool_(nullptr),
+    recent_programs_(),
+    program_resources_(),
+    binary_cache_(nullptr),
+    journal_(nullptr),
+    database_(nullptr),
+    timing_method_(TimingMethod::kDeviceEvents),
+    power_meter_(nullptr),
+    objective_(Objective::kTime),
+    energy_weight_(0.5),
+    collect_counters_(false),
+    counter_hooks_(),
+    tracer_(nullptr),
+    progress_callback_(nullptr),
+    time_budget_(0.0),
+    cancel_tuning_(nullptr),
+    tuning_start_(),
+    pruning_factor_(0.0),
+    pruning_model_type_(Model::kLinearRegression),
+    pruning_model_warmup_(0),
+    pruning_model_interval_(0),
+    pruning_model_margin_(0.0),
+    pruning_model_(nullptr),
+    pruning_model_samples_(0),
+    pruning_model_measured_(0),
+    pruning_model_best_(std::numeric_limits<float>::max()),
+    kernel_timeout_(0.0),
+    relative_kernel_timeout_(0.0),
     search_method_(SearchMethod::FullSearch),
     search_args_(0),
-    argument_counter_(0) {
+    argument_counter_(0),
+    extra_devices_(),
+    device_workers_(),
+    device_pool_(nullptr),
+    distributed_port_(0),
+    num_remote_workers_(0),
+    remote_workers_(),
+    sandbox_(nullptr),
+    isolation_timeout_(0.0),
+    sandbox_specification_() {
   if (!suppress_output_) {
     fprintf(stdout, "\n%s Initializing on platform %zu device %zu\n",
             kMessageFull.c_str(), platform_id, device_id);
@@ -96,12 +155,14 @@ TunerImpl::TunerImpl(const size_t platform_id, const size_t device_id):
 
 // End of the tuner
 TunerImpl::~TunerImpl() {
+  FinishTransfers();
   for (auto &reference_output: reference_outputs_) {
     delete[] static_cast<int*>(reference_output);
   }
 
-  // Frees the device buffers
+  // Frees the device buffers, except for those of the user
   auto free_buffers = [](MemArgument &mem_info) {
+    if (mem_info.user_owned) { return; }
     #ifdef USE_OPENCL
       CheckError(clReleaseMemObject(mem_info.buffer));
     #else
@@ -111,6 +172,8 @@ TunerImpl::~TunerImpl() {
   for (auto &mem_argument: arguments_input_) { free_buffers(mem_argument); }
   for (auto &mem_argument: arguments_output_) { free_buffers(mem_argument); }
   for (auto &mem_argument: arguments_output_copy_) { free_buffers(mem_argument); }
+  for (auto &mem_argument: reference_buffers_) { free_buffers(mem_argument); }
+  for (auto &mem_argument: abandoned_buffers_) { free_buffers(mem_argument); }
 
   if (!suppress_output_) {
     fprintf(stdout, "\n%s End of the tuning process\n\n", kMessageFull.c_str());
@@ -124,6 +187,16 @@ TunerImpl::~TunerImpl() {
 // parameters are computed for each kernel and those kernels are run. Their timing-results are
 // collected and stored into the tuning_results_ vector.
 void TunerImpl::Tune() {
+  tuning_start_ = std::chrono::steady_clock::now();
+  auto stopped = false; // whether tuning stopped early through 'IsTuningStopped'
+
+  // The energy is only measured on this device: the other devices and processes can't take part
+  if (objective_ != Objective::kTime) {
+    if (!power_meter_) { throw std::runtime_error("Energy objectives require a power sensor"); }
+    if (!extra_devices_.empty() || num_remote_workers_ > 0 || sandbox_) {
+      throw std::runtime_error("Energy objectives only support tuning on the main device");
+    }
+  }
 
   // Runs the reference kernel if it is defined
   if (has_reference_) {
@@ -131,56 +204,147 @@ void TunerImpl::Tune() {
     RunKernel(reference_kernel_->source(), *reference_kernel_, 0, 1);
     StoreReferenceOutput();
   }
+
+  // Prepares the additional devices (if any), now that all arguments and the reference are known
+  if (!extra_devices_.empty()) {
+    PrintHeader("Initializing "+std::to_string(extra_devices_.size())+" additional device(s)");
+    StartDeviceWorkers();
+  }
+
+  // Waits for the remote workers (if any) and sends them everything needed to run configurations
+  if (num_remote_workers_ > 0) {
+    PrintHeader("Waiting for "+std::to_string(num_remote_workers_)+" remote worker(s) on port "+
+                std::to_string(distributed_port_));
+    StartRemoteWorkers();
+  }
+  const auto num_parallel_workers = device_workers_.size() + remote_workers_.size();
+  if (journal_ && journal_->NumResumedRecords() > 0) {
+    fprintf(stdout, "%s Resuming with %zu result(s) from the journal\n", kMessageInfo.c_str(),
+            journal_->NumResumedRecords());
+  }
   
-  // Iterates over all tunable kernels
-  for (auto &kernel: kernels_) {
+  // Iterates over all tunable kernels. The stages of a pipeline are only tuned as part of it.
+  for (auto kernel_id=size_t{0}; kernel_id<kernels_.size(); ++kernel_id) {
+    auto &kernel = kernels_[kernel_id];
+    if (pipeline_stages_.count(kernel_id) != 0) { continue; }
+    if (IsTuningStopped()) { stopped = true; break; }
     PrintHeader("Testing kernel "+kernel.name());
+    auto best_progress = TunerResult{}; // the best result so far, as passed to the callback
+
+    // Records the kernel in the journal (if enabled). When resuming, this returns the seed of the
+    // interrupted run, such that the search method makes the same decisions as before.
+    auto seed = Searcher::TimeSeed();
+    if (journal_) { seed = journal_->StartKernel(kernel_id, JournalIdentity(kernel), seed); }
 
     // If there are no tuning parameters, simply run the kernel and store the results
     if (kernel.parameters().size() == 0) {
 
-        // Compiles and runs the kernel
-      auto tuning_result = RunKernel(kernel.source(), kernel, 0, 1);
-      tuning_result.status = VerifyOutput();
+        // Compiles and runs the kernel, unless it was already run before according to the journal
+      auto journaled = Journal::Record{};
+      auto tuning_result = TunerResult{};
+      if (journal_ && journal_->Find(kernel_id, 0, journaled)) {
+        tuning_result = FromRecord(journaled);
+        PrintResult(stdout, tuning_result, kMessageOK);
+      }
+      else {
+        if (sandbox_) {
+          tuning_result = RunIsolated(kernel_id, 0, 0, 1);
+        }
+        else {
+          tuning_result = RunKernel(kernel.source(), kernel, 0, 1, BestTime(kernel_id));
+          tuning_result.status = VerifyOutput();
+        }
+        tuning_result.kernel_id = kernel_id;
+        tuning_result.configuration_id = 0;
+        if (journal_) { journal_->Append(ToRecord(tuning_result)); }
+      }
 
       // Stores the result of the tuning
-      tuning_results_.push_back(tuning_result);
+      StoreResult(tuning_result);
+      ReportProgress(tuning_result, best_progress, 1, 1);
 
     // Else: there are tuning parameters to iterate over
     } else {
 
-      // Computes the permutations of all parameters and pass them to a (smart) search algorithm
+      // Creates the selected search algorithm. The permutations of all parameters are not computed
+      // up-front: the search algorithm visits the (lazy) configuration space of the kernel.
       #ifdef VERBOSE
-        fprintf(stdout, "%s Computing the permutations of all parameters\n", kMessageVerbose.c_str());
+        fprintf(stdout, "%s Searching %zu permutations of all parameters\n", kMessageVerbose.c_str(),
+                kernel.NumRawConfigurations());
       #endif
-      kernel.SetConfigurations();
-
-      // Creates the selected search algorithm
-      std::unique_ptr<Searcher> search;
-      switch (search_method_) {
-        case SearchMethod::FullSearch:
-          search.reset(new FullSearch{kernel.configurations()});
-          break;
-        case SearchMethod::RandomSearch:
-          search.reset(new RandomSearch{kernel.configurations(), search_args_[0]});
-          break;
-        case SearchMethod::Annealing:
-          search.reset(new Annealing{kernel.configurations(), search_args_[0], search_args_[1]});
-          break;
-        case SearchMethod::PSO:
-          search.reset(new PSO{kernel.configurations(), kernel.parameters(), search_args_[0],
-                               static_cast<size_t>(search_args_[1]), search_args_[2],
-                               search_args_[3], search_args_[4]});
-          break;
-      }
-
-      // Iterates over all possible configurations (the permutations of the tuning parameters)
-      for (auto p=size_t{0}; p<search->NumConfigurations(); ++p) {
+      auto search = CreateSearcher(kernel, seed);
+
+      // Starts the search at the best configurations of earlier runs (if a database is used)
+      if (database_) {
+        const auto warm_start_indices = WarmStartIndices(kernel);
+        if (!warm_start_indices.empty()) {
+          fprintf(stdout, "%s Warm-starting from %zu result(s) in the database\n",
+                  kMessageInfo.c_str(), warm_start_indices.size());
+          search->WarmStart(warm_start_indices);
+        }
+      }
+
+      // Starts the background compilation threads (if enabled). These are not used in isolated
+      // execution, since the configurations are then compiled by the child process.
+      if (num_compile_threads_ > 0 && !sandbox_) {
+        compile_pool_.reset(new CompilePool([this] (const std::string &source) {
+          return CompileProgram(source);
+        }, num_compile_threads_));
+      }
+
+      // Starts a thread for each of the additional devices and remote workers (if any)
+      if (num_parallel_workers > 0) {
+        device_pool_.reset(new DevicePool<TunerResult>(num_parallel_workers));
+      }
+
+      // Iterates over the configurations chosen by the search algorithm. These are requested in
+      // batches, such that the additional devices and remote workers (if any) or the background
+      // compilation threads work on the upcoming configurations while this device is running the
+      // first one. Each result is reported back to the search algorithm as soon as it is known.
+      // Search methods of which the next step depends on the current result (e.g. annealing with
+      // a single chain) hand out one configuration at a time and thus only use this device.
+      const auto batch_size = 1 + ((device_pool_) ? num_parallel_workers :
+                                   (compile_pool_) ? num_compile_threads_ : size_t{0});
+      auto batch = std::deque<std::pair<size_t,size_t>>(); // the configuration IDs and their steps
+      auto num_steps = size_t{0};
+
+      // Configurations which the model predicts to be slow are skipped as soon as they are handed
+      // out, such that they are never compiled nor run. Their predicted times are kept here.
+      auto skipped = std::unordered_map<size_t,float>();
+      auto num_skipped = size_t{0};
+      pruning_model_.reset();
+      pruning_model_samples_ = 0;
+      pruning_model_measured_ = 0;
+      pruning_model_best_ = std::numeric_limits<float>::max();
+      for (const auto &result: tuning_results_) {
+        if (result.kernel_id == kernel_id) { RecordPruningSample(result); }
+      }
+
+      while (true) {
+        if (IsTuningStopped()) { stopped = true; break; }
+        UpdatePruningModel(kernel_id);
+        Tracer::Span request_span(tracer_.get(), "search");
+        const auto requested_ids = search->RequestConfigurations(batch_size - batch.size());
+        request_span.End();
+        for (auto &requested_id: requested_ids) {
+          batch.push_back({requested_id, num_steps++});
+          auto predicted_time = 0.0f;
+          if (!(journal_ && journal_->Contains(kernel_id, requested_id)) &&
+              IsPredictedSlow(kernel_id, requested_id, predicted_time)) {
+            skipped[requested_id] = predicted_time;
+          }
+        }
+        if (batch.empty()) { break; }
+        const auto configuration_id = batch.front().first;
+        const auto p = batch.front().second;
+        const auto span_detail = (tracer_) ? kernel.name()+" #"+std::to_string(configuration_id) :
+                                             std::string{};
+        Tracer::Span configuration_span(tracer_.get(), "configuration", span_detail);
         #ifdef VERBOSE
           fprintf(stdout, "%s Exploring configuration (%zu out of %zu):\n", kMessageVerbose.c_str(),
                   p + 1, search->NumConfigurations());
         #endif
-        auto permutation = search->GetConfiguration();
+        auto permutation = kernel.GetConfiguration(configuration_id);
         #ifdef VERBOSE
           fprintf(stdout, "%s ", kMessageVerbose.c_str());
           for (auto &config: permutation) {
@@ -189,37 +353,149 @@ void TunerImpl::Tune() {
           fprintf(stdout, "\n");
         #endif
 
-
         // Adds the parameters to the source-code string as defines
-        auto source = std::string{};
-        for (auto &config: permutation) {
-          source += config.GetDefine();
+        auto source = SourceWithDefines(kernel, permutation);
+
+        // Configurations measured by an interrupted run are taken from the journal. The search is
+        // replayed as before, but nothing is compiled or run on any of the devices.
+        auto journaled = Journal::Record{};
+        const auto is_journaled = journal_ &&
+                                  journal_->Find(kernel_id, configuration_id, journaled);
+        const auto skipped_entry = skipped.find(configuration_id);
+        const auto is_skipped = (skipped_entry != skipped.end());
+
+        // Hands the upcoming configurations of the batch to the additional devices and remote
+        // workers (if any). Configurations which are already scheduled are ignored by the pool.
+        if (device_pool_) {
+          for (auto b=size_t{1}; b<batch.size(); ++b) {
+            const auto upcoming_id = batch[b].first;
+            if (journal_ && journal_->Contains(kernel_id, upcoming_id)) { continue; }
+            if (skipped.find(upcoming_id) != skipped.end()) { continue; }
+            const auto upcoming = kernel.GetConfiguration(upcoming_id);
+            auto job_kernel = kernel; // a copy, since its thread sizes are changed per configuration
+            const auto job_source = SourceWithDefines(kernel, upcoming);
+            const auto step = batch[b].second;
+            const auto num_configurations = search->NumConfigurations();
+            device_pool_->Enqueue(upcoming_id,
+                                  [this, job_kernel, upcoming, job_source, step, num_configurations,
+                                   kernel_id, upcoming_id] (const size_t worker_id) mutable -> TunerResult {
+              if (worker_id >= device_workers_.size()) {
+                try {
+                  return RunRemoteKernel(worker_id - device_workers_.size(), kernel_id,
+                                         upcoming_id, step, num_configurations);
+                } catch (const Socket::Exception&) {
+                  device_pool_->Retire(worker_id); // this configuration is then run here
+                  throw;
+                }
+              }
+              auto &worker = *device_workers_[worker_id];
+              #if !USE_OPENCL
+                CheckError(cuCtxSetCurrent(worker.context()()));
+              #endif
+              job_kernel.ComputeRanges(upcoming);
+              auto result = worker.RunKernel(job_source, job_kernel, step, num_configurations);
+              result.status = worker.VerifyOutput();
+              return result;
+            });
+          }
+        }
+
+        // Hands the current and the upcoming configurations of the batch to the background
+        // compilation threads, such that these are compiled while the device is running
+        else if (compile_pool_) {
+          if (!is_journaled && !is_skipped && !IsProgramCached(source) &&
+              FitsResources(source, kernel, permutation)) {
+            compile_pool_->Enqueue(source);
+          }
+          for (auto b=size_t{1}; b<batch.size(); ++b) {
+            const auto upcoming_id = batch[b].first;
+            if (journal_ && journal_->Contains(kernel_id, upcoming_id)) { continue; }
+            if (skipped.find(upcoming_id) != skipped.end()) { continue; }
+            const auto upcoming = kernel.GetConfiguration(upcoming_id);
+            const auto upcoming_source = SourceWithDefines(kernel, upcoming);
+            if (!IsProgramCached(upcoming_source) &&
+                FitsResources(upcoming_source, kernel, upcoming)) {
+              compile_pool_->Enqueue(upcoming_source);
+            }
+          }
         }
-        source += kernel.source();
 
         // Updates the local range with the parameter values
         kernel.ComputeRanges(permutation);
 
-        // Compiles and runs the kernel
-        auto tuning_result = RunKernel(source, kernel, p, search->NumConfigurations());
-        tuning_result.status = VerifyOutput();
+        // Compiles and runs the kernel, unless one of the additional devices already started it
+        const auto run_here = [&] () -> TunerResult {
+          if (sandbox_) {
+            return RunIsolated(kernel_id, configuration_id, p, search->NumConfigurations());
+          }
+          auto result = RunKernel(source, kernel, p, search->NumConfigurations(),
+                                  BestTime(kernel_id));
+          result.status = VerifyOutput();
+          return result;
+        };
+        auto tuning_result = TunerResult{};
+        if (is_journaled) {
+          tuning_result = FromRecord(journaled);
+          if (tuning_result.time != std::numeric_limits<float>::max()) {
+            const auto message = (tuning_result.status) ? kMessageOK : kMessageWarning;
+            PrintResult(stdout, tuning_result, message);
+          }
+        }
+        else if (is_skipped) {
+          tuning_result = TunerResult{kernel.name(), skipped_entry->second, 0, false, kernel_id,
+                                      configuration_id, timing_method_, 0.0f, SampleStatistics{},
+                                      true, false, 0.0f, Counters{}};
+          skipped.erase(skipped_entry);
+          ++num_skipped;
+          #ifdef VERBOSE
+            fprintf(stdout, "%s Skipped: predicted %.1lf ms\n", kMessageVerbose.c_str(),
+                    tuning_result.time);
+          #endif
+        }
+        else if (device_pool_) {
+          try {
+            tuning_result = device_pool_->Retrieve(configuration_id, run_here);
+          } catch (const Socket::Exception &e) {
+            fprintf(stdout, "%s Remote worker failed (%s): running here instead\n",
+                    kMessageWarning.c_str(), e.what());
+            tuning_result = run_here();
+          }
+        }
+        else {
+          tuning_result = run_here();
+        }
 
-        // Gives timing feedback to the search algorithm and calculates the next index
-        search->PushExecutionTime(tuning_result.time);
-        search->CalculateNextIndex();
+        // Gives timing feedback to the search algorithm, which then calculates its next step(s)
+        batch.pop_front();
+        Tracer::Span report_span(tracer_.get(), "search");
+        search->ReportResults({configuration_id}, {ObjectiveValue(tuning_result)});
+        report_span.End();
 
         // Stores the parameters and the timing-result
-        tuning_result.configuration = permutation;
-        if (tuning_result.time == std::numeric_limits<float>::max()) {
-          tuning_result.time = 0.0;
-          PrintResult(stdout, tuning_result, kMessageFailure);
-          tuning_result.time = std::numeric_limits<float>::max();
-          tuning_result.status = false;
-        }
-        else if (!tuning_result.status) {
-          PrintResult(stdout, tuning_result, kMessageWarning);
+        tuning_result.kernel_id = kernel_id;
+        tuning_result.configuration_id = configuration_id;
+        if (!is_journaled) {
+          if (tuning_result.time == std::numeric_limits<float>::max()) {
+            tuning_result.time = 0.0;
+            PrintResult(stdout, tuning_result, kMessageFailure);
+            tuning_result.time = std::numeric_limits<float>::max();
+            tuning_result.status = false;
+          }
+          else if (!tuning_result.status && !tuning_result.timed_out && !is_skipped) {
+            PrintResult(stdout, tuning_result, kMessageWarning);
+          }
+          if (journal_) { journal_->Append(ToRecord(tuning_result)); }
         }
-        tuning_results_.push_back(tuning_result);
+        StoreResult(tuning_result);
+        RecordPruningSample(tuning_result);
+        ReportProgress(tuning_result, best_progress, p + 1, search->NumConfigurations());
+      }
+      device_pool_.reset();
+      compile_pool_.reset();
+      pruning_model_.reset();
+      if (num_skipped > 0) {
+        fprintf(stdout, "%s Skipped %zu configuration(s) predicted to be slow\n",
+                kMessageInfo.c_str(), num_skipped);
       }
 
       // Prints a log of the searching process. This is disabled per default, but can be enabled
@@ -231,45 +507,168 @@ void TunerImpl::Tune() {
       }
     }
   }
+
+  if (stopped) {
+    const auto reason = (cancel_tuning_ && *cancel_tuning_) ? "cancelled" : "time budget used up";
+    fprintf(stdout, "%s Stopped tuning early (%s)\n", kMessageInfo.c_str(), reason);
+  }
+
+  // Stores the best results for later runs. This is done only now, such that an interrupted run
+  // which is resumed from its journal starts its searches in the same way.
+  if (database_) { StoreInDatabase(tuning_results_); }
+
+  // Releases the additional devices and the remote workers
+  for (auto &worker: device_workers_) { worker->suppress_output_ = true; }
+  device_workers_.clear();
+  StopRemoteWorkers();
+  StopIsolated();
+  recent_programs_.clear();
 }
 
 // =================================================================================================
 
-// Compiles the kernel and checks for error messages, sets all output buffers to zero,
-// launches the kernel, and collects the timing information.
-TunerImpl::TunerResult TunerImpl::RunKernel(const std::string &source, const KernelInfo &kernel,
-                                            const size_t configuration_id,
-                                            const size_t num_configurations) {
+// The device's CUDA context is only current on the threads which make it current, so also on the
+// new one. The callback and the time budget are only used by this run: these are cleared after it.
+std::shared_future<void> TunerImpl::TuneAsync(ProgressFunction callback,
+                                              const double time_budget_ms,
+                                              std::shared_ptr<std::atomic<bool>> cancel) {
+  progress_callback_ = callback;
+  time_budget_ = time_budget_ms;
+  cancel_tuning_ = cancel;
+  return std::async(std::launch::async, [this] () {
+    const auto finish = [this] () {
+      progress_callback_ = nullptr;
+      time_budget_ = 0.0;
+      cancel_tuning_.reset();
+    };
+    try {
+      #if !USE_OPENCL
+        CheckError(cuCtxSetCurrent(context_()));
+      #endif
+      Tune();
+    } catch (...) {
+      finish();
+      throw;
+    }
+    finish();
+  }).share();
+}
 
-  // In case of an exception, skip this run
-  try {
-    #ifdef VERBOSE
-      fprintf(stdout, "%s Starting compilation\n", kMessageVerbose.c_str());
-    #endif
+// Configurations which are already running (e.g. on the additional devices) are not waited for
+bool TunerImpl::IsTuningStopped() const {
+  if (cancel_tuning_ && *cancel_tuning_) { return true; }
+  if (time_budget_ <= 0.0) { return false; }
+  const auto elapsed = std::chrono::steady_clock::now() - tuning_start_;
+  return std::chrono::duration<double,std::milli>(elapsed).count() >= time_budget_;
+}
 
-     // Sets the build options from an environmental variable (if set)
-    auto options = std::vector<std::string>();
-    const auto environment_variable = std::getenv("CLTUNE_BUILD_OPTIONS");
-    if (environment_variable != nullptr) {
-      options.push_back(std::string(environment_variable));
-    }
+// The best result follows the objective, as in 'GetBestResult'
+void TunerImpl::ReportProgress(const TunerResult &result, TunerResult &best,
+                               const size_t num_explored, const size_t num_configurations) const {
+  if (!progress_callback_) { return; }
+  if (result.status && (!best.status || ObjectiveValue(result) <= ObjectiveValue(best))) {
+    best = result;
+  }
+  const auto to_parameters = [this] (const TunerResult &entry) {
+    auto parameters = std::unordered_map<std::string, size_t>{};
+    for (const auto &setting: GetConfiguration(entry)) { parameters[setting.name] = setting.value; }
+    return parameters;
+  };
+  auto progress = TuningProgress{result.kernel_name, to_parameters(result), result.time,
+                                 result.status, num_explored, num_configurations,
+                                 std::unordered_map<std::string, size_t>{},
+                                 std::numeric_limits<float>::max()};
+  if (best.status) {
+    progress.best_parameters = to_parameters(best);
+    progress.best_time = best.time;
+  }
+  progress_callback_(progress);
+}
+
+// =================================================================================================
+// Creates the search method with the arguments given through the Tuner API
+std::unique_ptr<Searcher> TunerImpl::CreateSearcher(const KernelInfo &kernel,
+                                                    const unsigned int seed) const {
+  std::unique_ptr<Searcher> search;
+  switch (search_method_) {
+    case SearchMethod::FullSearch:
+      search.reset(new FullSearch{kernel, seed});
+      break;
+    case SearchMethod::RandomSearch:
+      search.reset(new RandomSearch{kernel, search_args_[0], seed});
+      break;
+    case SearchMethod::Annealing:
+      search.reset(new Annealing{kernel, search_args_[0], search_args_[1],
+                                 static_cast<size_t>(search_args_[2]), seed});
+      break;
+    case SearchMethod::PSO:
+      search.reset(new PSO{kernel, search_args_[0], static_cast<size_t>(search_args_[1]),
+                           search_args_[2], search_args_[3], search_args_[4], seed});
+      break;
+    case SearchMethod::Bayesian:
+      search.reset(new Bayesian{kernel, search_args_[0], seed});
+      break;
+  }
+  return search;
+}
+
+// =================================================================================================
 
-    // Compiles the kernel and prints the compiler errors/warnings
-    auto program = Program(context_, source);
-    auto build_status = program.Build(device_, options);
-    if (build_status == BuildStatus::kError) {
-      auto message = program.GetBuildInfo(device_);
-      fprintf(stdout, "device compiler error/warning: %s\n", message.c_str());
-      throw std::runtime_error("device compiler error/warning occurred ^^\n");
+// Tunes for multiple problem sizes. First, the buffers are grown to the largest size and the
+// reference kernel is run for each size. Then, each configuration chosen by the search algorithm is
+// compiled once (the sizes share the source-code) and run for all sizes one after another. Since
+// the buffers keep their largest size, the parts beyond a smaller problem are restored before each
+// run and left untouched by both the reference and the tuned kernels, such that the verification
+// can simply compare the full buffers. For this reason, output-only buffers are restored as well.
+// The results of each size are swapped in as the tuning results while running, such that pruning
+// and timeouts are relative to the same size. This runs on the main device only: the additional
+// devices, remote workers, isolated execution, the journal, and model-guided pruning are not used.
+void TunerImpl::TuneSizes(const std::vector<ProblemSize> &sizes) {
+  if (sizes.empty()) { throw std::runtime_error("No problem sizes given"); }
+  for (auto &kernel: kernels_) {
+    if (kernel.IsPipeline()) { throw std::runtime_error("Pipelines can't be tuned for sizes"); }
+  }
+  const auto num_scalars = arguments_int_.size() + arguments_size_t_.size() +
+                           arguments_float_.size() + arguments_double_.size() +
+                           arguments_float2_.size() + arguments_double2_.size();
+  auto buffers = std::vector<MemArgument*>();
+  for (auto &argument: arguments_input_) { buffers.push_back(&argument); }
+  for (auto &argument: arguments_output_) { buffers.push_back(&argument); }
+  std::sort(buffers.begin(), buffers.end(), [] (const MemArgument *a, const MemArgument *b) {
+    return a->index < b->index;
+  });
+  for (auto &size: sizes) {
+    if (!size.scalars.empty() && size.scalars.size() != num_scalars) {
+      throw std::runtime_error("Expected "+std::to_string(num_scalars)+" scalar value(s)");
     }
-    if (build_status == BuildStatus::kInvalid) {
-      throw std::runtime_error("Invalid program binary");
+    if (!size.buffer_sizes.empty() && size.buffer_sizes.size() != buffers.size()) {
+      throw std::runtime_error("Expected "+std::to_string(buffers.size())+" buffer size(s)");
     }
-    #ifdef VERBOSE
-      fprintf(stdout, "%s Finished compilation\n", kMessageVerbose.c_str());
-    #endif
+  }
 
-    // Clears all previous copies of output buffer(s)
+  // Grows the buffers which are too small for one of the sizes, all at once. The copies of the
+  // output buffers are then re-created by the next run, restoring all of them.
+  FinishTransfers();
+  auto grown_output = false;
+  for (auto b=size_t{0}; b<buffers.size(); ++b) {
+    auto largest = buffers[b]->size;
+    for (auto &size: sizes) {
+      if (!size.buffer_sizes.empty()) { largest = std::max(largest, size.buffer_sizes[b]); }
+    }
+    if (largest == buffers[b]->size) { continue; }
+    if (buffers[b]->user_owned) {
+      throw std::runtime_error("Unable to grow the user's buffer of kernel argument "+
+                               std::to_string(buffers[b]->index));
+    }
+    GrowBuffer(*buffers[b], largest);
+    for (auto &argument: arguments_output_) { grown_output |= (&argument == buffers[b]); }
+  }
+  auto no_restore = std::vector<bool>();
+  for (auto &argument: arguments_output_) {
+    no_restore.push_back(argument.no_restore);
+    argument.no_restore = false;
+  }
+  if (grown_output) {
     for (auto &mem_info: arguments_output_copy_) {
       #ifdef USE_OPENCL
         CheckError(clReleaseMemObject(mem_info.buffer));
@@ -278,105 +677,786 @@ TunerImpl::TunerResult TunerImpl::RunKernel(const std::string &source, const Ker
       #endif
     }
     arguments_output_copy_.clear();
+  }
+
+  // Switches the kernels and the scalar arguments to a problem size. The original values are kept,
+  // such that they can be restored afterwards.
+  auto global_bases = std::vector<IntRange>();
+  for (auto &kernel: kernels_) { global_bases.push_back(kernel.global_base()); }
+  const auto reference_global_base = (has_reference_) ? reference_kernel_->global_base() :
+                                                        IntRange{};
+  const auto original_int = arguments_int_;
+  const auto original_size_t = arguments_size_t_;
+  const auto original_float = arguments_float_;
+  const auto original_double = arguments_double_;
+  const auto original_float2 = arguments_float2_;
+  const auto original_double2 = arguments_double2_;
+  const auto restore = [&] () {
+    for (auto k=size_t{0}; k<kernels_.size(); ++k) { kernels_[k].set_global_base(global_bases[k]); }
+    if (has_reference_) { reference_kernel_->set_global_base(reference_global_base); }
+    arguments_int_ = original_int;
+    arguments_size_t_ = original_size_t;
+    arguments_float_ = original_float;
+    arguments_double_ = original_double;
+    arguments_float2_ = original_float2;
+    arguments_double2_ = original_double2;
+  };
+  const auto apply = [&] (const ProblemSize &size) {
+    restore();
+    if (!size.global.empty()) {
+      for (auto &kernel: kernels_) { kernel.set_global_base(size.global); }
+      if (has_reference_) { reference_kernel_->set_global_base(size.global); }
+    }
+    if (!size.scalars.empty()) { SetScalarArguments(size.scalars); }
+  };
+  const auto describe = [&sizes] (const size_t s) {
+    auto description = std::string{};
+    for (auto &dimension: sizes[s].global) {
+      description += ((description.empty()) ? "" : "x") + std::to_string(dimension);
+    }
+    return "size "+std::to_string(s+1)+((description.empty()) ? "" : " ("+description+")");
+  };
+
+  // Runs the reference kernel for each of the sizes. Its output is kept per size and swapped in
+  // whenever a configuration is run for that size.
+  auto reference_outputs = std::vector<std::vector<void*>>(sizes.size());
+  auto reference_buffers = std::vector<std::vector<MemArgument>>(sizes.size());
+  const auto swap_reference = [&] (const size_t s) {
+    std::swap(reference_outputs_, reference_outputs[s]);
+    std::swap(reference_buffers_, reference_buffers[s]);
+  };
+  if (has_reference_) {
+    for (auto s=size_t{0}; s<sizes.size(); ++s) {
+      PrintHeader("Testing reference "+reference_kernel_->name()+" for "+describe(s));
+      apply(sizes[s]);
+      RunKernel(reference_kernel_->source(), *reference_kernel_, 0, 1);
+      StoreReferenceOutput();
+      swap_reference(s);
+    }
+  }
+
+  // Runs a configuration for all sizes and collects the results per size. The search algorithm is
+  // given the geometric mean of the times, or a failure if any of the sizes failed.
+  sweep_results_ = std::vector<std::vector<TunerResult>>(sizes.size());
+  auto sweep_best_times = std::vector<std::unordered_map<size_t,float>>(sizes.size());
+  const auto run_sizes = [&] (const size_t kernel_id, const size_t configuration_id,
+                              const std::string &source, const size_t step,
+                              const size_t num_configurations) {
+    auto &kernel = kernels_[kernel_id];
+    const auto configuration = kernel.GetConfiguration(configuration_id);
+    auto log_time = 0.0;
+    auto failed = false;
+    for (auto s=size_t{0}; s<sizes.size(); ++s) {
+      apply(sizes[s]);
+      kernel.ComputeRanges(configuration);
+      if (has_reference_) { swap_reference(s); }
+      std::swap(tuning_results_, sweep_results_[s]);
+      std::swap(best_times_, sweep_best_times[s]);
+      auto result = RunKernel(source, kernel, step, num_configurations, BestTime(kernel_id));
+      result.status = VerifyOutput();
+      if (has_reference_) { swap_reference(s); }
+      result.kernel_id = kernel_id;
+      result.configuration_id = configuration_id;
+      if (result.time == std::numeric_limits<float>::max()) {
+        result.time = 0.0;
+        PrintResult(stdout, result, kMessageFailure);
+        result.time = std::numeric_limits<float>::max();
+        result.status = false;
+        failed = true;
+      }
+      else {
+        if (!result.status && !result.timed_out) { PrintResult(stdout, result, kMessageWarning); }
+        log_time += std::log(std::max(static_cast<double>(result.time), 1e-6));
+      }
+      StoreResult(result);
+      std::swap(best_times_, sweep_best_times[s]);
+      std::swap(tuning_results_, sweep_results_[s]);
+    }
+    return (failed) ? std::numeric_limits<double>::max() :
+                      std::exp(log_time / static_cast<double>(sizes.size()));
+  };
+
+  // Iterates over all tunable kernels
+  for (auto kernel_id=size_t{0}; kernel_id<kernels_.size(); ++kernel_id) {
+    auto &kernel = kernels_[kernel_id];
+    PrintHeader("Testing kernel "+kernel.name()+" for "+std::to_string(sizes.size())+
+                " problem size(s)");
+    if (kernel.parameters().size() == 0) {
+      run_sizes(kernel_id, 0, kernel.source(), 0, 1);
+      continue;
+    }
+
+    // Iterates over the configurations chosen by the search algorithm, compiling the upcoming
+    // configurations in the background (if enabled) as in 'Tune'
+    auto search = CreateSearcher(kernel, Searcher::TimeSeed());
+    if (num_compile_threads_ > 0) {
+      compile_pool_.reset(new CompilePool([this] (const std::string &source) {
+        return CompileProgram(source);
+      }, num_compile_threads_));
+    }
+    const auto batch_size = 1 + ((compile_pool_) ? num_compile_threads_ : size_t{0});
+    auto batch = std::deque<std::pair<size_t,size_t>>(); // the configuration IDs and their steps
+    auto num_steps = size_t{0};
+    while (true) {
+      Tracer::Span request_span(tracer_.get(), "search");
+      for (auto &requested_id: search->RequestConfigurations(batch_size - batch.size())) {
+        batch.push_back({requested_id, num_steps++});
+      }
+      request_span.End();
+      if (batch.empty()) { break; }
+      const auto configuration_id = batch.front().first;
+      const auto source = SourceWithDefines(kernel, kernel.GetConfiguration(configuration_id));
+      if (compile_pool_) {
+        for (auto &entry: batch) {
+          const auto upcoming = kernel.GetConfiguration(entry.first);
+          const auto upcoming_source = SourceWithDefines(kernel, upcoming);
+          if (!IsProgramCached(upcoming_source) &&
+              FitsResources(upcoming_source, kernel, upcoming)) {
+            compile_pool_->Enqueue(upcoming_source);
+          }
+        }
+      }
+      const auto time = run_sizes(kernel_id, configuration_id, source, batch.front().second,
+                                  search->NumConfigurations());
+      batch.pop_front();
+      Tracer::Span report_span(tracer_.get(), "search");
+      search->ReportResults({configuration_id}, {time});
+    }
+    compile_pool_.reset();
+  }
+
+  // Prints the best result of each size and stores it in the database (if enabled)
+  PrintHeader("Best results per problem size");
+  for (auto s=size_t{0}; s<sizes.size(); ++s) {
+    auto best = sweep_results_[s].end();
+    for (auto it = sweep_results_[s].begin(); it != sweep_results_[s].end(); ++it) {
+      if (it->status && (best == sweep_results_[s].end() || it->time < best->time)) { best = it; }
+    }
+    if (best == sweep_results_[s].end()) {
+      fprintf(stdout, "%s No valid result for %s\n", kMessageWarning.c_str(), describe(s).c_str());
+      continue;
+    }
+    fprintf(stdout, "%s Best result for %s:\n", kMessageInfo.c_str(), describe(s).c_str());
+    PrintResult(stdout, *best, kMessageBest);
+    if (database_) {
+      apply(sizes[s]);
+      StoreInDatabase(sweep_results_[s]);
+    }
+  }
+
+  // Restores the original problem and releases the reference outputs of all sizes
+  restore();
+  for (auto i=size_t{0}; i<arguments_output_.size(); ++i) {
+    arguments_output_[i].no_restore = no_restore[i];
+  }
+  for (auto s=size_t{0}; s<sizes.size(); ++s) {
+    for (auto &reference_output: reference_outputs[s]) {
+      delete[] static_cast<int*>(reference_output);
+    }
+    for (auto &mem_info: reference_buffers[s]) {
+      #ifdef USE_OPENCL
+        CheckError(clReleaseMemObject(mem_info.buffer));
+      #else
+        CheckError(cuMemFree(mem_info.buffer));
+      #endif
+    }
+  }
+}
+
+// Collects the scalar arguments of all types, such that they can be set in the order of their
+// argument indices
+void TunerImpl::SetScalarArguments(const std::vector<double> &values) {
+  using Setter = std::pair<size_t, std::function<void(double)>>;
+  auto setters = std::vector<Setter>();
+  for (auto &i: arguments_int_) {
+    setters.push_back({i.first, [&i] (const double v) { i.second = static_cast<int>(v); }});
+  }
+  for (auto &i: arguments_size_t_) {
+    setters.push_back({i.first, [&i] (const double v) { i.second = static_cast<size_t>(v); }});
+  }
+  for (auto &i: arguments_float_) {
+    setters.push_back({i.first, [&i] (const double v) { i.second = static_cast<float>(v); }});
+  }
+  for (auto &i: arguments_double_) {
+    setters.push_back({i.first, [&i] (const double v) { i.second = v; }});
+  }
+  for (auto &i: arguments_float2_) {
+    setters.push_back({i.first, [&i] (const double v) {
+      i.second = float2(static_cast<float>(v));
+    }});
+  }
+  for (auto &i: arguments_double2_) {
+    setters.push_back({i.first, [&i] (const double v) { i.second = double2(v); }});
+  }
+  std::sort(setters.begin(), setters.end(), [] (const Setter &a, const Setter &b) {
+    return a.first < b.first;
+  });
+  for (auto i=size_t{0}; i<values.size() && i<setters.size(); ++i) { setters[i].second(values[i]); }
+}
+
+// Reads the current contents to the host, repeats them until the new size is filled, and replaces
+// the buffer by a new one holding these contents
+void TunerImpl::GrowBuffer(MemArgument &argument, const size_t size) {
+  switch (argument.type) {
+    case MemType::kShort: GrowBuffer<short>(argument, size); break;
+    case MemType::kInt: GrowBuffer<int>(argument, size); break;
+    case MemType::kSizeT: GrowBuffer<size_t>(argument, size); break;
+    case MemType::kHalf: GrowBuffer<half>(argument, size); break;
+    case MemType::kFloat: GrowBuffer<float>(argument, size); break;
+    case MemType::kDouble: GrowBuffer<double>(argument, size); break;
+    case MemType::kFloat2: GrowBuffer<float2>(argument, size); break;
+    case MemType::kDouble2: GrowBuffer<double2>(argument, size); break;
+    default: throw std::runtime_error("Unsupported buffer data-type");
+  }
+}
+template <typename T>
+void TunerImpl::GrowBuffer(MemArgument &argument, const size_t size) {
+  auto contents = std::vector<T>(argument.size);
+  if (argument.size > 0) { Buffer<T>(argument.buffer).Read(queue_, argument.size, contents); }
+  auto grown_contents = std::vector<T>(size);
+  for (auto i=size_t{0}; i<size && argument.size > 0; ++i) {
+    grown_contents[i] = contents[i % argument.size];
+  }
+  auto grown_buffer = Buffer<T>(context_, BufferAccess::kNotOwned, size);
+  grown_buffer.Write(queue_, size, grown_contents);
+  #ifdef USE_OPENCL
+    CheckError(clReleaseMemObject(argument.buffer));
+  #else
+    CheckError(cuMemFree(argument.buffer));
+  #endif
+  argument.buffer = grown_buffer();
+  argument.size = size;
+}
+
+// =================================================================================================
+
+// Prepends the parameters of a configuration as defines to the source-code of the kernel
+std::string TunerImpl::SourceWithDefines(const KernelInfo &kernel,
+                                         const KernelInfo::Configuration &configuration) const {
+  auto source = std::string{};
+  for (auto &config: configuration) {
+    if (kernel.ParameterIsDefine(config.name)) { source += config.GetDefine(); }
+  }
+  source += kernel.source();
+  return source;
+}
+
+// Compiles the kernel and throws an exception containing the compiler's messages in case of
+// errors. This does not print anything, since it might be called from multiple threads at once.
+Program TunerImpl::CompileProgram(const std::string &source) const {
+  Tracer::Span span(tracer_.get(), "compile");
+  auto options = BuildOptions();
+
+  // Loads the program from the binary cache (if enabled and present). Entries which fail to build
+  // (e.g. corrupted files) are simply ignored and overwritten by a fresh compilation.
+  auto cache_key = std::string{};
+  if (binary_cache_) {
+    cache_key = binary_cache_->Key(source, std::accumulate(options.begin(), options.end(),
+                                                           std::string{}));
+    auto binary = std::string{};
+    if (binary_cache_->Load(cache_key, binary)) {
+      try {
+        auto cached_program = Program(device_, context_, binary);
+        if (cached_program.Build(device_, options) == BuildStatus::kSuccess) {
+          return cached_program;
+        }
+      } catch (...) { }
+    }
+  }
+
+  // Compiles the kernel and passes on the compiler errors/warnings
+  auto program = Program(context_, source);
+  auto build_status = program.Build(device_, options);
+  if (build_status == BuildStatus::kError) {
+    auto message = program.GetBuildInfo(device_);
+    throw std::runtime_error("device compiler error/warning occurred:\n"+message);
+  }
+  if (build_status == BuildStatus::kInvalid) {
+    throw std::runtime_error("Invalid program binary");
+  }
+
+  // Stores the compiled program in the binary cache for later tuning runs
+  if (binary_cache_) {
+    binary_cache_->Store(cache_key, program.GetIR());
+  }
+  return program;
+}
+
+// Sets the build options from an environmental variable (if set)
+std::vector<std::string> TunerImpl::BuildOptions() {
+  auto options = std::vector<std::string>();
+  const auto environment_variable = std::getenv("CLTUNE_BUILD_OPTIONS");
+  if (environment_variable != nullptr) {
+    options.push_back(std::string(environment_variable));
+  }
+  return options;
+}
+
+// Looks up the source in the recent programs first. A hit is moved to the front, a new program is
+// added at the front (removing the least recently used one if needed).
+Program TunerImpl::GetProgram(const std::string &source) {
+  for (auto entry=recent_programs_.begin(); entry!=recent_programs_.end(); ++entry) {
+    if (entry->first == source) {
+      recent_programs_.splice(recent_programs_.begin(), recent_programs_, entry);
+      return entry->second;
+    }
+  }
+  auto program = (compile_pool_) ? compile_pool_->Retrieve(source) : CompileProgram(source);
+  recent_programs_.emplace_front(source, program);
+  if (recent_programs_.size() > kNumRecentPrograms) { recent_programs_.pop_back(); }
+  return program;
+}
+bool TunerImpl::IsProgramCached(const std::string &source) const {
+  for (const auto &entry: recent_programs_) {
+    if (entry.first == source) { return true; }
+  }
+  return false;
+}
+
+// The local memory and the maximum work-group size of a kernel follow from its compiled program
+// alone. Therefore, configurations which only differ in their thread-sizes (and thus share the same
+// program) can be checked without compiling again.
+std::string TunerImpl::ExceededResources(const std::string &source,
+                                         const KernelInfo &kernel) const {
+  const auto entry = program_resources_.find(source);
+  if (entry == program_resources_.end()) { return std::string{}; }
+  auto local_ranges = std::vector<IntRange>{kernel.local()};
+  if (kernel.IsPipeline()) {
+    local_ranges.clear();
+    for (auto &stage: kernel.stages()) { local_ranges.push_back(stage.local); }
+  }
+  for (auto i=size_t{0}; i<entry->second.size() && i<local_ranges.size(); ++i) {
+    const auto &resources = entry->second[i];
+    if (!device_.IsLocalMemoryValid(resources.local_memory)) {
+      return "Using too much local memory";
+    }
+    auto local_threads = size_t{1};
+    for (auto &item: local_ranges[i]) { local_threads *= item; }
+    if (resources.max_threads > 0 && local_threads > resources.max_threads) {
+      return "Using "+std::to_string(local_threads)+" threads per work-group, while the compiled "+
+             "kernel supports at most "+std::to_string(resources.max_threads);
+    }
+  }
+  return std::string{};
+}
+bool TunerImpl::FitsResources(const std::string &source, const KernelInfo &kernel,
+                              const KernelInfo::Configuration &configuration) const {
+  if (program_resources_.find(source) == program_resources_.end()) {
+    return true;
+  }
+  auto configured_kernel = kernel; // a copy, since its thread sizes are changed
+  configured_kernel.ComputeRanges(configuration);
+  return ExceededResources(source, configured_kernel).empty();
+}
+
+// =================================================================================================
+
+// Compiles the kernel and checks for error messages, sets all output buffers to zero,
+// launches the kernel, and collects the timing information.
+TunerImpl::TunerResult TunerImpl::RunKernel(const std::string &source, const KernelInfo &kernel,
+                                            const size_t configuration_id,
+                                            const size_t num_configurations,
+                                            const float best_time) {
+
+  // Whether the counter hooks are started, such that these are stopped in case of an exception
+  auto counting = false;
+  const auto stop_counting = [&counting, this] () {
+    counting = false;
+    return (counter_hooks_.stop) ? counter_hooks_.stop() : Counters();
+  };
+
+  // In case of an exception, skip this run
+  try {
+
+    // Rejects the configuration before compiling if it doesn't fit its program as compiled before
+    const auto exceeded_resources = ExceededResources(source, kernel);
+    if (!exceeded_resources.empty()) { throw std::runtime_error(exceeded_resources); }
 
-    // Creates a copy of the output buffer(s)
     #ifdef VERBOSE
-      fprintf(stdout, "%s Creating a copy of the output buffer\n", kMessageVerbose.c_str());
+      fprintf(stdout, "%s Starting compilation\n", kMessageVerbose.c_str());
     #endif
-    for (auto &output: arguments_output_) {
-      switch (output.type) {
-        case MemType::kShort: arguments_output_copy_.push_back(CopyOutputBuffer<short>(output)); break;
-        case MemType::kInt: arguments_output_copy_.push_back(CopyOutputBuffer<int>(output)); break;
-        case MemType::kSizeT: arguments_output_copy_.push_back(CopyOutputBuffer<size_t>(output)); break;
-        case MemType::kHalf: arguments_output_copy_.push_back(CopyOutputBuffer<half>(output)); break;
-        case MemType::kFloat: arguments_output_copy_.push_back(CopyOutputBuffer<float>(output)); break;
-        case MemType::kDouble: arguments_output_copy_.push_back(CopyOutputBuffer<double>(output)); break;
-        case MemType::kFloat2: arguments_output_copy_.push_back(CopyOutputBuffer<float2>(output)); break;
-        case MemType::kDouble2: arguments_output_copy_.push_back(CopyOutputBuffer<double2>(output)); break;
-        default: throw std::runtime_error("Unsupported reference output data-type");
+
+    // Compiles the kernel or retrieves it from the recent programs or the compilation threads
+    Tracer::Span program_span(tracer_.get(), "program");
+    auto program = GetProgram(source);
+    program_span.End();
+    #ifdef VERBOSE
+      fprintf(stdout, "%s Finished compilation\n", kMessageVerbose.c_str());
+    #endif
+
+    // Makes sure the arguments are uploaded: this overlapped with the compilation
+    Tracer::Span transfer_span(tracer_.get(), "transfers");
+    FinishTransfers();
+    transfer_span.End();
+
+    // Creates a copy of the output buffer(s) on the first run. On later runs, the existing copies are
+    // restored with a device-to-device copy queued behind all previous work: this avoids allocating
+    // (large) buffers for every configuration. Output-only buffers are not restored at all.
+    Tracer::Span copy_span(tracer_.get(), "copy outputs");
+    if (arguments_output_copy_.size() == arguments_output_.size()) {
+      #ifdef VERBOSE
+        fprintf(stdout, "%s Restoring the copy of the output buffer\n", kMessageVerbose.c_str());
+      #endif
+      for (auto i=size_t{0}; i<arguments_output_.size(); ++i) {
+        auto &output = arguments_output_[i];
+        auto &copy = arguments_output_copy_[i];
+        if (output.no_restore) { continue; }
+        switch (output.type) {
+          case MemType::kShort: RestoreOutputBuffer<short>(output, copy); break;
+          case MemType::kInt: RestoreOutputBuffer<int>(output, copy); break;
+          case MemType::kSizeT: RestoreOutputBuffer<size_t>(output, copy); break;
+          case MemType::kHalf: RestoreOutputBuffer<half>(output, copy); break;
+          case MemType::kFloat: RestoreOutputBuffer<float>(output, copy); break;
+          case MemType::kDouble: RestoreOutputBuffer<double>(output, copy); break;
+          case MemType::kFloat2: RestoreOutputBuffer<float2>(output, copy); break;
+          case MemType::kDouble2: RestoreOutputBuffer<double2>(output, copy); break;
+          default: throw std::runtime_error("Unsupported reference output data-type");
+        }
       }
     }
+    else {
+      #ifdef VERBOSE
+        fprintf(stdout, "%s Creating a copy of the output buffer\n", kMessageVerbose.c_str());
+      #endif
+      for (auto &mem_info: arguments_output_copy_) {
+        #ifdef USE_OPENCL
+          CheckError(clReleaseMemObject(mem_info.buffer));
+        #else
+          CheckError(cuMemFree(mem_info.buffer));
+        #endif
+      }
+      arguments_output_copy_.clear();
+      for (auto &output: arguments_output_) {
+        switch (output.type) {
+          case MemType::kShort: arguments_output_copy_.push_back(CopyOutputBuffer<short>(output)); break;
+          case MemType::kInt: arguments_output_copy_.push_back(CopyOutputBuffer<int>(output)); break;
+          case MemType::kSizeT: arguments_output_copy_.push_back(CopyOutputBuffer<size_t>(output)); break;
+          case MemType::kHalf: arguments_output_copy_.push_back(CopyOutputBuffer<half>(output)); break;
+          case MemType::kFloat: arguments_output_copy_.push_back(CopyOutputBuffer<float>(output)); break;
+          case MemType::kDouble: arguments_output_copy_.push_back(CopyOutputBuffer<double>(output)); break;
+          case MemType::kFloat2: arguments_output_copy_.push_back(CopyOutputBuffer<float2>(output)); break;
+          case MemType::kDouble2: arguments_output_copy_.push_back(CopyOutputBuffer<double2>(output)); break;
+          default: throw std::runtime_error("Unsupported reference output data-type");
+        }
+      }
+    }
+    copy_span.End();
 
-    // Sets the kernel and its arguments
+    // Sets the kernel and its arguments. A pipeline launches a kernel per stage instead, each with
+    // its own selection of the arguments and its own thread-sizes.
     #ifdef VERBOSE
       fprintf(stdout, "%s Setting kernel arguments\n", kMessageVerbose.c_str());
     #endif
-    auto tune_kernel = Kernel(program, kernel.name());
-    for (auto &i: arguments_input_) { tune_kernel.SetArgument(i.index, i.buffer); }
-    for (auto &i: arguments_output_copy_) { tune_kernel.SetArgument(i.index, i.buffer); }
-    for (auto &i: arguments_int_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_size_t_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_float_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_double_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_float2_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_double2_) { tune_kernel.SetArgument(i.first, i.second); }
-
-    // Sets the global and local thread-sizes
-    auto global = kernel.global();
-    auto local = kernel.local();
-
-    // Makes sure that the global size is a multiple of the local
-    for (auto i=size_t{0}; i<global.size(); ++i) {
-      global[i] = Ceil(global[i], local[i]);
+    struct Launch {
+      Kernel kernel;
+      IntRange global;
+      IntRange local;
+    };
+    auto launches = std::vector<Launch>();
+    if (kernel.IsPipeline()) {
+      for (auto &stage: kernel.stages()) {
+        launches.push_back(Launch{Kernel(program, stage.kernel->name()), stage.global,
+                                  stage.local});
+        SetArguments(launches.back().kernel, kernel, stage.arguments);
+      }
+    }
+    else {
+      launches.push_back(Launch{Kernel(program, kernel.name()), kernel.global(), kernel.local()});
+      SetArguments(launches.back().kernel, kernel, std::vector<size_t>());
     }
 
-    // Verifies the local memory usage of the kernel
-    auto local_mem_usage = tune_kernel.LocalMemUsage(device_);
-    if (!device_.IsLocalMemoryValid(local_mem_usage)) {
-      throw std::runtime_error("Using too much local memory");
+    // Makes sure that the global size is a multiple of the local and stores the resources of the
+    // compiled kernel(s), after which these are verified
+    auto resources = std::vector<KernelResources>();
+    for (auto &launch: launches) {
+      for (auto i=size_t{0}; i<launch.global.size(); ++i) {
+        launch.global[i] = Ceil(launch.global[i], launch.local[i]);
+      }
+      resources.push_back(KernelResources{launch.kernel.LocalMemUsage(device_),
+                                          launch.kernel.MaxWorkGroupSize(device_)});
+    }
+    program_resources_[source] = resources;
+    const auto exceeded_compiled = ExceededResources(source, kernel);
+    if (!exceeded_compiled.empty()) { throw std::runtime_error(exceeded_compiled); }
+
+    // Collects the counters of the compiled kernel(s), the largest values in case of a pipeline
+    auto counters = Counters();
+    if (collect_counters_) {
+      counters = Counters{{"local_memory", 0.0}, {"private_memory", 0.0}, {"registers", 0.0}};
+      for (auto &launch: launches) {
+        const auto values = std::vector<double>{
+          static_cast<double>(launch.kernel.LocalMemUsage(device_)),
+          static_cast<double>(launch.kernel.PrivateMemUsage(device_)),
+          static_cast<double>(launch.kernel.NumRegisters())
+        };
+        for (auto i=size_t{0}; i<values.size(); ++i) {
+          counters[i].second = std::max(counters[i].second, values[i]);
+        }
+      }
     }
 
+    // Launches all kernels back-to-back on the same queue. The events of the earlier kernels of a
+    // pipeline are only used for their timing: the last one completes after all others.
+    const auto launch_all = [&launches, this] (std::vector<Event> &events) {
+      events.clear();
+      for (auto &launch: launches) {
+        events.push_back(Event());
+        launch.kernel.Launch(queue_, launch.global, launch.local, events.back().pointer());
+      }
+    };
+
     // Prepares the kernel
     queue_.Finish();
 
-    // Multiple runs of the kernel to find the minimum execution time
+    auto pruned = false;
+
+    // Gives up on runaway configurations. These are reported with the timeout as their time, which
+    // is a lower bound on their actual time, such that the search method can still use it.
+    const auto timeout = KernelTimeout(best_time);
+    const auto timed_out = [&] () {
+      if (power_meter_) { power_meter_->Stop(); }
+      if (counting) { stop_counting(); }
+      AbandonRuns();
+      fprintf(stdout, "%s Kernel %s timed out after %.1lf ms - %zu out of %zu\n",
+              kMessageFailure.c_str(), kernel.name().c_str(), timeout,
+              configuration_id+1, num_configurations);
+      TunerResult result = {kernel.name(), static_cast<float>(timeout), 0, false, 0, 0,
+                            timing_method_, std::numeric_limits<float>::max(), SampleStatistics{},
+                            false, true, 0.0f, Counters{}};
+      return result;
+    };
+
+    // Runs the kernel a couple of times without measuring to warm-up caches, clocks, and the driver
+    Tracer::Span launch_span(tracer_.get(), "launch");
+    auto events = std::vector<Event>();
+    for (auto t=size_t{0}; t<measurement_policy_.num_warmup_runs; ++t) {
+      launch_all(events);
+      if (!WaitForKernel(events.back(), timeout)) { return timed_out(); }
+    }
+
+    // Multiple runs of the kernel according to the measurement policy. The device-side time is
+    // taken from the profiling events, excluding the launch latency and the host's scheduling jitter.
     fprintf(stdout, "%s Running %s\n", kMessageRun.c_str(), kernel.name().c_str());
-    auto events = std::vector<Event>(num_runs_);
-    auto elapsed_time = std::numeric_limits<float>::max();
-    for (auto t=size_t{0}; t<num_runs_; ++t) {
+    if (power_meter_) { power_meter_->Start(); }
+    if (collect_counters_) {
+      if (counter_hooks_.start) { counter_hooks_.start(kernel.name()); }
+      counting = true;
+    }
+    auto samples = std::vector<float>();
+    auto host_time = std::numeric_limits<float>::max();
+    auto statistics = SampleStatistics{};
+    for (auto t=size_t{0}; t<measurement_policy_.max_runs; ++t) {
       #ifdef VERBOSE
-        fprintf(stdout, "%s Launching kernel (%zu out of %zu for averaging)\n", kMessageVerbose.c_str(),
-                t + 1, num_runs_);
+        fprintf(stdout, "%s Launching kernel (%zu out of at most %zu)\n", kMessageVerbose.c_str(),
+                t + 1, measurement_policy_.max_runs);
       #endif
       const auto start_time = std::chrono::steady_clock::now();
 
       // Runs the kernel (this is the timed part)
-      tune_kernel.Launch(queue_, global, local, events[t].pointer());
-      queue_.Finish(events[t]);
+      launch_all(events);
+      if (!WaitForKernel(events.back(), timeout)) { return timed_out(); }
 
-      // Collects the timing information
+      // Collects the timing information. The device-side time of a pipeline is the sum of the times
+      // of its kernels.
       const auto cpu_timer = std::chrono::steady_clock::now() - start_time;
       const auto cpu_timing = std::chrono::duration<float,std::milli>(cpu_timer).count();
+      auto device_timing = cpu_timing;
+      if (timing_method_ != TimingMethod::kHostClock) {
+        device_timing = 0.0f;
+        for (auto &event: events) { device_timing += event.GetElapsedTime(); }
+      }
       #ifdef VERBOSE
-        fprintf(stdout, "%s Completed kernel in %.2lf ms\n", kMessageVerbose.c_str(), cpu_timing);
+        fprintf(stdout, "%s Completed kernel in %.2lf ms (host: %.2lf ms)\n",
+                kMessageVerbose.c_str(), device_timing, cpu_timing);
       #endif
-      elapsed_time = std::min(elapsed_time, cpu_timing);
+      samples.push_back(device_timing);
+      host_time = std::min(host_time, cpu_timing);
+
+      // Stops early when the measurements are stable enough
+      statistics = ComputeStatistics(samples, measurement_policy_.trimmed_fraction);
+
+      // Stops measuring when even the fastest run so far is much slower than the best-so-far
+      if (IsPruned(statistics, pruning_factor_, best_time)) {
+        pruned = true;
+        break;
+      }
+
+      if (measurement_policy_.target_relative_ci > 0.0 &&
+          samples.size() >= std::max(measurement_policy_.min_runs, size_t{2}) &&
+          statistics.relative_ci <= measurement_policy_.target_relative_ci) {
+        break;
+      }
     }
     queue_.Finish();
+    launch_span.End();
+    const auto elapsed_time = static_cast<float>(SelectStatistic(statistics,
+                                                                 measurement_policy_.statistic));
+
+    // The energy per run follows from the average power (in W) while running and the time (in ms)
+    const auto power = (power_meter_) ? power_meter_->Stop() : 0.0;
+    const auto energy = static_cast<float>(power * elapsed_time);
+    if (counting) {
+      for (auto &counter: stop_counting()) { counters.push_back(counter); }
+    }
 
     // Prints diagnostic information
-    fprintf(stdout, "%s Completed %s (%.1lf ms) - %zu out of %zu\n",
-            kMessageOK.c_str(), kernel.name().c_str(), elapsed_time,
-            configuration_id+1, num_configurations);
+    if (pruned) {
+      fprintf(stdout, "%s Pruned %s after %zu run(s) (%.1lf ms) - %zu out of %zu\n",
+              kMessageWarning.c_str(), kernel.name().c_str(), samples.size(), elapsed_time,
+              configuration_id+1, num_configurations);
+    }
+    else if (timing_method_ == TimingMethod::kBoth) {
+      fprintf(stdout, "%s Completed %s (%.1lf ms, host %.1lf ms) - %zu out of %zu\n",
+              kMessageOK.c_str(), kernel.name().c_str(), elapsed_time, host_time,
+              configuration_id+1, num_configurations);
+    }
+    else {
+      fprintf(stdout, "%s Completed %s (%.1lf ms) - %zu out of %zu\n",
+              kMessageOK.c_str(), kernel.name().c_str(), elapsed_time,
+              configuration_id+1, num_configurations);
+    }
 
-    // Computes the result of the tuning
+    // Computes the result of the tuning (the threads are those of the first kernel of a pipeline)
     auto local_threads = size_t{1};
-    for (auto &item: local) { local_threads *= item; }
-    TunerResult result = {kernel.name(), elapsed_time, local_threads, false, {}};
+    for (auto &item: launches.front().local) { local_threads *= item; }
+    TunerResult result = {kernel.name(), elapsed_time, local_threads, false, 0, 0,
+                          timing_method_, host_time, statistics, pruned, false, energy,
+                          counters};
     return result;
   }
 
   // There was an exception, now return an invalid tuner results
   catch(std::exception& e) {
+    if (power_meter_) {
+      try { power_meter_->Stop(); } catch (...) { } // the run failed already
+    }
+    if (counting) {
+      try { stop_counting(); } catch (...) { }
+    }
     fprintf(stdout, "%s Kernel %s failed\n", kMessageFailure.c_str(), kernel.name().c_str());
     fprintf(stdout, "%s   catched exception: %s\n", kMessageFailure.c_str(), e.what());
-    TunerResult result = {kernel.name(), std::numeric_limits<float>::max(), 0, false, {}};
+    TunerResult result = {kernel.name(), std::numeric_limits<float>::max(), 0, false, 0, 0,
+                          timing_method_, std::numeric_limits<float>::max(), SampleStatistics{},
+                          false, false, 0.0f, Counters{}};
     return result;
   }
 }
 
 // =================================================================================================
 
+// Sets the arguments of a kernel. The positions select the arguments of a stage of a pipeline:
+// argument 'p' of the kernel is the argument added to the tuner at position 'positions[p]'. Without
+// positions, the kernel takes all arguments in the order in which they were added.
+void TunerImpl::SetArguments(Kernel &launch_kernel, const KernelInfo &kernel,
+                             const std::vector<size_t> &positions) const {
+  const auto targets = [&positions] (const size_t index) {
+    if (positions.empty()) { return std::vector<size_t>{index}; }
+    auto result = std::vector<size_t>();
+    for (auto p=size_t{0}; p<positions.size(); ++p) {
+      if (positions[p] == index) { result.push_back(p); }
+    }
+    return result;
+  };
+  for (auto &i: arguments_input_) {
+    for (auto p: targets(i.index)) { launch_kernel.SetArgument(p, i.buffer); }
+  }
+  for (auto &i: arguments_output_copy_) {
+    for (auto p: targets(i.index)) { launch_kernel.SetArgument(p, i.buffer); }
+  }
+  for (auto &i: arguments_int_) {
+    for (auto p: targets(i.first)) { launch_kernel.SetArgument(p, i.second); }
+  }
+  for (auto &i: arguments_size_t_) {
+    for (auto p: targets(i.first)) { launch_kernel.SetArgument(p, i.second); }
+  }
+  for (auto &i: arguments_float_) {
+    for (auto p: targets(i.first)) { launch_kernel.SetArgument(p, i.second); }
+  }
+  for (auto &i: arguments_double_) {
+    for (auto p: targets(i.first)) { launch_kernel.SetArgument(p, i.second); }
+  }
+  for (auto &i: arguments_float2_) {
+    for (auto p: targets(i.first)) { launch_kernel.SetArgument(p, i.second); }
+  }
+  for (auto &i: arguments_double2_) {
+    for (auto p: targets(i.first)) { launch_kernel.SetArgument(p, i.second); }
+  }
+  for (auto &i: arguments_parameter_) {
+    for (auto p: targets(i.first)) {
+      auto is_set = false;
+      for (auto &setting: kernel.arguments()) {
+        if (setting.name != i.second) { continue; }
+        launch_kernel.SetArgument(p, static_cast<int>(setting.value));
+        is_set = true;
+      }
+      if (!is_set) {
+        throw std::runtime_error("Parameter '"+i.second+"' of kernel argument "+
+                                 std::to_string(i.first)+" is not in argument mode");
+      }
+    }
+  }
+}
+
+// =================================================================================================
+
+// Without a timeout, this simply blocks. Otherwise, the event is polled: first by yielding only,
+// such that short kernels are not delayed, and then by sleeping in between.
+bool TunerImpl::WaitForKernel(Event &event, const double timeout) const {
+  if (timeout <= 0.0) {
+    queue_.Finish(event);
+    return true;
+  }
+  queue_.Flush();
+  const auto start_time = std::chrono::steady_clock::now();
+  while (!event.IsComplete()) {
+    const auto elapsed = std::chrono::steady_clock::now() - start_time;
+    const auto elapsed_ms = std::chrono::duration<double,std::milli>(elapsed).count();
+    if (elapsed_ms > timeout) { return false; }
+    if (elapsed_ms < 10.0) { std::this_thread::yield(); }
+    else { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+  }
+  queue_.Finish(event);
+  return true;
+}
+
+// The relative timeout only applies once a successful time is known
+double TunerImpl::KernelTimeout(const float best_time) const {
+  auto timeout = kernel_timeout_;
+  if (relative_kernel_timeout_ > 0.0 && best_time != std::numeric_limits<float>::max()) {
+    const auto relative_timeout = relative_kernel_timeout_ * best_time;
+    timeout = (timeout > 0.0) ? std::min(timeout, relative_timeout) : relative_timeout;
+  }
+  return timeout;
+}
+
+// Results are kept by the position of their kernel rather than its name, which need not be unique
+void TunerImpl::StoreResult(const TunerResult &result) {
+  tuning_results_.push_back(result);
+  if (!result.status) { return; }
+  auto best_time = best_times_.find(result.kernel_id);
+  if (best_time == best_times_.end()) { best_times_[result.kernel_id] = result.time; }
+  else { best_time->second = std::min(best_time->second, result.time); }
+}
+
+// Returns the maximum float if no valid result of the kernel is known yet
+float TunerImpl::BestTime(const size_t kernel_id) const {
+  const auto best_time = best_times_.find(kernel_id);
+  if (best_time == best_times_.end()) { return std::numeric_limits<float>::max(); }
+  return best_time->second;
+}
+
+// Kernels can't be cancelled: the old queue and buffers are released by the driver (OpenCL) or at
+// the end of tuning (all abandoned buffers) once the kernels have finished. The output copies are
+// re-allocated by the next run. To reset the device as well, use isolated execution.
+void TunerImpl::AbandonRuns() {
+  abandoned_buffers_.insert(abandoned_buffers_.end(), arguments_output_copy_.begin(),
+                            arguments_output_copy_.end());
+  arguments_output_copy_.clear();
+  queue_ = Queue(context_, device_);
+}
+
+// =================================================================================================
+
 // Uploads a copy of the output vector to the device. This is done because the output might as well
 // be an input buffer at the same time. Every kernel might override it, so it needs to be updated
 // before each run.
@@ -385,16 +1465,623 @@ TunerImpl::MemArgument TunerImpl::CopyOutputBuffer(MemArgument &argument) {
   auto buffer_copy = Buffer<T>(context_, BufferAccess::kNotOwned, argument.size);
   auto buffer_source = Buffer<T>(argument.buffer);
   buffer_source.CopyTo(queue_, argument.size, buffer_copy);
-  auto result = MemArgument{argument.index, argument.size, argument.type, buffer_copy()};
+  auto result = MemArgument{argument.index, argument.size, argument.type, buffer_copy(),
+                            argument.no_restore, false};
   return result;
 }
 
+// Overwrites an existing copy of an output buffer with the original contents. This is not waited
+// for: the kernel launches are queued behind it.
+template <typename T>
+void TunerImpl::RestoreOutputBuffer(const MemArgument &argument, MemArgument &copy) {
+  auto buffer_copy = Buffer<T>(copy.buffer);
+  auto buffer_source = Buffer<T>(argument.buffer);
+  buffer_source.CopyToAsync(queue_, argument.size, buffer_copy);
+}
+
+// =================================================================================================
+
+// Creates the additional tuners and gives them the same settings and kernel arguments as this one.
+// Devices are driven from different threads, so the compilation and verification of the additional
+// devices take place on their own thread as well.
+void TunerImpl::StartDeviceWorkers() {
+  FinishTransfers();
+  device_workers_.clear();
+  for (auto &device_ids: extra_devices_) {
+    auto worker = std::unique_ptr<TunerImpl>(new TunerImpl(device_ids.first, device_ids.second));
+    worker->measurement_policy_ = measurement_policy_;
+    worker->timing_method_ = timing_method_;
+    worker->collect_counters_ = collect_counters_; // the hooks only apply to this device
+    worker->tracer_ = tracer_; // records the spans of all devices, each on its own thread
+    worker->kernel_timeout_ = kernel_timeout_; // without results, only the absolute one applies
+    worker->has_reference_ = has_reference_;
+    if (binary_cache_) {
+      worker->binary_cache_.reset(new BinaryCache(binary_cache_->directory(), worker->platform_,
+                                                  worker->device_));
+    }
+
+    // Copies the scalar arguments and the device buffers
+    worker->argument_counter_ = argument_counter_;
+    worker->arguments_int_ = arguments_int_;
+    worker->arguments_size_t_ = arguments_size_t_;
+    worker->arguments_float_ = arguments_float_;
+    worker->arguments_double_ = arguments_double_;
+    worker->arguments_float2_ = arguments_float2_;
+    worker->arguments_double2_ = arguments_double2_;
+    worker->arguments_parameter_ = arguments_parameter_;
+    for (auto &input: arguments_input_) {
+      worker->arguments_input_.push_back(CopyArgument(input, *worker));
+    }
+    for (auto &output: arguments_output_) {
+      worker->arguments_output_.push_back(CopyArgument(output, *worker));
+    }
+    worker->output_verifications_ = output_verifications_;
+
+    // Copies the output of the reference kernel, which is stored on the host
+    for (auto i=size_t{0}; i<reference_outputs_.size(); ++i) {
+      switch (arguments_output_[i].type) {
+        case MemType::kShort: CopyReference<short>(i, *worker); break;
+        case MemType::kInt: CopyReference<int>(i, *worker); break;
+        case MemType::kSizeT: CopyReference<size_t>(i, *worker); break;
+        case MemType::kHalf: CopyReference<half>(i, *worker); break;
+        case MemType::kFloat: CopyReference<float>(i, *worker); break;
+        case MemType::kDouble: CopyReference<double>(i, *worker); break;
+        case MemType::kFloat2: CopyReference<float2>(i, *worker); break;
+        case MemType::kDouble2: CopyReference<double2>(i, *worker); break;
+        default: throw std::runtime_error("Unsupported reference output data-type");
+      }
+    }
+    device_workers_.push_back(std::move(worker));
+  }
+
+  // Creating a CUDA context makes it current: switches back to the context of this device
+  #if !USE_OPENCL
+    CheckError(cuCtxSetCurrent(context_()));
+  #endif
+}
+
+// Copies a device buffer of this device to a new buffer on the device of another tuner
+TunerImpl::MemArgument TunerImpl::CopyArgument(const MemArgument &argument, TunerImpl &worker) {
+  switch (argument.type) {
+    case MemType::kShort: return CopyArgument<short>(argument, worker);
+    case MemType::kInt: return CopyArgument<int>(argument, worker);
+    case MemType::kSizeT: return CopyArgument<size_t>(argument, worker);
+    case MemType::kHalf: return CopyArgument<half>(argument, worker);
+    case MemType::kFloat: return CopyArgument<float>(argument, worker);
+    case MemType::kDouble: return CopyArgument<double>(argument, worker);
+    case MemType::kFloat2: return CopyArgument<float2>(argument, worker);
+    case MemType::kDouble2: return CopyArgument<double2>(argument, worker);
+    default: throw std::runtime_error("Unsupported argument data-type");
+  }
+}
+template <typename T>
+TunerImpl::MemArgument TunerImpl::CopyArgument(const MemArgument &argument, TunerImpl &worker) {
+  auto host_buffer = std::vector<T>(argument.size);
+  Buffer<T>(argument.buffer).Read(queue_, argument.size, host_buffer);
+  #if !USE_OPENCL
+    CheckError(cuCtxSetCurrent(worker.context_()));
+  #endif
+  auto device_buffer = Buffer<T>(worker.context_, BufferAccess::kNotOwned, argument.size);
+  device_buffer.Write(worker.queue_, argument.size, host_buffer);
+  worker.queue_.Finish();
+  #if !USE_OPENCL
+    CheckError(cuCtxSetCurrent(context_()));
+  #endif
+  return MemArgument{argument.index, argument.size, argument.type, device_buffer(),
+                     argument.no_restore, false};
+}
+template <typename T>
+void TunerImpl::CopyReference(const size_t i, TunerImpl &worker) const {
+  const auto size = arguments_output_[i].size;
+  const auto reference = static_cast<const T*>(reference_outputs_[i]);
+  auto host_buffer = new T[size];
+  std::copy(reference, reference + size, host_buffer);
+  worker.reference_outputs_.push_back(host_buffer);
+}
+
+// =================================================================================================
+
+// Commands sent from the coordinator to a remote worker
+namespace {
+  const auto kCommandStop = uint64_t{0};
+  const auto kCommandRun = uint64_t{1};
+}
+
+// Accepts all remote workers and sends each of them the serialized tuning specification. A worker
+// which can't be reached is left out, such that tuning continues with the remaining ones.
+void TunerImpl::StartRemoteWorkers() {
+  remote_workers_ = Socket::Accept(distributed_port_, num_remote_workers_);
+  const auto specification = SerializeSpecification();
+  for (auto &worker: remote_workers_) {
+    try {
+      worker->Send(specification);
+    } catch (const Socket::Exception &e) {
+      fprintf(stdout, "%s Remote worker failed (%s): disconnecting\n",
+              kMessageWarning.c_str(), e.what());
+      worker.reset();
+    }
+  }
+}
+
+// Tells the remote workers to stop and disconnects them
+void TunerImpl::StopRemoteWorkers() {
+  auto message = Message();
+  message.WriteInteger(kCommandStop);
+  for (auto &worker: remote_workers_) {
+    if (!worker) { continue; }
+    try { worker->Send(message); } catch (const Socket::Exception&) { }
+  }
+  remote_workers_.clear();
+}
+
+// Sends a single configuration to a remote worker and waits for its result. On failure, the worker
+// is disconnected and an exception is thrown, such that the configuration can be run elsewhere.
+// This is called from the device pool's thread belonging to this worker.
+TunerImpl::TunerResult TunerImpl::RunRemoteKernel(const size_t worker_id, const size_t kernel_id,
+                                                  const size_t configuration_id, const size_t step,
+                                                  const size_t num_configurations) {
+  auto &worker = remote_workers_[worker_id];
+  if (!worker) { throw Socket::Exception("worker "+std::to_string(worker_id)+" is disconnected"); }
+  try {
+    auto result = ExchangeJob(*worker, kernel_id, configuration_id, step, num_configurations);
+    if (result.time != std::numeric_limits<float>::max()) {
+      fprintf(stdout, "%s Completed %s on remote worker %zu (%.1lf ms) - %zu out of %zu\n",
+              kMessageOK.c_str(), result.kernel_name.c_str(), worker_id, result.time,
+              step+1, num_configurations);
+    }
+    return result;
+  } catch (const Message::Exception &e) {
+    worker.reset();
+    throw Socket::Exception(std::string{"malformed reply: "}+e.what());
+  } catch (const Socket::Exception&) {
+    worker.reset();
+    throw;
+  }
+}
+
+// Sends a single configuration to a worker and receives its result, given in the same order as the
+// fields of the TunerResult structure
+TunerImpl::TunerResult TunerImpl::ExchangeJob(Socket &worker, const size_t kernel_id,
+                                              const size_t configuration_id, const size_t step,
+                                              const size_t num_configurations) {
+  auto job = Message();
+  job.WriteInteger(kCommandRun);
+  job.WriteInteger(kernel_id);
+  job.WriteInteger(configuration_id);
+  job.WriteInteger(step);
+  job.WriteInteger(num_configurations);
+  worker.Send(job);
+
+  auto reply = worker.Receive();
+  auto result = TunerResult{};
+  result.kernel_name = kernels_[kernel_id].name();
+  result.time = static_cast<float>(reply.ReadDouble());
+  result.threads = static_cast<size_t>(reply.ReadInteger());
+  result.status = (reply.ReadInteger() != 0);
+  result.kernel_id = kernel_id;
+  result.configuration_id = configuration_id;
+  result.timing_method = static_cast<TimingMethod>(reply.ReadInteger());
+  result.host_time = static_cast<float>(reply.ReadDouble());
+  result.statistics.num_samples = static_cast<size_t>(reply.ReadInteger());
+  result.statistics.minimum = reply.ReadDouble();
+  result.statistics.median = reply.ReadDouble();
+  result.statistics.mean = reply.ReadDouble();
+  result.statistics.trimmed_mean = reply.ReadDouble();
+  result.statistics.standard_deviation = reply.ReadDouble();
+  result.statistics.relative_ci = reply.ReadDouble();
+  result.pruned = (reply.ReadInteger() != 0);
+  result.timed_out = (reply.ReadInteger() != 0);
+  return result;
+}
+
+// =================================================================================================
+
+// The child is started lazily, such that a crashed child is only replaced when there is work left.
+// Failing to start a child is not recoverable and is thus passed on to the caller. The timeout
+// covers the compilation, the runs, and the verification of the configuration.
+TunerImpl::TunerResult TunerImpl::RunIsolated(const size_t kernel_id,
+                                              const size_t configuration_id, const size_t step,
+                                              const size_t num_configurations) {
+  if (!sandbox_->IsRunning()) {
+    try {
+      if (sandbox_specification_.data().empty()) {
+        sandbox_specification_ = SerializeSpecification();
+      }
+      sandbox_->Start();
+      sandbox_->socket().Send(sandbox_specification_);
+    } catch (const Socket::Exception &e) {
+      sandbox_->Kill();
+      throw std::runtime_error(std::string{"Could not start the child process: "}+e.what());
+    }
+  }
+  try {
+    sandbox_->socket().SetTimeout(isolation_timeout_);
+    auto result = ExchangeJob(sandbox_->socket(), kernel_id, configuration_id, step,
+                              num_configurations);
+    if (result.timed_out) {
+      fprintf(stdout, "%s Kernel %s timed out after %.1lf ms: restarting the child process\n",
+              kMessageFailure.c_str(), result.kernel_name.c_str(), result.time);
+      sandbox_->Kill(); // the next configuration starts with a fresh context
+    }
+    else if (result.time != std::numeric_limits<float>::max()) {
+      fprintf(stdout, "%s Completed %s (%.1lf ms) - %zu out of %zu\n",
+              kMessageOK.c_str(), result.kernel_name.c_str(), result.time,
+              step+1, num_configurations);
+    }
+    return result;
+  } catch (const std::runtime_error &e) { // a Socket::Exception or a Message::Exception
+    sandbox_->Kill();
+    fprintf(stdout, "%s Kernel %s crashed or timed out in the child process (%s): restarting it\n",
+            kMessageFailure.c_str(), kernels_[kernel_id].name().c_str(), e.what());
+    TunerResult result = {kernels_[kernel_id].name(), std::numeric_limits<float>::max(), 0, false,
+                          kernel_id, configuration_id, timing_method_,
+                          std::numeric_limits<float>::max(), SampleStatistics{}, false, false,
+                          0.0f, Counters{}};
+    return result;
+  }
+}
+
+// Tells the child to stop (if it is still running) and waits for it to exit
+void TunerImpl::StopIsolated() {
+  if (!sandbox_) { return; }
+  if (sandbox_->IsRunning()) {
+    auto message = Message();
+    message.WriteInteger(kCommandStop);
+    try { sandbox_->socket().Send(message); } catch (const Socket::Exception&) { }
+  }
+  sandbox_->Stop();
+  sandbox_specification_ = Message();
+}
+
+// =================================================================================================
+
+// Serializes everything a worker needs to run configurations: the settings, the tunable kernels
+// with their parameters and thread-size modifiers, the kernel arguments, and the reference output.
+// Constraints are not included: only valid configurations are handed out by the coordinator.
+Message TunerImpl::SerializeSpecification() {
+  FinishTransfers();
+  auto message = Message();
+
+  // Settings
+  message.WriteInteger(measurement_policy_.num_warmup_runs);
+  message.WriteInteger(measurement_policy_.min_runs);
+  message.WriteInteger(measurement_policy_.max_runs);
+  message.WriteDouble(measurement_policy_.target_relative_ci);
+  message.WriteInteger(static_cast<uint64_t>(measurement_policy_.statistic));
+  message.WriteDouble(measurement_policy_.trimmed_fraction);
+  message.WriteInteger(static_cast<uint64_t>(timing_method_));
+  message.WriteDouble(kernel_timeout_);
+  message.WriteInteger(has_reference_ ? 1 : 0);
+
+  // Kernels. The stages of pipelines are sent without their source-code and parameters: these are
+  // part of the pipeline, and only the coordinator checks whether configurations are valid.
+  const auto write_thread_sizes = [&message] (const KernelInfo &kernel) {
+    message.WriteInteger(kernel.global_base().size());
+    for (auto &item: kernel.global_base()) { message.WriteInteger(item); }
+    message.WriteInteger(kernel.local_base().size());
+    for (auto &item: kernel.local_base()) { message.WriteInteger(item); }
+    message.WriteInteger(kernel.thread_size_modifiers().size());
+    for (auto &modifier: kernel.thread_size_modifiers()) {
+      message.WriteInteger(static_cast<uint64_t>(modifier.type));
+      message.WriteInteger(modifier.value.size());
+      for (auto &item: modifier.value) { message.WriteString(item); }
+    }
+  };
+  message.WriteInteger(kernels_.size());
+  for (auto &kernel: kernels_) {
+    message.WriteString(kernel.name());
+    message.WriteString(kernel.source());
+    write_thread_sizes(kernel);
+    message.WriteInteger(kernel.parameters().size());
+    for (auto &parameter: kernel.parameters()) {
+      message.WriteString(parameter.name);
+      message.WriteInteger(parameter.values.size());
+      for (auto &value: parameter.values) { message.WriteInteger(value); }
+      message.WriteInteger(static_cast<uint64_t>(parameter.mode));
+    }
+    message.WriteInteger(kernel.stages().size());
+    for (auto &stage: kernel.stages()) {
+      message.WriteString(stage.kernel->name());
+      write_thread_sizes(*stage.kernel);
+      message.WriteInteger(stage.arguments.size());
+      for (auto &position: stage.arguments) { message.WriteInteger(position); }
+    }
+  }
+
+  // Scalar arguments. Integers are sign-extended, complex values are stored as two doubles.
+  message.WriteInteger(argument_counter_);
+  message.WriteInteger(arguments_int_.size());
+  for (auto &i: arguments_int_) {
+    message.WriteInteger(i.first);
+    message.WriteInteger(static_cast<uint64_t>(static_cast<int64_t>(i.second)));
+  }
+  message.WriteInteger(arguments_size_t_.size());
+  for (auto &i: arguments_size_t_) { message.WriteInteger(i.first); message.WriteInteger(i.second); }
+  message.WriteInteger(arguments_float_.size());
+  for (auto &i: arguments_float_) { message.WriteInteger(i.first); message.WriteDouble(i.second); }
+  message.WriteInteger(arguments_double_.size());
+  for (auto &i: arguments_double_) { message.WriteInteger(i.first); message.WriteDouble(i.second); }
+  message.WriteInteger(arguments_float2_.size());
+  for (auto &i: arguments_float2_) {
+    message.WriteInteger(i.first);
+    message.WriteDouble(i.second.real());
+    message.WriteDouble(i.second.imag());
+  }
+  message.WriteInteger(arguments_double2_.size());
+  for (auto &i: arguments_double2_) {
+    message.WriteInteger(i.first);
+    message.WriteDouble(i.second.real());
+    message.WriteDouble(i.second.imag());
+  }
+  message.WriteInteger(arguments_parameter_.size());
+  for (auto &i: arguments_parameter_) {
+    message.WriteInteger(i.first);
+    message.WriteString(i.second);
+  }
+
+  // Device buffers and the output of the reference kernel (stored on the host)
+  message.WriteInteger(arguments_input_.size());
+  for (auto &input: arguments_input_) { SerializeArgument(input, message); }
+  message.WriteInteger(arguments_output_.size());
+  for (auto &output: arguments_output_) { SerializeArgument(output, message); }
+
+  // The verification of the output buffers. Functions can't be sent: workers fall back to the
+  // default metric for custom verifications.
+  for (auto &verification: output_verifications_) {
+    const auto is_custom = (verification.metric == VerificationMetric::kCustom);
+    message.WriteInteger(static_cast<uint64_t>(is_custom ? VerificationMetric::kAbsoluteSum :
+                                                           verification.metric));
+    message.WriteDouble(is_custom ? 1e-4 : verification.tolerance);
+    message.WriteInteger(verification.num_samples);
+  }
+  message.WriteInteger(reference_outputs_.size());
+  for (auto i=size_t{0}; i<reference_outputs_.size(); ++i) {
+    const auto bytes = arguments_output_[i].size * SizeOf(arguments_output_[i].type);
+    message.WriteString(std::string(static_cast<const char*>(reference_outputs_[i]), bytes));
+  }
+  return message;
+}
+
+// Reverse of the above: sets up this tuner as a worker
+void TunerImpl::DeserializeSpecification(Message &message) {
+
+  // Settings
+  measurement_policy_.num_warmup_runs = static_cast<size_t>(message.ReadInteger());
+  measurement_policy_.min_runs = static_cast<size_t>(message.ReadInteger());
+  measurement_policy_.max_runs = static_cast<size_t>(message.ReadInteger());
+  measurement_policy_.target_relative_ci = message.ReadDouble();
+  measurement_policy_.statistic = static_cast<Statistic>(message.ReadInteger());
+  measurement_policy_.trimmed_fraction = message.ReadDouble();
+  timing_method_ = static_cast<TimingMethod>(message.ReadInteger());
+  kernel_timeout_ = message.ReadDouble();
+  has_reference_ = (message.ReadInteger() != 0);
+
+  // Kernels
+  const auto read_thread_sizes = [&message] (KernelInfo &kernel) {
+    auto global = IntRange(static_cast<size_t>(message.ReadInteger()));
+    for (auto &item: global) { item = static_cast<size_t>(message.ReadInteger()); }
+    auto local = IntRange(static_cast<size_t>(message.ReadInteger()));
+    for (auto &item: local) { item = static_cast<size_t>(message.ReadInteger()); }
+    kernel.set_global_base(global);
+    kernel.set_local_base(local);
+    const auto num_modifiers = message.ReadInteger();
+    for (auto m=uint64_t{0}; m<num_modifiers; ++m) {
+      const auto type = static_cast<KernelInfo::ThreadSizeModifierType>(message.ReadInteger());
+      auto range = StringRange(static_cast<size_t>(message.ReadInteger()));
+      for (auto &item: range) { item = message.ReadString(); }
+      kernel.AddModifier(range, type);
+    }
+  };
+  const auto num_kernels = message.ReadInteger();
+  for (auto k=uint64_t{0}; k<num_kernels; ++k) {
+    const auto name = message.ReadString();
+    const auto source = message.ReadString();
+    auto kernel = KernelInfo(name, source, device_);
+    read_thread_sizes(kernel);
+    const auto num_parameters = message.ReadInteger();
+    for (auto p=uint64_t{0}; p<num_parameters; ++p) {
+      const auto parameter_name = message.ReadString();
+      auto values = std::vector<size_t>(static_cast<size_t>(message.ReadInteger()));
+      for (auto &value: values) { value = static_cast<size_t>(message.ReadInteger()); }
+      const auto mode = static_cast<ParameterMode>(message.ReadInteger());
+      kernel.AddParameter(parameter_name, values, mode);
+    }
+    const auto num_stages = message.ReadInteger();
+    for (auto s=uint64_t{0}; s<num_stages; ++s) {
+      auto stage = KernelInfo(message.ReadString(), std::string{}, device_);
+      read_thread_sizes(stage);
+      auto positions = std::vector<size_t>(static_cast<size_t>(message.ReadInteger()));
+      for (auto &position: positions) { position = static_cast<size_t>(message.ReadInteger()); }
+      kernel.AddStage(stage, positions);
+    }
+    kernels_.push_back(kernel);
+  }
+
+  // Scalar arguments
+  argument_counter_ = static_cast<size_t>(message.ReadInteger());
+  const auto read_index = [&message] () { return static_cast<size_t>(message.ReadInteger()); };
+  const auto num_int = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_int; ++i) {
+    const auto index = read_index();
+    const auto value = static_cast<int>(static_cast<int64_t>(message.ReadInteger()));
+    arguments_int_.push_back({index, value});
+  }
+  const auto num_size_t = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_size_t; ++i) {
+    const auto index = read_index();
+    arguments_size_t_.push_back({index, static_cast<size_t>(message.ReadInteger())});
+  }
+  const auto num_float = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_float; ++i) {
+    const auto index = read_index();
+    arguments_float_.push_back({index, static_cast<float>(message.ReadDouble())});
+  }
+  const auto num_double = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_double; ++i) {
+    const auto index = read_index();
+    arguments_double_.push_back({index, message.ReadDouble()});
+  }
+  const auto num_float2 = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_float2; ++i) {
+    const auto index = read_index();
+    const auto real = static_cast<float>(message.ReadDouble());
+    const auto imag = static_cast<float>(message.ReadDouble());
+    arguments_float2_.push_back({index, float2{real, imag}});
+  }
+  const auto num_double2 = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_double2; ++i) {
+    const auto index = read_index();
+    const auto real = message.ReadDouble();
+    const auto imag = message.ReadDouble();
+    arguments_double2_.push_back({index, double2{real, imag}});
+  }
+  const auto num_parameter = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_parameter; ++i) {
+    const auto index = read_index();
+    arguments_parameter_.push_back({index, message.ReadString()});
+  }
+
+  // Device buffers and the output of the reference kernel
+  const auto num_inputs = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_inputs; ++i) {
+    arguments_input_.push_back(DeserializeArgument(message));
+  }
+  const auto num_outputs = message.ReadInteger();
+  for (auto i=uint64_t{0}; i<num_outputs; ++i) {
+    arguments_output_.push_back(DeserializeArgument(message));
+  }
+  for (auto i=uint64_t{0}; i<num_outputs; ++i) {
+    auto verification = Verification{VerificationMetric::kAbsoluteSum, 1e-4, 0, nullptr};
+    verification.metric = static_cast<VerificationMetric>(message.ReadInteger());
+    verification.tolerance = message.ReadDouble();
+    verification.num_samples = static_cast<size_t>(message.ReadInteger());
+    output_verifications_.push_back(verification);
+  }
+  const auto num_references = message.ReadInteger();
+  for (auto i=size_t{0}; i<num_references; ++i) {
+    const auto bytes = message.ReadString();
+    if (i >= arguments_output_.size() ||
+        bytes.size() != arguments_output_[i].size * SizeOf(arguments_output_[i].type)) {
+      throw std::runtime_error("Invalid reference output in the tuning specification");
+    }
+    auto host_buffer = new char[bytes.size()];
+    std::copy(bytes.begin(), bytes.end(), host_buffer);
+    reference_outputs_.push_back(host_buffer);
+  }
+}
+
+// Device buffers are sent as raw bytes together with their kernel-argument index and data-type
+void TunerImpl::SerializeArgument(const MemArgument &argument, Message &message) {
+  const auto bytes = argument.size * SizeOf(argument.type);
+  auto host_buffer = std::string(bytes, '\0');
+  if (bytes > 0) { Buffer<char>(argument.buffer).Read(queue_, bytes, &host_buffer[0]); }
+  message.WriteInteger(argument.index);
+  message.WriteInteger(argument.size);
+  message.WriteInteger(static_cast<uint64_t>(argument.type));
+  message.WriteInteger(argument.no_restore ? 1 : 0);
+  message.WriteString(host_buffer);
+}
+TunerImpl::MemArgument TunerImpl::DeserializeArgument(Message &message) {
+  const auto index = static_cast<size_t>(message.ReadInteger());
+  const auto size = static_cast<size_t>(message.ReadInteger());
+  const auto type = static_cast<MemType>(message.ReadInteger());
+  const auto no_restore = (message.ReadInteger() != 0);
+  const auto host_buffer = message.ReadString();
+  if (host_buffer.size() != size * SizeOf(type)) {
+    throw std::runtime_error("Invalid device buffer in the tuning specification");
+  }
+  auto device_buffer = Buffer<char>(context_, BufferAccess::kNotOwned, host_buffer.size());
+  if (!host_buffer.empty()) {
+    device_buffer.Write(queue_, host_buffer.size(), host_buffer.data());
+    queue_.Finish();
+  }
+  return MemArgument{index, size, type, device_buffer(), no_restore, false};
+}
+
+// Returns the size in bytes of a single element of a given data-type
+size_t TunerImpl::SizeOf(const MemType type) const {
+  switch (type) {
+    case MemType::kShort: return sizeof(short);
+    case MemType::kInt: return sizeof(int);
+    case MemType::kSizeT: return sizeof(size_t);
+    case MemType::kHalf: return sizeof(half);
+    case MemType::kFloat: return sizeof(float);
+    case MemType::kDouble: return sizeof(double);
+    case MemType::kFloat2: return sizeof(float2);
+    case MemType::kDouble2: return sizeof(double2);
+    default: throw std::runtime_error("Unsupported argument data-type");
+  }
+}
+
+// =================================================================================================
+
+// Connects to the coordinator, receives the tuning specification, and runs the configurations it
+// hands out one by one. Compilation, measurement, and verification are all done locally; only the
+// results are sent back.
+void TunerImpl::RunWorker(const std::string &host, const size_t port) {
+  if (!kernels_.empty() || argument_counter_ != 0) {
+    throw std::runtime_error("A worker receives its kernels and arguments from the coordinator");
+  }
+  PrintHeader("Connecting to coordinator "+host+":"+std::to_string(port));
+  auto coordinator = Socket::Connect(host, port);
+  auto specification = coordinator->Receive();
+  DeserializeSpecification(specification);
+  PrintHeader("Received "+std::to_string(kernels_.size())+" kernel(s): running configurations");
+
+  while (true) {
+    auto job = coordinator->Receive();
+    if (job.ReadInteger() != kCommandRun) { break; }
+    const auto kernel_id = static_cast<size_t>(job.ReadInteger());
+    const auto configuration_id = static_cast<size_t>(job.ReadInteger());
+    const auto step = static_cast<size_t>(job.ReadInteger());
+    const auto num_configurations = static_cast<size_t>(job.ReadInteger());
+    if (kernel_id >= kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
+
+    // Runs the configuration as the coordinator would have done
+    auto kernel = kernels_[kernel_id];
+    const auto configuration = kernel.GetConfiguration(configuration_id);
+    const auto source = SourceWithDefines(kernel, configuration);
+    kernel.ComputeRanges(configuration);
+    auto result = RunKernel(source, kernel, step, num_configurations);
+    result.status = VerifyOutput();
+
+    // Sends back the result (see 'RunRemoteKernel' for the order of the fields)
+    auto reply = Message();
+    reply.WriteDouble(result.time);
+    reply.WriteInteger(result.threads);
+    reply.WriteInteger(result.status ? 1 : 0);
+    reply.WriteInteger(static_cast<uint64_t>(result.timing_method));
+    reply.WriteDouble(result.host_time);
+    reply.WriteInteger(result.statistics.num_samples);
+    reply.WriteDouble(result.statistics.minimum);
+    reply.WriteDouble(result.statistics.median);
+    reply.WriteDouble(result.statistics.mean);
+    reply.WriteDouble(result.statistics.trimmed_mean);
+    reply.WriteDouble(result.statistics.standard_deviation);
+    reply.WriteDouble(result.statistics.relative_ci);
+    reply.WriteInteger(result.pruned ? 1 : 0);
+    reply.WriteInteger(result.timed_out ? 1 : 0);
+    coordinator->Send(reply);
+  }
+}
+
 // =================================================================================================
 
-// Loops over all reference outputs, creates per output a new host buffer and copies the device
-// buffer from the device onto the host. This function is specialised for different data-types.
+// Loops over all reference outputs, creates per output a device copy and a new host buffer and
+// copies the device copy onto the host. This function is specialised for different data-types. The
+// device copy is used for verification on the device and decouples the download, which continues
+// on the copy queue while the first configuration is compiled and run. Host-side users of the
+// reference output call 'FinishTransfers' first.
 void TunerImpl::StoreReferenceOutput() {
   reference_outputs_.clear();
+  for (auto &mem_info: reference_buffers_) {
+    #ifdef USE_OPENCL
+      CheckError(clReleaseMemObject(mem_info.buffer));
+    #else
+      CheckError(cuMemFree(mem_info.buffer));
+    #endif
+  }
+  reference_buffers_.clear();
   for (auto &output_buffer: arguments_output_copy_) {
     switch (output_buffer.type) {
       case MemType::kShort: DownloadReference<short>(output_buffer); break;
@@ -410,11 +2097,19 @@ void TunerImpl::StoreReferenceOutput() {
   }
 }
 template <typename T> void TunerImpl::DownloadReference(MemArgument &device_buffer) {
+  reference_buffers_.push_back(CopyOutputBuffer<T>(device_buffer));
   auto host_buffer = new T[device_buffer.size];
-  Buffer<T>(device_buffer.buffer).Read(queue_, device_buffer.size, host_buffer);
+  Buffer<T>(reference_buffers_.back().buffer).ReadAsync(copy_queue_, device_buffer.size,
+                                                        host_buffer);
   reference_outputs_.push_back(host_buffer);
 }
 
+// Waits for the copy queue and releases the staging buffers
+void TunerImpl::FinishTransfers() {
+  copy_queue_.Finish();
+  staging_buffers_.clear();
+}
+
 // =================================================================================================
 
 // In case there is a reference kernel, this function loops over all outputs, creates per output a
@@ -422,6 +2117,8 @@ template <typename T> void TunerImpl::DownloadReference(MemArgument &device_buff
 // compares the results to the reference output. This function is specialised for different
 // data-types. These functions return "true" if everything is OK, and "false" if there is a warning.
 bool TunerImpl::VerifyOutput() {
+  if (arguments_output_copy_.size() != arguments_output_.size()) { return false; } // not run
+  Tracer::Span span(tracer_.get(), "verify");
   auto status = true;
   if (has_reference_) {
     auto i = size_t{0};
@@ -443,49 +2140,304 @@ bool TunerImpl::VerifyOutput() {
   return status;
 }
 
-// See above comment
+// See above comment. The comparison is done on the device if possible, which is not the case for
+// the ULP and custom metrics.
 template <typename T>
 bool TunerImpl::DownloadAndCompare(MemArgument &device_buffer, const size_t i) {
-  auto l2_norm = 0.0;
+  const auto &verification = output_verifications_[i];
+  auto errors = ErrorStatistics{false, 0.0, 0.0, 0.0, 0.0, 0.0};
+  const auto device_metric = (verification.metric != VerificationMetric::kMaxULP &&
+                              verification.metric != VerificationMetric::kCustom);
+  if (!device_metric || !CompareOnDevice(device_buffer, i, verification.num_samples, errors)) {
+
+    // Downloads the (sampled) results to the host
+    FinishTransfers();
+    const auto blocks = SampleBlocks(device_buffer.size, verification.num_samples);
+    auto num_elements = size_t{0};
+    for (auto &block: blocks) { num_elements += block.second; }
+    std::vector<T> host_buffer(num_elements);
+    auto position = size_t{0};
+    for (auto &block: blocks) {
+      Buffer<T>(device_buffer.buffer).ReadAsync(queue_, block.second, &host_buffer[position],
+                                                block.first);
+      position += block.second;
+    }
+    queue_.Finish();
 
-  // Downloads the results to the host
-  std::vector<T> host_buffer(device_buffer.size);
-  Buffer<T>(device_buffer.buffer).Read(queue_, device_buffer.size, host_buffer);
+    // Converts the values to doubles
+    const auto reference_output = static_cast<const T*>(reference_outputs_[i]);
+    auto reference_values = std::vector<double>();
+    auto result_values = std::vector<double>();
+    position = 0;
+    for (auto &block: blocks) {
+      for (auto j=size_t{0}; j<block.second; ++j) {
+        AppendValues(reference_output[block.first + j], reference_values);
+        AppendValues(host_buffer[position++], result_values);
+      }
+    }
 
-  // Compares the results (L2 norm)
-  T* reference_output = static_cast<T*>(reference_outputs_[i]);
-  for (auto j=size_t{0}; j<device_buffer.size; ++j) {
-    l2_norm += AbsoluteDifference(reference_output[j], host_buffer[j]);
+    // Compares the results using the user-supplied function
+    if (verification.metric == VerificationMetric::kCustom) {
+      if (!verification.function(reference_values, result_values)) {
+        fprintf(stderr, "%s Results differ: custom verification failed\n", kMessageWarning.c_str());
+        return false;
+      }
+      return true;
+    }
+    errors = ComputeErrors(reference_values, result_values, GetPrecision(device_buffer.type));
   }
 
-  // Verifies if everything was OK, if not: print the L2 norm
-  // TODO: Implement a choice of comparisons for the client to choose from
-  if (std::isnan(l2_norm) || l2_norm > kMaxL2Norm) {
-    fprintf(stderr, "%s Results differ: L2 norm is %6.2e\n", kMessageWarning.c_str(), l2_norm);
+  // Verifies if everything was OK, if not: print the value of the metric
+  if (!IsWithinTolerance(errors, verification)) {
+    fprintf(stderr, "%s Results differ: %s is %6.2e (tolerance %6.2e)\n", kMessageWarning.c_str(),
+            MetricName(verification.metric).c_str(), MetricValue(errors, verification.metric),
+            verification.tolerance);
     return false;
   }
   return true;
 }
 
-// Computes the absolute difference
+// Runs the verification kernel, which writes partial results per work-group. These are combined on
+// the host. The kernel for a data-type is compiled on first use only.
+bool TunerImpl::CompareOnDevice(const MemArgument &device_buffer, const size_t i,
+                                const size_t num_samples, ErrorStatistics &errors) {
+  const auto size = device_buffer.size;
+  auto num_blocks = size_t{0};
+  const auto stride = SampleStride(size, num_samples, num_blocks);
+  const auto num_compared = num_blocks * kVerificationBlockSize;
+  const auto max_size = static_cast<size_t>(std::numeric_limits<unsigned int>::max()) / 2;
+  if (size == 0 || size > max_size || num_compared > max_size) { return false; }
+
+  // Retrieves or compiles the verification kernel
+  auto entry = verification_programs_.find(device_buffer.type);
+  if (entry == verification_programs_.end()) {
+    auto program = std::shared_ptr<Program>();
+    const auto source = VerificationSource(device_buffer.type);
+    if (!source.empty()) {
+      try { program = std::make_shared<Program>(CompileProgram(source)); } catch (...) { }
+    }
+    entry = verification_programs_.emplace(device_buffer.type, program).first;
+  }
+  if (!entry->second) { return false; }
+
+  try {
+    if (reference_buffers_.size() != reference_outputs_.size()) { UploadReferenceOutput(); }
+
+    // Runs the kernel with a limited number of work-groups
+    const auto is_double = (device_buffer.type == MemType::kDouble ||
+                            device_buffer.type == MemType::kDouble2);
+    const auto accumulator_size = (is_double) ? sizeof(double) : sizeof(float);
+    const auto num_groups = std::min(CeilDiv(num_compared, kVerificationWorkGroupSize), size_t{256});
+    const auto partials_size = 4 * num_groups * accumulator_size;
+    if (!verification_partials_ || verification_partials_->GetSize() < partials_size) {
+      verification_partials_.reset(new Buffer<char>(context_, partials_size));
+    }
+    auto &partials = *verification_partials_;
+    auto verification_kernel = Kernel(*entry->second, "VerifyOutput");
+    verification_kernel.SetArgument(0, static_cast<unsigned int>(num_compared));
+    verification_kernel.SetArgument(1, static_cast<unsigned int>(stride));
+    verification_kernel.SetArgument(2, static_cast<unsigned int>(size));
+    verification_kernel.SetArgument(3, reference_buffers_[i].buffer);
+    verification_kernel.SetArgument(4, device_buffer.buffer);
+    verification_kernel.SetArgument(5, partials());
+    auto event = Event();
+    verification_kernel.Launch(queue_, {num_groups * kVerificationWorkGroupSize},
+                               {kVerificationWorkGroupSize}, event.pointer());
+    queue_.Finish(event);
+
+    // Combines the results of the work-groups
+    auto host_partials = std::vector<char>(partials_size);
+    partials.Read(queue_, partials_size, host_partials);
+    const auto partial = [&] (const size_t index) {
+      if (is_double) {
+        auto value = 0.0;
+        std::memcpy(&value, &host_partials[index * accumulator_size], sizeof(double));
+        return value;
+      }
+      auto value = 0.0f;
+      std::memcpy(&value, &host_partials[index * accumulator_size], sizeof(float));
+      return static_cast<double>(value);
+    };
+    errors = ErrorStatistics{false, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (auto g=size_t{0}; g<num_groups; ++g) {
+      errors.absolute_sum += partial(4*g);
+      errors.max_absolute = std::max(errors.max_absolute, partial(4*g + 1));
+      errors.squared_sum += partial(4*g + 2);
+      errors.reference_squared_sum += partial(4*g + 3);
+    }
+    errors.has_nan = std::isnan(errors.absolute_sum) || std::isnan(errors.squared_sum);
+    return true;
+  }
+
+  // Disables the device-side comparison for this data-type from now on
+  catch (...) {
+    entry->second.reset();
+    return false;
+  }
+}
+
+// Creates the source of the verification kernel for a data-type, or an empty string if the data-type
+// is not supported: half-precision (which can't be used in the same way with both back-ends) and
+// the integer types (of which the differences aren't exact in single-precision, while double-
+// precision isn't available on all devices). These are compared on the host in double-precision.
+std::string TunerImpl::VerificationSource(const MemType type) const {
+  const auto difference = std::string{"fabs((ACC)(a) - (ACC)(b))"};
+  auto type_name = std::string{};
+  auto accumulator = std::string{"float"};
+  auto components = 1;
+  switch (type) {
+    case MemType::kFloat: type_name = "float"; break;
+    case MemType::kDouble: type_name = "double"; accumulator = "double"; break;
+    case MemType::kFloat2: type_name = "float"; components = 2; break;
+    case MemType::kDouble2: type_name = "double"; accumulator = "double"; components = 2; break;
+    default: return std::string{};
+  }
+  auto source = std::string{};
+  #if USE_OPENCL
+    if (accumulator == "double") { source += "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"; }
+  #endif
+  source += kVerificationDefines;
+  source += "#define TYPE "+type_name+"\n";
+  source += "#define COMPONENTS "+std::to_string(components)+"\n";
+  source += "#define ACC "+accumulator+"\n";
+  source += "#define DIFF(a,b) "+difference+"\n";
+  source += "#define WGS "+std::to_string(kVerificationWorkGroupSize)+"\n";
+  source += "#define BLOCK "+std::to_string(kVerificationBlockSize)+"\n";
+  source += kVerificationKernel;
+  return source;
+}
+
+// Returns the precision of a data-type, used to compute the distance in ULPs
+Precision TunerImpl::GetPrecision(const MemType type) const {
+  switch (type) {
+    case MemType::kHalf: return Precision::kHalf;
+    case MemType::kFloat: case MemType::kFloat2: return Precision::kSingle;
+    case MemType::kDouble: case MemType::kDouble2: return Precision::kDouble;
+    default: return Precision::kInteger;
+  }
+}
+
+// Uploads the output of the reference kernel (stored on the host) to the device
+void TunerImpl::UploadReferenceOutput() {
+  for (auto i=reference_buffers_.size(); i<reference_outputs_.size(); ++i) {
+    const auto &output = arguments_output_[i];
+    const auto bytes = output.size * SizeOf(output.type);
+    auto device_buffer = Buffer<char>(context_, BufferAccess::kNotOwned, bytes);
+    device_buffer.Write(queue_, bytes, static_cast<const char*>(reference_outputs_[i]));
+    reference_buffers_.push_back(MemArgument{output.index, output.size, output.type,
+                                             device_buffer(), false, false});
+  }
+  queue_.Finish();
+}
+
+// Converts a value to one or more doubles
 template <typename T>
-double TunerImpl::AbsoluteDifference(const T reference, const T result) {
-  return fabs(static_cast<double>(reference) - static_cast<double>(result));
+void TunerImpl::AppendValues(const T value, std::vector<double> &values) {
+  values.push_back(static_cast<double>(value));
 }
-template <> double TunerImpl::AbsoluteDifference(const float2 reference, const float2 result) {
-  auto real = fabs(static_cast<double>(reference.real()) - static_cast<double>(result.real()));
-  auto imag = fabs(static_cast<double>(reference.imag()) - static_cast<double>(result.imag()));
-  return real + imag;
+template <> void TunerImpl::AppendValues(const float2 value, std::vector<double> &values) {
+  values.push_back(static_cast<double>(value.real()));
+  values.push_back(static_cast<double>(value.imag()));
 }
-template <> double TunerImpl::AbsoluteDifference(const double2 reference, const double2 result) {
-  auto real = fabs(reference.real() - result.real());
-  auto imag = fabs(reference.imag() - result.imag());
-  return real + imag;
+template <> void TunerImpl::AppendValues(const double2 value, std::vector<double> &values) {
+  values.push_back(value.real());
+  values.push_back(value.imag());
 }
-template <> double TunerImpl::AbsoluteDifference(const half reference, const half result) {
-  const auto reference_float = HalfToFloat(reference);
-  const auto result_float = HalfToFloat(result);
-  return fabs(static_cast<double>(reference_float) - static_cast<double>(result_float));
+template <> void TunerImpl::AppendValues(const half value, std::vector<double> &values) {
+  values.push_back(static_cast<double>(HalfToFloat(value)));
+}
+
+// =================================================================================================
+
+// Creates one of the machine learning models with its learning parameters. Both are trained with
+// the Adam optimizer, which converges in far fewer iterations than plain gradient descent. The
+// debug display outputs the learned data to stdout.
+std::unique_ptr<MLModel<float>> TunerImpl::CreateModel(const Model model_type,
+                                                       const size_t num_features,
+                                                       const bool debug_display) {
+
+  // Linear regression model
+  if (model_type == Model::kLinearRegression) {
+    auto learning_iterations = size_t{400}; // For the optimizer
+    auto learning_rate = 0.05f; // For the optimizer
+    auto lambda = 0.2f; // Regularization parameter
+    return std::unique_ptr<MLModel<float>>(
+      new LinearRegression<float>(learning_iterations, learning_rate, lambda, debug_display,
+                                  Optimizer::kAdam)
+    );
+  }
+
+  // Neural network model
+  if (model_type == Model::kNeuralNetwork) {
+    auto learning_iterations = size_t{400}; // For the optimizer
+    auto learning_rate = 0.05f; // For the optimizer
+    auto lambda = 0.005f; // Regularization parameter
+    auto layers = std::vector<size_t>{num_features, 20, 1};
+    return std::unique_ptr<MLModel<float>>(
+      new NeuralNetwork<float>(learning_iterations, learning_rate, lambda, layers, debug_display,
+                               Optimizer::kAdam)
+    );
+  }
+
+  // Unknown model
+  throw std::runtime_error("Unknown machine learning model");
+}
+
+// =================================================================================================
+
+// Trains the pruning model on the results of the kernel measured so far (see 'IsMeasured'). This
+// happens once enough results are present, and again each time a number of new results came in.
+void TunerImpl::UpdatePruningModel(const size_t kernel_id) {
+  if (pruning_model_warmup_ == 0) { return; }
+  if (pruning_model_measured_ < pruning_model_warmup_) { return; }
+  const auto num_new = pruning_model_measured_ - pruning_model_samples_;
+  if (pruning_model_ && num_new < pruning_model_interval_) { return; }
+  const auto &kernel = kernels_[kernel_id];
+  const auto features = kernel.parameters().size();
+  auto x_train = std::vector<std::vector<float>>();
+  auto y_train = std::vector<float>();
+  for (auto &result: tuning_results_) {
+    if (result.kernel_id != kernel_id || !IsMeasured(result)) { continue; }
+    auto x = std::vector<float>(features);
+    const auto values = kernel.GetValues(result.configuration_id);
+    for (auto f=size_t{0}; f<features && f<values.size(); ++f) {
+      x[f] = static_cast<float>(values[f]);
+    }
+    x_train.push_back(x);
+    y_train.push_back(result.time);
+  }
+  pruning_model_ = CreateModel(pruning_model_type_, features, false);
+  Tracer::Span span(tracer_.get(), "train model");
+  pruning_model_->Train(x_train, y_train);
+  pruning_model_samples_ = x_train.size();
+}
+
+// Keeps the number of measured configurations of the kernel being tuned and its best time so far,
+// such that these don't have to be computed from all results for each configuration
+void TunerImpl::RecordPruningSample(const TunerResult &result) {
+  if (!IsMeasured(result)) { return; }
+  ++pruning_model_measured_;
+  pruning_model_best_ = std::min(pruning_model_best_, result.time);
+}
+
+// Failed, skipped, and pruned configurations don't have a (complete) measurement: the time of a
+// skipped one is the predicted time, which the model must not be trained on
+bool TunerImpl::IsMeasured(const TunerResult &result) {
+  return result.status && !result.pruned && !result.timed_out;
+}
+
+// A configuration is predicted to be slow if its predicted time exceeds the best measured time of
+// the kernel so far by more than the margin
+bool TunerImpl::IsPredictedSlow(const size_t kernel_id, const size_t configuration_id,
+                                float &predicted_time) const {
+  if (!pruning_model_) { return false; }
+  if (pruning_model_best_ == std::numeric_limits<float>::max()) { return false; }
+  auto x = std::vector<float>();
+  for (auto &value: kernels_[kernel_id].GetValues(configuration_id)) {
+    x.push_back(static_cast<float>(value));
+  }
+  predicted_time = pruning_model_->Predict(x);
+  return (predicted_time > pruning_model_best_ * static_cast<float>(1.0 + pruning_model_margin_));
 }
 
 // =================================================================================================
@@ -495,125 +2447,126 @@ void TunerImpl::ModelPrediction(const Model model_type, const float validation_f
                                 const size_t test_top_x_configurations) {
 
   // Iterates over all tunable kernels
-  for (auto &kernel: kernels_) {
-
-    // Retrieves the number of training samples and features
-    auto validation_samples = static_cast<size_t>(tuning_results_.size()*validation_fraction);
-    auto training_samples = tuning_results_.size() - validation_samples;
-    auto features = tuning_results_[0].configuration.size();
+  for (auto kernel_id=size_t{0}; kernel_id<kernels_.size(); ++kernel_id) {
+    auto &kernel = kernels_[kernel_id];
+
+    // Retrieves the measured results of the kernel and the number of training samples and features.
+    // Failed, skipped, and pruned results are left out: their times aren't (complete) measurements.
+    auto results = std::vector<TunerResult>();
+    for (auto &result: tuning_results_) {
+      if (result.kernel_id == kernel_id && IsMeasured(result)) { results.push_back(result); }
+    }
+    auto validation_samples = static_cast<size_t>(results.size()*validation_fraction);
+    auto training_samples = results.size() - validation_samples;
+    auto features = kernel.parameters().size();
 
-    // Sets the raw training and validation data
+    // Sets the raw training and validation data. The features are the parameter values, which are
+    // looked up directly from the configuration indices of the results.
     auto x_train = std::vector<std::vector<float>>(training_samples, std::vector<float>(features));
     auto y_train = std::vector<float>(training_samples);
     for (auto s=size_t{0}; s<training_samples; ++s) {
-      y_train[s] = tuning_results_[s].time;
-      for (auto f=size_t{0}; f<features; ++f) {
-        x_train[s][f] = static_cast<float>(tuning_results_[s].configuration[f].value);
+      const auto &result = results[s];
+      y_train[s] = result.time;
+      const auto values = kernels_[result.kernel_id].GetValues(result.configuration_id);
+      for (auto f=size_t{0}; f<features && f<values.size(); ++f) {
+        x_train[s][f] = static_cast<float>(values[f]);
       }
     }
     auto x_validation = std::vector<std::vector<float>>(validation_samples, std::vector<float>(features));
     auto y_validation = std::vector<float>(validation_samples);
     for (auto s=size_t{0}; s<validation_samples; ++s) {
-      y_validation[s] = tuning_results_[s+training_samples].time;
-      for (auto f=size_t{0}; f<features; ++f) {
-        x_validation[s][f] = static_cast<float>(tuning_results_[s + training_samples].configuration[f].value);
+      const auto &result = results[s + training_samples];
+      y_validation[s] = result.time;
+      const auto values = kernels_[result.kernel_id].GetValues(result.configuration_id);
+      for (auto f=size_t{0}; f<features && f<values.size(); ++f) {
+        x_validation[s][f] = static_cast<float>(values[f]);
       }
     }
 
-    // Pointer to one of the machine learning models
-    std::unique_ptr<MLModel<float>> model;
-
-    // Trains a linear regression model
+    // Trains and validates one of the machine learning models
     if (model_type == Model::kLinearRegression) {
       PrintHeader("Training a linear regression model");
-
-      // Sets the learning parameters
-      auto learning_iterations = size_t{800}; // For gradient descent
-      auto learning_rate = 0.05f; // For gradient descent
-      auto lambda = 0.2f; // Regularization parameter
-      auto debug_display = true; // Output learned data to stdout
-
-      // Trains and validates the model
-      model = std::unique_ptr<MLModel<float>>(
-        new LinearRegression<float>(learning_iterations, learning_rate, lambda, debug_display)
-      );
-      model->Train(x_train, y_train);
-      model->Validate(x_validation, y_validation);
     }
-
-    // Trains a neural network model
     else if (model_type == Model::kNeuralNetwork) {
       PrintHeader("Training a neural network model");
-
-      // Sets the learning parameters
-      auto learning_iterations = size_t{800}; // For gradient descent
-      auto learning_rate = 0.1f; // For gradient descent
-      auto lambda = 0.005f; // Regularization parameter
-      auto debug_display = true; // Output learned data to stdout
-      auto layers = std::vector<size_t>{features, 20, 1};
-
-      // Trains and validates the model
-      model = std::unique_ptr<MLModel<float>>(
-        new NeuralNetwork<float>(learning_iterations, learning_rate, lambda, layers, debug_display)
-      );
-      model->Train(x_train, y_train);
-      model->Validate(x_validation, y_validation);
-    }
-
-    // Unknown model
-    else {
-      throw std::runtime_error("Unknown machine learning model");
     }
+    auto model = CreateModel(model_type, features, true);
+    model->Train(x_train, y_train);
+    model->Validate(x_validation, y_validation);
 
-    // Iterates over all configurations (the permutations of the tuning parameters)
+    // Iterates over all valid configurations (the permutations of the tuning parameters). These
+    // are predicted in blocks: the features of a block are packed into a matrix and predicted at
+    // once. Only the best 'test_top_x_configurations' predictions are kept.
     PrintHeader("Predicting the remaining configurations using the model");
+    const auto is_faster = [](const std::tuple<size_t,float> &t1,
+                              const std::tuple<size_t,float> &t2) {
+      return std::get<1>(t1) < std::get<1>(t2);
+    };
     auto model_results = std::vector<std::tuple<size_t,float>>();
-    auto p = size_t{0};
-    for (auto &permutation: kernel.configurations()) {
+    auto block = std::vector<size_t>();
+    const auto valid_indices = kernel.ValidIndices(0);
+    for (auto v=size_t{0}; v<valid_indices.size(); ++v) {
+      block.push_back(valid_indices[v]);
+      if (block.size() < kPredictionBlockSize && v+1 < valid_indices.size()) { continue; }
+
+      // Runs the trained model to predict the results of the block
+      auto x_test = Matrix<float>(block.size(), features);
+      for (auto b=size_t{0}; b<block.size(); ++b) {
+        const auto values = kernel.GetValues(block[b]);
+        for (auto f=size_t{0}; f<features && f<values.size(); ++f) {
+          x_test[b][f] = static_cast<float>(values[f]);
+        }
+      }
+      const auto predicted_times = model->PredictBatch(x_test);
+      for (auto b=size_t{0}; b<block.size(); ++b) {
+        model_results.push_back(std::make_tuple(block[b], predicted_times[b]));
+      }
+      block.clear();
 
-      // Runs the trained model to predicts the result
-      auto x_test = std::vector<float>();
-      for (auto &setting: permutation) {
-        x_test.push_back(static_cast<float>(setting.value));
+      // Keeps only the best results (in no particular order)
+      if (model_results.size() > test_top_x_configurations) {
+        std::nth_element(model_results.begin(), model_results.begin() + test_top_x_configurations,
+                         model_results.end(), is_faster);
+        model_results.resize(test_top_x_configurations);
       }
-      auto predicted_time = model->Predict(x_test);
-      model_results.push_back(std::make_tuple(p, predicted_time));
-      ++p;
     }
 
-    // Sorts the modelled results by performance
-    std::sort(begin(model_results), end(model_results),
-      [](const std::tuple<size_t,float> &t1, const std::tuple<size_t,float> &t2) {
-        return std::get<1>(t1) < std::get<1>(t2);
-      }
-    );
+    // Sorts the best modelled results by performance
+    std::sort(begin(model_results), end(model_results), is_faster);
 
-    // Tests the best configurations on the device to verify the results
+    // Tests the best configurations on the device to verify the results. All of these are known in
+    // advance, so they can all be handed to the background compilation threads (if enabled).
     PrintHeader("Testing the best-found configurations");
+    if (num_compile_threads_ > 0) {
+      compile_pool_.reset(new CompilePool([this] (const std::string &source) {
+        return CompileProgram(source);
+      }, num_compile_threads_));
+      for (auto i=size_t{0}; i<test_top_x_configurations && i<model_results.size(); ++i) {
+        const auto pid = std::get<0>(model_results[i]);
+        compile_pool_->Enqueue(SourceWithDefines(kernel, kernel.GetConfiguration(pid)));
+      }
+    }
     for (auto i=size_t{0}; i<test_top_x_configurations && i<model_results.size(); ++i) {
       auto result = model_results[i];
       printf("[ -------> ] The model predicted: %.3lf ms\n", std::get<1>(result));
       auto pid = std::get<0>(result);
-      auto permutations = kernel.configurations();
-      auto permutation = permutations[pid];
+      auto permutation = kernel.GetConfiguration(pid);
 
       // Adds the parameters to the source-code string as defines
-      auto source = std::string{};
-      for (auto &config: permutation) {
-        source += config.GetDefine();
-      }
-      source += kernel.source();
+      auto source = SourceWithDefines(kernel, permutation);
 
       // Updates the local range with the parameter values
       kernel.ComputeRanges(permutation);
 
       // Compiles and runs the kernel
-      auto tuning_result = RunKernel(source, kernel, pid, test_top_x_configurations);
+      auto tuning_result = RunKernel(source, kernel, pid, test_top_x_configurations,
+                                     BestTime(kernel_id));
       tuning_result.status = VerifyOutput();
 
       // Stores the parameters and the timing-result
-      tuning_result.configuration = permutation;
-      tuning_results_.push_back(tuning_result);
+      tuning_result.kernel_id = kernel_id;
+      tuning_result.configuration_id = pid;
+      StoreResult(tuning_result);
       if (tuning_result.time == std::numeric_limits<float>::max()) {
         tuning_result.time = 0.0;
         PrintResult(stdout, tuning_result, kMessageFailure);
@@ -623,16 +2576,117 @@ void TunerImpl::ModelPrediction(const Model model_type, const float validation_f
         PrintResult(stdout, tuning_result, kMessageWarning);
       }
     }
+    compile_pool_.reset();
+  }
+}
+
+// =================================================================================================
+
+// The kernel's name and the size of its configuration space are included as well, since the
+// journal refers to configurations by their index
+std::string TunerImpl::JournalIdentity(const KernelInfo &kernel) const {
+  auto identity = kernel.name() + " " + std::to_string(kernel.NumRawConfigurations()) + " " +
+                  std::to_string(static_cast<int>(search_method_));
+  for (auto &search_arg: search_args_) { identity += " " + std::to_string(search_arg); }
+  return identity;
+}
+
+// The dimensions of the base global range, e.g. '1024x512'
+std::string TunerImpl::DatabaseProblem(const KernelInfo &kernel) {
+  auto problem = std::string{};
+  for (auto &size: kernel.global_base()) {
+    if (!problem.empty()) { problem += "x"; }
+    problem += std::to_string(size);
+  }
+  return problem;
+}
+
+// The stored results are converted into configurations of this kernel. Results with a parameter
+// or value which is not (or no longer) part of the kernel, or which violate its constraints, are
+// skipped.
+std::vector<size_t> TunerImpl::WarmStartIndices(const KernelInfo &kernel) const {
+  auto indices = std::vector<size_t>();
+  const auto parameters = kernel.parameters();
+  for (auto &entry: database_->FindAll(kernel.name(), device_.Name(), DatabaseProblem(kernel))) {
+    if (indices.size() == kMaxWarmStartConfigurations) { break; }
+    auto value_indices = std::vector<size_t>();
+    for (auto &parameter: parameters) {
+      auto setting = std::find_if(entry.parameters.begin(), entry.parameters.end(),
+                                  [&parameter] (const std::pair<std::string,size_t> &p) {
+                                    return p.first == parameter.name;
+                                  });
+      if (setting == entry.parameters.end()) { break; }
+      auto value = std::find(parameter.values.begin(), parameter.values.end(), setting->second);
+      if (value == parameter.values.end()) { break; }
+      value_indices.push_back(static_cast<size_t>(value - parameter.values.begin()));
+    }
+    if (value_indices.size() != parameters.size()) { continue; }
+    const auto index = kernel.IndexFromValueIndices(value_indices);
+    if (!kernel.IsValidConfiguration(index)) { continue; }
+    if (std::find(indices.begin(), indices.end(), index) != indices.end()) { continue; }
+    indices.push_back(index);
+  }
+  return indices;
+}
+
+// Stores the best successful result of each kernel with tuning parameters. The database only
+// replaces a stored result if the new one is faster.
+void TunerImpl::StoreInDatabase(const std::vector<TunerResult> &results) {
+  for (auto kernel_id=size_t{0}; kernel_id<kernels_.size(); ++kernel_id) {
+    const auto &kernel = kernels_[kernel_id];
+    if (kernel.parameters().size() == 0) { continue; }
+    auto best = results.end();
+    for (auto it = results.begin(); it != results.end(); ++it) {
+      if (it->kernel_id != kernel_id || !it->status) { continue; }
+      if (best == results.end() || it->time < best->time) { best = it; }
+    }
+    if (best == results.end()) { continue; }
+    const auto configuration = kernel.GetConfiguration(best->configuration_id);
+    auto entry = Database::Entry{device_.Name(), DatabaseProblem(kernel), best->time, {}, ""};
+    for (auto &setting: configuration) {
+      entry.parameters.push_back({setting.name, setting.value});
+    }
+
+    // Refers to the binary of the best configuration, such that it can be shipped as well. It is
+    // only present if it was compiled on this host (and not e.g. by a remote worker).
+    if (binary_cache_) {
+      const auto options = BuildOptions();
+      const auto key = binary_cache_->Key(SourceWithDefines(kernel, configuration),
+                                          std::accumulate(options.begin(), options.end(),
+                                                          std::string{}));
+      auto binary = std::string{};
+      if (binary_cache_->Load(key, binary)) { entry.binary = BinaryCache::Basename(key); }
+    }
+    if (database_->Store(kernel.name(), entry)) {
+      fprintf(stdout, "%s Stored the best result of kernel '%s' in the database\n",
+              kMessageInfo.c_str(), kernel.name().c_str());
+    }
   }
 }
 
 // =================================================================================================
 
+// All fields except for the name of the kernel, which is stored only once per kernel
+Journal::Record TunerImpl::ToRecord(const TunerResult &result) {
+  return Journal::Record{result.kernel_id, result.configuration_id, result.time, result.threads,
+                         result.status, result.timing_method, result.host_time, result.statistics,
+                         result.pruned, result.timed_out, result.energy};
+}
+TunerImpl::TunerResult TunerImpl::FromRecord(const Journal::Record &record) const {
+  return TunerResult{kernels_[record.kernel_id].name(), record.time, record.threads, record.status,
+                     record.kernel_id, record.configuration_id, record.timing_method,
+                     record.host_time, record.statistics, record.pruned, record.timed_out,
+                     record.energy, Counters{}};
+}
+
+// =================================================================================================
+
 // Prints a result by looping over all its configuration parameters
 void TunerImpl::PrintResult(FILE* fp, const TunerResult &result, const std::string &message) const {
   fprintf(fp, "%s %s; ", message.c_str(), result.kernel_name.c_str());
   fprintf(fp, "%8.1lf ms;", result.time);
-  for (auto &setting: result.configuration) {
+  if (power_meter_) { fprintf(fp, "%8.1lf mJ;", result.energy); }
+  for (auto &setting: GetConfiguration(result)) {
     fprintf(fp, "%9s;", setting.GetConfig().c_str());
   }
   fprintf(fp, "\n");
@@ -643,16 +2697,38 @@ void TunerImpl::PrintResult(FILE* fp, const TunerResult &result, const std::stri
 // Finds the best result
 TunerImpl::TunerResult TunerImpl::GetBestResult() const {
   auto best_result = tuning_results_[0];
-  auto best_time = std::numeric_limits<double>::max();
+  auto best_value = std::numeric_limits<double>::max();
   for (auto &tuning_result: tuning_results_) {
-    if (tuning_result.status && best_time >= tuning_result.time) {
+    if (tuning_result.status && best_value >= ObjectiveValue(tuning_result)) {
       best_result = tuning_result;
-      best_time = tuning_result.time;
+      best_value = ObjectiveValue(tuning_result);
     }
   }
   return best_result;
 }
 
+// Failed results stay at the maximum, as do results without an energy measurement (e.g. skipped
+// configurations) if the energy is part of the objective. The weighted objective is computed in the
+// logarithmic domain, such that neither the units nor the magnitudes of the values matter.
+double TunerImpl::ObjectiveValue(const TunerResult &result) const {
+  const auto failed = std::numeric_limits<float>::max();
+  if (result.time == failed) { return failed; }
+  if (objective_ != Objective::kTime && result.energy == 0.0f) { return failed; }
+  switch (objective_) {
+    case Objective::kEnergy: return result.energy;
+    case Objective::kWeighted:
+      return std::exp((1.0 - energy_weight_) * std::log(std::max(result.time, 1e-6f)) +
+                      energy_weight_ * std::log(std::max(result.energy, 1e-6f)));
+    default: return result.time;
+  }
+}
+
+// Looks up the kernel of the result and decodes its configuration index
+KernelInfo::Configuration TunerImpl::GetConfiguration(const TunerResult &result) const {
+  if (result.kernel_id >= kernels_.size()) { return KernelInfo::Configuration{}; }
+  return kernels_[result.kernel_id].GetConfiguration(result.configuration_id);
+}
+
 // =================================================================================================
 
 // Loads a file into a stringstream and returns the result as a string
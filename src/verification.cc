@@ -0,0 +1,169 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the functions to compare an output buffer against the output of the reference
+// kernel (see the header for more information).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/verification.h"
+#include "internal/half.h"
+
+#include <algorithm> // std::max, std::min
+#include <cmath> // std::fabs, std::sqrt, std::isnan
+#include <cstring> // std::memcpy
+#include <cstdint> // int64_t, int32_t, uint64_t
+#include <limits> // std::numeric_limits
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// Converts the bits of IEEE-754 values to integers which are ordered like the values themselves
+namespace {
+  int64_t OrderedBits(const double value) {
+    auto bits = int64_t{0};
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (bits < 0) { bits = std::numeric_limits<int64_t>::min() - bits; }
+    return bits;
+  }
+  int64_t OrderedBits(const float value) {
+    auto bits = int32_t{0};
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (bits < 0) { bits = std::numeric_limits<int32_t>::min() - bits; }
+    return static_cast<int64_t>(bits);
+  }
+  int64_t OrderedBits(const half value) {
+    const auto bits = static_cast<int64_t>(value);
+    return (bits & 0x8000) ? -(bits & 0x7FFF) : bits;
+  }
+
+  // The difference is computed on unsigned integers, where it can't overflow, and only the result
+  // is converted: a double can't hold all 64-bit integers exactly
+  double Distance(const int64_t a, const int64_t b) {
+    const auto low = static_cast<uint64_t>(std::min(a, b));
+    const auto high = static_cast<uint64_t>(std::max(a, b));
+    return static_cast<double>(high - low);
+  }
+}
+
+// The integer representations of adjacent floating-point values differ by exactly one
+double UlpDistance(const double reference, const double result, const Precision precision) {
+  if (std::isnan(reference) || std::isnan(result)) { return std::numeric_limits<double>::infinity(); }
+  switch (precision) {
+    case Precision::kInteger:
+      return std::fabs(reference - result);
+    case Precision::kHalf:
+      return Distance(OrderedBits(FloatToHalf(static_cast<float>(reference))),
+                      OrderedBits(FloatToHalf(static_cast<float>(result))));
+    case Precision::kSingle:
+      return Distance(OrderedBits(static_cast<float>(reference)),
+                      OrderedBits(static_cast<float>(result)));
+    case Precision::kDouble:
+      return Distance(OrderedBits(reference), OrderedBits(result));
+    default: throw std::runtime_error("Unsupported precision");
+  }
+}
+
+// =================================================================================================
+
+// Computes all statistics in a single pass
+ErrorStatistics ComputeErrors(const std::vector<double> &reference,
+                              const std::vector<double> &result, const Precision precision) {
+  if (reference.size() != result.size()) {
+    throw std::runtime_error("Verification requires buffers of equal length");
+  }
+  auto errors = ErrorStatistics{false, 0.0, 0.0, 0.0, 0.0, 0.0};
+  for (auto i=size_t{0}; i<reference.size(); ++i) {
+    const auto difference = std::fabs(reference[i] - result[i]);
+    if (std::isnan(difference)) { errors.has_nan = true; }
+    errors.absolute_sum += difference;
+    errors.max_absolute = std::max(errors.max_absolute, difference);
+    errors.squared_sum += difference * difference;
+    errors.reference_squared_sum += reference[i] * reference[i];
+    errors.max_ulp = std::max(errors.max_ulp, UlpDistance(reference[i], result[i], precision));
+  }
+  return errors;
+}
+
+// Returns the value of the metric. The relative L2 norm is an absolute one for an all-zero
+// reference. NaNs always result in NaN.
+double MetricValue(const ErrorStatistics &errors, const VerificationMetric metric) {
+  if (errors.has_nan) { return std::numeric_limits<double>::quiet_NaN(); }
+  switch (metric) {
+    case VerificationMetric::kAbsoluteSum: return errors.absolute_sum;
+    case VerificationMetric::kRelativeL2:
+      if (errors.reference_squared_sum == 0.0) { return std::sqrt(errors.squared_sum); }
+      return std::sqrt(errors.squared_sum / errors.reference_squared_sum);
+    case VerificationMetric::kMaxAbsolute: return errors.max_absolute;
+    case VerificationMetric::kMaxULP: return errors.max_ulp;
+    default: throw std::runtime_error("The custom verification metric has no value");
+  }
+}
+
+// Note that a NaN value fails the comparison
+bool IsWithinTolerance(const ErrorStatistics &errors, const Verification &verification) {
+  return MetricValue(errors, verification.metric) <= verification.tolerance;
+}
+
+// Returns a human-readable name of a metric, used for printing
+std::string MetricName(const VerificationMetric metric) {
+  switch (metric) {
+    case VerificationMetric::kAbsoluteSum: return "L1 norm";
+    case VerificationMetric::kRelativeL2: return "relative L2 norm";
+    case VerificationMetric::kMaxAbsolute: return "max. absolute error";
+    case VerificationMetric::kMaxULP: return "max. ULP error";
+    default: return "custom metric";
+  }
+}
+
+// =================================================================================================
+
+// Spreads the blocks evenly over the buffer. Without sampling, or if the blocks would overlap, the
+// buffer is compared as a whole.
+size_t SampleStride(const size_t size, const size_t num_samples, size_t &num_blocks) {
+  num_blocks = (size + kVerificationBlockSize - 1) / kVerificationBlockSize;
+  if (num_samples == 0 || num_samples >= size) { return kVerificationBlockSize; }
+  const auto num_sample_blocks = (num_samples + kVerificationBlockSize - 1) / kVerificationBlockSize;
+  const auto stride = size / num_sample_blocks;
+  if (stride <= kVerificationBlockSize) { return kVerificationBlockSize; }
+  num_blocks = num_sample_blocks;
+  return stride;
+}
+
+// As above, but returns the blocks themselves
+std::vector<std::pair<size_t,size_t>> SampleBlocks(const size_t size, const size_t num_samples) {
+  auto num_blocks = size_t{0};
+  const auto stride = SampleStride(size, num_samples, num_blocks);
+  if (stride == kVerificationBlockSize) { return {{0, size}}; }
+  auto blocks = std::vector<std::pair<size_t,size_t>>();
+  for (auto b=size_t{0}; b<num_blocks; ++b) {
+    const auto offset = b * stride;
+    blocks.push_back({offset, std::min(kVerificationBlockSize, size - offset)});
+  }
+  return blocks;
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -0,0 +1,85 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the persistent database of the best tuning results.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "internal/database.h"
+
+#include <fstream> // std::ofstream
+#include <cstdio> // std::remove
+
+// =================================================================================================
+
+SCENARIO("databases keep the best results across runs", "[Database]") {
+  GIVEN("A database with results of a kernel on two devices") {
+    const auto filename = std::string{"cltune_test_database.txt"};
+    using Entry = cltune::Database::Entry;
+    const auto parameters = cltune::Database::Parameters{{"WPT", 4}, {"TS", 16}};
+    {
+      auto database = cltune::Database(filename, false);
+      REQUIRE(database.Store("copy", Entry{"GPU A", "1024", 2.5, parameters, ""}));
+      REQUIRE(database.Store("copy", Entry{"GPU A", "2048", 9.0, parameters, ""}));
+      REQUIRE(database.Store("copy", Entry{"GPU B", "1024", 1.5, parameters, "cltune_b.bin"}));
+      REQUIRE(!database.Store("copy", Entry{"GPU A", "1024", 3.0, {}, ""}));
+      REQUIRE(database.Store("copy", Entry{"GPU A", "1024", 2.0, parameters, ""}));
+    }
+
+    WHEN("it is opened again") {
+      auto database = cltune::Database(filename, false);
+      THEN("the best results are restored exactly") {
+        REQUIRE(database.NumEntries() == 3);
+        auto entry = Entry{};
+        REQUIRE(database.Find("copy", "GPU A", "1024", entry));
+        REQUIRE(entry.time == 2.0);
+        REQUIRE(entry.parameters == parameters);
+        REQUIRE(entry.binary.empty());
+        REQUIRE(database.Find("copy", "GPU B", "1024", entry));
+        REQUIRE(entry.binary == "cltune_b.bin");
+        REQUIRE(!database.Find("copy", "GPU C", "1024", entry));
+        REQUIRE(!database.Find("other", "GPU A", "1024", entry));
+      }
+      THEN("the results of a kernel are ordered by relevance") {
+        const auto entries = database.FindAll("copy", "GPU A", "1024");
+        REQUIRE(entries.size() == 3);
+        REQUIRE(entries[0].problem == "1024");
+        REQUIRE(entries[0].device == "GPU A");
+        REQUIRE(entries[1].problem == "2048");
+        REQUIRE(entries[2].device == "GPU B");
+        REQUIRE(database.FindAll("other", "GPU A", "1024").empty());
+      }
+    }
+    WHEN("it is opened read-only") {
+      auto database = cltune::Database(filename, true);
+      THEN("the results can be found but not stored") {
+        REQUIRE(database.NumEntries() == 3);
+        REQUIRE_THROWS_AS(database.Store("copy", Entry{"GPU C", "1024", 1.0, parameters, ""}),
+                          cltune::Database::Exception);
+        REQUIRE_THROWS_AS(cltune::Database("cltune_test_missing.txt", true),
+                          cltune::Database::Exception);
+      }
+    }
+    WHEN("the last line was cut off") {
+      {
+        std::ofstream file(filename, std::ios::out | std::ios::app);
+        file << "result\tcopy\tGPU C";
+      }
+      auto database = cltune::Database(filename, false);
+      THEN("only the complete entries are restored") {
+        REQUIRE(database.NumEntries() == 3);
+        REQUIRE(database.Store("copy", Entry{"GPU C", "1024", 1.0, parameters, ""}));
+      }
+    }
+    std::remove(filename.c_str());
+  }
+}
+
+// =================================================================================================
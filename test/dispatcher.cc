@@ -0,0 +1,66 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the run-time selection of tuned parameters from a database.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "cltune_dispatch.h"
+#include "internal/database.h"
+
+#include <cstdio> // std::remove
+
+// =================================================================================================
+
+SCENARIO("dispatchers select the nearest tuned result", "[Dispatcher]") {
+  GIVEN("A database with results of a kernel for several problem sizes") {
+    const auto filename = std::string{"cltune_test_dispatcher.txt"};
+    using Entry = cltune::Database::Entry;
+    {
+      auto database = cltune::Database(filename, false);
+      database.Store("gemm", Entry{"GPU A", "256x256", 1.0, {{"MWG", 32}}, "cltune_a.bin"});
+      database.Store("gemm", Entry{"GPU A", "4096x4096", 9.0, {{"MWG", 128}}, ""});
+      database.Store("gemm", Entry{"GPU B", "1024x1024", 2.0, {{"MWG", 64}}, ""});
+      database.Store("gemm", Entry{"GPU A", "1024", 2.0, {{"MWG", 16}}, ""});
+      database.Store("copy", Entry{"GPU A", "1024x1024", 2.0, {{"WPT", 4}}, ""});
+    }
+    auto dispatcher = cltune::Dispatcher(filename, "gemm", "binaries");
+    auto selection = cltune::Dispatcher::Selection{};
+
+    THEN("exact matches are selected together with their binary") {
+      REQUIRE(dispatcher.NumResults() == 4);
+      REQUIRE(dispatcher.Select("GPU A", {256, 256}, selection));
+      REQUIRE(selection.exact);
+      REQUIRE(selection.parameters.at("MWG") == 32);
+      REQUIRE(selection.binary == "binaries/cltune_a.bin");
+      REQUIRE(dispatcher.Select("GPU A", {1024}, selection));
+      REQUIRE(selection.parameters.at("MWG") == 16);
+      REQUIRE(selection.binary.empty());
+    }
+    THEN("other sizes take the nearest size of the same device") {
+      REQUIRE(dispatcher.Select("GPU A", {512, 512}, selection));
+      REQUIRE(!selection.exact);
+      REQUIRE(selection.parameters.at("MWG") == 32);
+      REQUIRE(dispatcher.Select("GPU A", {2048, 4096}, selection));
+      REQUIRE(selection.parameters.at("MWG") == 128);
+    }
+    THEN("other devices are used only if needed") {
+      REQUIRE(dispatcher.Select("GPU C", {1024, 1024}, selection));
+      REQUIRE(!selection.exact);
+      REQUIRE(selection.parameters.at("MWG") == 64);
+      REQUIRE(dispatcher.Select("GPU B", {4096}, selection));
+      REQUIRE(selection.parameters.at("MWG") == 16);
+      REQUIRE(!dispatcher.Select("GPU A", {1, 2, 3}, selection));
+    }
+    std::remove(filename.c_str());
+  }
+}
+
+// =================================================================================================
@@ -0,0 +1,95 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the journal used to resume interrupted tuning runs.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "internal/journal.h"
+
+#include <fstream> // std::ofstream
+#include <limits> // std::numeric_limits
+#include <cstdio> // std::remove
+
+// =================================================================================================
+
+SCENARIO("journals can be written and resumed", "[Journal]") {
+  GIVEN("A journal with a kernel and two results") {
+    const auto filename = std::string{"cltune_test_journal.txt"};
+    const auto statistics = cltune::SampleStatistics{3, 1.2, 1.25, 1.3, 1.25, 0.1, 0.02};
+    auto first = cltune::Journal::Record{0, 7, 1.25f, 256, true, cltune::TimingMethod::kBoth, 1.5f,
+                                         statistics, false, false, 3.5f};
+    auto failed = first;
+    failed.configuration_id = 3;
+    failed.time = std::numeric_limits<float>::max();
+    failed.status = false;
+    failed.pruned = true;
+    failed.timed_out = true;
+    {
+      auto journal = cltune::Journal(filename, false);
+      REQUIRE(journal.StartKernel(0, "kernel 128", 42) == 42);
+      journal.Append(first);
+      journal.Append(failed);
+    }
+
+    WHEN("it is resumed") {
+      auto journal = cltune::Journal(filename, true);
+      THEN("the seed and the results are restored exactly") {
+        REQUIRE(journal.NumResumedRecords() == 2);
+        REQUIRE(journal.StartKernel(0, "kernel 128", 1) == 42);
+        auto record = cltune::Journal::Record{};
+        REQUIRE(journal.Find(0, 7, record));
+        REQUIRE(record.time == first.time);
+        REQUIRE(record.threads == first.threads);
+        REQUIRE(record.status);
+        REQUIRE(record.timing_method == cltune::TimingMethod::kBoth);
+        REQUIRE(record.host_time == first.host_time);
+        REQUIRE(record.statistics.num_samples == 3);
+        REQUIRE(record.statistics.relative_ci == first.statistics.relative_ci);
+        REQUIRE(!record.pruned);
+        REQUIRE(!record.timed_out);
+        REQUIRE(record.energy == first.energy);
+        REQUIRE(journal.Find(0, 3, record));
+        REQUIRE(record.time == std::numeric_limits<float>::max());
+        REQUIRE(!record.status);
+        REQUIRE(record.pruned);
+        REQUIRE(record.timed_out);
+        REQUIRE(!journal.Contains(0, 0));
+        REQUIRE(!journal.Contains(1, 7));
+      }
+      THEN("a different kernel or search is rejected") {
+        REQUIRE_THROWS_AS(journal.StartKernel(0, "kernel 256", 1), cltune::Journal::Exception);
+        REQUIRE(journal.StartKernel(1, "other 2", 5) == 5);
+      }
+    }
+    WHEN("the last line was cut off") {
+      {
+        std::ofstream file(filename, std::ios::out | std::ios::app);
+        file << "result 0 9 1.";
+      }
+      auto journal = cltune::Journal(filename, true);
+      THEN("only the complete records are restored") {
+        REQUIRE(journal.NumResumedRecords() == 2);
+        REQUIRE(!journal.Contains(0, 9));
+      }
+    }
+    WHEN("it is opened without resuming") {
+      { auto journal = cltune::Journal(filename, false); }
+      auto journal = cltune::Journal(filename, true);
+      THEN("the previous results are discarded") {
+        REQUIRE(journal.NumResumedRecords() == 0);
+        REQUIRE(journal.StartKernel(0, "kernel 256", 1) == 1);
+      }
+    }
+    std::remove(filename.c_str());
+  }
+}
+
+// =================================================================================================
@@ -76,6 +76,110 @@ SCENARIO("kernel info objects can be used", "[KernelInfo]") {
       }
     }
 
+    WHEN("the configuration space is indexed") {
+      for (auto &parameter: kExampleParameters) {
+        kernel.AddParameter(parameter.first, parameter.second);
+      }
+      THEN("the number of configurations is the product of the number of values") {
+        REQUIRE(kernel.NumRawConfigurations() == size_t{8});
+      }
+      THEN("each index decodes into a configuration which encodes back into the same index") {
+        for (auto index=size_t{0}; index<kernel.NumRawConfigurations(); ++index) {
+          auto config = kernel.GetConfiguration(index);
+          REQUIRE(config.size() == kExampleParameters.size());
+          REQUIRE(kernel.IndexFromConfiguration(config) == index);
+          REQUIRE(kernel.IndexFromValueIndices(kernel.ValueIndices(index)) == index);
+        }
+      }
+      THEN("the first parameter is the most significant one") {
+        REQUIRE(kernel.GetConfiguration(0)[2].value == size_t{17});
+        REQUIRE(kernel.GetConfiguration(1)[2].value == size_t{3});
+        REQUIRE(kernel.GetConfiguration(4)[0].value == size_t{16});
+      }
+      THEN("values outside of the space are not found") {
+        auto config = kernel.GetConfiguration(0);
+        config[1].value = 5;
+        REQUIRE(kernel.IndexFromConfiguration(config) == kernel.NumRawConfigurations());
+      }
+    }
+
+    WHEN("the valid configurations are enumerated") {
+      kernel.set_global_base({64, 64});
+      kernel.set_local_base({1, 1});
+      kernel.AddParameter("A", {1, 2, 4, 8});
+      kernel.AddConstraint([] (std::vector<size_t> v) { return v[0] <= v[1]; }, {"A", "C"});
+      kernel.AddParameter("B", {1, 2, 3});
+      kernel.AddParameter("C", {1, 2, 4, 8, 16});
+      kernel.AddConstraint([] (std::vector<size_t> v) { return v[0] != v[1]; }, {"B", "A"});
+      kernel.AddModifier({"C", "B"}, cltune::KernelInfo::ThreadSizeModifierType::kLocalMul);
+      kernel.SetLocalMemoryUsage([] (std::vector<size_t> v) { return v[0] * v[1]; }, {"A", "B"});
+      auto expected = std::vector<size_t>();
+      for (auto index=size_t{0}; index<kernel.NumRawConfigurations(); ++index) {
+        if (kernel.IsValidConfiguration(index)) { expected.push_back(index); }
+      }
+      THEN("these are the configurations which pass all checks, in order") {
+        REQUIRE(!expected.empty());
+        REQUIRE(expected.size() < kernel.NumRawConfigurations());
+        for (auto num_threads: {size_t{1}, size_t{3}, size_t{0}}) {
+          REQUIRE(kernel.ValidIndices(num_threads) == expected);
+          REQUIRE(kernel.NumValidConfigurations(num_threads) == expected.size());
+        }
+      }
+      THEN("constraints over arrays of values are checked in the same way") {
+        kernel.AddFixedConstraint([] (const size_t *v) { return v[0] + v[1] != 9; }, {"C", "A"});
+        auto expected_fixed = std::vector<size_t>();
+        for (auto &index: expected) {
+          const auto values = kernel.GetValues(index);
+          if (values[2] + values[0] != 9) { expected_fixed.push_back(index); }
+        }
+        REQUIRE(expected_fixed.size() < expected.size());
+        REQUIRE(kernel.ValidIndices(2) == expected_fixed);
+      }
+      THEN("exceptions of the checks are passed on") {
+        kernel.AddConstraint([] (std::vector<size_t>) -> bool {
+          throw std::runtime_error("constraint failed");
+        }, {"C"});
+        REQUIRE_THROWS(kernel.ValidIndices(4));
+        REQUIRE_THROWS(kernel.IsValidConfiguration(expected.front()));
+      }
+    }
+
+    WHEN("parameters are added to a kernel which uses only some of them") {
+      cltune::KernelInfo used_kernel("name", "#if MWG > 4\n  x = VWM*MWG;\n#endif", device);
+      used_kernel.AddParameter("MWG", {4, 8});
+      used_kernel.AddParameter("WG", {4, 8});
+      used_kernel.AddParameter("VWM_GLOBAL", {1, 2});
+      THEN("only whole identifiers count as usage") {
+        REQUIRE(used_kernel.ParameterInSource("MWG"));
+        REQUIRE(!used_kernel.ParameterInSource("WG"));
+        REQUIRE(!used_kernel.ParameterInSource("VWM_GLOBAL"));
+      }
+      THEN("prepended source-code is taken into account") {
+        used_kernel.PrependSource("#define VECTOR VWM_GLOBAL");
+        REQUIRE(used_kernel.ParameterInSource("VWM_GLOBAL"));
+        REQUIRE(!used_kernel.ParameterInSource("WG"));
+      }
+      THEN("all parameters are used by sources which include files or paste tokens") {
+        cltune::KernelInfo include_kernel("name", "# include \"gemm.h\"\nx = MWG;", device);
+        include_kernel.AddParameter("WG", {4, 8});
+        REQUIRE(include_kernel.ParameterInSource("WG"));
+        REQUIRE(include_kernel.ParameterIsDefine("WG"));
+        used_kernel.PrependSource("#define NAME(a) a##_GLOBAL");
+        REQUIRE(used_kernel.ParameterInSource("WG"));
+      }
+      THEN("parameters passed as kernel arguments are not defined") {
+        used_kernel.AddParameter("VWM", {1, 2}, cltune::ParameterMode::kArgument);
+        REQUIRE(used_kernel.ParameterInSource("VWM"));
+        REQUIRE(!used_kernel.ParameterIsDefine("VWM"));
+        REQUIRE(used_kernel.ParameterIsDefine("MWG"));
+        REQUIRE(!used_kernel.ParameterIsDefine("WG"));
+        used_kernel.ComputeRanges(used_kernel.GetConfiguration(1));
+        REQUIRE(used_kernel.arguments().size() == 1);
+        REQUIRE(used_kernel.arguments()[0].name == "VWM");
+        REQUIRE(used_kernel.arguments()[0].value == size_t{2});
+      }
+    }
+
     WHEN("a configuration is set") {
       cltune::KernelInfo::Configuration config;
       config.push_back(cltune::KernelInfo::Setting({"example_param", 32}));
@@ -0,0 +1,86 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the computation of the statistics of time measurements.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "internal/measurement.h"
+
+#include <limits> // std::numeric_limits
+
+// =================================================================================================
+
+SCENARIO("statistics of time measurements can be computed", "[Measurement]") {
+  GIVEN("An example set of samples with an outlier") {
+    const auto samples = std::vector<float>{3.0f, 1.0f, 2.0f, 100.0f, 4.0f};
+
+    WHEN("the statistics are computed") {
+      const auto statistics = cltune::ComputeStatistics(samples, 0.2);
+      THEN("the basic statistics are correct") {
+        REQUIRE(statistics.num_samples == samples.size());
+        REQUIRE(statistics.minimum == Approx(1.0));
+        REQUIRE(statistics.median == Approx(3.0));
+        REQUIRE(statistics.mean == Approx(22.0));
+      }
+      THEN("the trimmed mean discards the outlier") {
+        REQUIRE(statistics.trimmed_mean == Approx(3.0));
+      }
+      THEN("the selected statistic matches") {
+        REQUIRE(cltune::SelectStatistic(statistics, cltune::Statistic::kMedian) == Approx(3.0));
+        REQUIRE(cltune::SelectStatistic(statistics, cltune::Statistic::kMinimum) == Approx(1.0));
+      }
+      THEN("the confidence interval is wide") {
+        REQUIRE(statistics.relative_ci > 1.0);
+      }
+    }
+  }
+
+  GIVEN("A set of identical samples") {
+    const auto samples = std::vector<float>{2.0f, 2.0f, 2.0f, 2.0f};
+    const auto statistics = cltune::ComputeStatistics(samples, 0.1);
+    THEN("the median of an even number of samples and the interval are correct") {
+      REQUIRE(statistics.median == Approx(2.0));
+      REQUIRE(statistics.standard_deviation == Approx(0.0));
+      REQUIRE(statistics.relative_ci == Approx(0.0));
+    }
+  }
+}
+
+SCENARIO("slow measurements can be pruned", "[Measurement]") {
+  GIVEN("The statistics of a run which is three times slower than the best time so far") {
+    const auto statistics = cltune::ComputeStatistics({3.0f}, 0.0);
+    THEN("it is pruned only if a factor is given and the best time is known") {
+      REQUIRE(cltune::IsPruned(statistics, 2.0, 1.0f));
+      REQUIRE(!cltune::IsPruned(statistics, 4.0, 1.0f));
+      REQUIRE(!cltune::IsPruned(statistics, 2.0, std::numeric_limits<float>::max()));
+    }
+    THEN("it is not pruned when the best time is only known for the relative timeout") {
+      REQUIRE(!cltune::IsPruned(statistics, 0.0, 1.0f));
+    }
+  }
+}
+
+SCENARIO("the Pareto front of two objectives can be computed", "[Measurement]") {
+  GIVEN("Example pairs of times and energies") {
+    const auto points = std::vector<std::pair<double,double>>{
+      {3.0, 1.0}, {1.0, 5.0}, {2.0, 2.0}, {2.5, 3.0}, {1.0, 6.0}, {2.0, 2.0}, {4.0, 1.0}
+    };
+    THEN("only the non-dominated points are on the front, ordered by their time") {
+      const auto front = cltune::ParetoFront(points);
+      REQUIRE(front == std::vector<size_t>({1, 2, 0}));
+    }
+    THEN("an empty set has an empty front") {
+      REQUIRE(cltune::ParetoFront({}).empty());
+    }
+  }
+}
+
+// =================================================================================================
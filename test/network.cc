@@ -0,0 +1,75 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the (de)serialization of the messages used for distributed tuning.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "internal/network.h"
+
+// =================================================================================================
+
+SCENARIO("messages can be written and read back", "[Network]") {
+  GIVEN("A message with integers, doubles, and strings") {
+    auto message = cltune::Message();
+    message.WriteInteger(42);
+    message.WriteDouble(-1.5);
+    message.WriteString("kernel");
+    message.WriteString("");
+    message.WriteInteger(18446744073709551615ULL);
+
+    WHEN("the raw data is read back") {
+      auto received = cltune::Message(message.data());
+      THEN("all values are the same and in order") {
+        REQUIRE(received.ReadInteger() == 42);
+        REQUIRE(received.ReadDouble() == -1.5);
+        REQUIRE(received.ReadString() == "kernel");
+        REQUIRE(received.ReadString() == "");
+        REQUIRE(received.ReadInteger() == 18446744073709551615ULL);
+      }
+      THEN("reading beyond the end throws") {
+        for (auto i=0; i<5; ++i) { received.ReadInteger(); }
+        REQUIRE_THROWS_AS(received.ReadInteger(), cltune::Message::Exception);
+      }
+    }
+  }
+}
+
+// =================================================================================================
+
+#ifndef _WIN32
+SCENARIO("connections can be accepted with a timeout", "[Network]") {
+  GIVEN("A listener on a free port of the loopback interface") {
+    cltune::Listener listener(0, true);
+    REQUIRE(listener.port() != 0);
+
+    WHEN("nobody connects") {
+      THEN("accepting times out") {
+        REQUIRE(listener.Accept(0.01) == nullptr);
+      }
+    }
+    WHEN("a client connects and sends nothing") {
+      auto client = cltune::Socket::Connect("127.0.0.1", listener.port());
+      auto server = listener.Accept(1.0);
+      REQUIRE(server != nullptr);
+      THEN("a message can be sent and receiving with a timeout throws") {
+        auto message = cltune::Message();
+        message.WriteInteger(7);
+        client->Send(message);
+        REQUIRE(server->Receive().ReadInteger() == 7);
+        server->SetTimeout(0.01);
+        REQUIRE_THROWS_AS(server->Receive(), cltune::Socket::Exception);
+      }
+    }
+  }
+}
+#endif
+
+// =================================================================================================
@@ -0,0 +1,59 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the measurement of the average power with a user-supplied sensor.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "internal/power_meter.h"
+
+#include <stdexcept> // std::runtime_error
+#include <atomic> // std::atomic
+#include <thread> // std::this_thread::sleep_for
+
+// =================================================================================================
+
+SCENARIO("power meters measure the average power of a sensor", "[PowerMeter]") {
+  GIVEN("A power meter with a constant sensor") {
+    auto num_reads = size_t{0};
+    cltune::PowerMeter meter([&num_reads] () { ++num_reads; return 150.0; }, 1.0);
+
+    THEN("the average is the constant and the sensor is read while measuring") {
+      REQUIRE(meter.Stop() == Approx(0.0));
+      meter.Start();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      REQUIRE(meter.Stop() == Approx(150.0));
+      REQUIRE(num_reads > 2);
+      meter.Start();
+      REQUIRE(meter.Stop() == Approx(150.0));
+    }
+  }
+  GIVEN("A power meter with a failing sensor") {
+    std::atomic<bool> fail(false);
+    cltune::PowerMeter meter([&fail] () {
+      if (fail) { throw std::runtime_error("sensor failure"); }
+      return 100.0;
+    }, 1.0);
+    THEN("the failure is reported when stopping") {
+      meter.Start();
+      fail = true;
+      REQUIRE_THROWS_AS(meter.Stop(), std::runtime_error);
+      REQUIRE(meter.Stop() == Approx(0.0));
+    }
+  }
+  GIVEN("Invalid settings") {
+    THEN("an exception is thrown") {
+      REQUIRE_THROWS_AS(cltune::PowerMeter(nullptr, 1.0), std::runtime_error);
+      REQUIRE_THROWS_AS(cltune::PowerMeter([] () { return 1.0; }, 0.0), std::runtime_error);
+    }
+  }
+}
+
+// =================================================================================================
@@ -0,0 +1,89 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the batch interface of the Searcher base class.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "internal/searcher.h"
+
+// Settings
+const size_t kPlatformID = 0;
+const size_t kDeviceID = 0;
+
+// =================================================================================================
+
+// A searcher which visits a fixed sequence of configuration indices, all known in advance
+class ScriptedSearcher: public cltune::Searcher {
+ public:
+  ScriptedSearcher(const cltune::KernelInfo &kernel, const std::vector<size_t> &sequence):
+      cltune::Searcher(kernel, 0),
+      sequence_(sequence),
+      position_(0) {
+    index_ = sequence_.front();
+  }
+  cltune::KernelInfo::Configuration GetConfiguration() override {
+    return kernel_.GetConfiguration(index_);
+  }
+  void CalculateNextIndex() override {
+    ++position_;
+    if (position_ < sequence_.size()) { index_ = sequence_[position_]; }
+  }
+  size_t NumConfigurations() override { return sequence_.size(); }
+  Configurations PeekConfigurations(const size_t count) const override {
+    auto configurations = Configurations();
+    for (auto p=position_ + 1; p<sequence_.size() && configurations.size()<count; ++p) {
+      configurations.push_back(kernel_.GetConfiguration(sequence_[p]));
+    }
+    return configurations;
+  }
+  const std::vector<size_t>& explored() const { return explored_indices_; }
+  double time(const size_t index) const { return ExecutionTime(index); }
+ private:
+  std::vector<size_t> sequence_;
+  size_t position_;
+};
+
+// =================================================================================================
+
+SCENARIO("searchers hand out configurations in batches", "[Searcher]") {
+  GIVEN("A search which visits one of the configurations twice") {
+    auto platform = cltune::Platform(kPlatformID);
+    auto device = cltune::Device(platform, kDeviceID);
+    cltune::KernelInfo kernel("name", "source", device);
+    kernel.AddParameter("PARAM", {1, 2, 3, 4, 5, 6, 7, 8});
+    auto searcher = ScriptedSearcher(kernel, {0, 2, 2, 5, 1});
+
+    THEN("the batch stops at the repeat until the first one is reported") {
+      REQUIRE(searcher.RequestConfigurations(5) == std::vector<size_t>({0, 2}));
+      REQUIRE(searcher.NumPendingConfigurations() == 2);
+      searcher.ReportResults({2}, {20.0});
+      REQUIRE(searcher.explored().empty());
+      REQUIRE(searcher.RequestConfigurations(5).empty());
+      searcher.ReportResults({0}, {10.0});
+      REQUIRE(searcher.explored() == std::vector<size_t>({0, 2}));
+      REQUIRE(searcher.NumPendingConfigurations() == 0);
+
+      AND_THEN("results reported out of order are passed on in the order of the search") {
+        REQUIRE(searcher.RequestConfigurations(5) == std::vector<size_t>({2, 5, 1}));
+        searcher.ReportResults({1, 5}, {15.0, 50.0});
+        REQUIRE(searcher.explored() == std::vector<size_t>({0, 2}));
+        searcher.ReportResults({2}, {21.0});
+        REQUIRE(searcher.explored() == std::vector<size_t>({0, 2, 2, 5, 1}));
+        REQUIRE(searcher.time(2) == 21.0);
+        REQUIRE(searcher.time(5) == 50.0);
+        REQUIRE(searcher.time(1) == 15.0);
+        REQUIRE(searcher.RequestConfigurations(5).empty());
+      }
+    }
+  }
+}
+
+// =================================================================================================
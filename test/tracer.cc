@@ -0,0 +1,70 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the recording and the export of the tuner's phases.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "internal/tracer.h"
+
+#include <cstdio> // std::remove
+#include <fstream> // std::ifstream
+#include <sstream> // std::stringstream
+#include <thread> // std::thread
+
+// =================================================================================================
+
+SCENARIO("tracers record and summarise the phases", "[Tracer]") {
+  GIVEN("A tracer with nested spans on two threads") {
+    cltune::Tracer tracer;
+    {
+      cltune::Tracer::Span outer(&tracer, "configuration", "gemm #3");
+      cltune::Tracer::Span inner(&tracer, "compile");
+      inner.End();
+      inner.End(); // ignored: already recorded
+      std::thread([&tracer] () { cltune::Tracer::Span span(&tracer, "compile"); }).join();
+    }
+    cltune::Tracer::Span disabled(nullptr, "verify");
+    disabled.End();
+
+    THEN("each span is recorded once with its thread") {
+      const auto events = tracer.Events();
+      REQUIRE(events.size() == 3);
+      REQUIRE(events[0].name == "compile");
+      REQUIRE(events[0].thread == 0);
+      REQUIRE(events[1].thread == 1);
+      REQUIRE(events[2].name == "configuration");
+      REQUIRE(events[2].detail == "gemm #3");
+      REQUIRE(events[2].start <= events[0].start);
+      REQUIRE(events[2].duration >= events[0].duration);
+    }
+    THEN("the summary groups the spans per phase") {
+      const auto phases = tracer.Summary();
+      REQUIRE(phases.size() == 2);
+      const auto &compile = (phases[0].name == "compile") ? phases[0] : phases[1];
+      REQUIRE(compile.count == 2);
+      REQUIRE(compile.maximum <= compile.total);
+      REQUIRE(tracer.Elapsed() >= compile.maximum);
+    }
+    THEN("the spans are written as a Chrome trace") {
+      const auto filename = std::string{"cltune_test_trace.json"};
+      tracer.WriteChromeTrace(filename);
+      std::ifstream file(filename);
+      std::stringstream contents;
+      contents << file.rdbuf();
+      REQUIRE(contents.str().find("{\"traceEvents\": [") == 0);
+      REQUIRE(contents.str().find("\"name\": \"configuration\"") != std::string::npos);
+      REQUIRE(contents.str().find("\"args\": {\"detail\": \"gemm #3\"}") != std::string::npos);
+      std::remove(filename.c_str());
+    }
+  }
+}
+
+// =================================================================================================
@@ -110,6 +110,81 @@ SCENARIO("kernels can be added", "[Tuner]") {
       }
     }
 
+    WHEN("typed constraints are added") {
+      const auto id = tuner.AddKernelFromString(kernel1, "small_kernel",
+                                                kConfigGlobal, kConfigLocal);
+      tuner.AddParameter(id, kExampleParameter, kExampleParameterValues);
+      const auto always = [] (const std::array<size_t,1> &) { return true; };
+      THEN("these are accepted for existing parameters only") {
+        tuner.AddConstraint(id, [] (const std::array<size_t,1> &v) { return v[0] > 6; },
+                            cltune::ParameterNames(kExampleParameter));
+        tuner.SetLocalMemoryUsage(id, [] (const std::array<size_t,1> &v) { return v[0] * 4; },
+                                  cltune::ParameterNames(kExampleParameter));
+        REQUIRE_THROWS_AS(tuner.AddConstraint(id, always, cltune::ParameterNames("UNKNOWN")),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(tuner.AddConstraint(id + 1, always,
+                                              cltune::ParameterNames(kExampleParameter)),
+                          std::runtime_error);
+      }
+    }
+
+    WHEN("invalid problem sizes are swept") {
+      tuner.AddKernelFromString(kernel1, "small_kernel", kConfigGlobal, kConfigLocal);
+      tuner.AddArgumentScalar(16);
+      THEN("an exception is thrown") {
+        REQUIRE_THROWS_AS(tuner.TuneSizes({}), std::runtime_error);
+        REQUIRE_THROWS_AS(tuner.TuneSizes({cltune::ProblemSize{{128}, {16.0, 32.0}, {}}}),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(tuner.TuneSizes({cltune::ProblemSize{{128}, {}, {256}}}),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(tuner.GetSweepResult(0), std::runtime_error);
+      }
+    }
+
+    WHEN("invalid measurement settings are given") {
+      THEN("an exception is thrown") {
+        REQUIRE_THROWS_AS(tuner.SetNumRuns(0), std::runtime_error);
+        auto policy = cltune::MeasurementPolicy{0, 1, 3, 0.0, cltune::Statistic::kTrimmedMean, 0.1};
+        tuner.SetMeasurementPolicy(policy);
+        policy.trimmed_fraction = -0.1;
+        REQUIRE_THROWS_AS(tuner.SetMeasurementPolicy(policy), std::runtime_error);
+        policy.trimmed_fraction = 0.5;
+        REQUIRE_THROWS_AS(tuner.SetMeasurementPolicy(policy), std::runtime_error);
+      }
+    }
+
+    WHEN("tuning is started in the background with an invalid time budget") {
+      THEN("an exception is thrown") {
+        REQUIRE_THROWS_AS(tuner.TuneAsync(nullptr, -1.0), std::runtime_error);
+      }
+    }
+
+    WHEN("pipelines are added") {
+      const auto first = tuner.AddKernelFromString(kernel1, "small_kernel", kConfigGlobal,
+                                                   kConfigLocal);
+      const auto second = tuner.AddKernelFromString(kernel2, "matvec_reference", kConfigGlobal,
+                                                    kConfigLocal);
+      tuner.AddParameter(first, kExampleParameter, kExampleParameterValues);
+      tuner.AddParameter(second, kExampleParameter, {6, 9});
+      THEN("parameters of the kernels have to match") {
+        REQUIRE_THROWS_AS(tuner.AddPipeline("pipeline", {first, second}, {{}, {}}),
+                          std::runtime_error);
+      }
+      THEN("invalid kernels are not accepted") {
+        REQUIRE_THROWS_AS(tuner.AddPipeline("pipeline", {}, {}), std::runtime_error);
+        REQUIRE_THROWS_AS(tuner.AddPipeline("pipeline", {first, counter + 2}, {{}, {}}),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(tuner.AddPipeline("pipeline", {first}, {}), std::runtime_error);
+      }
+      THEN("pipelines get a new ID and their kernels can't be part of another pipeline") {
+        const auto pipeline = tuner.AddPipeline("pipeline", {first}, {{0}});
+        REQUIRE(pipeline == second + 1);
+        tuner.AddParameter(pipeline, "OTHER_PARAM", {1, 2});
+        REQUIRE_THROWS_AS(tuner.AddPipeline("other", {first}, {{0}}), std::runtime_error);
+        REQUIRE_THROWS_AS(tuner.AddPipeline("other", {pipeline}, {{0}}), std::runtime_error);
+      }
+    }
+
   }
 }
 
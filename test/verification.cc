@@ -0,0 +1,103 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the verification metrics used to compare outputs against the reference.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include "internal/verification.h"
+
+#include <limits>
+#include <cmath>
+
+// =================================================================================================
+
+SCENARIO("outputs can be compared using different metrics", "[Verification]") {
+  GIVEN("A reference and an output with a single small error") {
+    const auto reference = std::vector<double>{1.0, 2.0, 3.0, 4.0};
+    const auto result = std::vector<double>{1.0, 2.0, 3.0, 4.5};
+    const auto errors = cltune::ComputeErrors(reference, result, cltune::Precision::kDouble);
+
+    THEN("the statistics are correct") {
+      REQUIRE(!errors.has_nan);
+      REQUIRE(errors.absolute_sum == Approx(0.5));
+      REQUIRE(errors.max_absolute == Approx(0.5));
+      REQUIRE(errors.squared_sum == Approx(0.25));
+      REQUIRE(errors.reference_squared_sum == Approx(30.0));
+    }
+    THEN("the metrics are compared against the tolerance") {
+      const auto strict = cltune::Verification{cltune::VerificationMetric::kMaxAbsolute, 0.1, 0,
+                                               nullptr};
+      const auto relaxed = cltune::Verification{cltune::VerificationMetric::kRelativeL2, 0.1, 0,
+                                                nullptr};
+      REQUIRE(!cltune::IsWithinTolerance(errors, strict));
+      REQUIRE(cltune::IsWithinTolerance(errors, relaxed));
+    }
+  }
+
+  GIVEN("Two adjacent single-precision values") {
+    const auto value = 1.0f;
+    const auto next = std::nextafter(value, 2.0f);
+    THEN("their distance is a single ULP") {
+      REQUIRE(cltune::UlpDistance(value, next, cltune::Precision::kSingle) == Approx(1.0));
+      REQUIRE(cltune::UlpDistance(-0.0, 0.0, cltune::Precision::kSingle) == Approx(0.0));
+      REQUIRE(cltune::UlpDistance(2.0, 5.0, cltune::Precision::kInteger) == Approx(3.0));
+    }
+  }
+
+  GIVEN("Double-precision values a few ULPs apart") {
+    const auto value = 1.0;
+    auto far = value;
+    for (auto i=0; i<600; ++i) { far = std::nextafter(far, 2.0); }
+    THEN("their distance is counted exactly") {
+      const auto next = std::nextafter(value, 2.0);
+      REQUIRE(cltune::UlpDistance(value, next, cltune::Precision::kDouble) == 1.0);
+      REQUIRE(cltune::UlpDistance(next, std::nextafter(value, 0.0),
+                                  cltune::Precision::kDouble) == 2.0);
+      REQUIRE(cltune::UlpDistance(value, far, cltune::Precision::kDouble) == 600.0);
+      REQUIRE(cltune::UlpDistance(-0.0, 0.0, cltune::Precision::kDouble) == 0.0);
+      REQUIRE(cltune::UlpDistance(-1.0, 1.0, cltune::Precision::kDouble) > 0.0);
+    }
+  }
+
+  GIVEN("An output containing a NaN") {
+    const auto nan = std::numeric_limits<double>::quiet_NaN();
+    const auto errors = cltune::ComputeErrors({1.0, 2.0}, {1.0, nan}, cltune::Precision::kSingle);
+    THEN("verification always fails") {
+      const auto verification = cltune::Verification{cltune::VerificationMetric::kMaxAbsolute,
+                                                     1e9, 0, nullptr};
+      REQUIRE(errors.has_nan);
+      REQUIRE(!cltune::IsWithinTolerance(errors, verification));
+    }
+  }
+}
+
+SCENARIO("large outputs can be sampled", "[Verification]") {
+  GIVEN("A buffer much larger than the number of samples") {
+    const auto blocks = cltune::SampleBlocks(100000, 1000);
+    auto num_elements = size_t{0};
+    for (auto &block: blocks) { num_elements += block.second; }
+    THEN("about the requested number of elements in blocks is compared") {
+      REQUIRE(blocks.size() == 16);
+      REQUIRE(num_elements == 16*cltune::kVerificationBlockSize);
+      REQUIRE(blocks.back().first + blocks.back().second <= 100000);
+    }
+  }
+  GIVEN("A buffer smaller than the number of samples") {
+    const auto blocks = cltune::SampleBlocks(1000, 5000);
+    THEN("the whole buffer is compared") {
+      REQUIRE(blocks.size() == 1);
+      REQUIRE(blocks[0].first == 0);
+      REQUIRE(blocks[0].second == 1000);
+    }
+  }
+}
+
+// =================================================================================================